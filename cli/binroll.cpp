@@ -12,7 +12,38 @@
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_binroll)
+using namespace std;
+using namespace hum;
+
+//
+// The roll of each file is written directly to standard output (see
+// Tool_binroll::run(HumdrumFile&, ostream&)) instead of being collected
+// by the tool first, so memory use depends only on the size of the
+// current input file.
+//
+
+int main(int argc, char** argv) {
+	Tool_binroll interface;
+	if (!interface.process(argc, argv)) {
+		interface.getError(cerr);
+		return -1;
+	}
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	HumdrumFile infile;
+	bool status = true;
+	while (instream.read(infile)) {
+		status &= interface.run(infile, cout);
+		if (interface.hasWarning()) {
+			interface.getWarning(cerr);
+		}
+		if (interface.hasError()) {
+			interface.getError(cerr);
+			return -1;
+		}
+		interface.clearOutput();
+	}
+	return !status;
+}
 
 
 
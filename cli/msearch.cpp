@@ -12,7 +12,38 @@
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_msearch)
+using namespace std;
+using namespace hum;
+
+//
+// When an index is given with the --index option, input files which
+// the index shows to have no matches are removed from the file list
+// before anything is read.  Otherwise this is the same as
+// STREAM_INTERFACE(Tool_msearch).
+//
+
+int main(int argc, char** argv) {
+	Tool_msearch interface;
+	if (!interface.process(argc, argv)) {
+		interface.getError(cerr);
+		return -1;
+	}
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	vector<string> files;
+	interface.getArgList(files);
+	if (!files.empty() && interface.filterFileList(files)) {
+		if (files.empty()) {
+			// no matches in any input file.
+			return 0;
+		}
+		instream.setFileList(files);
+	}
+	if (interface.hasError()) {
+		interface.getError(cerr);
+		return -1;
+	}
+	return runStreamInterface<Tool_msearch>(interface, instream, argc, argv);
+}
 
 
 
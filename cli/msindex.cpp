@@ -0,0 +1,101 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Sun Oct 18 05:08:47 UTC 2026
+// Last Modified: Sun Oct 18 05:08:47 UTC 2026
+// Filename:      msindex.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/cli/msindex.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab nowrap
+//
+// Description:   Create an n-gram index of melodies for msearch, or look up
+//                a music query in an index.  Examples:
+//                   msindex *.krn > corpus.msidx
+//                   msindex -i corpus.msidx -q "cdefg" -l
+//                   msearch --index corpus.msidx -q "cdefg" *.krn
+//
+
+#include "humlib.h"
+#include <iostream>
+
+using namespace hum;
+using namespace std;
+
+int    createIndex  (Options& options);
+int    searchIndex  (Options& options);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|ngram=i:3",  "number of attacks in each index key");
+	options.define("i|index=s",    "index file to search");
+	options.define("q|query=s",    "music query to search for in index");
+	options.define("l|list=b",     "list only the filenames of matches");
+	options.process(argc, argv);
+	if (options.getBoolean("index")) {
+		return searchIndex(options);
+	} else {
+		return createIndex(options);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// createIndex -- Index all input files and print the index.
+//
+
+int createIndex(Options& options) {
+	MSearchIndex index;
+	index.setNgramLength(options.getInteger("ngram"));
+	HumdrumFileStream instream(options);
+	HumdrumFile infile;
+	while (instream.read(infile)) {
+		index.addFile(infile);
+	}
+	index.write(cout);
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// searchIndex -- Print the possible match locations of a query in an
+//     index (filename, voice index and attack index), or just the
+//     filenames with the -l option.
+//
+
+int searchIndex(Options& options) {
+	MSearchIndex index;
+	if (!index.read(options.getString("index"))) {
+		cerr << "Error: cannot read index " << options.getString("index") << endl;
+		return 1;
+	}
+	Tool_msearch msearch;
+	vector<MSearchQueryToken> query;
+	msearch.fillMusicQuery(query, options.getString("query"));
+	vector<MSearchPosting> matches;
+	if (!index.search(query, matches)) {
+		cerr << "Error: query needs at least " << index.getNgramLength()
+		     << " consecutive pitches or rests" << endl;
+		return 1;
+	}
+	int lastfile = -1;
+	for (int i=0; i<(int)matches.size(); i++) {
+		if (options.getBoolean("list")) {
+			if (matches[i].file != lastfile) {
+				cout << index.getFileName(matches[i].file) << endl;
+			}
+		} else {
+			cout << index.getFileName(matches[i].file) << "\t"
+			     << matches[i].voice << "\t" << matches[i].attack << endl;
+		}
+		lastfile = matches[i].file;
+	}
+	return 0;
+}
+
+
@@ -59,13 +59,13 @@ class Convert {
 		static std::string  base40ToIntervalAbbr (int b40);
 		static int     kernToOctaveNumber   (const std::string& kerndata);
 		static int     kernToOctaveNumber   (HTp token)
-				{ return kernToOctaveNumber((std::string)*token); }
+				{ return token->getNoteInfo().octave; }
 		static int     kernToAccidentalCount(const std::string& kerndata);
 		static int     kernToAccidentalCount(HTp token)
-				{ return kernToAccidentalCount((std::string)*token); }
+				{ return token->getNoteInfo().accidentals; }
 		static int     kernToDiatonicPC     (const std::string& kerndata);
 		static int     kernToDiatonicPC     (HTp token)
-				{ return kernToDiatonicPC     ((std::string)*token); }
+				{ return token->getNoteInfo().diatonic; }
 		static char    kernToDiatonicUC     (const std::string& kerndata);
 		static int     kernToDiatonicUC     (HTp token)
 				{ return kernToDiatonicUC     ((std::string)*token); }
@@ -74,26 +74,26 @@ class Convert {
 				{ return kernToDiatonicLC     ((std::string)*token); }
 		static int     kernToBase40PC       (const std::string& kerndata);
 		static int     kernToBase40PC       (HTp token)
-				{ return kernToBase40PC       ((std::string)*token); }
+				{ return token->getNoteInfo().base40PC; }
 		static int     kernToBase12PC       (const std::string& kerndata);
 		static int     kernToBase12PC       (HTp token)
-				{ return kernToBase12PC       ((std::string)*token); }
+				{ return token->getNoteInfo().base12PC; }
 		static int     kernToBase7PC        (const std::string& kerndata) {
 		                                     return kernToDiatonicPC(kerndata); }
 		static int     kernToBase7PC        (HTp token)
-				{ return kernToBase7PC        ((std::string)*token); }
+				{ return token->getNoteInfo().diatonic; }
 		static int     kernToBase40         (const std::string& kerndata);
 		static int     kernToBase40         (HTp token)
-				{ return kernToBase40         ((std::string)*token); }
+				{ return token->getNoteInfo().getBase40(); }
 		static int     kernToBase12         (const std::string& kerndata);
 		static int     kernToBase12         (HTp token)
-				{ return kernToBase12         ((std::string)*token); }
+				{ return token->getNoteInfo().getBase12(); }
 		static int     kernToBase7          (const std::string& kerndata);
 		static int     kernToBase7          (HTp token)
-				{ return kernToBase7          ((std::string)*token); }
+				{ return token->getNoteInfo().getBase7(); }
 		static int     kernToMidiNoteNumber (const std::string& kerndata);
 		static int     kernToMidiNoteNumber(HTp token)
-				{ return kernToMidiNoteNumber((std::string)*token); }
+				{ return token->getNoteInfo().getMidi(); }
 		static std::string  kernToScientificPitch(const std::string& kerndata,
 		                                     std::string flat = "b",
 		                                     std::string sharp = "#",
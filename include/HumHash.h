@@ -102,10 +102,14 @@
 #ifndef _HUMHASH_H_INCLUDED
 #define _HUMHASH_H_INCLUDED
 
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
-#include <map>
 
 namespace hum {
 
@@ -122,15 +126,72 @@ class HumParameter : public std::string {
 		HumdrumToken* origin;
 };
 
-typedef std::map<std::string, std::map<std::string, std::map<std::string, HumParameter> > > MapNNKV;
-typedef std::map<std::string, std::map<std::string, HumParameter> > MapNKV;
-typedef std::map<std::string, HumParameter> MapKV;
+
+// HumParamKey: Namespace 1, namespace 2 and key of a parameter stored as
+// pointers to interned strings (see HumHash::internName()).  Create a
+// HumParamKey once for parameters which are accessed frequently to avoid
+// looking up the namespace and key strings in each access:
+//    static const HumParamKey slurEnd("auto", "slurEnd");
+//    HTp end = token->getValueHTp(slurEnd);
+class HumParamKey {
+	public:
+		explicit       HumParamKey         (const std::string& key);
+		               HumParamKey         (const std::string& ns2,
+		                                    const std::string& key);
+		               HumParamKey         (const std::string& ns1,
+		                                    const std::string& ns2,
+		                                    const std::string& key);
+
+		const std::string& getNamespace1   (void) const { return *m_ns1; }
+		const std::string& getNamespace2   (void) const { return *m_ns2; }
+		const std::string& getKey          (void) const { return *m_key; }
+
+		bool           operator<           (const HumParamKey& key) const;
+
+	private:
+		               HumParamKey         (void) {}
+
+		const std::string* m_ns1;
+		const std::string* m_ns2;
+		const std::string* m_key;
+
+	friend class HumHash;
+};
+
+
+// HumHashEntry: A parameter stored in a HumHash.
+struct HumHashEntry {
+	HumParamKey  name;
+	HumParameter value;
+};
+
+// HumNameCache: Interned names already looked up by one thread, so that
+// the shared list of names only needs to be locked for names which the
+// thread has not seen before.  "missing" holds names which were not in the
+// list when there were "count" interned names.
+struct HumNameCache {
+	std::unordered_map<std::string, const std::string*> found;
+	std::unordered_set<std::string> missing;
+	size_t count = 0;
+};
+
+// HumHashTree: Parameters grouped by namespace 1 and namespace 2, used
+// when printing parameters.
+typedef std::map<std::string, std::map<std::string,
+		std::vector<const HumHashEntry*> > > HumHashTree;
+
 
 class HumHash {
 	public:
 		               HumHash             (void);
+		               HumHash             (const HumHash& hash);
 		              ~HumHash             ();
 
+		HumHash&       operator=           (const HumHash& hash);
+
+		// interned namespace and key strings
+		static const std::string* internName (const std::string& name);
+
 		std::string    getValue            (const std::string& key) const;
 		std::string    getValue            (const std::string& ns2,
 		                                    const std::string& key) const;
@@ -210,6 +271,24 @@ class HumHash {
 		void           deleteValue         (const std::string& ns1, const std::string& ns2,
 		                                    const std::string& key);
 
+		// access by pre-interned namespaces/key
+		std::string    getValue            (const HumParamKey& key) const;
+		HTp            getValueHTp         (const HumParamKey& key) const;
+		int            getValueInt         (const HumParamKey& key) const;
+		HumNum         getValueFraction    (const HumParamKey& key) const;
+		double         getValueFloat       (const HumParamKey& key) const;
+		bool           getValueBool        (const HumParamKey& key) const;
+		void           setValue            (const HumParamKey& key,
+		                                    const std::string& value);
+		void           setValue            (const HumParamKey& key,
+		                                    const char* value);
+		void           setValue            (const HumParamKey& key, int value);
+		void           setValue            (const HumParamKey& key, HTp value);
+		void           setValue            (const HumParamKey& key, HumNum value);
+		void           setValue            (const HumParamKey& key, double value);
+		bool           isDefined           (const HumParamKey& key) const;
+		void           deleteValue         (const HumParamKey& key);
+
 		std::vector<std::string> getKeys   (void) const;
 		std::vector<std::string> getKeys   (const std::string& ns) const;
 		std::vector<std::string> getKeys   (const std::string& ns1,
@@ -259,9 +338,31 @@ class HumHash {
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
+		const HumParameter*      findParameter         (const HumParamKey& key) const;
+		const HumParameter*      findParameter         (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		HumParameter&            insertParameter       (const HumParamKey& key);
+		std::vector<const HumHashEntry*> getSortedEntries (void) const;
+		HumHashTree              getEntryTree          (void) const;
+		static bool              findKey               (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key,
+		                                                HumParamKey& output);
 
 	private:
-		MapNNKV*    parameters;
+		static const std::string*               findName     (const std::string& name);
+		static std::unordered_set<std::string>& getNameList  (void);
+		static std::mutex&                      getNameMutex (void);
+		static std::atomic<size_t>&             getNameCount (void);
+		static HumNameCache&                    getNameCache (void);
+
+	private:
+		// parameters: List of parameters sorted by the addresses of the
+		// interned namespace and key strings.  Allocated when the first
+		// parameter is set.
+		std::vector<HumHashEntry>* parameters;
+
 		std::string prefix;
 
 	friend std::ostream& operator<<(std::ostream& out, const HumHash& hash);
@@ -0,0 +1,88 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Sun Oct 18 02:13:28 UTC 2026
+// Last Modified: Sun Oct 18 12:13:17 UTC 2026
+// Filename:      HumPool.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumPool.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Arena allocator for HumdrumLine and HumdrumToken objects,
+//                which are created in large numbers when reading Humdrum
+//                files.  Each HumdrumFile owns an arena, and its slabs are
+//                returned to the system when the file is cleared.
+//
+
+#ifndef _HUMPOOL_H_INCLUDED
+#define _HUMPOOL_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+
+namespace hum {
+
+// START_MERGE
+
+class HumPoolSlab;
+
+class HumPool {
+	public:
+		                HumPool          (size_t slabsize = 65536);
+		               ~HumPool          ();
+
+		void*           allocate         (size_t size);
+		void            clear            (void);
+
+		static void*    allocateObject   (size_t size);
+		static void     releaseObject    (void* ptr);
+
+	protected:
+		void            addSlab          (void);
+		void            releaseSlab      (void);
+
+	private:
+		                HumPool          (const HumPool& pool);
+		HumPool&        operator=        (const HumPool& pool);
+
+		// m_slabsize: The size in bytes of each slab allocated from the
+		// system.  Objects larger than a quarter of a slab are allocated
+		// individually.
+		size_t m_slabsize;
+
+		// m_slab: The slab which new objects are allocated from.  Other
+		// slabs of the arena are returned to the system when their last
+		// object is deleted.
+		HumPoolSlab* m_slab;
+
+		// m_used: The number of bytes used in m_slab.
+		size_t m_used;
+};
+
+
+
+//////////////////////////////
+//
+// HumPoolScope -- Allocate HumdrumLine and HumdrumToken objects from the
+//    given arena while the scope exists in the current thread.  Outside
+//    of a scope they are allocated individually with the global operator
+//    new.
+//
+
+class HumPoolScope {
+	public:
+		                HumPoolScope     (HumPool& pool);
+		               ~HumPoolScope     ();
+
+	private:
+		HumPool* m_previous;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMPOOL_H_INCLUDED */
+
+
+
@@ -14,8 +14,12 @@
 #ifndef _HUMREGEX_H_INCLUDED
 #define _HUMREGEX_H_INCLUDED
 
+#include <list>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace hum {
@@ -39,6 +43,15 @@ class HumRegex {
 		bool        getGlobal          (void);
 		void        unsetGlobal        (void);
 
+		// precompiling a regular expression for repeated use
+		bool        compile            (const std::string& exp,
+		                                const std::string& options = "");
+
+		// compiled regular expression cache shared by all HumRegex objects
+		static void setCacheSize       (int size);
+		static int  getCacheSize       (void);
+		static void clearCache         (void);
+
 		// replacing
 		std::string&     replaceDestructive (std::string& input, const std::string& replacement,
 		                                const std::string& exp);
@@ -66,6 +79,12 @@ class HumRegex {
 		std::string&      tr                 (std::string& input, const std::string& from,
 		                                const std::string& to);
 
+		// replacing with the compiled regular expression
+		std::string&     replaceDestructive (std::string& input,
+		                                const std::string& replacement);
+		std::string      replaceCopy        (const std::string& input,
+		                                const std::string& replacement);
+
 		// matching (full-string match)
 		bool        match              (const std::string& input, const std::string& exp);
 		bool        match              (const std::string& input, const std::string& exp,
@@ -74,6 +93,10 @@ class HumRegex {
 		bool        match              (const std::string* input, const std::string& exp,
 		                                const std::string& options);
 
+		// matching with the compiled regular expression
+		bool        match              (const std::string& input);
+		bool        match              (const std::string* input);
+
 
 		// searching
 		// http://www.cplusplus.com/reference/regex/regex_search
@@ -95,6 +118,12 @@ class HumRegex {
 		                                const std::string& exp,
 		                                const std::string& options);
 
+		// searching with the compiled regular expression
+		int         search             (const std::string& input);
+		int         search             (const std::string& input, int startindex);
+		int         search             (std::string* input);
+		int         search             (std::string* input, int startindex);
+
 		int         getMatchCount      (void);
 		std::string getMatch           (int index);
 		int         getMatchInt        (int index);
@@ -115,17 +144,40 @@ class HumRegex {
 				getTemporaryRegexFlags(const std::string& sflags);
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
+		void        setRegex           (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
+		static std::shared_ptr<const std::regex>
+				getCachedRegex(const std::string& exp,
+				               std::regex_constants::syntax_option_type flags);
 
 
 	private:
+		struct RegexCache;
+		static RegexCache& getRegexCache (void);
+
 
 		// m_regex: stores the regular expression to use as a default.
+		// Compiled regular expressions are shared with other HumRegex
+		// objects through the cache in getCachedRegex(), so they must
+		// not be modified.
 		//
 		// http://en.cppreference.com/w/cpp/regex/basic_regex
-		// .assign(string) == set the regular expression.
-		// operator=       == set the regular expression.
 		// .flags()        == return syntax_option_type used to construct.
-		std::regex m_regex;
+		std::shared_ptr<const std::regex> m_regex;
+
+		// m_pattern: the string used to create m_regex, and
+		// m_patternflags: the flags used to create m_regex.  Used to avoid
+		// looking up the regular expression in the cache when the same
+		// expression is used repeatedly.
+		std::string m_pattern;
+		std::regex_constants::syntax_option_type m_patternflags;
+
+		// m_compiled: the regular expression given to compile() or to the
+		// constructor, which is used by the search/match/replace functions
+		// that do not take an expression parameter, and
+		// m_compiledflags: the search flags given with that expression.
+		std::shared_ptr<const std::regex> m_compiled;
+		std::regex_constants::match_flag_type m_compiledflags;
 
 		// m_matches: stores the matches from a search:
 		//
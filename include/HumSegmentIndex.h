@@ -0,0 +1,108 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Sun Oct 18 04:38:15 UTC 2026
+// Last Modified: Sun Oct 18 14:10:40 UTC 2026
+// Filename:      HumSegmentIndex.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumSegmentIndex.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Index of the byte ranges of !!!!SEGMENT: records in a file
+//                containing many concatenated Humdrum files, so that
+//                individual segments can be read without parsing the
+//                rest of the file.  The index can be saved to a sidecar
+//                file and loaded again later.
+//
+
+#ifndef _HUMSEGMENTINDEX_H_INCLUDED
+#define _HUMSEGMENTINDEX_H_INCLUDED
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumSegmentIndex {
+	public:
+		                   HumSegmentIndex    (void);
+		                   HumSegmentIndex    (const std::string& archive);
+		                  ~HumSegmentIndex    ();
+
+		void               clear              (void);
+		bool               build              (const std::string& archive);
+		bool               read               (const std::string& indexfile);
+		bool               read               (std::istream& input);
+		bool               write              (const std::string& indexfile) const;
+		std::ostream&      write              (std::ostream& out) const;
+		bool               isCurrent          (void) const;
+
+		const std::string& getArchive         (void) const;
+		void               setArchive         (const std::string& archive);
+		int64_t            getArchiveSize     (void) const;
+
+		int                getSegmentCount    (void) const;
+		int                getSegmentIndex    (const std::string& name) const;
+		const std::string& getSegmentName     (int index) const;
+		int                getSegmentLevel    (int index) const;
+		int64_t            getSegmentOffset   (int index) const;
+		int64_t            getSegmentSize     (int index) const;
+		const std::vector<std::string>& getSegmentUniversals(int index) const;
+
+		static std::string getSidecarName     (const std::string& archive);
+
+	protected:
+		void               addSegment         (const std::string& line,
+		                                       int64_t offset,
+		                                       int universals);
+		void               buildNameIndex     (void);
+		static int64_t     getFileTime        (const std::string& filename);
+
+	private:
+		struct Segment {
+			std::string name;       // filename from the !!!!SEGMENT: record
+			int         level;      // segment level (+/- number before colon)
+			int64_t     offset;     // byte offset of the !!!!SEGMENT: line
+			int64_t     size;       // number of bytes in the segment
+			int         universals; // index in m_universals, or -1 if none
+		};
+
+		// m_archive: The filename of the concatenated Humdrum files.
+		std::string m_archive;
+
+		// m_archivesize: The size of the archive when it was indexed, used
+		// to check if the index needs to be rebuilt.
+		int64_t m_archivesize = 0;
+
+		// m_archivetime: The modification time of the archive when it was
+		// indexed (or 0 if not known), also used to check if the index
+		// needs to be rebuilt.
+		int64_t m_archivetime = 0;
+
+		// m_universals: The sets of universal comments which are applied
+		// to segments when reading the archive with HumdrumFileStream.
+		// Segments which are read with the same universal comments share
+		// one entry.
+		std::vector<std::vector<std::string>> m_universals;
+
+		// m_segments: The list of segments in the order of the archive.
+		std::vector<Segment> m_segments;
+
+		// m_names: Lookup table for segment indexes by name.  The first
+		// segment is used if names are repeated.
+		std::unordered_map<std::string, int> m_names;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMSEGMENTINDEX_H_INCLUDED */
+
+
+
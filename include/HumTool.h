@@ -15,9 +15,16 @@
 
 #include "Options.h"
 #include "HumdrumFileSet.h"
+#include "HumdrumFileStream.h"
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace hum {
 
@@ -56,6 +63,10 @@ class HumTool : public Options {
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
 
+		bool          hasModifiedStructure (void);
+		void          setModifiedStructure (void);
+		int           getAnalysisLevel     (void);
+
 	protected:
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
@@ -65,9 +76,232 @@ class HumTool : public Options {
 
 		bool m_suppress = false;
 
+		// m_modified_structure: Set by tools which edit the input file in
+		// place and add or remove tokens/lines or change rhythms, so that
+		// the spine and rhythm structure of the file has to be re-analyzed
+		// before it is given to another tool.
+		bool m_modified_structure = false;
+
+		// m_analysis_level: The analyses of the input file which the tool
+		// needs (see the ANALYZE_* defines in HumdrumFileBase.h).  When
+		// tools are chained in the filter tool, the file is analyzed at
+		// this level before the tool is run.  Tools which need less than
+		// the full analysis set this in their constructor.
+		int m_analysis_level = ANALYZE_ALL;
+
+};
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Parallel processing of segments in a HumdrumFileStream
+//
+
+//////////////////////////////
+//
+// HumToolSegment -- Input and output of a tool for a single segment
+//    of a HumdrumFileStream when processing segments in parallel.
+//
+
+class HumToolSegment {
+	public:
+		std::vector<std::string> lines;  // Humdrum data for the segment
+		std::string  filename;           // filename of the segment
+		std::string  output;             // text to print to standard output
+		std::string  warning;            // warning messages
+		std::string  error;              // error messages
+		bool         status = true;
+		bool         fatal  = false;
+		bool         done   = false;
 };
 
 
+
+//////////////////////////////
+//
+// runStreamInParallel -- Process the segments of a HumdrumFileStream
+//    with more than one copy of a tool at the same time.  Each worker
+//    thread has its own instance of the tool (given the same command-line
+//    arguments as the main interface), and it parses segments and runs
+//    the tool on them.  Output is printed in the same order as the input
+//    segments.  Only tools which define a "threads" option are processed
+//    in this way (see STREAM_INTERFACE), since tools which keep state from
+//    one segment to the next would give different results.  Returns the
+//    exit status for main().
+//
+
+template <class TOOL>
+int runStreamInParallel(HumdrumFileStream& instream, int threadcount,
+		int argc, char** argv) {
+	typedef std::shared_ptr<HumToolSegment> Segment;
+
+	std::vector<std::unique_ptr<TOOL>> tools;
+	for (int i=0; i<threadcount; i++) {
+		tools.emplace_back(new TOOL);
+		tools.back()->process(argc, argv);
+	}
+
+	std::mutex mutex;
+	std::condition_variable jobready;
+	std::condition_variable jobdone;
+	std::deque<Segment> jobs;     // segments waiting for a worker
+	std::deque<Segment> inorder;  // segments waiting to be printed
+	bool finished = false;
+
+	auto worker = [&](TOOL& tool) {
+		while (true) {
+			Segment job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobready.wait(lock, [&]() { return finished || !jobs.empty(); });
+				if (jobs.empty()) {
+					return;
+				}
+				job = jobs.front();
+				jobs.pop_front();
+			}
+			HumdrumFileSet infiles;
+			HumdrumFile* infile = new HumdrumFile;
+			infile->readLinesNoRhythm(job->lines);
+			if (!job->filename.empty()) {
+				infile->setFilename(job->filename);
+			}
+			std::vector<std::string>().swap(job->lines);
+			infiles.appendHumdrumPointer(infile);
+
+			job->status = tool.run(infiles);
+			std::stringstream out;
+			if (tool.hasWarning()) {
+				job->warning = tool.getWarning();
+			}
+			if (tool.hasAnyText()) {
+				tool.getAllText(out);
+			}
+			if (tool.hasError()) {
+				job->error = tool.getError();
+				job->fatal = true;
+			} else if (!tool.hasAnyText()) {
+				for (int i=0; i<infiles.getCount(); i++) {
+					out << infiles[i];
+				}
+			}
+			job->output = out.str();
+			tool.clearOutput();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			job->done = true;
+			jobdone.notify_all();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i=0; i<threadcount; i++) {
+		threads.emplace_back(worker, std::ref(*tools[i]));
+	}
+
+	// Limit the number of segments in memory at one time:
+	int maxqueue = threadcount * 4;
+	bool status = true;
+	bool fatal = false;
+	bool more = true;
+	while (more && !fatal) {
+		Segment job = std::make_shared<HumToolSegment>();
+		more = instream.getFileLines(job->lines, job->filename);
+		std::unique_lock<std::mutex> lock(mutex);
+		if (more) {
+			jobs.push_back(job);
+			inorder.push_back(job);
+			jobready.notify_one();
+		}
+		while (!inorder.empty()) {
+			if (!inorder.front()->done) {
+				if (more && ((int)inorder.size() < maxqueue)) {
+					break;
+				}
+				jobdone.wait(lock);
+				continue;
+			}
+			Segment result = inorder.front();
+			inorder.pop_front();
+			lock.unlock();
+			status &= result->status;
+			if (!result->warning.empty()) {
+				std::cerr << result->warning;
+			}
+			std::cout << result->output;
+			if (result->fatal) {
+				std::cerr << result->error;
+				fatal = true;
+			}
+			lock.lock();
+			if (fatal) {
+				jobs.clear();
+				break;
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+		jobready.notify_all();
+	}
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+	if (fatal) {
+		return -1;
+	}
+	return !status;
+}
+
+
+
+//////////////////////////////
+//
+// runStreamInterface -- Run a tool on each segment of a HumdrumFileStream
+//    and print the results, as done by STREAM_INTERFACE.  This can be used
+//    by command-line programs which need to prepare the stream (such as
+//    changing its file list) before it is read.  Returns the exit status
+//    for main().
+//
+
+template <class TOOL>
+int runStreamInterface(TOOL& interface, HumdrumFileStream& instream,
+		int argc, char** argv) {
+	int threadcount = 1;
+	if (interface.isDefined("threads")) {
+		threadcount = interface.getInteger("threads");
+	}
+	if (threadcount > 1) {
+		return runStreamInParallel<TOOL>(instream, threadcount, argc, argv);
+	}
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (instream.readSingleSegment(infiles)) {
+		status &= interface.run(infiles);
+		if (interface.hasWarning()) {
+			interface.getWarning(std::cerr);
+		}
+		if (interface.hasAnyText()) {
+			interface.getAllText(std::cout);
+		}
+		if (interface.hasError()) {
+			interface.getError(std::cerr);
+			return -1;
+		}
+		if (!interface.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				std::cout << infiles[i];
+			}
+		}
+		interface.clearOutput();
+	}
+	return !status;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // common command-line Interfaces
@@ -116,7 +350,10 @@ int main(int argc, char** argv) {                      \
 //////////////////////////////
 //
 // STREAM_INTERFACE -- Use HumdrumFileStream (low-memory
-//    usage implementation).
+//    usage implementation).  Tools which do not keep any state from
+//    one segment to the next can define a "threads=i:1" option in their
+//    constructor, and if --threads is greater than one, then segments are
+//    processed in parallel.  Other tools do not accept --threads.
 //
 
 #define STREAM_INTERFACE(CLASS)                                  \
@@ -129,28 +366,8 @@ int main(int argc, char** argv) {                                \
 		return -1;                                                 \
 	}                                                             \
 	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	HumdrumFileSet infiles;                                       \
-	bool status = true;                                           \
-	while (instream.readSingleSegment(infiles)) {                 \
-		status &= interface.run(infiles);                          \
-		if (interface.hasWarning()) {                              \
-			interface.getWarning(cerr);                             \
-		}                                                          \
-		if (interface.hasAnyText()) {                              \
-		   interface.getAllText(cout);                             \
-		}                                                          \
-		if (interface.hasError()) {                                \
-			interface.getError(cerr);                               \
-         return -1;                                              \
-		}                                                          \
-		if (!interface.hasAnyText()) {                             \
-			for (int i=0; i<infiles.getCount(); i++) {              \
-				cout << infiles[i];                                  \
-			}                                                       \
-		}                                                          \
-		interface.clearOutput();                                   \
-	}                                                             \
-	return !status;                                               \
+	return runStreamInterface<CLASS>(interface, instream,         \
+			argc, argv);                                            \
 }
 
 
@@ -192,7 +409,9 @@ int main(int argc, char** argv) {                                \
 //////////////////////////////
 //
 // SET_INTERFACE -- Use HumdrumFileSet (multiple file high-memory
-//    usage implementation).
+//    usage implementation).  If the tool defines a "threads" option
+//    and it is greater than one, then the input files are parsed in
+//    parallel.
 //
 
 #define SET_INTERFACE(CLASS)                                     \
@@ -205,8 +424,12 @@ int main(int argc, char** argv) {                                \
 		return -1;                                                 \
 	}                                                             \
 	HumdrumFileStream instream(static_cast<Options&>(interface)); \
+	int threadcount = 1;                                          \
+	if (interface.isDefined("threads")) {                         \
+		threadcount = interface.getInteger("threads");             \
+	}                                                             \
 	HumdrumFileSet infiles;                                       \
-	instream.read(infiles);                                       \
+	instream.read(infiles, threadcount);                          \
 	bool status = interface.run(infiles);                         \
 	if (interface.hasWarning()) {                                 \
 		interface.getWarning(cerr);                                \
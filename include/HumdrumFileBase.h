@@ -80,6 +80,36 @@ namespace hum {
 #define OPT_ATTACKS   (OPT_DATA | OPT_NOREST | OPT_NOTIE | OPT_NONULL)
 
 
+// The following analysis levels are used for setAnalysisLevel() to select
+// which analyses are done when reading a file with read(), readString()
+// or readLines(), or when calling analyzeStructure().  Analyses which are
+// not selected are done the first time that a function which needs
+// them is called (such as HumdrumLine::getDurationFromStart() for rhythm,
+// getStrandStart() for strands, or HumdrumToken::getLayoutParameter()
+// for layout parameters).
+// * ANALYZE_TOKENS     => only split lines into tokens.  Spine information
+//                           is not available until analyzeBaseFromTokens()
+//                           is called.
+// * ANALYZE_SPINES     => spine information, token links and tracks
+//                           (the analysis done by readNoRhythm()).
+// * ANALYZE_STRANDS    => spine strands and null token resolution.
+// * ANALYZE_PARAMETERS => global/local layout parameters and signifiers.
+// * ANALYZE_RHYTHM     => token and line durations, barlines and ticks.
+//
+// Compound levels:
+// * ANALYZE_ALL       (ANALYZE_SPINES | ANALYZE_STRANDS | ANALYZE_PARAMETERS |
+//                      ANALYZE_RHYTHM)
+//     All analyses (the default for read()).
+//
+#define ANALYZE_TOKENS     0x00
+#define ANALYZE_SPINES     0x01
+#define ANALYZE_STRANDS    0x02
+#define ANALYZE_PARAMETERS 0x04
+#define ANALYZE_RHYTHM     0x08
+#define ANALYZE_ALL        (ANALYZE_SPINES | ANALYZE_STRANDS | \
+                            ANALYZE_PARAMETERS | ANALYZE_RHYTHM)
+
+
 class TokenPair {
 	public:
 		TokenPair(void) { clear(); }
@@ -96,6 +126,16 @@ class TokenPair {
 bool sortTokenPairsByLineIndex(const TokenPair& a, const TokenPair& b);
 
 
+// TimeSigChange: a time signature such as *M3/4 or *M3/3%2 in a track.
+class TimeSigChange {
+	public:
+		int    line   = -1; // line index of the time signature
+		int    top    = 0;  // top number of the time signature
+		int    bot    = 0;  // bottom number (3 in *M3/3%2)
+		HumNum bottom = 0;  // bottom as a rhythm (3/2 for *M3/3%2)
+};
+
+
 class HumdrumFileBase : public HumHash {
 	public:
 		              HumdrumFileBase          (void);
@@ -121,6 +161,7 @@ class HumdrumFileBase : public HumHash {
 		                                        const std::string& separator=",");
 		bool          readStringCsv            (const std::string& contents,
 		                                        const std::string& separator=",");
+		bool          readLines                (std::vector<std::string>& lines);
 		bool          isValid                  (void);
 		std::string   getParseError            (void) const;
 		bool          isQuiet                  (void) const;
@@ -130,6 +171,9 @@ class HumdrumFileBase : public HumHash {
 		bool          isStructureAnalyzed      (void);
 		bool          isRhythmAnalyzed         (void);
 		bool          areStrandsAnalyzed       (void);
+		bool          areParametersAnalyzed    (void);
+		void          setAnalysisLevel         (int level);
+		int           getAnalysisLevel         (void) const;
 
     	template <class TYPE>
 		   void       initializeArray          (std::vector<std::vector<TYPE>>& array, TYPE value);
@@ -185,6 +229,7 @@ class HumdrumFileBase : public HumHash {
 		void          example                  (void);
 
 		bool          analyzeNonNullDataTokens (void);
+		void          analyzeDataType          (int track);
 		HTp           getTrackStart            (int track) const;
 		void          getSpineStopList         (std::vector<HTp>& spinestops);
 		HTp           getSpineStart            (int spine) const
@@ -209,6 +254,7 @@ class HumdrumFileBase : public HumHash {
 		int           getTrackEndCount         (int track) const;
 		HTp           getTrackEnd              (int track, int subtrack) const;
 		void          createLinesFromTokens    (void);
+		void          updateLinesFromTokens    (void);
 		void          removeExtraTabs          (void);
 		void          addExtraTabs             (void);
 		std::vector<int> getTrackWidths        (void);
@@ -289,10 +335,13 @@ class HumdrumFileBase : public HumHash {
 		                                         unsigned short int port);
 
 	protected:
+		bool          readBuffer                (const char* contents, size_t size);
+		bool          readMappedFile            (const char* filename);
 		bool          analyzeTokens             (void);
 		bool          analyzeSpines             (void);
 		bool          analyzeLinks              (void);
 		bool          analyzeTracks             (void);
+		void          analyzeDataTypes          (void);
 		bool          analyzeLines              (void);
 		bool          adjustSpines              (HumdrumLine& line,
 		                                         std::vector<std::string>& datatype,
@@ -319,6 +368,10 @@ class HumdrumFileBase : public HumHash {
 		// The contents of lines must be deallocated when deconstructing object.
 		std::vector<HumdrumLine*> m_lines;
 
+		// m_pool: Arena for the lines and tokens created when reading the
+		// file.  Its memory is returned to the system in clear().
+		HumPool m_pool;
+
 		// m_filename: name of the file which was loaded.
 		std::string m_filename;
 
@@ -344,6 +397,11 @@ class HumdrumFileBase : public HumHash {
 		std::vector<HumdrumLine*> m_barlines;
 		// Maybe also add "measures" which are complete metrical cycles.
 
+		// m_timesigs: list of time signatures for each track in the order
+		// of the lines in the data.  The first dimension is the track
+		// number.
+		std::vector<std::vector<TimeSigChange> > m_timesigs;
+
 		// m_ticksperquarternote: this is the number of tick
 		int m_ticksperquarternote;
 
@@ -382,6 +440,15 @@ class HumdrumFileBase : public HumHash {
 		// file strands have been analyzed.
 		bool m_strands_analyzed = false;
 
+		// m_parameters_analyzed: Used to keep track of whether or not
+		// layout parameters and signifiers have been analyzed.
+		bool m_parameters_analyzed = false;
+
+		// m_analysis_level: The analyses to do when reading a file
+		// (see ANALYZE_* defines above).  Other analyses are done
+		// on demand.
+		int m_analysis_level = ANALYZE_ALL;
+
 		// m_slurs_analyzed: Used to keep track of whether or not
 		// slur endpoints have been linked or not.
 		bool m_slurs_analyzed = false;
@@ -394,6 +461,10 @@ class HumdrumFileBase : public HumHash {
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_timesigs_analyzed: Used to keep track of whether or not
+		// time signatures have been stored in m_timesigs.
+		bool m_timesigs_analyzed = false;
+
 	public:
 		// Dummy functions to allow the HumdrumFile class's inheritance
 		// to be shifted between HumdrumFileContent (the top-level default),
@@ -408,6 +479,7 @@ class HumdrumFileBase : public HumHash {
 		bool readNoRhythm      (const std::string& filename) {return read(filename);};
 		bool readStringNoRhythm(const char*   contents) {return read(contents);};
 		bool readStringNoRhythm(const std::string& contents) {return read(contents);};
+		bool readLinesNoRhythm (std::vector<std::string>& lines) {return readLines(lines);};
 		HumNum       getScoreDuration           (void) const { return 0; };
 		std::ostream&     printDurationInfo          (std::ostream& out=std::cout) {return out;};
 		int          tpq                        (void) { return 0; }
@@ -420,6 +492,7 @@ class HumdrumFileBase : public HumHash {
 		// HumdrumFileContent public functions:
 		// to be added later
 
+	friend class HumdrumToken;
 };
 
 std::ostream& operator<<(std::ostream& out, HumdrumFileBase& infile);
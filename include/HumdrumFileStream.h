@@ -19,12 +19,17 @@
 #define _HUMDRUMFILESTREAM_H_INCLUDED
 
 #include "HumdrumFile.h"
+#include "HumSegmentIndex.h"
 #include "Options.h"
 
 
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace hum {
@@ -40,6 +45,7 @@ class HumdrumFileStream {
 		                HumdrumFileStream  (const std::vector<std::string>& list);
 		                HumdrumFileStream  (Options& options);
 		                HumdrumFileStream  (const string& datastream);
+		               ~HumdrumFileStream  ();
 
 		void            loadString         (const string& data);
 
@@ -49,11 +55,29 @@ class HumdrumFileStream {
 		void            clear              (void);
 		int             eof                (void);
 
+		// reading files of the file list in a background thread:
+		void            setPrefetch        (int count);
+		int             getPrefetch        (void) const;
+
 		int             getFile            (HumdrumFile& infile);
+		int             getFileLines       (std::vector<std::string>& lines,
+		                                    std::string& filename);
 		int             read               (HumdrumFile& infile);
 		int             read               (HumdrumFileSet& infiles);
+		int             read               (HumdrumFileSet& infiles,
+		                                    int threadcount);
 		int             readSingleSegment  (HumdrumFileSet& infiles);
 
+		// reading segments of an archive with a HumSegmentIndex:
+		int             readSegment        (HumdrumFile& infile,
+		                                    const HumSegmentIndex& index,
+		                                    int segment);
+		int             readSegment        (HumdrumFile& infile,
+		                                    const HumSegmentIndex& index,
+		                                    const std::string& name);
+		void            setSegmentList     (const HumSegmentIndex& index,
+		                                    const std::vector<int>& segments);
+
 	protected:
 		std::stringstream m_stringbuffer;   // used to read files from a string
 		std::ifstream     m_instream;       // used to read from list of files
@@ -66,6 +90,44 @@ class HumdrumFileStream {
 
 		std::vector<std::string>  m_universals;     // storage for universal comments
 
+		// Reading a list of segments from an archive (see setSegmentList()):
+		bool                      m_readsegments = false;
+		HumSegmentIndex           m_segmentindex;
+		std::vector<int>          m_segmentlist;
+		int                       m_segmentpos = 0;
+		std::ifstream             m_segmentstream;  // open archive of segments
+		std::string               m_segmentarchive; // filename of m_segmentstream
+
+		// Reading files of the file list in a background thread (see
+		// setPrefetch()):
+		struct PrefetchFile {
+			int         index;     // index of the file in m_filelist
+			bool        ok;        // false if the file could not be read
+			std::string contents;  // contents of the file
+		};
+		int                       m_prefetch = 0;   // max files in queue
+		std::thread               m_prefetchthread;
+		std::mutex                m_prefetchmutex;  // guards members below
+		std::condition_variable   m_prefetchcv;
+		std::deque<PrefetchFile>  m_prefetchqueue;
+		int                       m_prefetchnext = 0;
+		bool                      m_prefetchstop = false;
+		bool                      m_prefetchactive = false;
+		std::stringstream         m_prefetchbuffer; // current prefetched file
+
+		void     startPrefetch            (int index);
+		void     stopPrefetch             (void);
+		void     prefetchFiles            (void);
+		bool     getPrefetchedFile        (int index, std::string& contents);
+		bool     readFileContents         (const std::string& filename,
+		                                   std::string& contents);
+		void     addToFileList            (const std::string& filename);
+
+		int      getSegmentLines          (std::vector<std::string>& lines,
+		                                   std::string& filename,
+		                                   const HumSegmentIndex& index,
+		                                   int segment);
+
 		// Automatic URL downloading of data from internet in read():
 		void     fillUrlBuffer            (std::stringstream& uribuffer,
 		                                   const std::string& uriname);
@@ -17,6 +17,7 @@
 #ifndef _HUMDRUMFILESTRUCTURE_H_INCLUDED
 #define _HUMDRUMFILESTRUCTURE_H_INCLUDED
 
+#include <cstdint>
 #include <iostream>
 #include <set>
 #include <string>
@@ -44,6 +45,7 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          read                         (const std::string& filename);
 		bool          readString                   (const char* contents);
 		bool          readString                   (const std::string& contents);
+		bool          readLines                    (std::vector<std::string>& lines);
 		bool parse(std::istream& contents)      { return read(contents); }
 		bool parse(const char* contents)   { return readString(contents); }
 		bool parse(const std::string& contents) { return readString(contents); }
@@ -52,6 +54,7 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          readNoRhythm                 (const std::string& filename);
 		bool          readStringNoRhythm           (const char* contents);
 		bool          readStringNoRhythm           (const std::string& contents);
+		bool          readLinesNoRhythm            (std::vector<std::string>& lines);
 
 		// CSV reading functions:
 		bool          readCsv                      (std::istream& contents,
@@ -85,6 +88,7 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		HumNum        getScoreDuration             (void) const;
 		std::ostream& printDurationInfo            (std::ostream& out = std::cout);
 		int           tpq                          (void);
+		int64_t       getScoreTickDuration         (void) const;
 
 		// strand functionality:
 		HTp           getStrandStart    (int index);
@@ -111,10 +115,17 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		HumNum        getBarlineDurationFromStart  (int index) const;
 		HumNum        getBarlineDurationToEnd      (int index) const;
 
+		// time signature functionality:
+		int           getTimeSigTop                (int lineindex, int track);
+		HumNum        getTimeSigBottom             (int lineindex, int track);
+		const TimeSigChange* getTimeSigChange      (int lineindex, int track);
+
 		bool          analyzeStructure             (void);
 		bool          analyzeStructureNoRhythm     (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
+		bool          analyzeParameters            (void);
+		bool          analyzeEdits                 (void);
 
 		// signifier access
 		std::string   getKernLinkSignifier         (void);
@@ -123,12 +134,15 @@ class HumdrumFileStructure : public HumdrumFileBase {
 
 	protected:
 		bool          analyzeRhythm                (void);
+		bool          analyzeRhythmFrom            (int lineindex);
 		bool          assignRhythmFromRecip        (HTp spinestart);
-		bool          analyzeMeter                 (void);
+		bool          analyzeMeter                 (int startline = 0);
+		bool          analyzeTicks                 (int startline = 0);
+		int           getPreviousBarlineIndex      (int lineindex);
+		bool          analyzeTimeSignatures        (void);
 		bool          analyzeTokenDurations        (void);
 		bool          analyzeGlobalParameters      (void);
 		bool          analyzeLocalParameters       (void);
-		// bool          analyzeParameters            (void);
 		bool          analyzeStrophes              (void);
 		bool          analyzeDurationsOfNonRhythmicSpines(void);
 		HumNum        getMinDur                    (std::vector<HumNum>& durs,
@@ -145,9 +159,9 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            HumNum startdur);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
 		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
-		bool          analyzeNullLineRhythms       (void);
-		void          fillInNegativeStartTimes     (void);
-		void          assignLineDurations          (void);
+		bool          analyzeNullLineRhythms       (int startline = 0);
+		void          fillInNegativeStartTimes     (int startline = 0);
+		void          assignLineDurations          (int startline = 0);
 		void          assignStrandsToTokens        (void);
 		std::set<HumNum>   getNonZeroLineDurations      (void);
 		std::set<HumNum>   getPositiveLineDurations     (void);
@@ -159,6 +173,9 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            HTp starttok);
 		void          analyzeSignifiers            (void);
 		void          setLineRhythmAnalyzed        (void);
+
+	private:
+		void          ensureRhythm                 (void) const;
 };
 
 
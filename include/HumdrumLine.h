@@ -16,7 +16,9 @@
 
 #include "HumdrumToken.h"
 #include "HumHash.h"
+#include "HumPool.h"
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -29,6 +31,28 @@ class HumdrumFile;
 
 typedef HumdrumLine* HLp;
 
+// The following flags record how the tokens on a line have been changed
+// by HumdrumToken::setText() since the line was last regenerated or
+// analyzed.  See HumdrumFileStructure::analyzeEdits().
+// * EDIT_NONE      => no tokens on the line have been changed.
+// * EDIT_TEXT      => the text of a token changed, so the line needs to be
+//                       regenerated with createLineFromTokens().
+// * EDIT_RHYTHM    => the duration of a token changed, so the rhythm
+//                       analysis is invalid from this line onwards.
+// * EDIT_STRUCTURE => a spine manipulator, a null token or a layout
+//                       parameter changed, so the spine structure of the
+//                       file has to be analyzed again.
+// * EDIT_PENDING   => tokens were changed with HumdrumToken::setText(),
+//                       but the edits have not been classified as text,
+//                       rhythm or structure changes yet (see
+//                       HumdrumLine::classifyEdits()).
+
+#define EDIT_NONE      0x00
+#define EDIT_TEXT      0x01
+#define EDIT_RHYTHM    0x02
+#define EDIT_STRUCTURE 0x04
+#define EDIT_PENDING   0x08
+
 class HumdrumLine : public std::string, public HumHash {
 	public:
 		            HumdrumLine            (void);
@@ -38,6 +62,10 @@ class HumdrumLine : public std::string, public HumHash {
 		            HumdrumLine            (HumdrumLine& line, void* owner);
 		           ~HumdrumLine            ();
 
+		// memory allocation from the arena of the file being read:
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr);
+
 		HumdrumLine& operator=             (HumdrumLine& line);
 		bool        isComment              (void) const;
 		bool        isCommentLocal         (void) const;
@@ -95,6 +123,13 @@ class HumdrumLine : public std::string, public HumHash {
 		std::string   getXmlId             (const std::string& prefix = "") const;
 		std::string   getXmlIdPrefix       (void) const;
 		void          createLineFromTokens (void);
+		bool          isModified           (void) const;
+		int           getModified          (void) const;
+		void          setModified          (int change = EDIT_TEXT);
+		void          clearModified        (int change = EDIT_TEXT |
+		                                    EDIT_RHYTHM | EDIT_STRUCTURE |
+		                                    EDIT_PENDING);
+		int           classifyEdits        (void);
 		void          removeExtraTabs      (void);
 		void          addExtraTabs         (std::vector<int>& trackWidths);
 		int           getLineIndex         (void) const;
@@ -118,6 +153,15 @@ class HumdrumLine : public std::string, public HumHash {
 		HumNum      getDurationFromBarline (HumNum scale);
 		HumNum      getDurationToBarline   (HumNum scale);
 		HumNum      getBarlineDuration     (HumNum scale);
+
+		// integer durations in units of HumdrumFileStructure::tpq():
+		int64_t     getTickDuration        (void);
+		int64_t     getTickFromStart       (void);
+		int64_t     getTickToEnd           (void);
+		int64_t     getTickFromBarline     (void);
+		int64_t     getTickToBarline       (void);
+		int64_t     getBarlineTickDuration (void);
+
 		int         getKernNoteAttacks     (void);
 		int         addLinkedParameter     (HTp token);
 
@@ -157,6 +201,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     clear                  (void);
 		void     setOwner               (void* hfile);
 		int      createTokensFromLine   (void);
+		void     clearTokenLinkInfo     (void);
 		void     setLayoutParameters    (void);
 		void     setParameters          (const std::string& pdata);
 		void     storeGlobalLinkedParameters(void);
@@ -166,7 +211,6 @@ class HumdrumLine : public std::string, public HumHash {
 		                                 const std::string& indent = "\t");
 
 	private:
-
 		//
 		// State variables managed by the HumdrumLine class:
 		//
@@ -221,6 +265,15 @@ class HumdrumLine : public std::string, public HumHash {
 		// This variable is filled by HumdrumFileStructure::analyzeMeter().
 		HumNum m_durationToBarline;
 
+		// m_tickDuration, m_tickFromStart, m_tickFromBarline and
+		// m_tickToBarline: The same values as the HumNum durations above,
+		// but as integer counts of ticks (see HumdrumFileStructure::tpq()).
+		// These variables are filled by HumdrumFileStructure::analyzeTicks().
+		int64_t m_tickDuration     = 0;
+		int64_t m_tickFromStart    = 0;
+		int64_t m_tickFromBarline  = 0;
+		int64_t m_tickToBarline    = 0;
+
 		// m_linkedParameters: List of Humdrum tokens which are parameters
 		// (mostly only layout parameters at the moment)
 		std::vector<HTp> m_linkedParameters;
@@ -229,6 +282,11 @@ class HumdrumLine : public std::string, public HumHash {
 		// has been added to line.
 		bool m_rhythm_analyzed = false;
 
+		// m_modified: EDIT_* flags for changes to tokens on the line which
+		// have not yet been processed by createLineFromTokens() or
+		// HumdrumFileStructure::analyzeEdits().
+		int m_modified = EDIT_NONE;
+
 		// owner: This is the HumdrumFile which manages the given line.
 		void* m_owner;
 
@@ -13,6 +13,7 @@
 #ifndef _HUMDRUMTOKEN_H_INCLUDED
 #define _HUMDRUMTOKEN_H_INCLUDED
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -23,6 +24,7 @@ class HumParamSet;
 #include "HumAddress.h"
 #include "HumHash.h"
 #include "HumParamSet.h"
+#include "HumPool.h"
 
 namespace hum {
 
@@ -31,6 +33,64 @@ namespace hum {
 
 typedef HumdrumToken* HTp;
 
+// datatype_id: Exclusive interpretations which always have the same
+// integer ID.  Other exclusive interpretations are given IDs starting
+// at datatype_custom in the order that they are first seen (see
+// HumdrumToken::registerDataType()).
+enum datatype_id {
+	datatype_unknown = -1,  // token has not been analyzed
+	datatype_none    =  0,  // token is not in a spine
+	datatype_kern,
+	datatype_mens,
+	datatype_recip,
+	datatype_text,
+	datatype_silbe,
+	datatype_sylb,
+	datatype_dynam,
+	datatype_harm,
+	datatype_custom
+};
+
+
+// HumNoteInfo: Note attributes of a token which are parsed from the
+// token text in a single pass by HumdrumToken::getNoteInfo().  Pitch
+// information is extracted from the first subtoken only (as in the
+// Convert::kernTo* functions), while the note/rest/tie/slur flags
+// consider the entire token.  The record is allocated from the arena
+// of the file which owns the token, so it is kept small: the base-7,
+// base-12, base-40 and MIDI values are calculated from the pitch class
+// and octave, since they do not fit into 16 bits for invalid octaves.
+struct HumNoteInfo {
+	             HumNoteInfo(void);
+	static void* operator new(size_t size);
+	static void  operator delete(void* ptr);
+
+	int getBase7 (void) const { return diatonic < 0 ? diatonic
+	                                  : diatonic + 7 * octave; }
+	int getBase12(void) const { return base12PC + 12 * octave; }
+	int getBase40(void) const { return base40PC < 0 ? base40PC
+	                                  : base40PC + 40 * octave; }
+	int getMidi  (void) const { return base12PC + 12 * (octave + 1); }
+
+	uint32_t length;          // length of token text when the info was parsed
+	uint32_t hash;            // hash of token text when the info was parsed
+	int16_t  diatonic;        // diatonic pitch class (C=0), see kernToDiatonicPC
+	int16_t  accidentals;     // sharps minus flats
+	int16_t  octave;          // octave number (middle C octave = 4)
+	int16_t  dots;            // augmentation dots
+	int16_t  base40PC;
+	int16_t  base12PC;
+	bool     note      : 1;   // has a pitch name (a-g, A-G)
+	bool     rest      : 1;   // has an "r"
+	bool     null      : 1;   // is a null data token (".")
+	bool     grace     : 1;   // has a "q"
+	bool     tieStart  : 1;   // has a "["
+	bool     tieCont   : 1;   // has a "_"
+	bool     tieEnd    : 1;   // has a "]"
+	bool     slurStart : 1;   // has a "("
+	bool     slurEnd   : 1;   // has a ")"
+};
+
 class HumdrumToken : public std::string, public HumHash {
 	public:
 		         HumdrumToken              (void);
@@ -41,9 +101,20 @@ class HumdrumToken : public std::string, public HumHash {
 		         HumdrumToken              (HumdrumToken* token,
 		                                    HumdrumLine* owner);
 		         HumdrumToken              (const char* token);
+		         HumdrumToken              (const char* token, size_t length);
 		         HumdrumToken              (const std::string& token);
 		        ~HumdrumToken              ();
 
+		// exclusive interpretation ID registry:
+		static int   registerDataType      (const std::string& dtype);
+		static std::string getDataTypeName (int dtypeid);
+
+		// memory allocation from the arena of the file being read:
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr);
+
+		const HumNoteInfo& getNoteInfo     (void);
+
 		bool     isNull                    (void) const;
 		bool     isManipulator             (void) const;
 
@@ -140,6 +211,14 @@ class HumdrumToken : public std::string, public HumHash {
 		HumNum   getBarlineDuration        (void);
 		HumNum   getBarlineDuration        (HumNum scale);
 
+		// integer durations in units of HumdrumFileStructure::tpq():
+		int64_t  getTickDuration           (void);
+		int64_t  getTickFromStart          (void);
+		int64_t  getTickToEnd              (void);
+		int64_t  getTickFromBarline        (void);
+		int64_t  getTickToBarline          (void);
+		int64_t  getBarlineTickDuration    (void);
+
 		HumdrumLine* getOwner              (void) const;
 		HumdrumLine* getLine               (void) const { return getOwner(); }
 		bool     equalChar                 (int index, char ch) const;
@@ -154,6 +233,8 @@ class HumdrumToken : public std::string, public HumHash {
 		int      getTokenNumber            (void) const;
 		const std::string& getDataType     (void) const;
 		bool     isDataType                (const std::string& dtype) const;
+		bool     isDataType                (int dtypeid) const;
+		int      getDataTypeId             (void) const;
 		bool     isKern                    (void) const;
 		bool     isMens                    (void) const;
 		std::string   getSpineInfo         (void) const;
@@ -256,13 +337,22 @@ class HumdrumToken : public std::string, public HumHash {
 		void     addNextNonNullToken       (HTp token);
 		void     makeForwardLink           (HumdrumToken& nextToken);
 		void     makeBackwardLink          (HumdrumToken& previousToken);
+		void     clearLinkInfo             (void);
 		void     setOwner                  (HumdrumLine* aLine);
 		int      getState                  (void) const;
 		void     incrementState            (void);
 		void     setDuration               (const HumNum& dur);
 		void     setStrandIndex            (int index);
+		void     setDataTypeId             (int dtypeid);
 
 		bool     analyzeDuration           (void);
+		void     checkParameterAnalysis    (void);
+		char     getEditClass              (void) const;
+		int      classifyEdit              (void);
+		void     clearEdit                 (void);
+		HumNum   getTextDuration           (const std::string& text) const;
+		bool     isNoteInfoCurrent         (void) const;
+		static uint32_t getTextHash        (const std::string& text);
 		std::ostream& printXmlBaseInfo     (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlContentInfo  (std::ostream& out = std::cout, int level = 0,
@@ -275,6 +365,9 @@ class HumdrumToken : public std::string, public HumHash {
 		                                    const std::string& indent = "\t");
 
 	private:
+		static std::vector<std::string>& getDataTypeList (void);
+		static std::mutex& getDataTypeMutex(void);
+
 		// address: The address contains information about the location of
 		// the token on a HumdrumLine and in a HumdrumFile.
 		HumAddress m_address;
@@ -286,6 +379,12 @@ class HumdrumToken : public std::string, public HumHash {
 		// list in the token for a graphical display duration.
 		HumNum m_duration;
 
+		// m_tickDuration: The duration of the token as an integer count
+		// of ticks (see HumdrumFileStructure::tpq()), or -1 for non-rhythmic
+		// tokens.  This variable is filled by
+		// HumdrumFileStructure::analyzeTicks().
+		int64_t m_tickDuration = -1;
+
 		// nextTokens: This is a list of all previous tokens in the spine which
 		// immediately precede this token. Typically there will be one
 		// following token, but there can be two tokens if the current
@@ -333,6 +432,21 @@ class HumdrumToken : public std::string, public HumHash {
 		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
 		bool m_rhythm_analyzed = false;
 
+		// m_datatype: Interned ID of the exclusive interpretation of the
+		// spine the token is in.  This variable is filled by
+		// HumdrumFileBase::analyzeTracks().
+		int m_datatype = datatype_unknown;
+
+		// m_noteinfo: Cached note attributes parsed from the token text.
+		// Allocated the first time getNoteInfo() is called, and parsed again
+		// if the length or hash of the token text no longer matches.
+		HumNoteInfo* m_noteinfo = NULL;
+
+		// m_edittext: The text of the token before it was first changed
+		// with setText().  Allocated when the token is edited and deleted
+		// when the edit is classified by HumdrumFileStructure::analyzeEdits().
+		std::string* m_edittext = NULL;
+
 	friend class HumdrumLine;
 	friend class HumdrumFileBase;
 	friend class HumdrumFileStructure;
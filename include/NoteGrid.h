@@ -15,15 +15,26 @@
 
 #include "NoteCell.h"
 
+#include <cstdint>
+
 using namespace std;
 
 namespace hum {
 
 // START_MERGE
 
+// Bits in the state column of a NoteGrid voice:
+enum notegrid_state {
+	GRID_ATTACK  = 0x01,  // note attack
+	GRID_REST    = 0x02,  // rest
+	GRID_SUSTAIN = 0x04,  // sustained note, or rest after the first rest
+	GRID_NOPITCH = 0x08   // no diatonic, MIDI or accidental value
+};
+
+
 class NoteGrid {
 	public:
-		           NoteGrid              (void) { }
+		           NoteGrid              (void) { m_infile = NULL; }
 		           NoteGrid              (HumdrumFile& infile);
 		          ~NoteGrid              ();
 
@@ -58,6 +69,17 @@ class NoteGrid {
 
 		HTp        getToken              (int vindex, int sindex);
 
+		int        getPrevAttackIndex    (int vindex, int sindex);
+		int        getCurrAttackIndex    (int vindex, int sindex);
+		int        getNextAttackIndex    (int vindex, int sindex);
+
+		// packed columns of a voice, indexed by slice:
+		const vector<int16_t>& getDiatonicColumn (int vindex);
+		const vector<int16_t>& getMidiColumn     (int vindex);
+		const vector<int16_t>& getBase40Column   (int vindex);
+		const vector<uint8_t>& getStateColumn    (int vindex);
+		const vector<int>&     getLineColumn     (void);
+
 		int        getPrevAttackDiatonic (int vindex, int sindex);
 		int        getNextAttackDiatonic (int vindex, int sindex);
 
@@ -71,12 +93,32 @@ class NoteGrid {
 	protected:
 		void       buildAttackIndexes    (void);
 		void       buildAttackIndex      (int vindex);
+		void       appendNumericPitches  (int vindex, HTp token);
 
 	private:
-		vector<vector<NoteCell*> > m_grid;
+		// One NoteCell for each slice of a voice, stored contiguously.
+		// The cells are views of the columns below:
+		vector<vector<NoteCell> >  m_cells;
+
+		// Packed columns for each voice, indexed by slice.  Pitches
+		// are negative for sustained notes and 0 for rests (see m_state).
+		vector<vector<int16_t> >   m_b7;         // diatonic note numbers
+		vector<vector<int16_t> >   m_b12;        // MIDI note numbers
+		vector<vector<int16_t> >   m_b40;        // base-40 note numbers
+		vector<vector<int16_t> >   m_accidental; // chromatic alterations
+		vector<vector<uint8_t> >   m_state;      // notegrid_state bits
+		vector<vector<int> >       m_prevattack; // index of previous attack
+		vector<vector<int> >       m_currattack; // index of current attack
+		vector<vector<int> >       m_nextattack; // index of next attack
+
+		// m_lines: line index in m_infile for each slice.
+		vector<int>                m_lines;
+
 		vector<HTp>                m_kernspines;
 		vector<double>             m_metriclevels;
 		HumdrumFile*               m_infile;
+
+	friend NoteCell;
 };
 
 
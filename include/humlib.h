@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Wed Mar 11 22:03:03 PDT 2020
+// Last Modified: Sun Oct 18 14:28:34 UTC 2026
 // Filename:      humlib.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/humlib.h
 // Syntax:        C++11
@@ -42,21 +42,33 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <list>
 #include <locale>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -120,15 +132,72 @@ class HumParameter : public std::string {
 		HumdrumToken* origin;
 };
 
-typedef std::map<std::string, std::map<std::string, std::map<std::string, HumParameter> > > MapNNKV;
-typedef std::map<std::string, std::map<std::string, HumParameter> > MapNKV;
-typedef std::map<std::string, HumParameter> MapKV;
+
+// HumParamKey: Namespace 1, namespace 2 and key of a parameter stored as
+// pointers to interned strings (see HumHash::internName()).  Create a
+// HumParamKey once for parameters which are accessed frequently to avoid
+// looking up the namespace and key strings in each access:
+//    static const HumParamKey slurEnd("auto", "slurEnd");
+//    HTp end = token->getValueHTp(slurEnd);
+class HumParamKey {
+	public:
+		explicit       HumParamKey         (const std::string& key);
+		               HumParamKey         (const std::string& ns2,
+		                                    const std::string& key);
+		               HumParamKey         (const std::string& ns1,
+		                                    const std::string& ns2,
+		                                    const std::string& key);
+
+		const std::string& getNamespace1   (void) const { return *m_ns1; }
+		const std::string& getNamespace2   (void) const { return *m_ns2; }
+		const std::string& getKey          (void) const { return *m_key; }
+
+		bool           operator<           (const HumParamKey& key) const;
+
+	private:
+		               HumParamKey         (void) {}
+
+		const std::string* m_ns1;
+		const std::string* m_ns2;
+		const std::string* m_key;
+
+	friend class HumHash;
+};
+
+
+// HumHashEntry: A parameter stored in a HumHash.
+struct HumHashEntry {
+	HumParamKey  name;
+	HumParameter value;
+};
+
+// HumNameCache: Interned names already looked up by one thread, so that
+// the shared list of names only needs to be locked for names which the
+// thread has not seen before.  "missing" holds names which were not in the
+// list when there were "count" interned names.
+struct HumNameCache {
+	std::unordered_map<std::string, const std::string*> found;
+	std::unordered_set<std::string> missing;
+	size_t count = 0;
+};
+
+// HumHashTree: Parameters grouped by namespace 1 and namespace 2, used
+// when printing parameters.
+typedef std::map<std::string, std::map<std::string,
+		std::vector<const HumHashEntry*> > > HumHashTree;
+
 
 class HumHash {
 	public:
 		               HumHash             (void);
+		               HumHash             (const HumHash& hash);
 		              ~HumHash             ();
 
+		HumHash&       operator=           (const HumHash& hash);
+
+		// interned namespace and key strings
+		static const std::string* internName (const std::string& name);
+
 		std::string    getValue            (const std::string& key) const;
 		std::string    getValue            (const std::string& ns2,
 		                                    const std::string& key) const;
@@ -208,6 +277,24 @@ class HumHash {
 		void           deleteValue         (const std::string& ns1, const std::string& ns2,
 		                                    const std::string& key);
 
+		// access by pre-interned namespaces/key
+		std::string    getValue            (const HumParamKey& key) const;
+		HTp            getValueHTp         (const HumParamKey& key) const;
+		int            getValueInt         (const HumParamKey& key) const;
+		HumNum         getValueFraction    (const HumParamKey& key) const;
+		double         getValueFloat       (const HumParamKey& key) const;
+		bool           getValueBool        (const HumParamKey& key) const;
+		void           setValue            (const HumParamKey& key,
+		                                    const std::string& value);
+		void           setValue            (const HumParamKey& key,
+		                                    const char* value);
+		void           setValue            (const HumParamKey& key, int value);
+		void           setValue            (const HumParamKey& key, HTp value);
+		void           setValue            (const HumParamKey& key, HumNum value);
+		void           setValue            (const HumParamKey& key, double value);
+		bool           isDefined           (const HumParamKey& key) const;
+		void           deleteValue         (const HumParamKey& key);
+
 		std::vector<std::string> getKeys   (void) const;
 		std::vector<std::string> getKeys   (const std::string& ns) const;
 		std::vector<std::string> getKeys   (const std::string& ns1,
@@ -257,9 +344,31 @@ class HumHash {
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
+		const HumParameter*      findParameter         (const HumParamKey& key) const;
+		const HumParameter*      findParameter         (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		HumParameter&            insertParameter       (const HumParamKey& key);
+		std::vector<const HumHashEntry*> getSortedEntries (void) const;
+		HumHashTree              getEntryTree          (void) const;
+		static bool              findKey               (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key,
+		                                                HumParamKey& output);
 
 	private:
-		MapNNKV*    parameters;
+		static const std::string*               findName     (const std::string& name);
+		static std::unordered_set<std::string>& getNameList  (void);
+		static std::mutex&                      getNameMutex (void);
+		static std::atomic<size_t>&             getNameCount (void);
+		static HumNameCache&                    getNameCache (void);
+
+	private:
+		// parameters: List of parameters sorted by the addresses of the
+		// interned namespace and key strings.  Allocated when the first
+		// parameter is set.
+		std::vector<HumHashEntry>* parameters;
+
 		std::string prefix;
 
 	friend std::ostream& operator<<(std::ostream& out, const HumHash& hash);
@@ -381,6 +490,15 @@ class HumRegex {
 		bool        getGlobal          (void);
 		void        unsetGlobal        (void);
 
+		// precompiling a regular expression for repeated use
+		bool        compile            (const std::string& exp,
+		                                const std::string& options = "");
+
+		// compiled regular expression cache shared by all HumRegex objects
+		static void setCacheSize       (int size);
+		static int  getCacheSize       (void);
+		static void clearCache         (void);
+
 		// replacing
 		std::string&     replaceDestructive (std::string& input, const std::string& replacement,
 		                                const std::string& exp);
@@ -408,6 +526,12 @@ class HumRegex {
 		std::string&      tr                 (std::string& input, const std::string& from,
 		                                const std::string& to);
 
+		// replacing with the compiled regular expression
+		std::string&     replaceDestructive (std::string& input,
+		                                const std::string& replacement);
+		std::string      replaceCopy        (const std::string& input,
+		                                const std::string& replacement);
+
 		// matching (full-string match)
 		bool        match              (const std::string& input, const std::string& exp);
 		bool        match              (const std::string& input, const std::string& exp,
@@ -416,6 +540,10 @@ class HumRegex {
 		bool        match              (const std::string* input, const std::string& exp,
 		                                const std::string& options);
 
+		// matching with the compiled regular expression
+		bool        match              (const std::string& input);
+		bool        match              (const std::string* input);
+
 
 		// searching
 		// http://www.cplusplus.com/reference/regex/regex_search
@@ -437,6 +565,12 @@ class HumRegex {
 		                                const std::string& exp,
 		                                const std::string& options);
 
+		// searching with the compiled regular expression
+		int         search             (const std::string& input);
+		int         search             (const std::string& input, int startindex);
+		int         search             (std::string* input);
+		int         search             (std::string* input, int startindex);
+
 		int         getMatchCount      (void);
 		std::string getMatch           (int index);
 		int         getMatchInt        (int index);
@@ -457,17 +591,40 @@ class HumRegex {
 				getTemporaryRegexFlags(const std::string& sflags);
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
+		void        setRegex           (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
+		static std::shared_ptr<const std::regex>
+				getCachedRegex(const std::string& exp,
+				               std::regex_constants::syntax_option_type flags);
 
 
 	private:
+		struct RegexCache;
+		static RegexCache& getRegexCache (void);
+
 
 		// m_regex: stores the regular expression to use as a default.
+		// Compiled regular expressions are shared with other HumRegex
+		// objects through the cache in getCachedRegex(), so they must
+		// not be modified.
 		//
 		// http://en.cppreference.com/w/cpp/regex/basic_regex
-		// .assign(string) == set the regular expression.
-		// operator=       == set the regular expression.
 		// .flags()        == return syntax_option_type used to construct.
-		std::regex m_regex;
+		std::shared_ptr<const std::regex> m_regex;
+
+		// m_pattern: the string used to create m_regex, and
+		// m_patternflags: the flags used to create m_regex.  Used to avoid
+		// looking up the regular expression in the cache when the same
+		// expression is used repeatedly.
+		std::string m_pattern;
+		std::regex_constants::syntax_option_type m_patternflags;
+
+		// m_compiled: the regular expression given to compile() or to the
+		// constructor, which is used by the search/match/replace functions
+		// that do not take an expression parameter, and
+		// m_compiledflags: the search flags given with that expression.
+		std::shared_ptr<const std::regex> m_compiled;
+		std::regex_constants::match_flag_type m_compiledflags;
 
 		// m_matches: stores the matches from a search:
 		//
@@ -699,6 +856,134 @@ std::ostream& operator<<(std::ostream& out, HumParamSet& hps);
 
 
 
+class HumPoolSlab;
+
+class HumPool {
+	public:
+		                HumPool          (size_t slabsize = 65536);
+		               ~HumPool          ();
+
+		void*           allocate         (size_t size);
+		void            clear            (void);
+
+		static void*    allocateObject   (size_t size);
+		static void     releaseObject    (void* ptr);
+
+	protected:
+		void            addSlab          (void);
+		void            releaseSlab      (void);
+
+	private:
+		                HumPool          (const HumPool& pool);
+		HumPool&        operator=        (const HumPool& pool);
+
+		// m_slabsize: The size in bytes of each slab allocated from the
+		// system.  Objects larger than a quarter of a slab are allocated
+		// individually.
+		size_t m_slabsize;
+
+		// m_slab: The slab which new objects are allocated from.  Other
+		// slabs of the arena are returned to the system when their last
+		// object is deleted.
+		HumPoolSlab* m_slab;
+
+		// m_used: The number of bytes used in m_slab.
+		size_t m_used;
+};
+
+
+
+//////////////////////////////
+//
+// HumPoolScope -- Allocate HumdrumLine and HumdrumToken objects from the
+//    given arena while the scope exists in the current thread.  Outside
+//    of a scope they are allocated individually with the global operator
+//    new.
+//
+
+class HumPoolScope {
+	public:
+		                HumPoolScope     (HumPool& pool);
+		               ~HumPoolScope     ();
+
+	private:
+		HumPool* m_previous;
+};
+
+
+
+class HumSegmentIndex {
+	public:
+		                   HumSegmentIndex    (void);
+		                   HumSegmentIndex    (const std::string& archive);
+		                  ~HumSegmentIndex    ();
+
+		void               clear              (void);
+		bool               build              (const std::string& archive);
+		bool               read               (const std::string& indexfile);
+		bool               read               (std::istream& input);
+		bool               write              (const std::string& indexfile) const;
+		std::ostream&      write              (std::ostream& out) const;
+		bool               isCurrent          (void) const;
+
+		const std::string& getArchive         (void) const;
+		void               setArchive         (const std::string& archive);
+		int64_t            getArchiveSize     (void) const;
+
+		int                getSegmentCount    (void) const;
+		int                getSegmentIndex    (const std::string& name) const;
+		const std::string& getSegmentName     (int index) const;
+		int                getSegmentLevel    (int index) const;
+		int64_t            getSegmentOffset   (int index) const;
+		int64_t            getSegmentSize     (int index) const;
+		const std::vector<std::string>& getSegmentUniversals(int index) const;
+
+		static std::string getSidecarName     (const std::string& archive);
+
+	protected:
+		void               addSegment         (const std::string& line,
+		                                       int64_t offset,
+		                                       int universals);
+		void               buildNameIndex     (void);
+		static int64_t     getFileTime        (const std::string& filename);
+
+	private:
+		struct Segment {
+			std::string name;       // filename from the !!!!SEGMENT: record
+			int         level;      // segment level (+/- number before colon)
+			int64_t     offset;     // byte offset of the !!!!SEGMENT: line
+			int64_t     size;       // number of bytes in the segment
+			int         universals; // index in m_universals, or -1 if none
+		};
+
+		// m_archive: The filename of the concatenated Humdrum files.
+		std::string m_archive;
+
+		// m_archivesize: The size of the archive when it was indexed, used
+		// to check if the index needs to be rebuilt.
+		int64_t m_archivesize = 0;
+
+		// m_archivetime: The modification time of the archive when it was
+		// indexed (or 0 if not known), also used to check if the index
+		// needs to be rebuilt.
+		int64_t m_archivetime = 0;
+
+		// m_universals: The sets of universal comments which are applied
+		// to segments when reading the archive with HumdrumFileStream.
+		// Segments which are read with the same universal comments share
+		// one entry.
+		std::vector<std::vector<std::string>> m_universals;
+
+		// m_segments: The list of segments in the order of the archive.
+		std::vector<Segment> m_segments;
+
+		// m_names: Lookup table for segment indexes by name.  The first
+		// segment is used if names are repeated.
+		std::unordered_map<std::string, int> m_names;
+};
+
+
+
 class _HumInstrument {
 	public:
 		_HumInstrument    (void) { humdrum = ""; name = ""; gm = 0; }
@@ -978,6 +1263,28 @@ class HumInstrument {
 
 typedef HumdrumLine* HLp;
 
+// The following flags record how the tokens on a line have been changed
+// by HumdrumToken::setText() since the line was last regenerated or
+// analyzed.  See HumdrumFileStructure::analyzeEdits().
+// * EDIT_NONE      => no tokens on the line have been changed.
+// * EDIT_TEXT      => the text of a token changed, so the line needs to be
+//                       regenerated with createLineFromTokens().
+// * EDIT_RHYTHM    => the duration of a token changed, so the rhythm
+//                       analysis is invalid from this line onwards.
+// * EDIT_STRUCTURE => a spine manipulator, a null token or a layout
+//                       parameter changed, so the spine structure of the
+//                       file has to be analyzed again.
+// * EDIT_PENDING   => tokens were changed with HumdrumToken::setText(),
+//                       but the edits have not been classified as text,
+//                       rhythm or structure changes yet (see
+//                       HumdrumLine::classifyEdits()).
+
+#define EDIT_NONE      0x00
+#define EDIT_TEXT      0x01
+#define EDIT_RHYTHM    0x02
+#define EDIT_STRUCTURE 0x04
+#define EDIT_PENDING   0x08
+
 class HumdrumLine : public std::string, public HumHash {
 	public:
 		            HumdrumLine            (void);
@@ -987,6 +1294,10 @@ class HumdrumLine : public std::string, public HumHash {
 		            HumdrumLine            (HumdrumLine& line, void* owner);
 		           ~HumdrumLine            ();
 
+		// memory allocation from the arena of the file being read:
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr);
+
 		HumdrumLine& operator=             (HumdrumLine& line);
 		bool        isComment              (void) const;
 		bool        isCommentLocal         (void) const;
@@ -1044,6 +1355,13 @@ class HumdrumLine : public std::string, public HumHash {
 		std::string   getXmlId             (const std::string& prefix = "") const;
 		std::string   getXmlIdPrefix       (void) const;
 		void          createLineFromTokens (void);
+		bool          isModified           (void) const;
+		int           getModified          (void) const;
+		void          setModified          (int change = EDIT_TEXT);
+		void          clearModified        (int change = EDIT_TEXT |
+		                                    EDIT_RHYTHM | EDIT_STRUCTURE |
+		                                    EDIT_PENDING);
+		int           classifyEdits        (void);
 		void          removeExtraTabs      (void);
 		void          addExtraTabs         (std::vector<int>& trackWidths);
 		int           getLineIndex         (void) const;
@@ -1067,6 +1385,15 @@ class HumdrumLine : public std::string, public HumHash {
 		HumNum      getDurationFromBarline (HumNum scale);
 		HumNum      getDurationToBarline   (HumNum scale);
 		HumNum      getBarlineDuration     (HumNum scale);
+
+		// integer durations in units of HumdrumFileStructure::tpq():
+		int64_t     getTickDuration        (void);
+		int64_t     getTickFromStart       (void);
+		int64_t     getTickToEnd           (void);
+		int64_t     getTickFromBarline     (void);
+		int64_t     getTickToBarline       (void);
+		int64_t     getBarlineTickDuration (void);
+
 		int         getKernNoteAttacks     (void);
 		int         addLinkedParameter     (HTp token);
 
@@ -1106,6 +1433,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     clear                  (void);
 		void     setOwner               (void* hfile);
 		int      createTokensFromLine   (void);
+		void     clearTokenLinkInfo     (void);
 		void     setLayoutParameters    (void);
 		void     setParameters          (const std::string& pdata);
 		void     storeGlobalLinkedParameters(void);
@@ -1115,7 +1443,6 @@ class HumdrumLine : public std::string, public HumHash {
 		                                 const std::string& indent = "\t");
 
 	private:
-
 		//
 		// State variables managed by the HumdrumLine class:
 		//
@@ -1170,6 +1497,15 @@ class HumdrumLine : public std::string, public HumHash {
 		// This variable is filled by HumdrumFileStructure::analyzeMeter().
 		HumNum m_durationToBarline;
 
+		// m_tickDuration, m_tickFromStart, m_tickFromBarline and
+		// m_tickToBarline: The same values as the HumNum durations above,
+		// but as integer counts of ticks (see HumdrumFileStructure::tpq()).
+		// These variables are filled by HumdrumFileStructure::analyzeTicks().
+		int64_t m_tickDuration     = 0;
+		int64_t m_tickFromStart    = 0;
+		int64_t m_tickFromBarline  = 0;
+		int64_t m_tickToBarline    = 0;
+
 		// m_linkedParameters: List of Humdrum tokens which are parameters
 		// (mostly only layout parameters at the moment)
 		std::vector<HTp> m_linkedParameters;
@@ -1178,6 +1514,11 @@ class HumdrumLine : public std::string, public HumHash {
 		// has been added to line.
 		bool m_rhythm_analyzed = false;
 
+		// m_modified: EDIT_* flags for changes to tokens on the line which
+		// have not yet been processed by createLineFromTokens() or
+		// HumdrumFileStructure::analyzeEdits().
+		int m_modified = EDIT_NONE;
+
 		// owner: This is the HumdrumFile which manages the given line.
 		void* m_owner;
 
@@ -1195,6 +1536,64 @@ std::ostream& operator<< (std::ostream& out, HumdrumLine* line);
 
 typedef HumdrumToken* HTp;
 
+// datatype_id: Exclusive interpretations which always have the same
+// integer ID.  Other exclusive interpretations are given IDs starting
+// at datatype_custom in the order that they are first seen (see
+// HumdrumToken::registerDataType()).
+enum datatype_id {
+	datatype_unknown = -1,  // token has not been analyzed
+	datatype_none    =  0,  // token is not in a spine
+	datatype_kern,
+	datatype_mens,
+	datatype_recip,
+	datatype_text,
+	datatype_silbe,
+	datatype_sylb,
+	datatype_dynam,
+	datatype_harm,
+	datatype_custom
+};
+
+
+// HumNoteInfo: Note attributes of a token which are parsed from the
+// token text in a single pass by HumdrumToken::getNoteInfo().  Pitch
+// information is extracted from the first subtoken only (as in the
+// Convert::kernTo* functions), while the note/rest/tie/slur flags
+// consider the entire token.  The record is allocated from the arena
+// of the file which owns the token, so it is kept small: the base-7,
+// base-12, base-40 and MIDI values are calculated from the pitch class
+// and octave, since they do not fit into 16 bits for invalid octaves.
+struct HumNoteInfo {
+	             HumNoteInfo(void);
+	static void* operator new(size_t size);
+	static void  operator delete(void* ptr);
+
+	int getBase7 (void) const { return diatonic < 0 ? diatonic
+	                                  : diatonic + 7 * octave; }
+	int getBase12(void) const { return base12PC + 12 * octave; }
+	int getBase40(void) const { return base40PC < 0 ? base40PC
+	                                  : base40PC + 40 * octave; }
+	int getMidi  (void) const { return base12PC + 12 * (octave + 1); }
+
+	uint32_t length;          // length of token text when the info was parsed
+	uint32_t hash;            // hash of token text when the info was parsed
+	int16_t  diatonic;        // diatonic pitch class (C=0), see kernToDiatonicPC
+	int16_t  accidentals;     // sharps minus flats
+	int16_t  octave;          // octave number (middle C octave = 4)
+	int16_t  dots;            // augmentation dots
+	int16_t  base40PC;
+	int16_t  base12PC;
+	bool     note      : 1;   // has a pitch name (a-g, A-G)
+	bool     rest      : 1;   // has an "r"
+	bool     null      : 1;   // is a null data token (".")
+	bool     grace     : 1;   // has a "q"
+	bool     tieStart  : 1;   // has a "["
+	bool     tieCont   : 1;   // has a "_"
+	bool     tieEnd    : 1;   // has a "]"
+	bool     slurStart : 1;   // has a "("
+	bool     slurEnd   : 1;   // has a ")"
+};
+
 class HumdrumToken : public std::string, public HumHash {
 	public:
 		         HumdrumToken              (void);
@@ -1205,9 +1604,20 @@ class HumdrumToken : public std::string, public HumHash {
 		         HumdrumToken              (HumdrumToken* token,
 		                                    HumdrumLine* owner);
 		         HumdrumToken              (const char* token);
+		         HumdrumToken              (const char* token, size_t length);
 		         HumdrumToken              (const std::string& token);
 		        ~HumdrumToken              ();
 
+		// exclusive interpretation ID registry:
+		static int   registerDataType      (const std::string& dtype);
+		static std::string getDataTypeName (int dtypeid);
+
+		// memory allocation from the arena of the file being read:
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr);
+
+		const HumNoteInfo& getNoteInfo     (void);
+
 		bool     isNull                    (void) const;
 		bool     isManipulator             (void) const;
 
@@ -1304,6 +1714,14 @@ class HumdrumToken : public std::string, public HumHash {
 		HumNum   getBarlineDuration        (void);
 		HumNum   getBarlineDuration        (HumNum scale);
 
+		// integer durations in units of HumdrumFileStructure::tpq():
+		int64_t  getTickDuration           (void);
+		int64_t  getTickFromStart          (void);
+		int64_t  getTickToEnd              (void);
+		int64_t  getTickFromBarline        (void);
+		int64_t  getTickToBarline          (void);
+		int64_t  getBarlineTickDuration    (void);
+
 		HumdrumLine* getOwner              (void) const;
 		HumdrumLine* getLine               (void) const { return getOwner(); }
 		bool     equalChar                 (int index, char ch) const;
@@ -1318,6 +1736,8 @@ class HumdrumToken : public std::string, public HumHash {
 		int      getTokenNumber            (void) const;
 		const std::string& getDataType     (void) const;
 		bool     isDataType                (const std::string& dtype) const;
+		bool     isDataType                (int dtypeid) const;
+		int      getDataTypeId             (void) const;
 		bool     isKern                    (void) const;
 		bool     isMens                    (void) const;
 		std::string   getSpineInfo         (void) const;
@@ -1420,13 +1840,22 @@ class HumdrumToken : public std::string, public HumHash {
 		void     addNextNonNullToken       (HTp token);
 		void     makeForwardLink           (HumdrumToken& nextToken);
 		void     makeBackwardLink          (HumdrumToken& previousToken);
+		void     clearLinkInfo             (void);
 		void     setOwner                  (HumdrumLine* aLine);
 		int      getState                  (void) const;
 		void     incrementState            (void);
 		void     setDuration               (const HumNum& dur);
 		void     setStrandIndex            (int index);
+		void     setDataTypeId             (int dtypeid);
 
 		bool     analyzeDuration           (void);
+		void     checkParameterAnalysis    (void);
+		char     getEditClass              (void) const;
+		int      classifyEdit              (void);
+		void     clearEdit                 (void);
+		HumNum   getTextDuration           (const std::string& text) const;
+		bool     isNoteInfoCurrent         (void) const;
+		static uint32_t getTextHash        (const std::string& text);
 		std::ostream& printXmlBaseInfo     (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlContentInfo  (std::ostream& out = std::cout, int level = 0,
@@ -1439,6 +1868,9 @@ class HumdrumToken : public std::string, public HumHash {
 		                                    const std::string& indent = "\t");
 
 	private:
+		static std::vector<std::string>& getDataTypeList (void);
+		static std::mutex& getDataTypeMutex(void);
+
 		// address: The address contains information about the location of
 		// the token on a HumdrumLine and in a HumdrumFile.
 		HumAddress m_address;
@@ -1450,6 +1882,12 @@ class HumdrumToken : public std::string, public HumHash {
 		// list in the token for a graphical display duration.
 		HumNum m_duration;
 
+		// m_tickDuration: The duration of the token as an integer count
+		// of ticks (see HumdrumFileStructure::tpq()), or -1 for non-rhythmic
+		// tokens.  This variable is filled by
+		// HumdrumFileStructure::analyzeTicks().
+		int64_t m_tickDuration = -1;
+
 		// nextTokens: This is a list of all previous tokens in the spine which
 		// immediately precede this token. Typically there will be one
 		// following token, but there can be two tokens if the current
@@ -1497,6 +1935,21 @@ class HumdrumToken : public std::string, public HumHash {
 		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
 		bool m_rhythm_analyzed = false;
 
+		// m_datatype: Interned ID of the exclusive interpretation of the
+		// spine the token is in.  This variable is filled by
+		// HumdrumFileBase::analyzeTracks().
+		int m_datatype = datatype_unknown;
+
+		// m_noteinfo: Cached note attributes parsed from the token text.
+		// Allocated the first time getNoteInfo() is called, and parsed again
+		// if the length or hash of the token text no longer matches.
+		HumNoteInfo* m_noteinfo = NULL;
+
+		// m_edittext: The text of the token before it was first changed
+		// with setText().  Allocated when the token is edited and deleted
+		// when the edit is classified by HumdrumFileStructure::analyzeEdits().
+		std::string* m_edittext = NULL;
+
 	friend class HumdrumLine;
 	friend class HumdrumFileBase;
 	friend class HumdrumFileStructure;
@@ -1548,6 +2001,36 @@ std::ostream& printSequence(std::vector<HTp>& sequence, std::ostream& out = std:
 #define OPT_ATTACKS   (OPT_DATA | OPT_NOREST | OPT_NOTIE | OPT_NONULL)
 
 
+// The following analysis levels are used for setAnalysisLevel() to select
+// which analyses are done when reading a file with read(), readString()
+// or readLines(), or when calling analyzeStructure().  Analyses which are
+// not selected are done the first time that a function which needs
+// them is called (such as HumdrumLine::getDurationFromStart() for rhythm,
+// getStrandStart() for strands, or HumdrumToken::getLayoutParameter()
+// for layout parameters).
+// * ANALYZE_TOKENS     => only split lines into tokens.  Spine information
+//                           is not available until analyzeBaseFromTokens()
+//                           is called.
+// * ANALYZE_SPINES     => spine information, token links and tracks
+//                           (the analysis done by readNoRhythm()).
+// * ANALYZE_STRANDS    => spine strands and null token resolution.
+// * ANALYZE_PARAMETERS => global/local layout parameters and signifiers.
+// * ANALYZE_RHYTHM     => token and line durations, barlines and ticks.
+//
+// Compound levels:
+// * ANALYZE_ALL       (ANALYZE_SPINES | ANALYZE_STRANDS | ANALYZE_PARAMETERS |
+//                      ANALYZE_RHYTHM)
+//     All analyses (the default for read()).
+//
+#define ANALYZE_TOKENS     0x00
+#define ANALYZE_SPINES     0x01
+#define ANALYZE_STRANDS    0x02
+#define ANALYZE_PARAMETERS 0x04
+#define ANALYZE_RHYTHM     0x08
+#define ANALYZE_ALL        (ANALYZE_SPINES | ANALYZE_STRANDS | \
+                            ANALYZE_PARAMETERS | ANALYZE_RHYTHM)
+
+
 class TokenPair {
 	public:
 		TokenPair(void) { clear(); }
@@ -1564,6 +2047,16 @@ class TokenPair {
 bool sortTokenPairsByLineIndex(const TokenPair& a, const TokenPair& b);
 
 
+// TimeSigChange: a time signature such as *M3/4 or *M3/3%2 in a track.
+class TimeSigChange {
+	public:
+		int    line   = -1; // line index of the time signature
+		int    top    = 0;  // top number of the time signature
+		int    bot    = 0;  // bottom number (3 in *M3/3%2)
+		HumNum bottom = 0;  // bottom as a rhythm (3/2 for *M3/3%2)
+};
+
+
 class HumdrumFileBase : public HumHash {
 	public:
 		              HumdrumFileBase          (void);
@@ -1589,6 +2082,7 @@ class HumdrumFileBase : public HumHash {
 		                                        const std::string& separator=",");
 		bool          readStringCsv            (const std::string& contents,
 		                                        const std::string& separator=",");
+		bool          readLines                (std::vector<std::string>& lines);
 		bool          isValid                  (void);
 		std::string   getParseError            (void) const;
 		bool          isQuiet                  (void) const;
@@ -1598,6 +2092,9 @@ class HumdrumFileBase : public HumHash {
 		bool          isStructureAnalyzed      (void);
 		bool          isRhythmAnalyzed         (void);
 		bool          areStrandsAnalyzed       (void);
+		bool          areParametersAnalyzed    (void);
+		void          setAnalysisLevel         (int level);
+		int           getAnalysisLevel         (void) const;
 
     	template <class TYPE>
 		   void       initializeArray          (std::vector<std::vector<TYPE>>& array, TYPE value);
@@ -1653,6 +2150,7 @@ class HumdrumFileBase : public HumHash {
 		void          example                  (void);
 
 		bool          analyzeNonNullDataTokens (void);
+		void          analyzeDataType          (int track);
 		HTp           getTrackStart            (int track) const;
 		void          getSpineStopList         (std::vector<HTp>& spinestops);
 		HTp           getSpineStart            (int spine) const
@@ -1677,6 +2175,7 @@ class HumdrumFileBase : public HumHash {
 		int           getTrackEndCount         (int track) const;
 		HTp           getTrackEnd              (int track, int subtrack) const;
 		void          createLinesFromTokens    (void);
+		void          updateLinesFromTokens    (void);
 		void          removeExtraTabs          (void);
 		void          addExtraTabs             (void);
 		std::vector<int> getTrackWidths        (void);
@@ -1757,10 +2256,13 @@ class HumdrumFileBase : public HumHash {
 		                                         unsigned short int port);
 
 	protected:
+		bool          readBuffer                (const char* contents, size_t size);
+		bool          readMappedFile            (const char* filename);
 		bool          analyzeTokens             (void);
 		bool          analyzeSpines             (void);
 		bool          analyzeLinks              (void);
 		bool          analyzeTracks             (void);
+		void          analyzeDataTypes          (void);
 		bool          analyzeLines              (void);
 		bool          adjustSpines              (HumdrumLine& line,
 		                                         std::vector<std::string>& datatype,
@@ -1787,6 +2289,10 @@ class HumdrumFileBase : public HumHash {
 		// The contents of lines must be deallocated when deconstructing object.
 		std::vector<HumdrumLine*> m_lines;
 
+		// m_pool: Arena for the lines and tokens created when reading the
+		// file.  Its memory is returned to the system in clear().
+		HumPool m_pool;
+
 		// m_filename: name of the file which was loaded.
 		std::string m_filename;
 
@@ -1812,6 +2318,11 @@ class HumdrumFileBase : public HumHash {
 		std::vector<HumdrumLine*> m_barlines;
 		// Maybe also add "measures" which are complete metrical cycles.
 
+		// m_timesigs: list of time signatures for each track in the order
+		// of the lines in the data.  The first dimension is the track
+		// number.
+		std::vector<std::vector<TimeSigChange> > m_timesigs;
+
 		// m_ticksperquarternote: this is the number of tick
 		int m_ticksperquarternote;
 
@@ -1850,6 +2361,15 @@ class HumdrumFileBase : public HumHash {
 		// file strands have been analyzed.
 		bool m_strands_analyzed = false;
 
+		// m_parameters_analyzed: Used to keep track of whether or not
+		// layout parameters and signifiers have been analyzed.
+		bool m_parameters_analyzed = false;
+
+		// m_analysis_level: The analyses to do when reading a file
+		// (see ANALYZE_* defines above).  Other analyses are done
+		// on demand.
+		int m_analysis_level = ANALYZE_ALL;
+
 		// m_slurs_analyzed: Used to keep track of whether or not
 		// slur endpoints have been linked or not.
 		bool m_slurs_analyzed = false;
@@ -1862,6 +2382,10 @@ class HumdrumFileBase : public HumHash {
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_timesigs_analyzed: Used to keep track of whether or not
+		// time signatures have been stored in m_timesigs.
+		bool m_timesigs_analyzed = false;
+
 	public:
 		// Dummy functions to allow the HumdrumFile class's inheritance
 		// to be shifted between HumdrumFileContent (the top-level default),
@@ -1876,6 +2400,7 @@ class HumdrumFileBase : public HumHash {
 		bool readNoRhythm      (const std::string& filename) {return read(filename);};
 		bool readStringNoRhythm(const char*   contents) {return read(contents);};
 		bool readStringNoRhythm(const std::string& contents) {return read(contents);};
+		bool readLinesNoRhythm (std::vector<std::string>& lines) {return readLines(lines);};
 		HumNum       getScoreDuration           (void) const { return 0; };
 		std::ostream&     printDurationInfo          (std::ostream& out=std::cout) {return out;};
 		int          tpq                        (void) { return 0; }
@@ -1888,6 +2413,7 @@ class HumdrumFileBase : public HumHash {
 		// HumdrumFileContent public functions:
 		// to be added later
 
+	friend class HumdrumToken;
 };
 
 std::ostream& operator<<(std::ostream& out, HumdrumFileBase& infile);
@@ -1910,6 +2436,7 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          read                         (const std::string& filename);
 		bool          readString                   (const char* contents);
 		bool          readString                   (const std::string& contents);
+		bool          readLines                    (std::vector<std::string>& lines);
 		bool parse(std::istream& contents)      { return read(contents); }
 		bool parse(const char* contents)   { return readString(contents); }
 		bool parse(const std::string& contents) { return readString(contents); }
@@ -1918,6 +2445,7 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          readNoRhythm                 (const std::string& filename);
 		bool          readStringNoRhythm           (const char* contents);
 		bool          readStringNoRhythm           (const std::string& contents);
+		bool          readLinesNoRhythm            (std::vector<std::string>& lines);
 
 		// CSV reading functions:
 		bool          readCsv                      (std::istream& contents,
@@ -1951,6 +2479,7 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		HumNum        getScoreDuration             (void) const;
 		std::ostream& printDurationInfo            (std::ostream& out = std::cout);
 		int           tpq                          (void);
+		int64_t       getScoreTickDuration         (void) const;
 
 		// strand functionality:
 		HTp           getStrandStart    (int index);
@@ -1977,10 +2506,17 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		HumNum        getBarlineDurationFromStart  (int index) const;
 		HumNum        getBarlineDurationToEnd      (int index) const;
 
+		// time signature functionality:
+		int           getTimeSigTop                (int lineindex, int track);
+		HumNum        getTimeSigBottom             (int lineindex, int track);
+		const TimeSigChange* getTimeSigChange      (int lineindex, int track);
+
 		bool          analyzeStructure             (void);
 		bool          analyzeStructureNoRhythm     (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
+		bool          analyzeParameters            (void);
+		bool          analyzeEdits                 (void);
 
 		// signifier access
 		std::string   getKernLinkSignifier         (void);
@@ -1989,12 +2525,15 @@ class HumdrumFileStructure : public HumdrumFileBase {
 
 	protected:
 		bool          analyzeRhythm                (void);
+		bool          analyzeRhythmFrom            (int lineindex);
 		bool          assignRhythmFromRecip        (HTp spinestart);
-		bool          analyzeMeter                 (void);
+		bool          analyzeMeter                 (int startline = 0);
+		bool          analyzeTicks                 (int startline = 0);
+		int           getPreviousBarlineIndex      (int lineindex);
+		bool          analyzeTimeSignatures        (void);
 		bool          analyzeTokenDurations        (void);
 		bool          analyzeGlobalParameters      (void);
 		bool          analyzeLocalParameters       (void);
-		// bool          analyzeParameters            (void);
 		bool          analyzeStrophes              (void);
 		bool          analyzeDurationsOfNonRhythmicSpines(void);
 		HumNum        getMinDur                    (std::vector<HumNum>& durs,
@@ -2011,9 +2550,9 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            HumNum startdur);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
 		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
-		bool          analyzeNullLineRhythms       (void);
-		void          fillInNegativeStartTimes     (void);
-		void          assignLineDurations          (void);
+		bool          analyzeNullLineRhythms       (int startline = 0);
+		void          fillInNegativeStartTimes     (int startline = 0);
+		void          assignLineDurations          (int startline = 0);
 		void          assignStrandsToTokens        (void);
 		std::set<HumNum>   getNonZeroLineDurations      (void);
 		std::set<HumNum>   getPositiveLineDurations     (void);
@@ -2025,6 +2564,9 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            HTp starttok);
 		void          analyzeSignifiers            (void);
 		void          setLineRhythmAnalyzed        (void);
+
+	private:
+		void          ensureRhythm                 (void) const;
 };
 
 
@@ -3235,10 +3777,10 @@ class NoteCell {
 		       NoteCell             (NoteGrid* owner, HTp token);
 		      ~NoteCell             (void) { clear();                    }
 
-		double getSgnDiatonicPitch  (void) { return m_b7;                }
-		double getSgnMidiPitch      (void) { return m_b12;               }
-		double getSgnBase40Pitch    (void) { return m_b40;               }
-		double getSgnAccidental     (void) { return m_accidental;        }
+		double getSgnDiatonicPitch  (void);
+		double getSgnMidiPitch      (void);
+		double getSgnBase40Pitch    (void);
+		double getSgnAccidental     (void);
 
 		double getSgnDiatonicPitchClass(void);
 		double getAbsDiatonicPitchClass(void);
@@ -3246,15 +3788,15 @@ class NoteCell {
 		double getSgnBase40PitchClass(void);
 		double getAbsBase40PitchClass(void);
 
-		double getAbsDiatonicPitch  (void) { return fabs(m_b7);          }
-		double getAbsMidiPitch      (void) { return fabs(m_b12);         }
-		double getAbsBase40Pitch    (void) { return fabs(m_b40);         }
-		double getAbsAccidental     (void) { return fabs(m_accidental);  }
+		double getAbsDiatonicPitch  (void) { return fabs(getSgnDiatonicPitch()); }
+		double getAbsMidiPitch      (void) { return fabs(getSgnMidiPitch());     }
+		double getAbsBase40Pitch    (void) { return fabs(getSgnBase40Pitch());   }
+		double getAbsAccidental     (void) { return fabs(getSgnAccidental());    }
 
 		HTp    getToken             (void) { return m_token;             }
-		int    getNextAttackIndex   (void) { return m_nextAttackIndex;   }
-		int    getPrevAttackIndex   (void) { return m_prevAttackIndex;   }
-		int    getCurrAttackIndex   (void) { return m_currAttackIndex;   }
+		int    getNextAttackIndex   (void);
+		int    getPrevAttackIndex   (void);
+		int    getCurrAttackIndex   (void);
 		int    getSliceIndex        (void) { return m_timeslice;         }
 		int    getVoiceIndex        (void) { return m_voice;             }
 
@@ -3284,14 +3826,13 @@ class NoteCell {
 
 	protected:
 		void clear                  (void);
-		void calculateNumericPitches(void);
 		void setVoiceIndex          (int index) { m_voice = index;           }
 		void setSliceIndex          (int index) { m_timeslice = index;       }
-		void setNextAttackIndex     (int index) { m_nextAttackIndex = index; }
-		void setPrevAttackIndex     (int index) { m_prevAttackIndex = index; }
-		void setCurrAttackIndex     (int index) { m_currAttackIndex = index; }
 
 	private:
+		// The pitch and attack information of the cell is stored in
+		// columns of the owning NoteGrid, and the cell is a view of
+		// those columns at m_voice and m_timeslice.
 		NoteGrid* m_owner; // the NoteGrid to which this cell belongs.
 		HTp m_token;       // pointer to the note in the origina Humdrum file.
 		int m_voice;       // index of the voice in the score the note belongs
@@ -3299,16 +3840,6 @@ class NoteCell {
 		                   // column in NoteGrid.
 		int m_timeslice;   // index for the row in NoteGrid.
 
-		double m_b7;         // diatonic note number; NaN=rest; negative=sustain.
-		double m_b12;        // MIDI note number; NaN=rest; negative=sustain.
-		double m_b40;        // base-40 note number; NaN=rest; negative=sustain.
-		double m_accidental; // chromatic alteration of a diatonic pitch.
-		                     // NaN=no accidental.
-		int m_nextAttackIndex; // index to next note attack (or rest),
-		                       // -1 for undefined (interpred as rest).
-		int m_prevAttackIndex; // index to previous note attack.
-		int m_currAttackIndex; // index to current note attack (useful for
-		                       // finding the start of a sustained note.
 		int m_metertop = 0;    // top number of prevailing meter signature
 		HumNum m_meterbot = 0; // bottom number of prevailing meter signature
 
@@ -3317,9 +3848,18 @@ class NoteCell {
 
 
 
+// Bits in the state column of a NoteGrid voice:
+enum notegrid_state {
+	GRID_ATTACK  = 0x01,  // note attack
+	GRID_REST    = 0x02,  // rest
+	GRID_SUSTAIN = 0x04,  // sustained note, or rest after the first rest
+	GRID_NOPITCH = 0x08   // no diatonic, MIDI or accidental value
+};
+
+
 class NoteGrid {
 	public:
-		           NoteGrid              (void) { }
+		           NoteGrid              (void) { m_infile = NULL; }
 		           NoteGrid              (HumdrumFile& infile);
 		          ~NoteGrid              ();
 
@@ -3354,6 +3894,17 @@ class NoteGrid {
 
 		HTp        getToken              (int vindex, int sindex);
 
+		int        getPrevAttackIndex    (int vindex, int sindex);
+		int        getCurrAttackIndex    (int vindex, int sindex);
+		int        getNextAttackIndex    (int vindex, int sindex);
+
+		// packed columns of a voice, indexed by slice:
+		const vector<int16_t>& getDiatonicColumn (int vindex);
+		const vector<int16_t>& getMidiColumn     (int vindex);
+		const vector<int16_t>& getBase40Column   (int vindex);
+		const vector<uint8_t>& getStateColumn    (int vindex);
+		const vector<int>&     getLineColumn     (void);
+
 		int        getPrevAttackDiatonic (int vindex, int sindex);
 		int        getNextAttackDiatonic (int vindex, int sindex);
 
@@ -3367,12 +3918,32 @@ class NoteGrid {
 	protected:
 		void       buildAttackIndexes    (void);
 		void       buildAttackIndex      (int vindex);
+		void       appendNumericPitches  (int vindex, HTp token);
 
 	private:
-		vector<vector<NoteCell*> > m_grid;
+		// One NoteCell for each slice of a voice, stored contiguously.
+		// The cells are views of the columns below:
+		vector<vector<NoteCell> >  m_cells;
+
+		// Packed columns for each voice, indexed by slice.  Pitches
+		// are negative for sustained notes and 0 for rests (see m_state).
+		vector<vector<int16_t> >   m_b7;         // diatonic note numbers
+		vector<vector<int16_t> >   m_b12;        // MIDI note numbers
+		vector<vector<int16_t> >   m_b40;        // base-40 note numbers
+		vector<vector<int16_t> >   m_accidental; // chromatic alterations
+		vector<vector<uint8_t> >   m_state;      // notegrid_state bits
+		vector<vector<int> >       m_prevattack; // index of previous attack
+		vector<vector<int> >       m_currattack; // index of current attack
+		vector<vector<int> >       m_nextattack; // index of next attack
+
+		// m_lines: line index in m_infile for each slice.
+		vector<int>                m_lines;
+
 		vector<HTp>                m_kernspines;
 		vector<double>             m_metriclevels;
 		HumdrumFile*               m_infile;
+
+	friend NoteCell;
 };
 
 
@@ -3413,13 +3984,13 @@ class Convert {
 		static std::string  base40ToIntervalAbbr (int b40);
 		static int     kernToOctaveNumber   (const std::string& kerndata);
 		static int     kernToOctaveNumber   (HTp token)
-				{ return kernToOctaveNumber((std::string)*token); }
+				{ return token->getNoteInfo().octave; }
 		static int     kernToAccidentalCount(const std::string& kerndata);
 		static int     kernToAccidentalCount(HTp token)
-				{ return kernToAccidentalCount((std::string)*token); }
+				{ return token->getNoteInfo().accidentals; }
 		static int     kernToDiatonicPC     (const std::string& kerndata);
 		static int     kernToDiatonicPC     (HTp token)
-				{ return kernToDiatonicPC     ((std::string)*token); }
+				{ return token->getNoteInfo().diatonic; }
 		static char    kernToDiatonicUC     (const std::string& kerndata);
 		static int     kernToDiatonicUC     (HTp token)
 				{ return kernToDiatonicUC     ((std::string)*token); }
@@ -3428,26 +3999,26 @@ class Convert {
 				{ return kernToDiatonicLC     ((std::string)*token); }
 		static int     kernToBase40PC       (const std::string& kerndata);
 		static int     kernToBase40PC       (HTp token)
-				{ return kernToBase40PC       ((std::string)*token); }
+				{ return token->getNoteInfo().base40PC; }
 		static int     kernToBase12PC       (const std::string& kerndata);
 		static int     kernToBase12PC       (HTp token)
-				{ return kernToBase12PC       ((std::string)*token); }
+				{ return token->getNoteInfo().base12PC; }
 		static int     kernToBase7PC        (const std::string& kerndata) {
 		                                     return kernToDiatonicPC(kerndata); }
 		static int     kernToBase7PC        (HTp token)
-				{ return kernToBase7PC        ((std::string)*token); }
+				{ return token->getNoteInfo().diatonic; }
 		static int     kernToBase40         (const std::string& kerndata);
 		static int     kernToBase40         (HTp token)
-				{ return kernToBase40         ((std::string)*token); }
+				{ return token->getNoteInfo().getBase40(); }
 		static int     kernToBase12         (const std::string& kerndata);
 		static int     kernToBase12         (HTp token)
-				{ return kernToBase12         ((std::string)*token); }
+				{ return token->getNoteInfo().getBase12(); }
 		static int     kernToBase7          (const std::string& kerndata);
 		static int     kernToBase7          (HTp token)
-				{ return kernToBase7          ((std::string)*token); }
+				{ return token->getNoteInfo().getBase7(); }
 		static int     kernToMidiNoteNumber (const std::string& kerndata);
 		static int     kernToMidiNoteNumber(HTp token)
-				{ return kernToMidiNoteNumber((std::string)*token); }
+				{ return token->getNoteInfo().getMidi(); }
 		static std::string  kernToScientificPitch(const std::string& kerndata,
 		                                     std::string flat = "b",
 		                                     std::string sharp = "#",
@@ -4570,6 +5141,151 @@ class Options {
 
 
 
+class HumdrumFileSet;
+
+class HumdrumFileStream {
+	public:
+		                HumdrumFileStream  (void);
+		                HumdrumFileStream  (char** list);
+		                HumdrumFileStream  (const std::vector<std::string>& list);
+		                HumdrumFileStream  (Options& options);
+		                HumdrumFileStream  (const string& datastream);
+		               ~HumdrumFileStream  ();
+
+		void            loadString         (const string& data);
+
+		int             setFileList        (char** list);
+		int             setFileList        (const std::vector<std::string>& list);
+
+		void            clear              (void);
+		int             eof                (void);
+
+		// reading files of the file list in a background thread:
+		void            setPrefetch        (int count);
+		int             getPrefetch        (void) const;
+
+		int             getFile            (HumdrumFile& infile);
+		int             getFileLines       (std::vector<std::string>& lines,
+		                                    std::string& filename);
+		int             read               (HumdrumFile& infile);
+		int             read               (HumdrumFileSet& infiles);
+		int             read               (HumdrumFileSet& infiles,
+		                                    int threadcount);
+		int             readSingleSegment  (HumdrumFileSet& infiles);
+
+		// reading segments of an archive with a HumSegmentIndex:
+		int             readSegment        (HumdrumFile& infile,
+		                                    const HumSegmentIndex& index,
+		                                    int segment);
+		int             readSegment        (HumdrumFile& infile,
+		                                    const HumSegmentIndex& index,
+		                                    const std::string& name);
+		void            setSegmentList     (const HumSegmentIndex& index,
+		                                    const std::vector<int>& segments);
+
+	protected:
+		std::stringstream m_stringbuffer;   // used to read files from a string
+		std::ifstream     m_instream;       // used to read from list of files
+		std::stringstream m_urlbuffer;      // used to read data over internet
+		std::string       m_newfilebuffer;  // used to keep track of !!!!segment:
+		                                    // records.
+
+		std::vector<std::string>  m_filelist;       // used when not using cin
+		int                       m_curfile;        // index into filelist
+
+		std::vector<std::string>  m_universals;     // storage for universal comments
+
+		// Reading a list of segments from an archive (see setSegmentList()):
+		bool                      m_readsegments = false;
+		HumSegmentIndex           m_segmentindex;
+		std::vector<int>          m_segmentlist;
+		int                       m_segmentpos = 0;
+		std::ifstream             m_segmentstream;  // open archive of segments
+		std::string               m_segmentarchive; // filename of m_segmentstream
+
+		// Reading files of the file list in a background thread (see
+		// setPrefetch()):
+		struct PrefetchFile {
+			int         index;     // index of the file in m_filelist
+			bool        ok;        // false if the file could not be read
+			std::string contents;  // contents of the file
+		};
+		int                       m_prefetch = 0;   // max files in queue
+		std::thread               m_prefetchthread;
+		std::mutex                m_prefetchmutex;  // guards members below
+		std::condition_variable   m_prefetchcv;
+		std::deque<PrefetchFile>  m_prefetchqueue;
+		int                       m_prefetchnext = 0;
+		bool                      m_prefetchstop = false;
+		bool                      m_prefetchactive = false;
+		std::stringstream         m_prefetchbuffer; // current prefetched file
+
+		void     startPrefetch            (int index);
+		void     stopPrefetch             (void);
+		void     prefetchFiles            (void);
+		bool     getPrefetchedFile        (int index, std::string& contents);
+		bool     readFileContents         (const std::string& filename,
+		                                   std::string& contents);
+		void     addToFileList            (const std::string& filename);
+
+		int      getSegmentLines          (std::vector<std::string>& lines,
+		                                   std::string& filename,
+		                                   const HumSegmentIndex& index,
+		                                   int segment);
+
+		// Automatic URL downloading of data from internet in read():
+		void     fillUrlBuffer            (std::stringstream& uribuffer,
+		                                   const std::string& uriname);
+
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+class HumdrumFileSet {
+   public:
+                            HumdrumFileSet   (void);
+                            HumdrumFileSet   (Options& options);
+                            HumdrumFileSet   (const std::string& contents);
+                           ~HumdrumFileSet   ();
+
+      void                  clear            (void);
+      void                  clearNoFree      (void);
+      int                   getSize          (void);
+      int                   getCount         (void) { return getSize(); }
+      HumdrumFile&          operator[]       (int index);
+		bool                  swap             (int index1, int index2);
+		bool                  hasFilters       (void);
+		bool                  hasGlobalFilters    (void);
+		bool                  hasUniversalFilters (void);
+		std::vector<HumdrumLine*> getUniversalReferenceRecords(void);
+
+      int                   readFile         (const std::string& filename);
+      int                   readString       (const std::string& contents);
+      int                   readStringCsv    (const std::string& contents);
+      int                   read             (std::istream& inStream);
+      int                   read             (Options& options);
+      int                   read             (HumdrumFileStream& instream);
+
+      int                   readAppendFile   (const std::string& filename);
+      int                   readAppendString (const std::string& contents);
+      int                   readAppendStringCsv (const std::string& contents);
+      int                   readAppend       (std::istream& inStream);
+      int                   readAppend       (Options& options);
+      int                   readAppend       (HumdrumFileStream& instream);
+      int                   readAppendHumdrum(HumdrumFile& infile);
+		int                   appendHumdrumPointer(HumdrumFile* infile);
+
+   protected:
+      vector<HumdrumFile*>  m_data;
+
+      void                  appendHumdrumFileContent(const std::string& filename,
+                                               std::stringstream& inbuffer);
+};
+
+
+
 class HumTool : public Options {
 	public:
 		              HumTool         (void);
@@ -4603,6 +5319,10 @@ class HumTool : public Options {
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
 
+		bool          hasModifiedStructure (void);
+		void          setModifiedStructure (void);
+		int           getAnalysisLevel     (void);
+
 	protected:
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
@@ -4612,9 +5332,232 @@ class HumTool : public Options {
 
 		bool m_suppress = false;
 
+		// m_modified_structure: Set by tools which edit the input file in
+		// place and add or remove tokens/lines or change rhythms, so that
+		// the spine and rhythm structure of the file has to be re-analyzed
+		// before it is given to another tool.
+		bool m_modified_structure = false;
+
+		// m_analysis_level: The analyses of the input file which the tool
+		// needs (see the ANALYZE_* defines in HumdrumFileBase.h).  When
+		// tools are chained in the filter tool, the file is analyzed at
+		// this level before the tool is run.  Tools which need less than
+		// the full analysis set this in their constructor.
+		int m_analysis_level = ANALYZE_ALL;
+
+};
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Parallel processing of segments in a HumdrumFileStream
+//
+
+//////////////////////////////
+//
+// HumToolSegment -- Input and output of a tool for a single segment
+//    of a HumdrumFileStream when processing segments in parallel.
+//
+
+class HumToolSegment {
+	public:
+		std::vector<std::string> lines;  // Humdrum data for the segment
+		std::string  filename;           // filename of the segment
+		std::string  output;             // text to print to standard output
+		std::string  warning;            // warning messages
+		std::string  error;              // error messages
+		bool         status = true;
+		bool         fatal  = false;
+		bool         done   = false;
 };
 
 
+
+//////////////////////////////
+//
+// runStreamInParallel -- Process the segments of a HumdrumFileStream
+//    with more than one copy of a tool at the same time.  Each worker
+//    thread has its own instance of the tool (given the same command-line
+//    arguments as the main interface), and it parses segments and runs
+//    the tool on them.  Output is printed in the same order as the input
+//    segments.  Only tools which define a "threads" option are processed
+//    in this way (see STREAM_INTERFACE), since tools which keep state from
+//    one segment to the next would give different results.  Returns the
+//    exit status for main().
+//
+
+template <class TOOL>
+int runStreamInParallel(HumdrumFileStream& instream, int threadcount,
+		int argc, char** argv) {
+	typedef std::shared_ptr<HumToolSegment> Segment;
+
+	std::vector<std::unique_ptr<TOOL>> tools;
+	for (int i=0; i<threadcount; i++) {
+		tools.emplace_back(new TOOL);
+		tools.back()->process(argc, argv);
+	}
+
+	std::mutex mutex;
+	std::condition_variable jobready;
+	std::condition_variable jobdone;
+	std::deque<Segment> jobs;     // segments waiting for a worker
+	std::deque<Segment> inorder;  // segments waiting to be printed
+	bool finished = false;
+
+	auto worker = [&](TOOL& tool) {
+		while (true) {
+			Segment job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobready.wait(lock, [&]() { return finished || !jobs.empty(); });
+				if (jobs.empty()) {
+					return;
+				}
+				job = jobs.front();
+				jobs.pop_front();
+			}
+			HumdrumFileSet infiles;
+			HumdrumFile* infile = new HumdrumFile;
+			infile->readLinesNoRhythm(job->lines);
+			if (!job->filename.empty()) {
+				infile->setFilename(job->filename);
+			}
+			std::vector<std::string>().swap(job->lines);
+			infiles.appendHumdrumPointer(infile);
+
+			job->status = tool.run(infiles);
+			std::stringstream out;
+			if (tool.hasWarning()) {
+				job->warning = tool.getWarning();
+			}
+			if (tool.hasAnyText()) {
+				tool.getAllText(out);
+			}
+			if (tool.hasError()) {
+				job->error = tool.getError();
+				job->fatal = true;
+			} else if (!tool.hasAnyText()) {
+				for (int i=0; i<infiles.getCount(); i++) {
+					out << infiles[i];
+				}
+			}
+			job->output = out.str();
+			tool.clearOutput();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			job->done = true;
+			jobdone.notify_all();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i=0; i<threadcount; i++) {
+		threads.emplace_back(worker, std::ref(*tools[i]));
+	}
+
+	// Limit the number of segments in memory at one time:
+	int maxqueue = threadcount * 4;
+	bool status = true;
+	bool fatal = false;
+	bool more = true;
+	while (more && !fatal) {
+		Segment job = std::make_shared<HumToolSegment>();
+		more = instream.getFileLines(job->lines, job->filename);
+		std::unique_lock<std::mutex> lock(mutex);
+		if (more) {
+			jobs.push_back(job);
+			inorder.push_back(job);
+			jobready.notify_one();
+		}
+		while (!inorder.empty()) {
+			if (!inorder.front()->done) {
+				if (more && ((int)inorder.size() < maxqueue)) {
+					break;
+				}
+				jobdone.wait(lock);
+				continue;
+			}
+			Segment result = inorder.front();
+			inorder.pop_front();
+			lock.unlock();
+			status &= result->status;
+			if (!result->warning.empty()) {
+				std::cerr << result->warning;
+			}
+			std::cout << result->output;
+			if (result->fatal) {
+				std::cerr << result->error;
+				fatal = true;
+			}
+			lock.lock();
+			if (fatal) {
+				jobs.clear();
+				break;
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+		jobready.notify_all();
+	}
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+	if (fatal) {
+		return -1;
+	}
+	return !status;
+}
+
+
+
+//////////////////////////////
+//
+// runStreamInterface -- Run a tool on each segment of a HumdrumFileStream
+//    and print the results, as done by STREAM_INTERFACE.  This can be used
+//    by command-line programs which need to prepare the stream (such as
+//    changing its file list) before it is read.  Returns the exit status
+//    for main().
+//
+
+template <class TOOL>
+int runStreamInterface(TOOL& interface, HumdrumFileStream& instream,
+		int argc, char** argv) {
+	int threadcount = 1;
+	if (interface.isDefined("threads")) {
+		threadcount = interface.getInteger("threads");
+	}
+	if (threadcount > 1) {
+		return runStreamInParallel<TOOL>(instream, threadcount, argc, argv);
+	}
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (instream.readSingleSegment(infiles)) {
+		status &= interface.run(infiles);
+		if (interface.hasWarning()) {
+			interface.getWarning(std::cerr);
+		}
+		if (interface.hasAnyText()) {
+			interface.getAllText(std::cout);
+		}
+		if (interface.hasError()) {
+			interface.getError(std::cerr);
+			return -1;
+		}
+		if (!interface.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				std::cout << infiles[i];
+			}
+		}
+		interface.clearOutput();
+	}
+	return !status;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // common command-line Interfaces
@@ -4663,7 +5606,10 @@ int main(int argc, char** argv) {                      \
 //////////////////////////////
 //
 // STREAM_INTERFACE -- Use HumdrumFileStream (low-memory
-//    usage implementation).
+//    usage implementation).  Tools which do not keep any state from
+//    one segment to the next can define a "threads=i:1" option in their
+//    constructor, and if --threads is greater than one, then segments are
+//    processed in parallel.  Other tools do not accept --threads.
 //
 
 #define STREAM_INTERFACE(CLASS)                                  \
@@ -4676,28 +5622,8 @@ int main(int argc, char** argv) {                                \
 		return -1;                                                 \
 	}                                                             \
 	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	HumdrumFileSet infiles;                                       \
-	bool status = true;                                           \
-	while (instream.readSingleSegment(infiles)) {                 \
-		status &= interface.run(infiles);                          \
-		if (interface.hasWarning()) {                              \
-			interface.getWarning(cerr);                             \
-		}                                                          \
-		if (interface.hasAnyText()) {                              \
-		   interface.getAllText(cout);                             \
-		}                                                          \
-		if (interface.hasError()) {                                \
-			interface.getError(cerr);                               \
-         return -1;                                              \
-		}                                                          \
-		if (!interface.hasAnyText()) {                             \
-			for (int i=0; i<infiles.getCount(); i++) {              \
-				cout << infiles[i];                                  \
-			}                                                       \
-		}                                                          \
-		interface.clearOutput();                                   \
-	}                                                             \
-	return !status;                                               \
+	return runStreamInterface<CLASS>(interface, instream,         \
+			argc, argv);                                            \
 }
 
 
@@ -4739,7 +5665,9 @@ int main(int argc, char** argv) {                                \
 //////////////////////////////
 //
 // SET_INTERFACE -- Use HumdrumFileSet (multiple file high-memory
-//    usage implementation).
+//    usage implementation).  If the tool defines a "threads" option
+//    and it is greater than one, then the input files are parsed in
+//    parallel.
 //
 
 #define SET_INTERFACE(CLASS)                                     \
@@ -4752,8 +5680,12 @@ int main(int argc, char** argv) {                                \
 		return -1;                                                 \
 	}                                                             \
 	HumdrumFileStream instream(static_cast<Options&>(interface)); \
+	int threadcount = 1;                                          \
+	if (interface.isDefined("threads")) {                         \
+		threadcount = interface.getInteger("threads");             \
+	}                                                             \
 	HumdrumFileSet infiles;                                       \
-	instream.read(infiles);                                       \
+	instream.read(infiles, threadcount);                          \
 	bool status = interface.run(infiles);                         \
 	if (interface.hasWarning()) {                                 \
 		interface.getWarning(cerr);                                \
@@ -4776,94 +5708,6 @@ int main(int argc, char** argv) {                                \
 
 
 
-class HumdrumFileSet;
-
-class HumdrumFileStream {
-	public:
-		                HumdrumFileStream  (void);
-		                HumdrumFileStream  (char** list);
-		                HumdrumFileStream  (const std::vector<std::string>& list);
-		                HumdrumFileStream  (Options& options);
-		                HumdrumFileStream  (const string& datastream);
-
-		void            loadString         (const string& data);
-
-		int             setFileList        (char** list);
-		int             setFileList        (const std::vector<std::string>& list);
-
-		void            clear              (void);
-		int             eof                (void);
-
-		int             getFile            (HumdrumFile& infile);
-		int             read               (HumdrumFile& infile);
-		int             read               (HumdrumFileSet& infiles);
-		int             readSingleSegment  (HumdrumFileSet& infiles);
-
-	protected:
-		std::stringstream m_stringbuffer;   // used to read files from a string
-		std::ifstream     m_instream;       // used to read from list of files
-		std::stringstream m_urlbuffer;      // used to read data over internet
-		std::string       m_newfilebuffer;  // used to keep track of !!!!segment:
-		                                    // records.
-
-		std::vector<std::string>  m_filelist;       // used when not using cin
-		int                       m_curfile;        // index into filelist
-
-		std::vector<std::string>  m_universals;     // storage for universal comments
-
-		// Automatic URL downloading of data from internet in read():
-		void     fillUrlBuffer            (std::stringstream& uribuffer,
-		                                   const std::string& uriname);
-
-};
-
-
-
-///////////////////////////////////////////////////////////////////////////
-
-class HumdrumFileSet {
-   public:
-                            HumdrumFileSet   (void);
-                            HumdrumFileSet   (Options& options);
-                            HumdrumFileSet   (const std::string& contents);
-                           ~HumdrumFileSet   ();
-
-      void                  clear            (void);
-      void                  clearNoFree      (void);
-      int                   getSize          (void);
-      int                   getCount         (void) { return getSize(); }
-      HumdrumFile&          operator[]       (int index);
-		bool                  swap             (int index1, int index2);
-		bool                  hasFilters       (void);
-		bool                  hasGlobalFilters    (void);
-		bool                  hasUniversalFilters (void);
-		std::vector<HumdrumLine*> getUniversalReferenceRecords(void);
-
-      int                   readFile         (const std::string& filename);
-      int                   readString       (const std::string& contents);
-      int                   readStringCsv    (const std::string& contents);
-      int                   read             (std::istream& inStream);
-      int                   read             (Options& options);
-      int                   read             (HumdrumFileStream& instream);
-
-      int                   readAppendFile   (const std::string& filename);
-      int                   readAppendString (const std::string& contents);
-      int                   readAppendStringCsv (const std::string& contents);
-      int                   readAppend       (std::istream& inStream);
-      int                   readAppend       (Options& options);
-      int                   readAppend       (HumdrumFileStream& instream);
-      int                   readAppendHumdrum(HumdrumFile& infile);
-		int                   appendHumdrumPointer(HumdrumFile* infile);
-
-   protected:
-      vector<HumdrumFile*>  m_data;
-
-      void                  appendHumdrumFileContent(const std::string& filename,
-                                               std::stringstream& inbuffer);
-};
-
-
-
 
 class Tool_autobeam : public HumTool {
 	public:
@@ -4899,7 +5743,7 @@ class Tool_autobeam : public HumTool {
 		void     removeBeamCharacters(HTp token);
 
 	private:
-		std::vector<std::vector<pair<int, HumNum> > > m_timesigs;
+		HumdrumFile*     m_infile = NULL;
 		std::vector<HTp> m_kernspines;
 		bool        m_overwriteQ = false;
 		int         m_track;
@@ -4998,6 +5842,14 @@ class Tool_autostem : public HumTool {
 };
 
 
+class BinrollNote {
+	public:
+		int pitch      = 0;  // MIDI note number
+		int startindex = 0;  // time step of the attack
+		int endindex   = 0;  // time step after the end of the note
+};
+
+
 class Tool_binroll : public HumTool {
 	public:
 		         Tool_binroll      (void);
@@ -5009,14 +5861,36 @@ class Tool_binroll : public HumTool {
 		bool     run               (HumdrumFile& infile, ostream& out);
 
 	protected:
-		void     processFile       (HumdrumFile& infile);
-		void     processStrand     (vector<vector<char>>& roll, HTp starting,
-		                            HTp ending);
-		void     printAnalysis     (HumdrumFile& infile,
-		                            vector<vector<char>>& roll);
+		void     initialize        (void);
+		void     processFile       (HumdrumFile& infile, ostream& out);
+		int      getWindowEndLine  (HumdrumFile& infile, int startline);
+		int      getStepIndex      (int64_t tick);
+		void     storeLineNotes    (vector<BinrollNote>& notes,
+		                            HumdrumLine& line);
+		void     addNote           (const BinrollNote& note,
+		                            vector<BinrollNote>& carry);
+		void     clearRoll         (int width);
+		void     setBitRange       (vector<uint64_t>& row, int startindex,
+		                            int endindex);
+		void     printRoll         (ostream& out, int width);
+		void     printHeader       (HumdrumFile& infile, ostream& out);
+		void     printTrailer      (HumdrumFile& infile, ostream& out);
+		void     printComment      (const string& line, ostream& out);
 
 	private:
 		HumNum    m_duration;
+		int       m_measures = 0;      // used with -m option
+
+		// m_onsets, m_sustains: bit-packed piano roll of the current
+		// window, with one row of 64-bit words for each MIDI pitch.
+		vector<vector<uint64_t>> m_onsets;
+		vector<vector<uint64_t>> m_sustains;
+
+		// time-step calculation: index = tick * m_stepden / m_stepnum.
+		int64_t   m_stepnum = 1;
+		int64_t   m_stepden = 1;
+		int       m_windowstart = 0;   // first time step of window
+		int       m_windowend   = 0;   // time step after window
 
 };
 
@@ -5658,6 +6532,8 @@ class Tool_filter : public HumTool {
 		void     getUniversalCommandList(std::vector<std::pair<std::string, std::string> >& commands,
 		                             HumdrumFileSet& infiles);
 		void     initialize         (HumdrumFile& infile);
+		void     analyzeInput       (HumdrumFile& infile, int& analyzed,
+		                             int level);
 		void     removeGlobalFilterLines    (HumdrumFile& infile);
 		void     removeUniversalFilterLines (HumdrumFileSet& infiles);
 
@@ -5838,9 +6714,13 @@ class Tool_humdiff : public HumTool {
 		void     compareFiles       (HumdrumFile& reference, HumdrumFile& alternate);
 
 		void     compareTimePoints  (vector<vector<TimePoint>>& timepoints, HumdrumFile& reference, HumdrumFile& alternate);
+		void     alignTimePoints    (vector<pair<int, int>>& alignment, vector<vector<TimePoint>>& timepoints);
+		void     getTimePointNotes  (vector<pair<int, HumNum>>& notes, TimePoint& tp);
+		int      getMatchCost       (vector<pair<int, HumNum>>& notes1, HumNum dur1, vector<pair<int, HumNum>>& notes2, HumNum dur2);
+		void     reportMeasureGaps  (vector<pair<int, int>>& alignment, vector<vector<TimePoint>>& timepoints);
 		void     extractTimePoints  (vector<TimePoint>& points, HumdrumFile& infile);
 		void     printTimePoints    (vector<TimePoint>& timepoints);
-		void     compareLines       (HumNum minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles);
+		void     compareLines       (vector<int>& indexes, vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles);
 		void     getNoteList        (vector<NotePoint>& notelist, HumdrumFile& infile, int line, int measure, int sourceindex, int tpindex);
 		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps);
 		void     printNotePoints    (vector<NotePoint>& notelist);
@@ -5946,6 +6826,8 @@ class Tool_imitation : public HumTool {
 		int     checkForIntervalSequence(vector<int>& m_intervals,
 		                            vector<double>& v1i, int starti, int count);
 		void    markedTiedNotes    (vector<HTp>& tokens);
+		string  getIntervalKey     (vector<double>& intervals, int start,
+		                            int count, bool negate);
 
 	private:
 	 	vector<HTp> m_kernspines;
@@ -5959,7 +6841,7 @@ class Tool_imitation : public HumTool {
 		bool m_mark;
 		char m_marker = '@';
 		bool m_single = false;
-		static int Enumerator;
+		int m_enumerator = 0;
 		bool m_first = false;
 		bool m_nozero = false;
 		bool m_onlyzero = false;
@@ -6468,6 +7350,170 @@ class TextInfo {
 };
 
 
+class MSearchPosting {
+	public:
+		MSearchPosting(void) {
+			file   = 0;
+			voice  = 0;
+			attack = 0;
+		}
+		MSearchPosting(int f, int v, int a) {
+			file   = f;
+			voice  = v;
+			attack = a;
+		}
+		bool operator<(const MSearchPosting& posting) const {
+			if (file != posting.file) {
+				return file < posting.file;
+			}
+			if (voice != posting.voice) {
+				return voice < posting.voice;
+			}
+			return attack < posting.attack;
+		}
+		bool operator==(const MSearchPosting& posting) const {
+			return (file == posting.file) && (voice == posting.voice) &&
+					(attack == posting.attack);
+		}
+		int file;    // index of the file in MSearchIndex
+		int voice;   // voice index in the NoteGrid of the file
+		int attack;  // index in the note-and-rest attack list of the voice
+};
+
+
+class MSearchIndex {
+	public:
+		                   MSearchIndex      (void);
+		                  ~MSearchIndex      ();
+
+		void               clear             (void);
+		void               setNgramLength    (int length);
+		int                getNgramLength    (void) const;
+
+		int                addFile           (HumdrumFile& infile);
+		int                addFile           (const string& filename,
+		                                      NoteGrid& grid);
+		bool               read              (const string& indexfile);
+		bool               read              (istream& input);
+		bool               write             (const string& indexfile) const;
+		ostream&           write             (ostream& out) const;
+
+		int                getFileCount      (void) const;
+		int                getFileIndex      (const string& filename) const;
+		const string&      getFileName       (int index) const;
+		int                getNgramCount     (void) const;
+
+		bool               search            (const vector<MSearchQueryToken>& query,
+		                                      vector<MSearchPosting>& matches) const;
+		bool               search            (const vector<MSearchQueryToken>& query,
+		                                      const string& filename,
+		                                      vector<MSearchPosting>& matches) const;
+
+		static char        getNoteSymbol     (NoteCell* cell);
+		static char        getQuerySymbol    (const MSearchQueryToken& token);
+
+	protected:
+		int                getLongestPitchRun(const vector<MSearchQueryToken>& query,
+		                                      string& symbols) const;
+
+	private:
+		// m_ngram: The number of consecutive attacks in each index key.
+		int m_ngram = 3;
+
+		// m_files: The list of indexed filenames.
+		vector<string> m_files;
+
+		// m_fileindex: Lookup table for file indexes by name.  The first
+		// file is used if names are repeated.
+		std::unordered_map<string, int> m_fileindex;
+
+		// m_postings: List of (file, voice, attack) for each n-gram of
+		// diatonic pitch classes (c-b, and r for rests).  Postings are sorted.
+		std::unordered_map<string, vector<MSearchPosting>> m_postings;
+};
+
+
+class MSearchMatch {
+	public:
+		MSearchMatch(void) {
+			query = 0;
+			start = 0;
+			end   = -1;
+		}
+		MSearchMatch(int q, int s, int e) {
+			query = q;
+			start = s;
+			end   = e;
+		}
+		int query;   // index of the query in MSearchMatcher
+		int start;   // index of the first attack in the match
+		int end;     // index of the attack after the match (-1 = none)
+};
+
+
+class MSearchMatcher {
+	public:
+		                   MSearchMatcher    (void);
+		                  ~MSearchMatcher    ();
+
+		void               clear             (void);
+		int                addQuery          (const vector<MSearchQueryToken>& query);
+		int                getQueryCount     (void) const;
+		void               search            (vector<NoteCell*>& notes,
+		                                      vector<MSearchMatch>& matches);
+
+	protected:
+		void               resizeRows        (vector<vector<uint64_t>>& rows,
+		                                      int words);
+		void               restrictBit       (vector<vector<uint64_t>>& rows,
+		                                      int bit, int allowed,
+		                                      int allowed2 = -1);
+		int                getDurationRow    (HumNum duration);
+		void               addMatch          (vector<MSearchMatch>& matches,
+		                                      int query, int start, int count);
+
+	private:
+		struct QueryInfo {
+			int tokens;    // number of tokens in the query
+			int length;    // number of attacks matched by the query
+			int firstbit;  // state bit of the first attack
+		};
+
+		// m_queries: The list of compiled queries.  Each query with a
+		// non-zero length uses one state bit for each attack that it
+		// matches, and the bits for all queries are concatenated.
+		vector<QueryInfo> m_queries;
+		int m_bitcount = 0;
+
+		// m_bitquery: The query index for each state bit.
+		vector<int> m_bitquery;
+
+		// m_start, m_final: State bits of the first and last attacks
+		// of each query.
+		vector<uint64_t> m_start;
+		vector<uint64_t> m_final;
+
+		// Bit masks of the query attacks which accept a note feature.
+		// The mask for a note is the intersection of the rows for
+		// each of its features:
+		//    m_dpcrows:    diatonic pitch class (7 = rest)
+		//    m_b40rows:    base-40 pitch class (40 = rest)
+		//    m_b40dirrows: base-40 direction from the previous note
+		//                  (0 = up, 1 = down, 2 = same, 3 = first note)
+		//    m_midirows:   MIDI direction from the previous note
+		//                  (0 = up, 1 = down, 2 = same, 3 = none)
+		//    m_durrows:    durations in the queries (m_durations)
+		//    m_durother:   any other duration
+		vector<vector<uint64_t>> m_dpcrows;
+		vector<vector<uint64_t>> m_b40rows;
+		vector<vector<uint64_t>> m_b40dirrows;
+		vector<vector<uint64_t>> m_midirows;
+		vector<vector<uint64_t>> m_durrows;
+		vector<uint64_t> m_durother;
+		vector<HumNum> m_durations;
+};
+
+
 class Tool_msearch : public HumTool {
 	public:
 		         Tool_msearch      (void);
@@ -6477,15 +7523,19 @@ class Tool_msearch : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		void     fillMusicQuery    (vector<MSearchQueryToken>& query,
+		                            const string& input);
+		bool     filterFileList    (vector<string>& files);
 
 	protected:
 		void    initialize         (void);
 		void    doMusicSearch      (HumdrumFile& infile, NoteGrid& grid,
-		                            vector<MSearchQueryToken>& query);
+		                            vector<MSearchPosting>* candidates = NULL);
+		bool    loadQueries        (void);
+		void    printMatch         (HumdrumFile& infile, int query,
+		                            vector<NoteCell*>& match);
 		void    doTextSearch       (HumdrumFile& infile, NoteGrid& grid,
 		                            vector<MSearchTextQuery>& query);
-		void    fillMusicQuery     (vector<MSearchQueryToken>& query,
-		                            const string& input);
 		void    fillTextQuery      (vector<MSearchTextQuery>& query,
 		                            const string& input);
 		bool    checkForMatchDiatonicPC(vector<NoteCell*>& notes, int index,
@@ -6498,11 +7548,33 @@ class Tool_msearch : public HumTool {
 		                            vector<TextInfo*>& words);
 		void    fillWordsForTrack  (vector<TextInfo*>& words,
 		                            HTp starttoken);
+		bool    loadIndex          (void);
+		bool    getIndexCandidates (HumdrumFile& infile,
+		                            vector<MSearchPosting>& candidates);
 
 	private:
 	 	vector<HTp> m_kernspines;
 		string      m_text;
 		string      m_marker;
+
+		// m_queries: The music queries from the -q option, or one for
+		// each line of the --query-file option.  m_matcher searches
+		// for all of the queries in one pass through each voice.
+		vector<vector<MSearchQueryToken>> m_queries;
+		vector<string> m_querystrings;
+		MSearchMatcher m_matcher;
+		bool        m_queriesloaded = false;
+
+		// m_index: Optional n-gram index of the input files used to
+		// limit the search to candidate locations (--index option).
+		MSearchIndex m_index;
+		bool        m_indexloaded = false;
+
+		// m_indexusable: True if all queries are long enough to be looked
+		// up in the index.  m_candidates are the match locations of any
+		// of the queries in all indexed files, sorted by file.
+		bool        m_indexusable = false;
+		vector<MSearchPosting> m_candidates;
 };
 
 
@@ -7023,6 +8095,8 @@ class Tool_periodicity : public HumTool {
 		void     fillAttackGrids    (HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy);
 		void     printAttackGrid    (ostream& out, HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy);
 		void     doAnalysis         (vector<vector<double>>& analysis, int level, vector<double>& grid);
+		void     doSparseAnalysis   (vector<vector<double>>& analysis, int level,
+		                             vector<int>& positions, vector<double>& weights);
 		void     doPeriodicityAnalysis(vector<vector<double>> & analysis, vector<double>& grid, HumNum minrhy);
 		void     printPeriodicityAnalysis(ostream& out, vector<vector<double>>& analysis);
 		void     printSvgAnalysis(ostream& out, vector<vector<double>>& analysis, HumNum minrhy);
@@ -7410,6 +8484,12 @@ class MeasureComparisonGrid {
 		void         clear                     (void);
 		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2);
 		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2);
+		void         analyzeSparse             (MeasureDataSet& set1, MeasureDataSet& set2,
+		                                        int topk, double threshold);
+		void         setThreadCount            (int count);
+		int          getRowCount               (void);
+		int          getColumnCount            (void);
+		double       getCorrelation7pc         (int index1, int index2);
 
 		double       getStartTime1             (int index);
 		double       getStopTime1              (int index);
@@ -7429,11 +8509,51 @@ class MeasureComparisonGrid {
 		ostream&     printCorrelationGrid      (ostream& out = std::cout);
 		ostream&     printCorrelationDiagonal  (ostream& out = std::cout);
 		ostream&     printSvgGrid              (ostream& out = std::cout);
+		ostream&     printSparseGrid           (ostream& out = std::cout);
 		void         getColorMapping           (double input, double& hue, double& saturation,
 				 double& lightness);
 
+	protected:
+		enum { HIST_STRIDE = 8 };
+
+		void         packHistograms            (MeasureDataSet& set,
+		                                        std::vector<double>& hist,
+		                                        std::vector<double>& sd,
+		                                        std::vector<char>& empty);
+		double       correlate                 (int index1, int index2);
+		void         analyzeRows               (int startrow, int stoprow);
+		void         runThreads                (void);
+
 	private:
-		std::vector<std::vector<MeasureComparison>> m_grid;
+		// m_hist1, m_hist2: The 7-pc histograms of each measure, packed
+		// into contiguous arrays (HIST_STRIDE values per measure) as the
+		// deviations from the running mean of the histogram.
+		// m_sd1, m_sd2: The standard deviation of each histogram.
+		// m_empty1, m_empty2: Set for measures without notes.
+		std::vector<double> m_hist1;
+		std::vector<double> m_hist2;
+		std::vector<double> m_sd1;
+		std::vector<double> m_sd2;
+		std::vector<char>   m_empty1;
+		std::vector<char>   m_empty2;
+		int m_rows = 0;
+		int m_cols = 0;
+
+		// m_grid: The full correlation matrix (m_rows * m_cols) when
+		// calculated with analyze().
+		std::vector<double> m_grid;
+
+		// m_sparse: For each row, the (column, correlation) pairs above
+		// the threshold and/or in the top-k of the row when calculated
+		// with analyzeSparse().  m_sparseQ is true in sparse mode.
+		std::vector<std::vector<std::pair<int, double>>> m_sparse;
+		bool   m_sparseQ   = false;
+		int    m_topk      = 0;
+		double m_threshold = -1.0;
+
+		// m_threads: The number of threads for calculating the grid.
+		int    m_threads   = 1;
+
 		MeasureDataSet* m_set1 = NULL;
 		MeasureDataSet* m_set2 = NULL;
 };
@@ -7608,28 +8728,28 @@ class Tool_transpose : public HumTool {
 		                                 int segments, vector<int>& ktracks,
 		                                 vector<vector<vector<double> > >&
 		                                 trackhist);
+		void     buildHistogramPrefixSums(vector<vector<double> >& prefixhist,
+		                                 vector<vector<double> >& trackhist);
 		void     doTrackKeyAnalysis     (vector<vector<double> >& analysis,
 		                                 int level, int hop, int count,
-		                                 vector<vector<double> >& trackhist,
-		                                 vector<double>& majorweights,
-		                                 vector<double>& minorweights);
+		                                 vector<vector<double> >& prefixhist,
+		                                 vector<vector<double> >& profiles);
 		void     identifyKeyDouble      (vector<double>& correls,
 		                                 vector<double>& histogram,
 		                                 vector<double>& majorweights,
 		                                 vector<double>& minorweights);
 		void     fillWeightsWithKostkaPayne(vector<double>& maj,
 		                                 vector<double>& min);
+		void     fillKeyProfileMatrix   (vector<vector<double> >& profiles);
 		void     printRawTrackAnalysis  (vector<vector<vector<double> > >&
 		                                 analysis, vector<int>& ktracks);
 		void     doSingleAnalysis       (vector<double>& analysis,
 		                                 int startindex, int length,
-		                                 vector<vector<double> >& trackhist,
-		                                 vector<double>& majorweights,
-		                                 vector<double>& minorweights);
+		                                 vector<vector<double> >& prefixhist,
+		                                 vector<vector<double> >& profiles);
 		void     identifyKey            (vector<double>& correls,
 		                                 vector<double>& histogram,
-		                                 vector<double>& majorweights,
-		                                 vector<double>& minorweights);
+		                                 vector<vector<double> >& profiles);
 		void     doTranspositionAnalysis(vector<vector<vector<double> > >&
 		                                 analysis);
 		int      calculateTranspositionFromKey(int targetkey,
@@ -55,7 +55,7 @@ class Tool_autobeam : public HumTool {
 		void     removeBeamCharacters(HTp token);
 
 	private:
-		std::vector<std::vector<pair<int, HumNum> > > m_timesigs;
+		HumdrumFile*     m_infile = NULL;
 		std::vector<HTp> m_kernspines;
 		bool        m_overwriteQ = false;
 		int         m_track;
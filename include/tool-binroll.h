@@ -17,10 +17,20 @@
 #include "HumNum.h"
 #include "HumdrumFile.h"
 
+#include <cstdint>
+
 namespace hum {
 
 // START_MERGE
 
+class BinrollNote {
+	public:
+		int pitch      = 0;  // MIDI note number
+		int startindex = 0;  // time step of the attack
+		int endindex   = 0;  // time step after the end of the note
+};
+
+
 class Tool_binroll : public HumTool {
 	public:
 		         Tool_binroll      (void);
@@ -32,14 +42,36 @@ class Tool_binroll : public HumTool {
 		bool     run               (HumdrumFile& infile, ostream& out);
 
 	protected:
-		void     processFile       (HumdrumFile& infile);
-		void     processStrand     (vector<vector<char>>& roll, HTp starting,
-		                            HTp ending);
-		void     printAnalysis     (HumdrumFile& infile,
-		                            vector<vector<char>>& roll);
+		void     initialize        (void);
+		void     processFile       (HumdrumFile& infile, ostream& out);
+		int      getWindowEndLine  (HumdrumFile& infile, int startline);
+		int      getStepIndex      (int64_t tick);
+		void     storeLineNotes    (vector<BinrollNote>& notes,
+		                            HumdrumLine& line);
+		void     addNote           (const BinrollNote& note,
+		                            vector<BinrollNote>& carry);
+		void     clearRoll         (int width);
+		void     setBitRange       (vector<uint64_t>& row, int startindex,
+		                            int endindex);
+		void     printRoll         (ostream& out, int width);
+		void     printHeader       (HumdrumFile& infile, ostream& out);
+		void     printTrailer      (HumdrumFile& infile, ostream& out);
+		void     printComment      (const string& line, ostream& out);
 
 	private:
 		HumNum    m_duration;
+		int       m_measures = 0;      // used with -m option
+
+		// m_onsets, m_sustains: bit-packed piano roll of the current
+		// window, with one row of 64-bit words for each MIDI pitch.
+		vector<vector<uint64_t>> m_onsets;
+		vector<vector<uint64_t>> m_sustains;
+
+		// time-step calculation: index = tick * m_stepden / m_stepnum.
+		int64_t   m_stepnum = 1;
+		int64_t   m_stepden = 1;
+		int       m_windowstart = 0;   // first time step of window
+		int       m_windowend   = 0;   // time step after window
 
 };
 
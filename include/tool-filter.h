@@ -37,6 +37,8 @@ class Tool_filter : public HumTool {
 		void     getUniversalCommandList(std::vector<std::pair<std::string, std::string> >& commands,
 		                             HumdrumFileSet& infiles);
 		void     initialize         (HumdrumFile& infile);
+		void     analyzeInput       (HumdrumFile& infile, int& analyzed,
+		                             int level);
 		void     removeGlobalFilterLines    (HumdrumFile& infile);
 		void     removeUniversalFilterLines (HumdrumFileSet& infiles);
 
@@ -100,9 +100,13 @@ class Tool_humdiff : public HumTool {
 		void     compareFiles       (HumdrumFile& reference, HumdrumFile& alternate);
 
 		void     compareTimePoints  (vector<vector<TimePoint>>& timepoints, HumdrumFile& reference, HumdrumFile& alternate);
+		void     alignTimePoints    (vector<pair<int, int>>& alignment, vector<vector<TimePoint>>& timepoints);
+		void     getTimePointNotes  (vector<pair<int, HumNum>>& notes, TimePoint& tp);
+		int      getMatchCost       (vector<pair<int, HumNum>>& notes1, HumNum dur1, vector<pair<int, HumNum>>& notes2, HumNum dur2);
+		void     reportMeasureGaps  (vector<pair<int, int>>& alignment, vector<vector<TimePoint>>& timepoints);
 		void     extractTimePoints  (vector<TimePoint>& points, HumdrumFile& infile);
 		void     printTimePoints    (vector<TimePoint>& timepoints);
-		void     compareLines       (HumNum minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles);
+		void     compareLines       (vector<int>& indexes, vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles);
 		void     getNoteList        (vector<NotePoint>& notelist, HumdrumFile& infile, int line, int measure, int sourceindex, int tpindex);
 		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps);
 		void     printNotePoints    (vector<NotePoint>& notelist);
@@ -48,6 +48,8 @@ class Tool_imitation : public HumTool {
 		int     checkForIntervalSequence(vector<int>& m_intervals,
 		                            vector<double>& v1i, int starti, int count);
 		void    markedTiedNotes    (vector<HTp>& tokens);
+		string  getIntervalKey     (vector<double>& intervals, int start,
+		                            int count, bool negate);
 
 	private:
 	 	vector<HTp> m_kernspines;
@@ -61,7 +63,7 @@ class Tool_imitation : public HumTool {
 		bool m_mark;
 		char m_marker = '@';
 		bool m_single = false;
-		static int Enumerator;
+		int m_enumerator = 0;
 		bool m_first = false;
 		bool m_nozero = false;
 		bool m_onlyzero = false;
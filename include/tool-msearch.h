@@ -17,6 +17,12 @@
 #include "HumdrumFile.h"
 #include "NoteGrid.h"
 
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace hum {
 
 // START_MERGE
@@ -120,6 +126,170 @@ class TextInfo {
 };
 
 
+class MSearchPosting {
+	public:
+		MSearchPosting(void) {
+			file   = 0;
+			voice  = 0;
+			attack = 0;
+		}
+		MSearchPosting(int f, int v, int a) {
+			file   = f;
+			voice  = v;
+			attack = a;
+		}
+		bool operator<(const MSearchPosting& posting) const {
+			if (file != posting.file) {
+				return file < posting.file;
+			}
+			if (voice != posting.voice) {
+				return voice < posting.voice;
+			}
+			return attack < posting.attack;
+		}
+		bool operator==(const MSearchPosting& posting) const {
+			return (file == posting.file) && (voice == posting.voice) &&
+					(attack == posting.attack);
+		}
+		int file;    // index of the file in MSearchIndex
+		int voice;   // voice index in the NoteGrid of the file
+		int attack;  // index in the note-and-rest attack list of the voice
+};
+
+
+class MSearchIndex {
+	public:
+		                   MSearchIndex      (void);
+		                  ~MSearchIndex      ();
+
+		void               clear             (void);
+		void               setNgramLength    (int length);
+		int                getNgramLength    (void) const;
+
+		int                addFile           (HumdrumFile& infile);
+		int                addFile           (const string& filename,
+		                                      NoteGrid& grid);
+		bool               read              (const string& indexfile);
+		bool               read              (istream& input);
+		bool               write             (const string& indexfile) const;
+		ostream&           write             (ostream& out) const;
+
+		int                getFileCount      (void) const;
+		int                getFileIndex      (const string& filename) const;
+		const string&      getFileName       (int index) const;
+		int                getNgramCount     (void) const;
+
+		bool               search            (const vector<MSearchQueryToken>& query,
+		                                      vector<MSearchPosting>& matches) const;
+		bool               search            (const vector<MSearchQueryToken>& query,
+		                                      const string& filename,
+		                                      vector<MSearchPosting>& matches) const;
+
+		static char        getNoteSymbol     (NoteCell* cell);
+		static char        getQuerySymbol    (const MSearchQueryToken& token);
+
+	protected:
+		int                getLongestPitchRun(const vector<MSearchQueryToken>& query,
+		                                      string& symbols) const;
+
+	private:
+		// m_ngram: The number of consecutive attacks in each index key.
+		int m_ngram = 3;
+
+		// m_files: The list of indexed filenames.
+		vector<string> m_files;
+
+		// m_fileindex: Lookup table for file indexes by name.  The first
+		// file is used if names are repeated.
+		std::unordered_map<string, int> m_fileindex;
+
+		// m_postings: List of (file, voice, attack) for each n-gram of
+		// diatonic pitch classes (c-b, and r for rests).  Postings are sorted.
+		std::unordered_map<string, vector<MSearchPosting>> m_postings;
+};
+
+
+class MSearchMatch {
+	public:
+		MSearchMatch(void) {
+			query = 0;
+			start = 0;
+			end   = -1;
+		}
+		MSearchMatch(int q, int s, int e) {
+			query = q;
+			start = s;
+			end   = e;
+		}
+		int query;   // index of the query in MSearchMatcher
+		int start;   // index of the first attack in the match
+		int end;     // index of the attack after the match (-1 = none)
+};
+
+
+class MSearchMatcher {
+	public:
+		                   MSearchMatcher    (void);
+		                  ~MSearchMatcher    ();
+
+		void               clear             (void);
+		int                addQuery          (const vector<MSearchQueryToken>& query);
+		int                getQueryCount     (void) const;
+		void               search            (vector<NoteCell*>& notes,
+		                                      vector<MSearchMatch>& matches);
+
+	protected:
+		void               resizeRows        (vector<vector<uint64_t>>& rows,
+		                                      int words);
+		void               restrictBit       (vector<vector<uint64_t>>& rows,
+		                                      int bit, int allowed,
+		                                      int allowed2 = -1);
+		int                getDurationRow    (HumNum duration);
+		void               addMatch          (vector<MSearchMatch>& matches,
+		                                      int query, int start, int count);
+
+	private:
+		struct QueryInfo {
+			int tokens;    // number of tokens in the query
+			int length;    // number of attacks matched by the query
+			int firstbit;  // state bit of the first attack
+		};
+
+		// m_queries: The list of compiled queries.  Each query with a
+		// non-zero length uses one state bit for each attack that it
+		// matches, and the bits for all queries are concatenated.
+		vector<QueryInfo> m_queries;
+		int m_bitcount = 0;
+
+		// m_bitquery: The query index for each state bit.
+		vector<int> m_bitquery;
+
+		// m_start, m_final: State bits of the first and last attacks
+		// of each query.
+		vector<uint64_t> m_start;
+		vector<uint64_t> m_final;
+
+		// Bit masks of the query attacks which accept a note feature.
+		// The mask for a note is the intersection of the rows for
+		// each of its features:
+		//    m_dpcrows:    diatonic pitch class (7 = rest)
+		//    m_b40rows:    base-40 pitch class (40 = rest)
+		//    m_b40dirrows: base-40 direction from the previous note
+		//                  (0 = up, 1 = down, 2 = same, 3 = first note)
+		//    m_midirows:   MIDI direction from the previous note
+		//                  (0 = up, 1 = down, 2 = same, 3 = none)
+		//    m_durrows:    durations in the queries (m_durations)
+		//    m_durother:   any other duration
+		vector<vector<uint64_t>> m_dpcrows;
+		vector<vector<uint64_t>> m_b40rows;
+		vector<vector<uint64_t>> m_b40dirrows;
+		vector<vector<uint64_t>> m_midirows;
+		vector<vector<uint64_t>> m_durrows;
+		vector<uint64_t> m_durother;
+		vector<HumNum> m_durations;
+};
+
+
 class Tool_msearch : public HumTool {
 	public:
 		         Tool_msearch      (void);
@@ -129,15 +299,19 @@ class Tool_msearch : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		void     fillMusicQuery    (vector<MSearchQueryToken>& query,
+		                            const string& input);
+		bool     filterFileList    (vector<string>& files);
 
 	protected:
 		void    initialize         (void);
 		void    doMusicSearch      (HumdrumFile& infile, NoteGrid& grid,
-		                            vector<MSearchQueryToken>& query);
+		                            vector<MSearchPosting>* candidates = NULL);
+		bool    loadQueries        (void);
+		void    printMatch         (HumdrumFile& infile, int query,
+		                            vector<NoteCell*>& match);
 		void    doTextSearch       (HumdrumFile& infile, NoteGrid& grid,
 		                            vector<MSearchTextQuery>& query);
-		void    fillMusicQuery     (vector<MSearchQueryToken>& query,
-		                            const string& input);
 		void    fillTextQuery      (vector<MSearchTextQuery>& query,
 		                            const string& input);
 		bool    checkForMatchDiatonicPC(vector<NoteCell*>& notes, int index,
@@ -150,11 +324,33 @@ class Tool_msearch : public HumTool {
 		                            vector<TextInfo*>& words);
 		void    fillWordsForTrack  (vector<TextInfo*>& words,
 		                            HTp starttoken);
+		bool    loadIndex          (void);
+		bool    getIndexCandidates (HumdrumFile& infile,
+		                            vector<MSearchPosting>& candidates);
 
 	private:
 	 	vector<HTp> m_kernspines;
 		string      m_text;
 		string      m_marker;
+
+		// m_queries: The music queries from the -q option, or one for
+		// each line of the --query-file option.  m_matcher searches
+		// for all of the queries in one pass through each voice.
+		vector<vector<MSearchQueryToken>> m_queries;
+		vector<string> m_querystrings;
+		MSearchMatcher m_matcher;
+		bool        m_queriesloaded = false;
+
+		// m_index: Optional n-gram index of the input files used to
+		// limit the search to candidate locations (--index option).
+		MSearchIndex m_index;
+		bool        m_indexloaded = false;
+
+		// m_indexusable: True if all queries are long enough to be looked
+		// up in the index.  m_candidates are the match locations of any
+		// of the queries in all indexed files, sorted by file.
+		bool        m_indexusable = false;
+		vector<MSearchPosting> m_candidates;
 };
 
 // END_MERGE
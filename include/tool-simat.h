@@ -17,6 +17,8 @@
 #include "HumdrumFile.h"
 
 #include <iostream>
+#include <utility>
+#include <vector>
 
 namespace hum {
 
@@ -105,6 +107,12 @@ class MeasureComparisonGrid {
 		void         clear                     (void);
 		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2);
 		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2);
+		void         analyzeSparse             (MeasureDataSet& set1, MeasureDataSet& set2,
+		                                        int topk, double threshold);
+		void         setThreadCount            (int count);
+		int          getRowCount               (void);
+		int          getColumnCount            (void);
+		double       getCorrelation7pc         (int index1, int index2);
 
 		double       getStartTime1             (int index);
 		double       getStopTime1              (int index);
@@ -124,11 +132,51 @@ class MeasureComparisonGrid {
 		ostream&     printCorrelationGrid      (ostream& out = std::cout);
 		ostream&     printCorrelationDiagonal  (ostream& out = std::cout);
 		ostream&     printSvgGrid              (ostream& out = std::cout);
+		ostream&     printSparseGrid           (ostream& out = std::cout);
 		void         getColorMapping           (double input, double& hue, double& saturation,
 				 double& lightness);
 
+	protected:
+		enum { HIST_STRIDE = 8 };
+
+		void         packHistograms            (MeasureDataSet& set,
+		                                        std::vector<double>& hist,
+		                                        std::vector<double>& sd,
+		                                        std::vector<char>& empty);
+		double       correlate                 (int index1, int index2);
+		void         analyzeRows               (int startrow, int stoprow);
+		void         runThreads                (void);
+
 	private:
-		std::vector<std::vector<MeasureComparison>> m_grid;
+		// m_hist1, m_hist2: The 7-pc histograms of each measure, packed
+		// into contiguous arrays (HIST_STRIDE values per measure) as the
+		// deviations from the running mean of the histogram.
+		// m_sd1, m_sd2: The standard deviation of each histogram.
+		// m_empty1, m_empty2: Set for measures without notes.
+		std::vector<double> m_hist1;
+		std::vector<double> m_hist2;
+		std::vector<double> m_sd1;
+		std::vector<double> m_sd2;
+		std::vector<char>   m_empty1;
+		std::vector<char>   m_empty2;
+		int m_rows = 0;
+		int m_cols = 0;
+
+		// m_grid: The full correlation matrix (m_rows * m_cols) when
+		// calculated with analyze().
+		std::vector<double> m_grid;
+
+		// m_sparse: For each row, the (column, correlation) pairs above
+		// the threshold and/or in the top-k of the row when calculated
+		// with analyzeSparse().  m_sparseQ is true in sparse mode.
+		std::vector<std::vector<std::pair<int, double>>> m_sparse;
+		bool   m_sparseQ   = false;
+		int    m_topk      = 0;
+		double m_threshold = -1.0;
+
+		// m_threads: The number of threads for calculating the grid.
+		int    m_threads   = 1;
+
 		MeasureDataSet* m_set1 = NULL;
 		MeasureDataSet* m_set2 = NULL;
 };
@@ -75,28 +75,28 @@ class Tool_transpose : public HumTool {
 		                                 int segments, vector<int>& ktracks,
 		                                 vector<vector<vector<double> > >&
 		                                 trackhist);
+		void     buildHistogramPrefixSums(vector<vector<double> >& prefixhist,
+		                                 vector<vector<double> >& trackhist);
 		void     doTrackKeyAnalysis     (vector<vector<double> >& analysis,
 		                                 int level, int hop, int count,
-		                                 vector<vector<double> >& trackhist,
-		                                 vector<double>& majorweights,
-		                                 vector<double>& minorweights);
+		                                 vector<vector<double> >& prefixhist,
+		                                 vector<vector<double> >& profiles);
 		void     identifyKeyDouble      (vector<double>& correls,
 		                                 vector<double>& histogram,
 		                                 vector<double>& majorweights,
 		                                 vector<double>& minorweights);
 		void     fillWeightsWithKostkaPayne(vector<double>& maj,
 		                                 vector<double>& min);
+		void     fillKeyProfileMatrix   (vector<vector<double> >& profiles);
 		void     printRawTrackAnalysis  (vector<vector<vector<double> > >&
 		                                 analysis, vector<int>& ktracks);
 		void     doSingleAnalysis       (vector<double>& analysis,
 		                                 int startindex, int length,
-		                                 vector<vector<double> >& trackhist,
-		                                 vector<double>& majorweights,
-		                                 vector<double>& minorweights);
+		                                 vector<vector<double> >& prefixhist,
+		                                 vector<vector<double> >& profiles);
 		void     identifyKey            (vector<double>& correls,
 		                                 vector<double>& histogram,
-		                                 vector<double>& majorweights,
-		                                 vector<double>& minorweights);
+		                                 vector<vector<double> >& profiles);
 		void     doTranspositionAnalysis(vector<vector<vector<double> > >&
 		                                 analysis);
 		int      calculateTranspositionFromKey(int targetkey,
@@ -104,9 +104,13 @@
 #include "Convert.h"
 #include "HumdrumToken.h"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_set>
 
 using namespace std;
 
@@ -131,6 +135,73 @@ HumParameter::HumParameter(const string& str) : string(str) {
 
 
 
+//////////////////////////////
+//
+// HumParamKey::HumParamKey -- HumParamKey constructor.  The single-string
+//    version splits the namespaces and key at colons in the same manner
+//    as HumHash::getValue(key).
+//
+
+HumParamKey::HumParamKey(const string& key) {
+	auto loc1 = key.find(':');
+	if (loc1 == string::npos) {
+		m_ns1 = HumHash::internName("");
+		m_ns2 = m_ns1;
+		m_key = HumHash::internName(key);
+		return;
+	}
+	auto loc2 = key.find(':', loc1 + 1);
+	if (loc2 == string::npos) {
+		m_ns1 = HumHash::internName("");
+		m_ns2 = HumHash::internName(key.substr(0, loc1));
+		m_key = HumHash::internName(key.substr(loc1 + 1));
+		return;
+	}
+	auto loc3 = key.find(':', loc2 + 1);
+	m_ns1 = HumHash::internName(key.substr(0, loc1));
+	m_ns2 = HumHash::internName(key.substr(loc1 + 1, loc2 - loc1 - 1));
+	if (loc3 == string::npos) {
+		m_key = HumHash::internName(key.substr(loc2 + 1));
+	} else {
+		m_key = HumHash::internName(key.substr(loc2 + 1, loc3 - loc2 - 1));
+	}
+}
+
+
+HumParamKey::HumParamKey(const string& ns2, const string& key) {
+	m_ns1 = HumHash::internName("");
+	m_ns2 = HumHash::internName(ns2);
+	m_key = HumHash::internName(key);
+}
+
+
+HumParamKey::HumParamKey(const string& ns1, const string& ns2,
+		const string& key) {
+	m_ns1 = HumHash::internName(ns1);
+	m_ns2 = HumHash::internName(ns2);
+	m_key = HumHash::internName(key);
+}
+
+
+
+//////////////////////////////
+//
+// HumParamKey::operator< -- Order parameter keys by the addresses of their
+//     interned strings.
+//
+
+bool HumParamKey::operator<(const HumParamKey& key) const {
+	if (m_ns1 != key.m_ns1) {
+		return std::less<const string*>()(m_ns1, key.m_ns1);
+	}
+	if (m_ns2 != key.m_ns2) {
+		return std::less<const string*>()(m_ns2, key.m_ns2);
+	}
+	return std::less<const string*>()(m_key, key.m_key);
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::HumHash -- HumHash constructor.  The data storage is empty
@@ -142,6 +213,37 @@ HumHash::HumHash(void) {
 }
 
 
+HumHash::HumHash(const HumHash& hash) {
+	parameters = NULL;
+	if (hash.parameters) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	}
+	prefix = hash.prefix;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::operator= -- Copy the parameters of another HumHash.
+//
+
+HumHash& HumHash::operator=(const HumHash& hash) {
+	if (this == &hash) {
+		return *this;
+	}
+	if (parameters) {
+		delete parameters;
+		parameters = NULL;
+	}
+	if (hash.parameters) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	}
+	prefix = hash.prefix;
+	return *this;
+}
+
+
 
 //////////////////////////////
 //
@@ -198,23 +300,20 @@ string HumHash::getValue(const string& ns2, const string& key) const {
 
 string HumHash::getValue(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return "";
 	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return "";
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return "";
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	return *parameter;
+}
+
+
+string HumHash::getValue(const HumParamKey& key) const {
+	const HumParameter* parameter = findParameter(key);
+	if (parameter == NULL) {
 		return "";
 	}
-	return it3->second;
+	return *parameter;
 }
 
 
@@ -231,7 +330,7 @@ HTp HumHash::getValueHTp(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueHTp("", "", keys[2]);
+		return getValueHTp("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueHTp(keys[0], keys[1]);
 	} else {
@@ -253,7 +352,19 @@ HTp HumHash::getValueHTp(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return NULL;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return NULL;
+	}
+	return getValueHTp(pkey);
+}
+
+
+HTp HumHash::getValueHTp(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	string value = getValue(key);
 	if (value.find("HT_") != 0) {
 		return NULL;
 	} else {
@@ -287,7 +398,7 @@ int HumHash::getValueInt(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueInt("", "", keys[2]);
+		return getValueInt("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueInt(keys[0], keys[1]);
 	} else {
@@ -309,7 +420,19 @@ int HumHash::getValueInt(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return 0;
+	}
+	return getValueInt(pkey);
+}
+
+
+int HumHash::getValueInt(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return 0;
+	}
+	string value = getValue(key);
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return  nvalue.getInteger();
@@ -365,11 +488,21 @@ HumNum HumHash::getValueFraction(const string& ns2, const string& key) const {
 
 HumNum HumHash::getValueFraction(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (!isDefined(ns1, ns2, key)) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
-	HumNum fractionvalue(value);
+	HumNum fractionvalue(*parameter);
+	return fractionvalue;
+}
+
+
+HumNum HumHash::getValueFraction(const HumParamKey& key) const {
+	const HumParameter* parameter = findParameter(key);
+	if (parameter == NULL) {
+		return 0;
+	}
+	HumNum fractionvalue(*parameter);
 	return fractionvalue;
 }
 
@@ -392,7 +525,7 @@ double HumHash::getValueFloat(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueFloat("", "", keys[2]);
+		return getValueFloat("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueFloat(keys[0], keys[1]);
 	} else {
@@ -414,7 +547,19 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return 0.0;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return 0.0;
+	}
+	return getValueFloat(pkey);
+}
+
+
+double HumHash::getValueFloat(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return 0.0;
+	}
+	string value = getValue(key);
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return nvalue.getFloat();
@@ -446,7 +591,7 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 bool HumHash::getValueBool(const string& key) const {
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueBool("", "", keys[2]);
+		return getValueBool("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueBool(keys[0], keys[1]);
 	} else {
@@ -462,15 +607,28 @@ bool HumHash::getValueBool(const string& ns2, const string& key) const {
 
 bool HumHash::getValueBool(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return false;
 	}
-	if (!isDefined(ns1, ns2, key)) {
+	if (*parameter == "false") {
+		return false;
+	} else if (*parameter == "0") {
 		return false;
+	} else {
+		return true;
 	}
-	if ((*parameters)[ns1][ns2][key] == "false") {
+}
+
+
+bool HumHash::getValueBool(const HumParamKey& key) const {
+	const HumParameter* parameter = findParameter(key);
+	if (parameter == NULL) {
 		return false;
-	} else if ((*parameters)[ns1][ns2][key] == "0") {
+	}
+	if (*parameter == "false") {
+		return false;
+	} else if (*parameter == "0") {
 		return false;
 	} else {
 		return true;
@@ -511,8 +669,19 @@ void HumHash::setValue(const string& ns2, const string& key,
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, const string& value) {
-	initializeParameters();
-	(*parameters)[ns1][ns2][key] = value;
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, const string& value) {
+	HumParameter& parameter = insertParameter(key);
+	parameter.assign(value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, const char* value) {
+	HumParameter& parameter = insertParameter(key);
+	parameter.assign(value);
 }
 
 
@@ -552,10 +721,14 @@ void HumHash::setValue(const string& ns2, const string& key, int value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, int value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, int value) {
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -578,10 +751,14 @@ void HumHash::setValue(const string& ns2, const string& key, HTp value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HTp value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, HTp value) {
 	stringstream ss;
 	ss << "HT_" << ((long long)value);
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -604,10 +781,14 @@ void HumHash::setValue(const string& ns2, const string& key, HumNum value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HumNum value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, HumNum value) {
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -630,10 +811,14 @@ void HumHash::setValue(const string& ns2, const string& key, double value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, double value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, double value) {
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -650,8 +835,10 @@ map<string, string> HumHash::getParameters(const string& ns1, const string& ns2)
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output[it.first] = it.second;
+	for (auto& entry : *parameters) {
+		if ((entry.name.getNamespace1() == ns1) && (entry.name.getNamespace2() == ns2)) {
+			output[entry.name.getKey()] = entry.value;
+		}
 	}
 	return output;
 }
@@ -691,8 +878,10 @@ vector<string> HumHash::getKeys(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output.push_back(it.first);
+	for (auto entry : getSortedEntries()) {
+		if ((entry->name.getNamespace1() == ns1) && (entry->name.getNamespace2() == ns2)) {
+			output.push_back(entry->name.getKey());
+		}
 	}
 	return output;
 }
@@ -710,9 +899,9 @@ vector<string> HumHash::getKeys(const string& ns) const {
 		return getKeys(ns1, ns2);
 	}
 
-	for (auto& it1 : (*parameters)[ns]) {
-		for (auto& it2 : it1.second) {
-			output.push_back(it1.first + ":" + it2.first);
+	for (auto entry : getSortedEntries()) {
+		if (entry->name.getNamespace1() == ns) {
+			output.push_back(entry->name.getNamespace2() + ":" + entry->name.getKey());
 		}
 	}
 	return output;
@@ -724,12 +913,9 @@ vector<string> HumHash::getKeys(void) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			for (auto it3 : it2.second) {
-				output.push_back(it1.first + ":" + it2.first + ":" + it3.first);
-			}
-		}
+	for (auto entry : getSortedEntries()) {
+		output.push_back(entry->name.getNamespace1() + ":" +
+				entry->name.getNamespace2() + ":" + entry->name.getKey());
 	}
 	return output;
 }
@@ -747,22 +933,7 @@ vector<string> HumHash::getKeys(void) const {
 //
 
 bool HumHash::hasParameters(const string& ns1, const string& ns2) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	auto it2 = (*parameters)[ns1].find(ns2);
-	if (it2 == (*parameters)[ns1].end()) {
-		return false;
-	} else {
-		return true;
-	}
+	return getParameterCount(ns1, ns2) > 0;
 }
 
 
@@ -777,12 +948,12 @@ bool HumHash::hasParameters(const string& ns) const {
 		return hasParameters(ns1, ns2);
 	}
 
-	auto it = parameters->find(ns);
-	if (it == parameters->end()) {
-		return false;
-	} else {
-		return true;
+	for (auto& entry : *parameters) {
+		if (entry.name.getNamespace1() == ns) {
+			return true;
+		}
 	}
+	return false;
 }
 
 
@@ -790,19 +961,7 @@ bool HumHash::hasParameters(void) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	for (auto& it1 : *parameters) {
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			} else {
-				return true;
-			}
-		}
-	}
-	return false;
+	return !parameters->empty();
 }
 
 
@@ -822,18 +981,13 @@ int HumHash::getParameterCount(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return 0;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return 0;
+	int sum = 0;
+	for (auto& entry : *parameters) {
+		if ((entry.name.getNamespace1() == ns1) && (entry.name.getNamespace2() == ns2)) {
+			sum++;
+		}
 	}
-	return (int)it2->second.size();
+	return sum;
 }
 
 
@@ -848,13 +1002,11 @@ int HumHash::getParameterCount(const string& ns) const {
 		return getParameterCount(ns1, ns2);
 	}
 
-	auto it1 = parameters->find(ns);
-	if (it1 == parameters->end()) {
-		return false;
-	}
 	int sum = 0;
-	for (auto& it2 : it1->second) {
-		sum += (int)it2.second.size();
+	for (auto& entry : *parameters) {
+		if (entry.name.getNamespace1() == ns) {
+			sum++;
+		}
 	}
 	return sum;
 }
@@ -864,16 +1016,7 @@ int HumHash::getParameterCount(void) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	int sum = 0;
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			sum += (int)it2.second.size();
-		}
-	}
-	return sum;
+	return (int)parameters->size();
 }
 
 
@@ -892,29 +1035,28 @@ bool HumHash::isDefined(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return (*parameters)[""][""].count(keys[0]) ? true : false;
+		return findParameter("", "", keys[0]) ? true : false;
 	} else if (keys.size() == 2) {
-		return (*parameters)[""][keys[0]].count(keys[1]) ? true : false;
+		return findParameter("", keys[0], keys[1]) ? true : false;
 	} else {
-		return (*parameters)[keys[0]][keys[1]].count(keys[2]) ? true : false;
+		return findParameter(keys[0], keys[1], keys[2]) ? true : false;
 	}
 }
 
 
 bool HumHash::isDefined(const string& ns2, const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[""][ns2].count(key) ? true : false;
+	return findParameter("", ns2, key) ? true : false;
 }
 
 
 bool HumHash::isDefined(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[ns1][ns2].count(key) ? true : false;
+	return findParameter(ns1, ns2, key) ? true : false;
+}
+
+
+bool HumHash::isDefined(const HumParamKey& key) const {
+	return findParameter(key) ? true : false;
 }
 
 
@@ -954,22 +1096,25 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return;
 	}
-	(*parameters)[ns1][ns2].erase(key);
-
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
 		return;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
+	deleteValue(pkey);
+}
+
+
+void HumHash::deleteValue(const HumParamKey& key) {
+	if (parameters == NULL) {
 		return;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
+	auto it = std::lower_bound(parameters->begin(), parameters->end(), key,
+			[](const HumHashEntry& entry, const HumParamKey& k) {
+				return entry.name < k;
+			});
+	if ((it != parameters->end()) && !(key < it->name)) {
+		parameters->erase(it);
 	}
-	it2->second.erase(key);
 }
 
 
@@ -982,12 +1127,268 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 
 void HumHash::initializeParameters(void) {
 	if (parameters == NULL) {
-		parameters = new MapNNKV;
+		parameters = new vector<HumHashEntry>;
 	}
 }
 
 
 
+//////////////////////////////
+//
+// HumHash::internName -- Return a pointer to the single stored copy of
+//     a namespace or key string, adding the string to the list of names
+//     if it is not already present.  The returned pointer is valid for the
+//     rest of the program, and two names are equal when their pointers are
+//     equal.  Names already seen by the current thread are found in its
+//     name cache without locking the shared list.
+//
+
+const string* HumHash::internName(const string& name) {
+	HumNameCache& cache = getNameCache();
+	auto it = cache.found.find(name);
+	if (it != cache.found.end()) {
+		return it->second;
+	}
+	const string* output;
+	{
+		std::lock_guard<std::mutex> lock(getNameMutex());
+		auto result = getNameList().insert(name);
+		if (result.second) {
+			getNameCount().fetch_add(1, std::memory_order_release);
+		}
+		output = &(*result.first);
+	}
+	cache.found.emplace(name, output);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findName -- Return a pointer to the interned copy of a name,
+//     or NULL if the name has not been interned, without adding it to the
+//     list of names.  Names which were not found are remembered by the
+//     thread until another name is interned, so repeated queries for
+//     undefined parameters also do not lock the shared list.
+//
+
+const string* HumHash::findName(const string& name) {
+	HumNameCache& cache = getNameCache();
+	auto it = cache.found.find(name);
+	if (it != cache.found.end()) {
+		return it->second;
+	}
+	size_t count = getNameCount().load(std::memory_order_acquire);
+	if (cache.count != count) {
+		cache.missing.clear();
+		cache.count = count;
+	} else if (cache.missing.find(name) != cache.missing.end()) {
+		return NULL;
+	}
+	const string* output = NULL;
+	{
+		std::lock_guard<std::mutex> lock(getNameMutex());
+		std::unordered_set<string>& names = getNameList();
+		auto it2 = names.find(name);
+		if (it2 != names.end()) {
+			output = &(*it2);
+		}
+	}
+	if (output) {
+		cache.found.emplace(name, output);
+	} else {
+		cache.missing.insert(name);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameList -- Return the list of interned names.  The list
+//     is never deleted so that names remain valid while static objects
+//     are being destroyed.
+//
+
+std::unordered_set<string>& HumHash::getNameList(void) {
+	static std::unordered_set<string>* names = new std::unordered_set<string>;
+	return *names;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameMutex -- Return the mutex which protects the list of
+//     interned names.
+//
+
+std::mutex& HumHash::getNameMutex(void) {
+	static std::mutex* namemutex = new std::mutex;
+	return *namemutex;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameCount -- Return the number of interned names.  The
+//     count is used by the thread name caches to notice that a name which
+//     was missing may have been added since.
+//
+
+std::atomic<size_t>& HumHash::getNameCount(void) {
+	static std::atomic<size_t>* namecount = new std::atomic<size_t>(0);
+	return *namecount;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameCache -- Return the interned-name cache for the
+//     current thread.
+//
+
+HumNameCache& HumHash::getNameCache(void) {
+	static thread_local HumNameCache cache;
+	return cache;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findParameter -- Return the stored parameter for a given
+//     namespace/key, or NULL if the parameter is not defined.
+//
+
+const HumParameter* HumHash::findParameter(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	auto it = std::lower_bound(parameters->begin(), parameters->end(), key,
+			[](const HumHashEntry& entry, const HumParamKey& k) {
+				return entry.name < k;
+			});
+	if ((it == parameters->end()) || (key < it->name)) {
+		return NULL;
+	}
+	return &it->value;
+}
+
+
+const HumParameter* HumHash::findParameter(const string& ns1,
+		const string& ns2, const string& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return NULL;
+	}
+	return findParameter(pkey);
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findKey -- Fill in a HumParamKey from namespace and key strings
+//     without interning them.  Returns false if any of the names has not
+//     been interned, in which case no parameter can exist for the key.
+//
+
+bool HumHash::findKey(const string& ns1, const string& ns2, const string& key,
+		HumParamKey& output) {
+	output.m_ns1 = findName(ns1);
+	if (output.m_ns1 == NULL) {
+		return false;
+	}
+	output.m_ns2 = findName(ns2);
+	if (output.m_ns2 == NULL) {
+		return false;
+	}
+	output.m_key = findName(key);
+	if (output.m_key == NULL) {
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::insertParameter -- Return the stored parameter for a given
+//     namespace/key, adding an empty parameter if it does not exist.
+//
+
+HumParameter& HumHash::insertParameter(const HumParamKey& key) {
+	initializeParameters();
+	auto it = std::lower_bound(parameters->begin(), parameters->end(), key,
+			[](const HumHashEntry& entry, const HumParamKey& k) {
+				return entry.name < k;
+			});
+	if ((it == parameters->end()) || (key < it->name)) {
+		it = parameters->insert(it, HumHashEntry{key, HumParameter()});
+	}
+	return it->value;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getSortedEntries -- Return the parameters sorted alphabetically
+//     by namespace 1, namespace 2 and then key.  This is the order in which
+//     parameters are printed.
+//
+
+vector<const HumHashEntry*> HumHash::getSortedEntries(void) const {
+	vector<const HumHashEntry*> output;
+	if (parameters == NULL) {
+		return output;
+	}
+	output.reserve(parameters->size());
+	for (auto& entry : *parameters) {
+		output.push_back(&entry);
+	}
+	std::sort(output.begin(), output.end(),
+			[](const HumHashEntry* a, const HumHashEntry* b) {
+				int cmp = a->name.getNamespace1().compare(b->name.getNamespace1());
+				if (cmp != 0) {
+					return cmp < 0;
+				}
+				cmp = a->name.getNamespace2().compare(b->name.getNamespace2());
+				if (cmp != 0) {
+					return cmp < 0;
+				}
+				return a->name.getKey() < b->name.getKey();
+			});
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getEntryTree -- Return the parameters grouped by namespace 1 and
+//     namespace 2, with the groups and keys sorted alphabetically.
+//
+
+HumHashTree HumHash::getEntryTree(void) const {
+	HumHashTree output;
+	for (auto entry : getSortedEntries()) {
+		output[entry->name.getNamespace1()][entry->name.getNamespace2()].push_back(entry);
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getKeyList -- Return a list of colon separated values from
@@ -995,11 +1396,16 @@ void HumHash::initializeParameters(void) {
 //
 
 vector<string> HumHash::getKeyList(const string& keys) const {
-	stringstream ss(keys);
-	string key;
 	vector<string> output;
-	while (getline(ss, key, ':')) {
-		output.push_back(key);
+	size_t start = 0;
+	while (start < keys.size()) {
+		size_t loc = keys.find(':', start);
+		if (loc == string::npos) {
+			output.push_back(keys.substr(start));
+			break;
+		}
+		output.push_back(keys.substr(start, loc - start));
+		start = loc + 1;
 	}
 	if (output.size() == 0) {
 		output.push_back(keys);
@@ -1079,23 +1485,11 @@ void HumHash::setOrigin(const string& ns2, const string& key,
 
 void HumHash::setOrigin(const string& ns1, const string& ns2,
 		const string& key, HumdrumToken* tok) {
-	if (parameters == NULL) {
-		return;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	HumParameter* parameter = (HumParameter*)findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return;
 	}
-	it3->second.origin = tok;
+	parameter->origin = tok;
 }
 
 
@@ -1139,23 +1533,11 @@ HumdrumToken* HumHash::getOrigin(const string& ns2, const string& key) const {
 
 HumdrumToken* HumHash::getOrigin(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return NULL;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return NULL;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return NULL;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return NULL;
 	}
-	return it3->second.origin;
+	return parameter->origin;
 }
 
 
@@ -1174,13 +1556,14 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 	if (parameters->size() == 0) {
 		return out;
 	}
+	HumHashTree tree = getEntryTree();
 
 	stringstream str;
 	bool found = 0;
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : tree) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -1199,10 +1582,10 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 			for (auto& it3 : it2.second) {
 				str << Convert::repeatString(indent, level);
-				str << "<parameter key=\"" << it3.first << "\"";
+				str << "<parameter key=\"" << it3->name.getKey() << "\"";
 				str << " value=\"";
-				str << Convert::encodeXml(it3.second) << "\"";
-				ref = it3.second.origin;
+				str << Convert::encodeXml(it3->value) << "\"";
+				ref = it3->value.origin;
 				if (ref != NULL) {
 					str << " idref=\"";
 					str << ref->getXmlId();
@@ -1240,6 +1623,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 	if (parameters->size() == 0) {
 		return out;
 	}
+	HumHashTree tree = getEntryTree();
 
 	stringstream str;
 	stringstream str2;
@@ -1250,7 +1634,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : tree) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -1283,15 +1667,15 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 			for (auto& it3 : it2.second) {
 				if ((it2.first == "") && (it2.first == "")) {
 
-					if ((it3.first == "global") && (it3.second == "true")) {
+					if ((it3->name.getKey() == "global") && (it3->value == "true")) {
 						// don't do anything because parameter should be removed
 					} else {
 						str2count++;
 						str2 << Convert::repeatString(indent, level);
-						str2 << "<parameter key=\"" << it3.first << "\"";
+						str2 << "<parameter key=\"" << it3->name.getKey() << "\"";
 						str2 << " value=\"";
-						str2 << Convert::encodeXml(it3.second) << "\"";
-						ref = it3.second.origin;
+						str2 << Convert::encodeXml(it3->value) << "\"";
+						ref = it3->value.origin;
 						if (ref != NULL) {
 							str2 << " idref=\"";
 							str2 << ref->getXmlId();
@@ -1301,10 +1685,10 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 					}
 				} else {
 					str << Convert::repeatString(indent, level);
-					str << "<parameter key=\"" << it3.first << "\"";
+					str << "<parameter key=\"" << it3->name.getKey() << "\"";
 					str << " value=\"";
-					str << Convert::encodeXml(it3.second) << "\"";
-					ref = it3.second.origin;
+					str << Convert::encodeXml(it3->value) << "\"";
+					ref = it3->value.origin;
 					if (ref != NULL) {
 						str << " idref=\"";
 						str << ref->getXmlId();
@@ -1353,10 +1737,11 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 	if (hash.parameters->size() == 0) {
 		return out;
 	}
+	HumHashTree tree = hash.getEntryTree();
 
 	string cleaned;
 
-	for (auto& it1 : *(hash.parameters)) {
+	for (auto& it1 : tree) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -1367,9 +1752,9 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 			out << hash.prefix;
 			out << it1.first << ":" << it2.first;
 			for (auto& it3 : it2.second) {
-				out << ":" << it3.first;
-				if (it3.second != "true") {
-					cleaned = it3.second;
+				out << ":" << it3->name.getKey();
+				if (it3->value != "true") {
+					cleaned = it3->value;
 					Convert::replaceOccurrences(cleaned, ":", "&colon;");
 					out << "=" << cleaned;
 				}
@@ -0,0 +1,231 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Sun Oct 18 02:13:28 UTC 2026
+// Last Modified: Sun Oct 18 12:13:17 UTC 2026
+// Filename:      HumPool.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumPool.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Arena allocator for HumdrumLine and HumdrumToken objects,
+//                which are created in large numbers when reading Humdrum
+//                files.  Each HumdrumFile owns an arena, and its slabs are
+//                returned to the system when the file is cleared.
+//
+
+#include "HumPool.h"
+
+#include <new>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumPoolSlab -- Header at the start of each slab of an arena.  The
+//    reference count is the number of objects in the slab which have not
+//    been deleted, plus one while the arena is allocating from the slab.
+//    Objects can be deleted in a different thread than the one which
+//    created them, so the count is atomic.
+//
+
+class HumPoolSlab {
+	public:
+		std::atomic<int> refcount;
+};
+
+
+// Every object is preceded by a header which stores a pointer to its
+// slab (or NULL if the object was allocated individually):
+static const size_t HUMPOOL_HEADER = alignof(std::max_align_t);
+
+// The arena used for new objects in the current thread (see HumPoolScope):
+static thread_local HumPool* humpool_current = NULL;
+
+
+
+//////////////////////////////
+//
+// HumPool::HumPool -- Constructor.  No memory is allocated until the
+//     first object is created in the arena.
+// default value: slabsize = 65536
+//
+
+HumPool::HumPool(size_t slabsize) {
+	m_slabsize = slabsize < 4096 ? 4096 : slabsize;
+	m_slab = NULL;
+	m_used = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::~HumPool -- Slabs which still have objects in them (such as
+//     tokens moved to another file) are freed when their last object is
+//     deleted.
+//
+
+HumPool::~HumPool() {
+	releaseSlab();
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::allocate -- Return memory for an object of the given size
+//    from the current slab of the arena.  Memory of deleted objects is
+//    not reused until all objects in its slab have been deleted.
+//
+
+void* HumPool::allocate(size_t size) {
+	size_t align = HUMPOOL_HEADER;
+	size_t total = HUMPOOL_HEADER + ((size + align - 1) / align) * align;
+	if (total > m_slabsize / 4) {
+		char* block = (char*)::operator new(HUMPOOL_HEADER + size);
+		*((HumPoolSlab**)block) = NULL;
+		return block + HUMPOOL_HEADER;
+	}
+	if ((m_slab == NULL) || (m_used + total > m_slabsize)) {
+		addSlab();
+	}
+	char* block = (char*)m_slab + m_used;
+	m_used += total;
+	m_slab->refcount.fetch_add(1, std::memory_order_relaxed);
+	*((HumPoolSlab**)block) = m_slab;
+	return block + HUMPOOL_HEADER;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::clear -- Called when the file which owns the arena has deleted
+//    its lines and tokens.  If no objects are left in the current slab,
+//    then it is kept for the next file read into the arena; otherwise,
+//    it will be freed when its last object is deleted.
+//
+
+void HumPool::clear(void) {
+	if (m_slab == NULL) {
+		return;
+	}
+	if (m_slab->refcount.load(std::memory_order_acquire) == 1) {
+		// Only the arena refers to the slab, so it can be reused.
+		m_used = HUMPOOL_HEADER;
+	} else {
+		releaseSlab();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::allocateObject -- Allocate memory for a HumdrumLine or
+//    HumdrumToken from the arena of the current HumPoolScope, or
+//    individually if there is no scope.
+//
+
+void* HumPool::allocateObject(size_t size) {
+	if (humpool_current) {
+		return humpool_current->allocate(size);
+	}
+	char* block = (char*)::operator new(HUMPOOL_HEADER + size);
+	*((HumPoolSlab**)block) = NULL;
+	return block + HUMPOOL_HEADER;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::releaseObject -- Free the memory of an object allocated with
+//    allocate() or allocateObject().  A slab is returned to the system
+//    when its last object is deleted.
+//
+
+void HumPool::releaseObject(void* ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	char* block = (char*)ptr - HUMPOOL_HEADER;
+	HumPoolSlab* slab = *((HumPoolSlab**)block);
+	if (slab == NULL) {
+		::operator delete(block);
+	} else if (slab->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		slab->~HumPoolSlab();
+		::operator delete(slab);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::addSlab -- Start allocating from a new slab.
+//
+
+void HumPool::addSlab(void) {
+	releaseSlab();
+	void* memory = ::operator new(m_slabsize);
+	m_slab = new (memory) HumPoolSlab;
+	m_slab->refcount.store(1, std::memory_order_relaxed);
+	m_used = HUMPOOL_HEADER;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::releaseSlab -- Stop allocating from the current slab.
+//
+
+void HumPool::releaseSlab(void) {
+	if (m_slab == NULL) {
+		return;
+	}
+	if (m_slab->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		m_slab->~HumPoolSlab();
+		::operator delete(m_slab);
+	}
+	m_slab = NULL;
+	m_used = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumPoolScope::HumPoolScope -- Use the arena for new lines and tokens
+//    in the current thread.
+//
+
+HumPoolScope::HumPoolScope(HumPool& pool) {
+	m_previous = humpool_current;
+	humpool_current = &pool;
+}
+
+
+
+//////////////////////////////
+//
+// HumPoolScope::~HumPoolScope -- Go back to the previous arena.
+//
+
+HumPoolScope::~HumPoolScope() {
+	humpool_current = m_previous;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -19,6 +19,8 @@
 #include "HumRegex.h"
 
 #include <iostream>
+#include <list>
+#include <unordered_map>
 
 using namespace std;
 
@@ -37,6 +39,9 @@ HumRegex::HumRegex(void) {
 	m_regexflags  = std::regex_constants::ECMAScript;
 
 	m_searchflags = std::regex_constants::format_first_only;
+
+	m_patternflags  = m_regexflags;
+	m_compiledflags = m_searchflags;
 }
 
 
@@ -48,9 +53,12 @@ HumRegex::HumRegex(const string& exp, const string& options) {
 		// explicitly set the default syntax
 		m_regexflags = std::regex_constants::ECMAScript;
 	}
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	m_patternflags = m_regexflags;
 	m_searchflags = (std::regex_constants::match_flag_type)0;
 	m_searchflags = getTemporarySearchFlags(options);
+	setRegex(exp, getTemporaryRegexFlags(options));
+	m_compiled = m_regex;
+	m_compiledflags = m_searchflags;
 }
 
 
@@ -65,6 +73,184 @@ HumRegex::~HumRegex() {
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// compiled regular expressions
+//
+
+//////////////////////////////
+//
+// HumRegex::RegexCache -- Compiled regular expressions shared by all
+//    HumRegex objects.  The oldest entry is removed when the cache is full.
+//
+
+struct HumRegex::RegexCache {
+	std::mutex mutex;
+	std::unordered_map<string, std::shared_ptr<const std::regex>> entries;
+	std::list<string> order;  // keys in order of insertion
+	int size = 256;
+};
+
+
+
+//////////////////////////////
+//
+// HumRegex::getRegexCache -- Return the compiled regular expression
+//    cache.  The cache is never deleted so that it may be used while
+//    static objects are being destroyed.
+//
+
+HumRegex::RegexCache& HumRegex::getRegexCache(void) {
+	static RegexCache* cache = new RegexCache;
+	return *cache;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCachedRegex -- Return a compiled regular expression for
+//    the given expression and syntax flags, compiling it only if it is
+//    not already in the cache.  Invalid expressions throw std::regex_error
+//    as when constructing a std::regex.
+//
+
+std::shared_ptr<const std::regex> HumRegex::getCachedRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	RegexCache& cache = getRegexCache();
+	string key = to_string((int)flags);
+	key += ':';
+	key += exp;
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		auto it = cache.entries.find(key);
+		if (it != cache.entries.end()) {
+			return it->second;
+		}
+	}
+
+	// compile outside of the lock so that other threads are not blocked:
+	std::shared_ptr<const std::regex> output = std::make_shared<const std::regex>(exp, flags);
+
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	if (cache.size <= 0) {
+		return output;
+	}
+	auto status = cache.entries.emplace(key, output);
+	if (!status.second) {
+		// another thread compiled the same expression
+		return status.first->second;
+	}
+	cache.order.push_back(key);
+	while ((int)cache.entries.size() > cache.size) {
+		cache.entries.erase(cache.order.front());
+		cache.order.pop_front();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::setCacheSize -- Set the maximum number of compiled regular
+//    expressions to store in the cache.  A size of 0 disables the cache.
+//    The default size is 256.
+//
+
+void HumRegex::setCacheSize(int size) {
+	RegexCache& cache = getRegexCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.size = size < 0 ? 0 : size;
+	while ((int)cache.entries.size() > cache.size) {
+		cache.entries.erase(cache.order.front());
+		cache.order.pop_front();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCacheSize -- Return the maximum number of compiled regular
+//    expressions to store in the cache.
+//
+
+int HumRegex::getCacheSize(void) {
+	RegexCache& cache = getRegexCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	return cache.size;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::clearCache -- Remove all compiled regular expressions from the
+//    cache.  Expressions still in use by HumRegex objects are not affected.
+//
+
+void HumRegex::clearCache(void) {
+	RegexCache& cache = getRegexCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.entries.clear();
+	cache.order.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::setRegex -- Set the regular expression to use for searching,
+//    matching or replacing.  Nothing is done if the expression is the
+//    same as the last one used by the object.
+//
+
+void HumRegex::setRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_regex && (flags == m_patternflags) && (exp == m_pattern)) {
+		return;
+	}
+	m_regex = getCachedRegex(exp, flags);
+	m_pattern = exp;
+	m_patternflags = flags;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::compile -- Compile a regular expression to use with the
+//     search/match/replace functions which do not take an expression
+//     parameter.  Options are the same as the temporary options for
+//     the other functions (such as "i" for ignoring case and "g" for
+//     global replacements).  Returns false if the expression is invalid.
+//
+// default value: options = ""
+//
+//     Example:
+//        HumRegex hre;
+//        hre.compile("^=(\\d+)");
+//        for (int i=0; i<infile.getLineCount(); i++) {
+//           if (hre.search(infile[i])) { ... }
+//        }
+//
+
+bool HumRegex::compile(const string& exp, const string& options) {
+	try {
+		setRegex(exp, getTemporaryRegexFlags(options));
+	} catch (std::regex_error& e) {
+		cerr << "Error: invalid regular expression " << exp << ": " << e.what() << endl;
+		m_compiled.reset();
+		return false;
+	}
+	m_compiled = m_regex;
+	m_compiledflags = getTemporarySearchFlags(options);
+	return true;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // option setting
@@ -155,8 +341,8 @@ void HumRegex::unsetGlobal(void) {
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	bool result = regex_search(input, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -170,10 +356,10 @@ int HumRegex::search(const string& input, const string& exp) {
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
+	bool result = regex_search(startit, endit, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -199,8 +385,8 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	bool result = regex_search(input, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -213,10 +399,10 @@ int HumRegex::search(const string& input, const string& exp,
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
+	bool result = regex_search(startit, endit, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -238,6 +424,51 @@ int HumRegex::search(string* input, int startindex, const string& exp,
 	return HumRegex::search(*input, startindex, exp, options);
 }
 
+//
+// This version of HumRegex uses the expression given to compile().
+//
+
+int HumRegex::search(const string& input) {
+	if (!m_compiled) {
+		return 0;
+	}
+	bool result = regex_search(input, m_matches, *m_compiled, m_compiledflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+int HumRegex::search(const string& input, int startindex) {
+	if (!m_compiled) {
+		return 0;
+	}
+	auto startit = input.begin() + startindex;
+	auto endit   = input.end();
+	bool result = regex_search(startit, endit, m_matches, *m_compiled, m_compiledflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+int HumRegex::search(string* input) {
+	return HumRegex::search(*input);
+}
+
+
+int HumRegex::search(string* input, int startindex) {
+	return HumRegex::search(*input, startindex);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////
 //
@@ -385,15 +616,15 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	return regex_match(input, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	return regex_match(input, *m_regex, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	return regex_match(input, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	return regex_match(input, *m_regex, getTemporarySearchFlags(options));
 }
 
 
@@ -408,6 +639,22 @@ bool HumRegex::match(const string* input, const string& exp,
 	return HumRegex::match(*input, exp, options);
 }
 
+//
+// This version of HumRegex uses the expression given to compile().
+//
+
+bool HumRegex::match(const string& input) {
+	if (!m_compiled) {
+		return false;
+	}
+	return regex_match(input, *m_compiled, m_compiledflags);
+}
+
+
+bool HumRegex::match(const string* input) {
+	return HumRegex::match(*input);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -424,8 +671,8 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	input = regex_replace(input, m_regex, replacement, m_searchflags);
+	setRegex(exp, m_regexflags);
+	input = regex_replace(input, *m_regex, replacement, m_searchflags);
 	return input;
 }
 
@@ -441,8 +688,8 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	input = regex_replace(input, *m_regex, replacement, getTemporarySearchFlags(options));
 	return input;
 }
 
@@ -452,6 +699,18 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 	return HumRegex::replaceDestructive(*input, replacement, exp, options);
 }
 
+//
+// This version uses the expression given to compile().
+//
+
+string& HumRegex::replaceDestructive(string& input, const string& replacement) {
+	if (!m_compiled) {
+		return input;
+	}
+	input = regex_replace(input, *m_compiled, replacement, m_compiledflags);
+	return input;
+}
+
 
 
 //////////////////////////////
@@ -462,10 +721,10 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement);
+			input.end(), *m_regex, replacement);
 	return output;
 }
 
@@ -481,10 +740,10 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
+			input.end(), *m_regex, replacement, getTemporarySearchFlags(options));
 	return output;
 }
 
@@ -494,6 +753,20 @@ string HumRegex::replaceCopy(string* input, const string& exp,
 	return HumRegex::replaceCopy(*input, replacement, exp, options);
 }
 
+//
+// This version uses the expression given to compile().
+//
+
+string HumRegex::replaceCopy(const string& input, const string& replacement) {
+	if (!m_compiled) {
+		return input;
+	}
+	string output;
+	regex_replace(std::back_inserter(output), input.begin(),
+			input.end(), *m_compiled, replacement, m_compiledflags);
+	return output;
+}
+
 
 
 //////////////////////////////
@@ -0,0 +1,565 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Sun Oct 18 04:38:15 UTC 2026
+// Last Modified: Sun Oct 18 14:10:40 UTC 2026
+// Filename:      HumSegmentIndex.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumSegmentIndex.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Index of the byte ranges of !!!!SEGMENT: records in a file
+//                containing many concatenated Humdrum files, so that
+//                individual segments can be read without parsing the
+//                rest of the file.  The index can be saved to a sidecar
+//                file and loaded again later.
+//
+//                Sidecar file format (tab-separated):
+//                   HumSegmentIndex   1
+//                   archive           <filename of archive>
+//                   size              <size of archive in bytes>
+//                   mtime             <modification time of archive>
+//                followed by one line for each universal comment which
+//                is applied to segments:
+//                   universal   <set number>   <universal comment>
+//                and one line for each segment:
+//                   <offset>   <size>   <level>   <set number>   <name>
+//                The set number of a segment is -1 if no universal
+//                comments are applied to it.
+//
+
+#include "HumSegmentIndex.h"
+#include "HumRegex.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <sys/stat.h>    /* stat            */
+#endif
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::HumSegmentIndex -- Constructor.  If an archive
+//    filename is given, then build the index for it.
+//
+
+HumSegmentIndex::HumSegmentIndex(void) {
+	// do nothing
+}
+
+
+HumSegmentIndex::HumSegmentIndex(const string& archive) {
+	build(archive);
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::~HumSegmentIndex -- Deconstructor.
+//
+
+HumSegmentIndex::~HumSegmentIndex() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::clear -- Remove all segments from the index.
+//
+
+void HumSegmentIndex::clear(void) {
+	m_archive.clear();
+	m_archivesize = 0;
+	m_archivetime = 0;
+	m_universals.clear();
+	m_segments.clear();
+	m_names.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::build -- Scan an archive of concatenated Humdrum
+//    files for !!!!SEGMENT: lines and store their byte ranges.  Each
+//    segment starts at a !!!!SEGMENT: line and ends before the next one
+//    (or at the end of the archive).  The universal comments which
+//    HumdrumFileStream applies to each segment when reading the archive
+//    sequentially are also stored, so that a segment can be read without
+//    reading anything before it.  Data before the first !!!!SEGMENT: line
+//    is not indexed.  Returns false if the archive cannot be read.
+//
+
+bool HumSegmentIndex::build(const string& archive) {
+	clear();
+	m_archive = archive;
+	m_archivetime = getFileTime(archive);
+	ifstream input(archive.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+
+	// The universal comments in effect are tracked in the same way as in
+	// HumdrumFileStream::getFileLines(): universal comments before any
+	// other content of a file (which starts at a !!!!SEGMENT: line after
+	// data, or at a second ** line) replace the previous ones.
+	vector<string> universals;  // universal comments currently in effect
+	int current = -1;           // index of universals in m_universals
+	bool dataQ = false;         // content other than universals found
+	bool foundQ = false;        // universal comment found in current file
+	bool starstarQ = false;     // exclusive interpretation found
+	bool starminusQ = false;    // spine terminator found
+
+	int64_t offset = 0;
+	string line;
+	while (getline(input, line)) {
+		int64_t lineoffset = offset;
+		offset += line.size();
+		if (!input.eof()) {
+			// add the newline which is removed by getline():
+			offset++;
+		}
+
+		if (line.compare(0, 11, "!!!!SEGMENT") == 0) {
+			if ((current < 0) && !universals.empty()) {
+				m_universals.push_back(universals);
+				current = (int)m_universals.size() - 1;
+			}
+			addSegment(line, lineoffset, current);
+			if (dataQ) {
+				// start of a new file
+				foundQ = false;
+				starstarQ = false;
+				starminusQ = false;
+				continue;
+			}
+		}
+
+		if (line.compare(0, 2, "**") == 0) {
+			if (starstarQ) {
+				// start of a new file (without a !!!!SEGMENT: line)
+				dataQ = false;
+				foundQ = false;
+				starminusQ = false;
+				continue;
+			}
+			starstarQ = true;
+		}
+
+		if ((line.size() > 4) && (line.compare(0, 4, "!!!!") == 0) &&
+				(line[4] != '!') && !dataQ &&
+				(line.compare(0, 11, "!!!!filter:") != 0) &&
+				(line.compare(0, 12, "!!!!SEGMENT:") != 0)) {
+			if (!foundQ) {
+				universals.clear();
+				foundQ = true;
+			}
+			universals.push_back(line);
+			current = -1;
+			continue;
+		}
+
+		if (line.compare(0, 2, "*-") == 0) {
+			starminusQ = true;
+		}
+		if ((starminusQ || !starstarQ) && !line.empty() &&
+				(line[0] != '*') && (line[0] != '!') && (line[0] != ' ')) {
+			// treated as a filename by HumdrumFileStream
+			continue;
+		}
+		dataQ = true;
+	}
+	m_archivesize = offset;
+
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		if (i < (int)m_segments.size() - 1) {
+			m_segments[i].size = m_segments[i+1].offset - m_segments[i].offset;
+		} else {
+			m_segments[i].size = m_archivesize - m_segments[i].offset;
+		}
+	}
+	buildNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::addSegment -- Store a segment starting at the given
+//    !!!!SEGMENT: line.  The size is calculated later in build().
+//
+
+void HumSegmentIndex::addSegment(const string& line, int64_t offset,
+		int universals) {
+	Segment segment;
+	segment.level = 0;
+	segment.offset = offset;
+	segment.size = 0;
+	segment.universals = universals;
+	HumRegex hre;
+	if (hre.search(line, R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*)\s*$)")) {
+		if (hre.getMatchLength(1) > 0) {
+			segment.level = atoi(hre.getMatch(1).c_str());
+		}
+		segment.name = hre.getMatch(2);
+	}
+	m_segments.push_back(segment);
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::buildNameIndex -- Create the lookup table for
+//    segment names.
+//
+
+void HumSegmentIndex::buildNameIndex(void) {
+	m_names.clear();
+	m_names.reserve(m_segments.size());
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		// emplace does not replace earlier segments with the same name:
+		m_names.emplace(m_segments[i].name, i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::write -- Save the index to a sidecar file or to
+//    an output stream.
+//
+
+bool HumSegmentIndex::write(const string& indexfile) const {
+	std::ofstream output(indexfile.c_str(), std::ios::out | std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	write(output);
+	output.close();
+	return !output.fail();
+}
+
+
+ostream& HumSegmentIndex::write(ostream& out) const {
+	out << "HumSegmentIndex\t1\n";
+	out << "archive\t" << m_archive << "\n";
+	out << "size\t" << m_archivesize << "\n";
+	out << "mtime\t" << m_archivetime << "\n";
+	for (int i=0; i<(int)m_universals.size(); i++) {
+		for (int j=0; j<(int)m_universals[i].size(); j++) {
+			out << "universal\t" << i << '\t' << m_universals[i][j] << '\n';
+		}
+	}
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		const Segment& segment = m_segments[i];
+		out << segment.offset << '\t' << segment.size << '\t'
+		    << segment.level << '\t' << segment.universals << '\t'
+		    << segment.name << '\n';
+	}
+	return out;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::read -- Load an index from a sidecar file or from an
+//    input stream.  Returns false if the input is not a segment index.
+//
+
+bool HumSegmentIndex::read(const string& indexfile) {
+	ifstream input(indexfile.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	return read(input);
+}
+
+
+bool HumSegmentIndex::read(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line.compare(0, 16, "HumSegmentIndex\t") != 0)) {
+		return false;
+	}
+	while (getline(input, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		if (line.compare(0, 8, "archive\t") == 0) {
+			m_archive = line.substr(8);
+			continue;
+		}
+		if (line.compare(0, 5, "size\t") == 0) {
+			m_archivesize = strtoll(line.c_str() + 5, NULL, 10);
+			continue;
+		}
+		if (line.compare(0, 6, "mtime\t") == 0) {
+			m_archivetime = strtoll(line.c_str() + 6, NULL, 10);
+			continue;
+		}
+		const char* ptr = line.c_str();
+		char* end;
+		if (line.compare(0, 10, "universal\t") == 0) {
+			// universal comment entry: set number, comment
+			long set = strtol(ptr + 10, &end, 10);
+			if ((*end != '\t') || (set < 0) || (set > (long)m_universals.size())) {
+				clear();
+				return false;
+			}
+			if (set == (long)m_universals.size()) {
+				m_universals.resize(set + 1);
+			}
+			m_universals[set].push_back(end + 1);
+			continue;
+		}
+		// segment entry: offset, size, level, set number, name
+		Segment segment;
+		segment.offset = strtoll(ptr, &end, 10);
+		if (*end != '\t') {
+			clear();
+			return false;
+		}
+		segment.size = strtoll(end + 1, &end, 10);
+		if (*end != '\t') {
+			clear();
+			return false;
+		}
+		segment.level = (int)strtol(end + 1, &end, 10);
+		if (*end != '\t') {
+			clear();
+			return false;
+		}
+		segment.universals = (int)strtol(end + 1, &end, 10);
+		if ((*end != '\t') || (segment.universals < -1) ||
+				(segment.universals >= (int)m_universals.size())) {
+			clear();
+			return false;
+		}
+		segment.name = end + 1;
+		m_segments.push_back(segment);
+	}
+	buildNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::isCurrent -- Returns true if the archive has the same
+//    size and modification time as when it was indexed.  If not, the index
+//    should be rebuilt.
+//
+
+bool HumSegmentIndex::isCurrent(void) const {
+	ifstream input(m_archive.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	if ((int64_t)input.tellg() != m_archivesize) {
+		return false;
+	}
+	return getFileTime(m_archive) == m_archivetime;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getFileTime -- Return the modification time of a file
+//    in seconds, or 0 if it is not available.
+//
+
+int64_t HumSegmentIndex::getFileTime(const string& filename) {
+	#if defined(__unix__) || defined(__APPLE__)
+		struct stat info;
+		if (stat(filename.c_str(), &info) == 0) {
+			return (int64_t)info.st_mtime;
+		}
+	#endif
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getArchive -- Return the filename of the indexed
+//    archive.
+//
+
+const string& HumSegmentIndex::getArchive(void) const {
+	return m_archive;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::setArchive -- Change the filename of the archive,
+//    such as when the archive and its index have been moved after
+//    the index was saved.
+//
+
+void HumSegmentIndex::setArchive(const string& archive) {
+	m_archive = archive;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getArchiveSize -- Return the size of the archive in
+//    bytes when it was indexed.
+//
+
+int64_t HumSegmentIndex::getArchiveSize(void) const {
+	return m_archivesize;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentCount -- Return the number of segments in
+//    the archive.
+//
+
+int HumSegmentIndex::getSegmentCount(void) const {
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentIndex -- Return the index of the segment
+//    with the given name, or -1 if there is no segment with that name.
+//
+
+int HumSegmentIndex::getSegmentIndex(const string& name) const {
+	auto it = m_names.find(name);
+	if (it == m_names.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentName -- Return the name of a segment (the
+//    text after the colon in the !!!!SEGMENT: line).
+//
+
+const string& HumSegmentIndex::getSegmentName(int index) const {
+	static string empty;
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return empty;
+	}
+	return m_segments[index].name;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentLevel -- Return the level of a segment.
+//
+
+int HumSegmentIndex::getSegmentLevel(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return 0;
+	}
+	return m_segments[index].level;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentOffset -- Return the byte offset of
+//    the !!!!SEGMENT: line of a segment in the archive.
+//
+
+int64_t HumSegmentIndex::getSegmentOffset(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return -1;
+	}
+	return m_segments[index].offset;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentSize -- Return the number of bytes in
+//    a segment.
+//
+
+int64_t HumSegmentIndex::getSegmentSize(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return 0;
+	}
+	return m_segments[index].size;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentUniversals -- Return the universal comments
+//    which are applied to a segment when the archive is read with
+//    HumdrumFileStream.
+//
+
+const vector<string>& HumSegmentIndex::getSegmentUniversals(int index) const {
+	static vector<string> empty;
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return empty;
+	}
+	int set = m_segments[index].universals;
+	if (set < 0) {
+		return empty;
+	}
+	return m_universals[set];
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSidecarName -- Return the default filename for
+//    saving the index of an archive.
+//
+
+string HumSegmentIndex::getSidecarName(const string& archive) {
+	return archive + ".segidx";
+}
+
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
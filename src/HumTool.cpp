@@ -25,7 +25,7 @@ namespace hum {
 //
 
 HumTool::HumTool(void) {
-	// do nothing
+	define("prefetch=i:0", "number of input files to read ahead in background");
 }
 
 
@@ -274,6 +274,7 @@ void HumTool::clearOutput(void) {
 	m_free_text.str("");
   	m_warning_text.str("");
   	m_error_text.str("");
+	m_modified_structure = false;
 }
 
 
@@ -289,6 +290,47 @@ void HumTool::setError(const string& message) {
 
 
 
+//////////////////////////////
+//
+// HumTool::setModifiedStructure -- Indicate that the tool has edited
+//    the input file in place in a way which invalidates its spine or rhythm
+//    analysis (such as adding a data spine or appending lines).  Tools which
+//    only change the text of existing tokens do not need to call this
+//    function.
+//
+
+void HumTool::setModifiedStructure(void) {
+	m_modified_structure = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::hasModifiedStructure -- Returns true if the structure of the
+//    input file was changed by the tool, and the file needs to be
+//    re-analyzed before further processing.
+//
+
+bool HumTool::hasModifiedStructure(void) {
+	return m_modified_structure;
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::getAnalysisLevel -- Returns the analyses of the input file
+//    which the tool needs (see the ANALYZE_* defines in HumdrumFileBase.h).
+//    Default value: ANALYZE_ALL.
+//
+
+int HumTool::getAnalysisLevel(void) {
+	return m_analysis_level;
+}
+
+
+
 
 // END_MERGE
 
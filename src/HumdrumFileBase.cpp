@@ -22,9 +22,19 @@
 #include <stdarg.h>
 #include <string.h>
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
+// Files given by name are read through a memory map when possible
+// (see HumdrumFileBase::readMappedFile()).
+#if defined(__unix__) || defined(__APPLE__)
+	#include <fcntl.h>       /* open            */
+	#include <sys/mman.h>    /* mmap, munmap    */
+	#include <sys/stat.h>    /* fstat           */
+	#include <unistd.h>      /* close           */
+#endif
+
 using namespace std;
 
 namespace hum {
@@ -80,7 +90,9 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysis_level = infile.m_analysis_level;
 
+	HumPoolScope scope(m_pool);
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
 		m_lines[i] = new HumdrumLine(infile.m_lines[i]->getText());
@@ -116,7 +128,9 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysis_level = infile.m_analysis_level;
 
+	HumPoolScope scope(m_pool);
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
 		m_lines[i] = new HumdrumLine(infile.m_lines[i]->getText());
@@ -154,6 +168,8 @@ void HumdrumFileBase::clear(void) {
 		}
 	}
 	m_lines.clear();
+	// return the memory of the deleted lines and tokens to the system:
+	m_pool.clear();
 
 	// clear state variables which are now invalid:
 	m_trackstarts.clear();
@@ -167,8 +183,12 @@ void HumdrumFileBase::clear(void) {
 	m_segmentlevel = 0;
 	m_structure_analyzed = false;
 	m_rhythm_analyzed = false;
+	m_strands_analyzed = false;
+	m_parameters_analyzed = false;
 	m_slurs_analyzed = false;
+	m_phrases_analyzed = false;
 	m_nulls_analyzed = false;
+	m_timesigs_analyzed = false;
 }
 
 
@@ -206,6 +226,42 @@ bool HumdrumFileBase::areStrandsAnalyzed(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::areParametersAnalyzed --
+//
+
+bool HumdrumFileBase::areParametersAnalyzed(void) {
+	return m_parameters_analyzed;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::setAnalysisLevel -- Select which analyses are done
+//    when reading a file (see the ANALYZE_* defines in HumdrumFileBase.h).
+//    The level is kept when the file is cleared or read again.
+//
+
+void HumdrumFileBase::setAnalysisLevel(int level) {
+	m_analysis_level = level;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getAnalysisLevel -- Return the analyses which are
+//    done when reading a file.  Default value: ANALYZE_ALL.
+//
+
+int HumdrumFileBase::getAnalysisLevel(void) const {
+	return m_analysis_level;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::setXmlIdPrefix -- Set the prefix for a HumdrumXML ID
@@ -275,7 +331,7 @@ bool HumdrumFileBase::setParseError(const char* format, ...) {
 	char buffer[1024] = {0};
 	va_list ap;
 	va_start(ap, format);
-	snprintf(buffer, 1024, format, ap);
+	vsnprintf(buffer, 1024, format, ap);
 	va_end(ap);
 	m_parseError = buffer;
 	return !m_parseError.size();
@@ -317,40 +373,140 @@ bool HumdrumFileBase::read(const char* filename) {
 	}
 #endif
 
-	ifstream infile;
 	if (fname.empty() || (fname ==  "-")) {
 		return HumdrumFileBase::read(cin);
-	} else {
-		infile.open(filename);
-		if (!infile.is_open()) {
-			return setParseError("Cannot open file >>%s<< for reading. A", filename);
-		}
 	}
-	HumdrumFileBase::read(infile);
-	infile.close();
+	readMappedFile(filename);
 	return isValid();
 }
 
 
 bool HumdrumFileBase::read(istream& contents) {
+	stringstream buffer;
+	buffer << contents.rdbuf();
+	string data = buffer.str();
+	return readBuffer(data.data(), data.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readMappedFile -- Read a file by mapping it into memory,
+//     so that lines are copied only once from the operating system's file
+//     cache.  On systems without mmap(), such as Windows, the file contents
+//     are read into a single string instead.
+//
+
+bool HumdrumFileBase::readMappedFile(const char* filename) {
+#if defined(__unix__) || defined(__APPLE__)
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)) {
+		// not a regular file (such as a pipe), so read it as a stream:
+		::close(fd);
+		ifstream infile(filename);
+		return HumdrumFileBase::read(infile);
+	}
+	size_t size = (size_t)info.st_size;
+	if (size == 0) {
+		::close(fd);
+		return readBuffer("", 0);
+	}
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		ifstream infile(filename);
+		return HumdrumFileBase::read(infile);
+	}
+	madvise(data, size, MADV_SEQUENTIAL);
+	readBuffer((const char*)data, size);
+	munmap(data, size);
+	return isValid();
+#else
+	ifstream infile;
+	infile.open(filename, ios::in | ios::binary);
+	if (!infile.is_open()) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	return HumdrumFileBase::read(infile);
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBuffer -- Split Humdrum data in memory into lines
+//     and then analyze them.  Lines are separated by newlines, and a
+//     carriage return at the end of a line is removed.  There is no limit
+//     on the length of a line.
+//
+
+bool HumdrumFileBase::readBuffer(const char* contents, size_t size) {
 	clear();
+	HumPoolScope scope(m_pool);
 	m_displayError = true;
-	char buffer[123123] = {0};
+	m_lines.reserve(std::count(contents, contents + size, '\n') + 1);
+	const char* ptr = contents;
+	const char* end = contents + size;
 	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
-		s = new HumdrumLine(buffer);
+	while (ptr < end) {
+		const char* newline = (const char*)memchr(ptr, '\n', end - ptr);
+		const char* next;
+		if (newline == NULL) {
+			newline = end;
+			next = end;
+		} else {
+			next = newline + 1;
+		}
+		if ((newline > ptr) && (*(newline - 1) == 0x0d)) {
+			newline--;
+		}
+		// Tokens are created later in analyzeTokens(), so do not use
+		// the HumdrumLine(const char*) constructor which also creates them.
+		s = new HumdrumLine;
+		s->assign(ptr, newline - ptr);
+		s->setOwner(this);
+		m_lines.push_back(s);
+		ptr = next;
+	}
+	return analyzeBaseFromLines();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readLines -- Read Humdrum data which has already been
+//     split into lines (without newlines).  The contents of the strings
+//     are moved into the HumdrumLines of the file rather than copied, so
+//     lines will only contain empty strings afterwards.  A carriage return
+//     at the end of a line is removed.
+//
+
+bool HumdrumFileBase::readLines(std::vector<std::string>& lines) {
+	clear();
+	HumPoolScope scope(m_pool);
+	m_displayError = true;
+	m_lines.reserve(lines.size());
+	HumdrumLine* s;
+	for (int i=0; i<(int)lines.size(); i++) {
+		string& line = lines[i];
+		if (!line.empty() && (line.back() == 0x0d)) {
+			line.pop_back();
+		}
+		// Tokens are created later in analyzeTokens(), so do not use
+		// the HumdrumLine(const string&) constructor which also creates them.
+		s = new HumdrumLine;
+		s->string::swap(line);
 		s->setOwner(this);
 		m_lines.push_back(s);
 	}
 	return analyzeBaseFromLines();
-/*
-	if (!analyzeTokens()) { return isValid(); }
-	if (!analyzeLines() ) { return isValid(); }
-	if (!analyzeSpines()) { return isValid(); }
-	if (!analyzeLinks() ) { return isValid(); }
-	if (!analyzeTracks()) { return isValid(); }
-	return isValid();
-*/
 }
 
 
@@ -384,10 +540,11 @@ bool HumdrumFileBase::readCsv(const char* filename, const string& separator) {
 
 
 bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
+	HumPoolScope scope(m_pool);
 	m_displayError = true;
-	char buffer[123123] = {0};
+	string buffer;
 	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
+	while (getline(contents, buffer)) {
 		s = new HumdrumLine;
 		s->setLineFromCsv(buffer);
 		s->setOwner(this);
@@ -400,12 +557,18 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 
 //////////////////////////////
 //
-// HumdrumFileBase::analyzeBaseFromLines --
+// HumdrumFileBase::analyzeBaseFromLines -- Create tokens from the text
+//    of the lines and analyze the spine structure of the file (unless
+//    the analysis level is ANALYZE_TOKENS).
 //
 
 bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
+	if (m_analysis_level == ANALYZE_TOKENS) {
+		// spines are analyzed later with analyzeBaseFromTokens().
+		return isValid();
+	}
 	if (!analyzeSpines()) { return isValid(); }
 	if (!analyzeLinks() ) { return isValid(); }
 	if (!analyzeTracks()) { return isValid(); }
@@ -416,11 +579,31 @@ bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 
 //////////////////////////////
 //
-// HumdrumFileBase::analyzeBaseFromTokens --
+// HumdrumFileBase::analyzeBaseFromTokens -- Analyze the spine structure
+//    of the file from the current tokens on each line rather than from
+//    the text of the lines.  This allows tokens and lines to be edited
+//    in place (such as adding a spine with insertToken()) without having
+//    to print and then re-parse the entire file.  Analyses which depend
+//    on the spine structure (strands, rhythm, slurs) will need to be
+//    redone after calling this function.
 //
 
 bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 	// if (!analyzeTokens()) { return isValid(); } // this creates tokens from lines
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setOwner(this);
+		m_lines[i]->clearTokenLinkInfo();
+		// lines still need to be regenerated if tokens were edited:
+		m_lines[i]->clearModified(EDIT_RHYTHM | EDIT_STRUCTURE | EDIT_PENDING);
+	}
+	m_structure_analyzed = false;
+	m_rhythm_analyzed = false;
+	m_strands_analyzed = false;
+	m_parameters_analyzed = false;
+	m_slurs_analyzed = false;
+	m_phrases_analyzed = false;
+	m_nulls_analyzed = false;
+	m_timesigs_analyzed = false;
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
 	if (!analyzeLinks() ) { return isValid(); }
@@ -437,17 +620,12 @@ bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 //
 
 bool HumdrumFileBase::readString(const string& contents) {
-	stringstream infile;
-	infile << contents;
-	bool status = read(infile);
-	return status;
+	return readBuffer(contents.data(), contents.size());
 }
 
 
 bool HumdrumFileBase::readString(const char* contents) {
-	stringstream infile;
-	infile << contents;
-	return read(infile);
+	return readBuffer(contents, strlen(contents));
 }
 
 
@@ -701,6 +879,7 @@ HumdrumLine* HumdrumFileBase::getLine(int index) {
 //
 
 bool HumdrumFileBase::analyzeTokens(void) {
+	HumPoolScope scope(m_pool);
 	for (int i=0; i<(int)m_lines.size(); i++) {
 		m_lines[i]->createTokensFromLine();
 	}
@@ -785,6 +964,25 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::updateLinesFromTokens -- Generate Humdrum line strings
+//   only for lines which have tokens that were changed with
+//   HumdrumToken::setText() (or lines marked with
+//   HumdrumLine::setModified()).  Use createLinesFromTokens() if tokens
+//   were changed directly through their std::string interface.
+//
+
+void HumdrumFileBase::updateLinesFromTokens(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->getModified() & EDIT_TEXT) {
+			m_lines[i]->createLineFromTokens();
+		}
+	}
+}
+
+
+
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
@@ -1414,11 +1612,74 @@ bool HumdrumFileBase::analyzeTracks(void) {
 			return false;
 		}
 	}
+	analyzeDataTypes();
 	return isValid();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::analyzeDataTypes -- Store the interned ID of the
+//    exclusive interpretation in each token, so that HumdrumToken::isKern()
+//    and similar functions do not have to compare strings.
+//
+
+void HumdrumFileBase::analyzeDataTypes(void) {
+	vector<int> ids(m_trackstarts.size(), datatype_none);
+	for (int i=1; i<(int)m_trackstarts.size(); i++) {
+		if (m_trackstarts[i] != NULL) {
+			ids[i] = HumdrumToken::registerDataType(*m_trackstarts[i]);
+		}
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine* line = m_lines[i];
+		for (int j=0; j<line->getTokenCount(); j++) {
+			HTp token = line->token(j);
+			if (token == NULL) {
+				continue;
+			}
+			int track = token->getTrack();
+			if ((track > 0) && (track < (int)ids.size())) {
+				token->setDataTypeId(ids[track]);
+			} else {
+				token->setDataTypeId(datatype_none);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::analyzeDataType -- Update the interned data-type ID of
+//    the tokens in a single track.  This is needed when the exclusive
+//    interpretation at the start of the track is changed with
+//    HumdrumToken::setText().
+//
+
+void HumdrumFileBase::analyzeDataType(int track) {
+	if ((track < 1) || (track >= (int)m_trackstarts.size())) {
+		return;
+	}
+	int id = datatype_none;
+	if (m_trackstarts[track] != NULL) {
+		id = HumdrumToken::registerDataType(*m_trackstarts[track]);
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine* line = m_lines[i];
+		for (int j=0; j<line->getTokenCount(); j++) {
+			HTp token = line->token(j);
+			if ((token != NULL) && (token->getTrack() == track)) {
+				token->setDataTypeId(id);
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::analyzeLinks -- Generate forward and backwards spine links
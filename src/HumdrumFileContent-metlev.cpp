@@ -68,24 +68,19 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 
 	for (int i=0; i<lineCount; i++) {
 		if (infile[i].isInterpretation()) {
-			// check for time signature:
-			HumdrumLine& line = *infile.getLine(i);
-			for (int j=0; j<line.getFieldCount(); j++) {
-				int ttrack = line.token(j)->getTrack();
-				if (ttrack != track) {
-					continue;
-				}
-				if (sscanf(infile.token(i,j)->c_str(), "*M%d/%d", &top, &bot)) {
-					beatdur.setValue(1*4, bot); // converted to quarter-note units
-					if ((top % 3 == 0) && (top != 3)) {
-						// if meter top is a multiple of 3 but not 3, then compound
-						// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
-						compoundQ = true;
-						beatdur *= 3;
-					} else {
-						compoundQ = false;
-					}
-					break;
+			// check for time signature (parsed in analyzeTimeSignatures()):
+			const TimeSigChange* change = getTimeSigChange(i, track);
+			if (change && (change->line == i)) {
+				top = change->top;
+				bot = change->bot;
+				beatdur.setValue(1*4, bot); // converted to quarter-note units
+				if ((top % 3 == 0) && (top != 3)) {
+					// if meter top is a multiple of 3 but not 3, then compound
+					// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
+					compoundQ = true;
+					beatdur *= 3;
+				} else {
+					compoundQ = false;
 				}
 			}
 		}
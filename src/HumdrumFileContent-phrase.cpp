@@ -101,7 +101,7 @@ bool HumdrumFileContent::analyzeKernPhrasings(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)kernspines.size(); i++) {
 		output = output && analyzeKernPhrasings(kernspines[i], phrasestarts, phraseends, labels, endings, linkSignifier);
 	}
@@ -45,7 +45,7 @@ bool HumdrumFileContent::analyzeTextRepetition(void) {
 		startij = false;
 		lastword = NULL;
 		HTp start = sstarts[i];
-		if (!(start->isDataType("**text") || start->isDataType("**sylb"))) {
+		if (!(start->isDataType(datatype_text) || start->isDataType(datatype_sylb))) {
 			continue;
 		}
 		HTp current = start;
@@ -34,7 +34,7 @@ bool HumdrumFileContent::analyzeKernTies(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	output = analyzeKernTies(linkedtiestarts, linkedtieends, linkSignifier);
 	createLinkedTies(linkedtiestarts, linkedtieends);
 	return output;
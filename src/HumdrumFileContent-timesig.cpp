@@ -28,7 +28,7 @@ namespace hum {
 // HumdrumFileStructure::getTimeSigs -- Return the prevailing time signature
 //     top and bottom for a particular spine for each line in the HumdrumFile.
 //     This version does not handle mulimeters such as 2+3/4 or 3/4+6/8.
-//     Only checks the primary strand of a spine/track for time signatures.
+//     Only the first time signature of a track on a line is used.
 //
 //     default value: track = 0: 0 means use the time signature
 //         of the first **kern spine in the file; otherwise, use the
@@ -54,42 +54,32 @@ void HumdrumFileContent::getTimeSigs(vector<pair<int, HumNum> >& output,
 		track = 1;
 	}
 
-	int top  = 0;   // top number of time signature (0 for no meter)
-	int bot  = 0;   // bottom number of time signature
-	int bot2 = 0;   // such as the 2 in 3%2.
-
+	// The time signatures are parsed in
+	// HumdrumFileStructure::analyzeTimeSignatures().
+	if (!m_timesigs_analyzed) {
+		analyzeTimeSignatures();
+	}
 	int firstsig  = -1;
 	int firstdata = -1;
-
-	HTp token = getTrackStart(track);
-	while (token) {
-		if (token->isData()) {
-			if (firstdata < 0) {
-				firstdata = token->getLineIndex();
+	if ((track < (int)m_timesigs.size()) && !m_timesigs[track].empty()) {
+		firstsig = m_timesigs[track][0].line;
+	}
+	HTp start = getTrackStart(track);
+	if (start) {
+		for (int i=start->getLineIndex(); i<lineCount; i++) {
+			if (infile[i].isData()) {
+				firstdata = i;
+				break;
 			}
-			token = token->getNextToken();
-			continue;
 		}
-		if (!token->isInterpretation()) {
-			token = token->getNextToken();
-			continue;
-		}
-		// check for time signature:
-		if (sscanf(token->c_str(), "*M%d/%d%%%d", &top, &bot, &bot2) == 3) {
-			current.first = top;
-			current.second.setValue(bot, bot2);
-			if (firstsig < 0) {
-				firstsig = token->getLineIndex();
-			}
-		} else if (sscanf(token->c_str(), "*M%d/%d", &top, &bot) == 2) {
-			current.first = top;
-			current.second = bot;
-			if (firstsig < 0) {
-				firstsig = token->getLineIndex();
-			}
+	}
+
+	for (int i=0; i<lineCount; i++) {
+		const TimeSigChange* change = getTimeSigChange(i, track);
+		if (change) {
+			output[i].first  = change->top;
+			output[i].second = change->bottom;
 		}
-		output[token->getLineIndex()] = current;
-		token = token->getNextToken();
 	}
 
 	// Back-fill the list if the first time signature occurs before
@@ -100,20 +90,6 @@ void HumdrumFileContent::getTimeSigs(vector<pair<int, HumNum> >& output,
 			output[i] = current;
 		}
 	}
-
-	// In-fill the list:
-	int starti = firstsig;
-	if (starti < 0) {
-		starti = 0;
-	}
-	current = output[starti];
-	for (int i=starti+1; i<(int)output.size(); i++) {
-		if (output[i].first == 0) {
-			output[i] = current;
-		} else {
-			current = output[i];
-		}
-	}
 }
 
 
@@ -18,10 +18,16 @@
 #include "HumdrumFileSet.h"
 #include "HumRegex.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -55,6 +61,9 @@ HumdrumFileStream::HumdrumFileStream(Options& options) {
 	vector<string> list;
 	options.getArgList(list);
 	setFileList(list);
+	if (options.isDefined("prefetch")) {
+		setPrefetch(options.getInteger("prefetch"));
+	}
 }
 
 HumdrumFileStream::HumdrumFileStream(const string& datastring) {
@@ -64,18 +73,34 @@ HumdrumFileStream::HumdrumFileStream(const string& datastring) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::~HumdrumFileStream -- Deconstructor.
+//
+
+HumdrumFileStream::~HumdrumFileStream() {
+	stopPrefetch();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::clear -- reset the contents of the class.
 //
 
 void HumdrumFileStream::clear(void) {
+	stopPrefetch();
 	m_curfile = 0;
 	m_filelist.resize(0);
 	m_universals.resize(0);
 	m_newfilebuffer.resize(0);
 	// m_stringbuffer.clear(0);
 	m_stringbuffer.str("");
+	m_readsegments = false;
+	m_segmentindex.clear();
+	m_segmentlist.clear();
+	m_segmentpos = 0;
 }
 
 
@@ -86,6 +111,7 @@ void HumdrumFileStream::clear(void) {
 //
 
 int HumdrumFileStream::setFileList(char** list) {
+	stopPrefetch();
 	m_filelist.reserve(1000);
 	m_filelist.resize(0);
 	int i = 0;
@@ -98,12 +124,207 @@ int HumdrumFileStream::setFileList(char** list) {
 
 
 int HumdrumFileStream::setFileList(const vector<string>& list) {
+	stopPrefetch();
 	m_filelist = list;
 	return (int)list.size();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::setPrefetch -- Read up to the given number of
+//    files (or URLs) of the file list in a background thread while the
+//    current file is being processed.  A count of 0 (the default) reads
+//    each file only when it is needed.
+//
+
+void HumdrumFileStream::setPrefetch(int count) {
+	stopPrefetch();
+	m_prefetch = count > 0 ? count : 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getPrefetch -- Return the maximum number of files
+//    read ahead by the prefetch thread.
+//
+
+int HumdrumFileStream::getPrefetch(void) const {
+	return m_prefetch;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::startPrefetch -- Start the prefetch thread, reading
+//    files of the file list starting at the given index.
+//
+
+void HumdrumFileStream::startPrefetch(int index) {
+	stopPrefetch();
+	m_prefetchnext = index;
+	m_prefetchstop = false;
+	m_prefetchthread = std::thread(&HumdrumFileStream::prefetchFiles, this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::stopPrefetch -- Stop the prefetch thread and
+//    discard any files which it has read but have not been used.
+//
+
+void HumdrumFileStream::stopPrefetch(void) {
+	if (m_prefetchthread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_prefetchmutex);
+			m_prefetchstop = true;
+		}
+		m_prefetchcv.notify_all();
+		m_prefetchthread.join();
+	}
+	m_prefetchqueue.clear();
+	m_prefetchactive = false;
+	m_prefetchbuffer.str("");
+	m_prefetchbuffer.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::prefetchFiles -- Function of the prefetch thread:
+//    read files of the file list in order until the queue is full, then
+//    wait for the queue to be emptied by getPrefetchedFile().
+//
+
+void HumdrumFileStream::prefetchFiles(void) {
+	while (true) {
+		PrefetchFile file;
+		string filename;
+		{
+			std::unique_lock<std::mutex> lock(m_prefetchmutex);
+			m_prefetchcv.wait(lock, [this](void) {
+				return m_prefetchstop ||
+						((m_prefetchnext < (int)m_filelist.size()) &&
+						((int)m_prefetchqueue.size() < m_prefetch));
+			});
+			if (m_prefetchstop) {
+				return;
+			}
+			file.index = m_prefetchnext++;
+			filename = m_filelist[file.index];
+		}
+		file.ok = readFileContents(filename, file.contents);
+		{
+			std::lock_guard<std::mutex> lock(m_prefetchmutex);
+			m_prefetchqueue.push_back(std::move(file));
+		}
+		m_prefetchcv.notify_all();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getPrefetchedFile -- Return the contents of a file
+//    in the file list which was read by the prefetch thread, waiting for
+//    it if necessary.  Returns false if the file could not be read.
+//
+
+bool HumdrumFileStream::getPrefetchedFile(int index, string& contents) {
+	if (!m_prefetchthread.joinable()) {
+		startPrefetch(index);
+	}
+	std::unique_lock<std::mutex> lock(m_prefetchmutex);
+	while (true) {
+		// files skipped by the reader are not needed anymore:
+		while (!m_prefetchqueue.empty() && (m_prefetchqueue.front().index < index)) {
+			m_prefetchqueue.pop_front();
+		}
+		if (!m_prefetchqueue.empty()) {
+			break;
+		}
+		if (m_prefetchnext > index + 1) {
+			// The thread has moved beyond the requested file, which
+			// should not happen, so restart it at the requested file.
+			lock.unlock();
+			startPrefetch(index);
+			lock.lock();
+		}
+		m_prefetchcv.notify_all();
+		m_prefetchcv.wait(lock);
+	}
+	PrefetchFile& file = m_prefetchqueue.front();
+	bool status = file.ok && (file.index == index);
+	contents.swap(file.contents);
+	m_prefetchqueue.pop_front();
+	lock.unlock();
+	// notify the thread that there is space in the queue:
+	m_prefetchcv.notify_all();
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readFileContents -- Read a file (or URL) into a
+//    string.  Returns false if the file cannot be read.
+//
+
+bool HumdrumFileStream::readFileContents(const string& filename,
+		string& contents) {
+	contents.clear();
+	if (strstr(filename.c_str(), "://") != NULL) {
+		stringstream uribuffer;
+		fillUrlBuffer(uribuffer, filename);
+		contents = uribuffer.str();
+		return !contents.empty();
+	}
+	ifstream input(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	std::streamoff size = input.tellg();
+	input.seekg(0, std::ios::beg);
+	if (size > 0) {
+		contents.resize((size_t)size);
+		input.read(&contents[0], size);
+		contents.resize((size_t)input.gcount());
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::addToFileList -- Append a filename found in the
+//    input data to the file list.
+//
+
+void HumdrumFileStream::addToFileList(const string& filename) {
+	if (m_prefetchthread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_prefetchmutex);
+			m_filelist.push_back(filename);
+		}
+		m_prefetchcv.notify_all();
+	} else {
+		m_filelist.push_back(filename);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::loadString --
@@ -139,6 +360,57 @@ int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::read -- Read all segments of the input, and parse
+//    them into HumdrumFiles with more than one thread.  The files are
+//    stored in infiles in the same order as they occur in the input.
+//
+
+int HumdrumFileStream::read(HumdrumFileSet& infiles, int threadcount) {
+	if (threadcount <= 1) {
+		return read(infiles);
+	}
+	infiles.clear();
+	vector<vector<string>> contents;
+	vector<string> filenames;
+	vector<string> lines;
+	string filename;
+	while (getFileLines(lines, filename)) {
+		contents.push_back(std::move(lines));
+		filenames.push_back(filename);
+		lines.clear();
+	}
+
+	vector<HumdrumFile*> files(contents.size(), NULL);
+	std::atomic<int> next(0);
+	auto parser = [&](void) {
+		int i;
+		while ((i = next++) < (int)contents.size()) {
+			files[i] = new HumdrumFile;
+			files[i]->readLinesNoRhythm(contents[i]);
+			if (!filenames[i].empty()) {
+				files[i]->setFilename(filenames[i]);
+			}
+			vector<string>().swap(contents[i]);
+		}
+	};
+	vector<std::thread> threads;
+	for (int i=0; i<threadcount; i++) {
+		threads.emplace_back(parser);
+	}
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+
+	for (int i=0; i<(int)files.size(); i++) {
+		infiles.appendHumdrumPointer(files[i]);
+	}
+	return 0;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::readSingleSegment -- Get a single file for a set structure.
@@ -167,6 +439,10 @@ int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 int HumdrumFileStream::eof(void) {
 	istream* newinput = NULL;
 
+	if (m_readsegments) {
+		return m_segmentpos >= (int)m_segmentlist.size();
+	}
+
 	// Read HumdrumFile contents from:
 	// (1) Current ifstream if open
 	// (2) Next filename if ifstream is done
@@ -182,6 +458,11 @@ int HumdrumFileStream::eof(void) {
 		return 0;
 	}
 
+	// (1c) Is there a prefetched file being read?
+	else if (m_prefetchactive && !m_prefetchbuffer.eof()) {
+		return 0;
+	}
+
 	// (2) If ifstream is closed but there is a file to be processed,
 	// load it into the ifstream and start processing it immediately.
 	else if ((m_filelist.size() > 0) && (m_curfile < (int)m_filelist.size()-1)) {
@@ -213,8 +494,48 @@ int HumdrumFileStream::eof(void) {
 
 int HumdrumFileStream::getFile(HumdrumFile& infile) {
 	infile.clear();
+	vector<string> lines;
+	string filename;
+	if (!getFileLines(lines, filename)) {
+		return 0;
+	}
+	infile.readLinesNoRhythm(lines);
+	if (!filename.empty()) {
+		infile.setFilename(filename);
+	}
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getFileLines -- Extract the lines of the next
+//    HumdrumFile from the input stream or next input file in the list
+//    without parsing them.  Universal comments are demoted to global
+//    comments at the start of the lines.  The filename is set from the
+//    input file list or from a !!!!SEGMENT: record.  Returns true if
+//    content was extracted, fails if there is no more HumdrumFiles in
+//    the input stream.  The lines can be given to
+//    HumdrumFile::readLinesNoRhythm() without copying their contents.
+//
+
+int HumdrumFileStream::getFileLines(vector<string>& lines, string& filename) {
+	lines.clear();
+	filename.clear();
 	istream* newinput = NULL;
 
+	if (m_readsegments) {
+		// only read segments given to setSegmentList():
+		while (m_segmentpos < (int)m_segmentlist.size()) {
+			int segment = m_segmentlist[m_segmentpos++];
+			if (getSegmentLines(lines, filename, m_segmentindex, segment)) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
 restarting:
 
 	newinput = NULL;
@@ -246,6 +567,11 @@ restarting:
 		newinput = &m_urlbuffer;
 	}
 
+	// (2c) Is a file read by the prefetch thread being processed?
+	else if (m_prefetchactive && !m_prefetchbuffer.eof()) {
+		newinput = &m_prefetchbuffer;
+	}
+
 	// (3) If ifstream is closed but there is a file to be processed,
 	// load it into the ifstream and start processing it immediately.
 	else if (((int)m_filelist.size() > 0) &&
@@ -254,25 +580,38 @@ restarting:
 		if (m_instream.is_open()) {
 			m_instream.close();
 		}
-		if (strstr(m_filelist[m_curfile].c_str(), "://") != NULL) {
+		if (m_prefetch > 0) {
+			// The file (or URL) has been read by the prefetch thread.
+			string contents;
+			if (!getPrefetchedFile(m_curfile, contents)) {
+				m_prefetchactive = false;
+				goto restarting;
+			}
+			m_prefetchbuffer.str(contents);
+			m_prefetchbuffer.clear();
+			m_prefetchactive = true;
+			filename = m_filelist[m_curfile];
+			newinput = &m_prefetchbuffer;
+		} else if (strstr(m_filelist[m_curfile].c_str(), "://") != NULL) {
 			// The next file to read is a URL/URI, so buffer the
 			// data from the internet and start reading that instead
 			// of reading from a file on the hard disk.
 			fillUrlBuffer(m_urlbuffer, m_filelist[m_curfile].c_str());
-			infile.setFilename(m_filelist[m_curfile].c_str());
-			goto restarting;
-		}
-		m_instream.open(m_filelist[m_curfile].c_str());
-		infile.setFilename(m_filelist[m_curfile].c_str());
-		if (!m_instream.is_open()) {
-			// file does not exist or cannot be opened close
-			// the file and try luck with next file in the list
-			// (perhaps given an error or warning?).
-			infile.setFilename("");
-			m_instream.close();
+			filename = m_filelist[m_curfile];
 			goto restarting;
+		} else {
+			m_instream.open(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
+			if (!m_instream.is_open()) {
+				// file does not exist or cannot be opened close
+				// the file and try luck with next file in the list
+				// (perhaps given an error or warning?).
+				filename.clear();
+				m_instream.close();
+				goto restarting;
+			}
+			newinput = &m_instream;
 		}
-		newinput = &m_instream;
 	} else {
 		// no input fstream open and no list of files to process, so
 		// start (or continue) reading from standard input.
@@ -292,15 +631,10 @@ restarting:
 		HumRegex hre;
 		if (hre.search(m_newfilebuffer,
 				R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*)\s*$)")) {
-			if (hre.getMatchLength(1) > 0) {
-				infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-			} else {
-				infile.setSegmentLevel(0);
-			}
-			infile.setFilename(hre.getMatch(2));
+			filename = hre.getMatch(2);
 		} else if ((m_curfile >=0) && (m_curfile < (int)m_filelist.size())
 				&& (m_filelist.size() > 0)) {
-			infile.setFilename(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
 		} else {
 			// reading from standard input, but no name.
 		}
@@ -311,7 +645,6 @@ restarting:
 		return 0;
 	}
 
-	stringstream buffer;
 	int foundUniversalQ = 0;
 
 	// Start reading the input stream.  If !!!!SEGMENT: universal comment
@@ -327,7 +660,7 @@ restarting:
 	if (m_newfilebuffer.size() < 4) {
 		//searchName = 1;
 	}
-	char templine[123123] = {0};
+	string templine;
 
 	if (newinput->eof()) {
 		if (m_curfile < (int)m_filelist.size()-1) {
@@ -344,30 +677,29 @@ restarting:
 	// then treat it as part of the current file.
 	if ((m_newfilebuffer.size() > 1) &&
 		 (strncmp(m_newfilebuffer.c_str(), "**", 2)) == 0) {
-		buffer << m_newfilebuffer << "\n";
+		lines.push_back(m_newfilebuffer);
 		m_newfilebuffer = "";
 		starstarFoundQ = 1;
+	} else if (strncmp(m_newfilebuffer.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
+		// The previous read stopped at the !!!!SEGMENT: line which
+		// starts the current file.
+		lines.push_back(m_newfilebuffer);
+		m_newfilebuffer = "";
+		dataFoundQ = 1;
 	}
 
 	while (!input.eof()) {
-		input.getline(templine, 123123, '\n');
+		getline(input, templine);
 		if ((!dataFoundQ) &&
-				(strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0)) {
-			string tempstring;
-			tempstring = templine;
+				(strncmp(templine.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0)) {
 			HumRegex hre;
-			if (hre.search(tempstring,
+			if (hre.search(templine,
 					"^!!!!SEGMENT\\s*([+-]?\\d+)?\\s*:\\s*(.*)\\s*$")) {
-				if (hre.getMatchLength(1) > 0) {
-					infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-				} else {
-					infile.setSegmentLevel(0);
-				}
-				infile.setFilename(hre.getMatch(2));
+				filename = hre.getMatch(2);
 			}
 		}
 
-		if (strncmp(templine, "**", 2) == 0) {
+		if (strncmp(templine.c_str(), "**", 2) == 0) {
 			if (starstarFoundQ == 1) {
 				m_newfilebuffer = templine;
 				// already found a **, so this one is defined as a file
@@ -379,7 +711,7 @@ restarting:
 			starstarFoundQ = 1;
 		}
 
-		if (input.eof() && (strcmp(templine, "") == 0)) {
+		if (input.eof() && templine.empty()) {
 			// No more data coming from current stream, so this is
 			// the end of the HumdrumFile.  Break from the while loop
 			// and then store the read contents of the stream in the
@@ -391,36 +723,27 @@ restarting:
 		// (1a) this is the name of the current file to process if no
 		// data has yet been found,
 		// (1b) or a name is being actively searched for.
-		if (strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
-			m_newfilebuffer = templine;
+		if (strncmp(templine.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
 			if (dataFoundQ) {
 				// this new filename is for the next chunk to process in the
 				// current file stream, not this one, so stop reading the
 				// HumdrumFile content and send what has already been read back
-				// out with new contents.
-			}  else {
-				// !!!!SEGMENT: came before any real data was read, so
-				// it is most likely the name of the current file
-				// (i.e., it comes at the start of the file stream and
-				// is the name of the first HumdrumFile in the stream).
-				HumRegex hre;
-				if (hre.search(m_newfilebuffer,
-						R"(^!!!!SEGMENT\s*([+-]?\d+)?\s:\s*(.*)\s*$)")) {
-					if (hre.getMatchLength(1) > 0) {
-						infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-					} else {
-						infile.setSegmentLevel(0);
-					}
-					infile.setFilename(hre.getMatch(2));
-				}
+				// out with new contents.  The !!!!SEGMENT: line will be the
+				// first line of the next file.
+				m_newfilebuffer = templine;
+				break;
 			}
+			// Otherwise !!!!SEGMENT: came before any real data was read, so
+			// it is the name of the current file (i.e., it comes at the
+			// start of the file stream and is the name of the first
+			// HumdrumFile in the stream), which was stored above.
 		}
-		int len = (int)strlen(templine);
-		if ((len > 4) && (strncmp(templine, "!!!!", 4) == 0) &&
+		int len = (int)templine.size();
+		if ((len > 4) && (strncmp(templine.c_str(), "!!!!", 4) == 0) &&
 				(templine[4] != '!') &&
 				(dataFoundQ == 0) &&
-				(strncmp(templine, "!!!!filter:", strlen("!!!!filter:")) != 0) &&
-				(strncmp(templine, "!!!!SEGMENT:", strlen("!!!!SEGMENT:")) != 0)) {
+				(strncmp(templine.c_str(), "!!!!filter:", strlen("!!!!filter:")) != 0) &&
+				(strncmp(templine.c_str(), "!!!!SEGMENT:", strlen("!!!!SEGMENT:")) != 0)) {
 			// This is a universal comment.  Should it be appended
 			// to the list or should the current list be erased and
 			// this record placed into the first entry?
@@ -438,7 +761,7 @@ restarting:
 			continue;
 		}
 
-		if (strncmp(templine, "*-", 2) == 0) {
+		if (strncmp(templine.c_str(), "*-", 2) == 0) {
 			starminusFoundQ = 1;
 		}
 
@@ -452,12 +775,12 @@ restarting:
 				// so that infinite loops are prevented.
 				int found = 0;
 				for (int mm=0; mm<(int)m_filelist.size(); mm++) {
-					if (strcmp(m_filelist[mm].c_str(), templine) == 0) {
+					if (m_filelist[mm] == templine) {
 						found = 1;
 					}
 				}
 				if (!found) {
-					m_filelist.push_back(templine);
+					addToFileList(templine);
 					addedFilename = 1;
 				}
 				continue;
@@ -467,8 +790,9 @@ restarting:
 		dataFoundQ = 1; // found something other than universal comments
 		// should empty lines be treated somewhat as universal comments?
 
-		// store the data line for later parsing into HumdrumFile record:
-		buffer << templine << "\n";
+		// store the data line for later parsing into HumdrumFile record
+		// (templine keeps its capacity for reading the next line):
+		lines.push_back(templine);
 	}
 
 	if (dataFoundQ == 0) {
@@ -480,25 +804,44 @@ restarting:
 	}
 
 	// Arriving here means that reading of the data stream is complete.
-	// The string stream variable "buffer" contains the HumdrumFile
-	// content, so send it to the HumdrumFile variable.  Also, prepend
+	// The "lines" variable contains the HumdrumFile content.  Also, prepend
 	// Universal comments (demoted into Global comments) at the start
 	// of the data stream (maybe allow for postpending Universal comments
 	// in the future).
-	stringstream contents;
-	contents.str(""); // empty any contents in buffer
-	contents.clear(); // reset error flags in buffer
-
+	vector<string> globals;
 	for (int i=0; i<(int)m_universals.size(); i++) {
 		// Convert universals reference records to globals, but do not demote !!!!filter:
 		if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
 			continue;
 		}
-		contents << &(m_universals[i][1]) << "\n";
+		globals.emplace_back(m_universals[i], 1, string::npos);
+	}
+	if (!globals.empty()) {
+		lines.insert(lines.begin(), std::make_move_iterator(globals.begin()),
+				std::make_move_iterator(globals.end()));
 	}
-	contents << buffer.str();
-	string filename = infile.getFilename();
-	infile.readNoRhythm(contents);
+	return 1;
+}
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegment -- Read a single segment of an archive
+//    of concatenated Humdrum files, given its index number or name in
+//    a HumSegmentIndex.  Only the bytes of the segment are read, and the
+//    universal comments for the segment are taken from the index.  Returns
+//    true if the segment was read.
+//
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile,
+		const HumSegmentIndex& index, int segment) {
+	infile.clear();
+	vector<string> lines;
+	string filename;
+	if (!getSegmentLines(lines, filename, index, segment)) {
+		return 0;
+	}
+	infile.readLinesNoRhythm(lines);
 	if (!filename.empty()) {
 		infile.setFilename(filename);
 	}
@@ -506,6 +849,87 @@ restarting:
 }
 
 
+int HumdrumFileStream::readSegment(HumdrumFile& infile,
+		const HumSegmentIndex& index, const string& name) {
+	int segment = index.getSegmentIndex(name);
+	if (segment < 0) {
+		infile.clear();
+		return 0;
+	}
+	return readSegment(infile, index, segment);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::setSegmentList -- Only read the given segments of
+//    an archive (in the given order) with getFile() and read() rather
+//    than the input files of the stream.  Use clear() to return to
+//    reading the input files.
+//
+
+void HumdrumFileStream::setSegmentList(const HumSegmentIndex& index,
+		const vector<int>& segments) {
+	m_readsegments = true;
+	m_segmentindex = index;
+	m_segmentlist = segments;
+	m_segmentpos = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentLines -- Read the lines of a segment in
+//    an archive.  The segment is split into lines in the same way as
+//    getFileLines(), with the universal comments which apply to the
+//    segment when reading the archive sequentially (as stored in the
+//    index) placed before it.
+//
+
+int HumdrumFileStream::getSegmentLines(vector<string>& lines,
+		string& filename, const HumSegmentIndex& index, int segment) {
+	lines.clear();
+	filename.clear();
+	if ((segment < 0) || (segment >= index.getSegmentCount())) {
+		return 0;
+	}
+	if ((!m_segmentstream.is_open()) || (m_segmentarchive != index.getArchive())) {
+		if (m_segmentstream.is_open()) {
+			m_segmentstream.close();
+		}
+		m_segmentstream.clear();
+		m_segmentarchive = index.getArchive();
+		m_segmentstream.open(m_segmentarchive.c_str(), std::ios::in | std::ios::binary);
+		if (!m_segmentstream.is_open()) {
+			return 0;
+		}
+	}
+
+	const vector<string>& universals = index.getSegmentUniversals(segment);
+	string contents;
+	for (int i=0; i<(int)universals.size(); i++) {
+		contents += universals[i];
+		contents += '\n';
+	}
+	int64_t start = contents.size();
+	int64_t size = index.getSegmentSize(segment);
+	contents.resize(start + size);
+	m_segmentstream.clear();
+	m_segmentstream.seekg(index.getSegmentOffset(segment));
+	m_segmentstream.read(&contents[start], size);
+	if (!m_segmentstream) {
+		// the archive is smaller than the index expects.
+		return 0;
+	}
+
+	HumdrumFileStream segmentstream(contents);
+	return segmentstream.getFileLines(lines, filename);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::fillUrlBuffer --
@@ -20,6 +20,8 @@
 #include <string.h>
 
 #include <algorithm>
+#include <cctype>
+#include <cstdio>
 #include <sstream>
 
 using namespace std;
@@ -98,6 +100,22 @@ bool HumdrumFileStructure::read(const string& filename) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::readLines -- Read Humdrum data which has already
+//    been split into lines.  The strings in lines are emptied.
+//
+
+bool HumdrumFileStructure::readLines(vector<string>& lines) {
+	m_displayError = false;
+	if (!readLinesNoRhythm(lines)) {
+		return isValid();
+	}
+	return analyzeStructure();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::readCsv --  Read the contents of a file from a file or
@@ -193,21 +211,59 @@ bool HumdrumFileStructure::readStringCsv(const string& contents,
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeStructure -- Analyze global/local
-//    parameters and rhythmic structure.
+// HumdrumFileStructure::analyzeStructure -- Analyze strands, global/local
+//    parameters and rhythmic structure, as selected by the analysis level
+//    of the file (see setAnalysisLevel()).  Analyses which are not
+//    selected are done later when they are needed.
 //
 
 bool HumdrumFileStructure::analyzeStructure(void) {
 	m_structure_analyzed = false;
+	int level = m_analysis_level;
+	if (level == ANALYZE_TOKENS) {
+		// no spine information for the other analyses.
+		return isValid();
+	}
+	if (level & ANALYZE_RHYTHM) {
+		level |= ANALYZE_PARAMETERS;
+	}
+	if (level & ANALYZE_PARAMETERS) {
+		// local parameters are linked to tokens along strands.
+		level |= ANALYZE_STRANDS;
+	}
+
+	if ((level & ANALYZE_STRANDS) && !m_strands_analyzed) {
+		if (!analyzeStrands()          ) { return isValid(); }
+	}
+	if (level & ANALYZE_PARAMETERS) {
+		if (!analyzeParameters()       ) { return isValid(); }
+	}
+	if (level & ANALYZE_RHYTHM) {
+		if (!analyzeTokenDurations()   ) { return isValid(); }
+		m_structure_analyzed = true;
+		if (!analyzeRhythmStructure()  ) { return isValid(); }
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeParameters -- Analyze global and local
+//    layout parameters and signifiers.  Local parameters are analyzed
+//    together with the strands.
+//
+
+bool HumdrumFileStructure::analyzeParameters(void) {
+	m_parameters_analyzed = true;
+	if (!m_parseError.empty()) {
+		return false;
+	}
 	if (!m_strands_analyzed) {
-		if (!analyzeStrands()       ) { return isValid(); }
+		if (!analyzeStrands()          ) { return isValid(); }
 	}
 	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	m_structure_analyzed = true;
-	if (!analyzeRhythmStructure()  ) { return isValid(); }
 	analyzeSignifiers();
 	return isValid();
 }
@@ -288,10 +344,10 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 	if (!m_strands_analyzed) {
 		if (!analyzeStrands()          ) { return isValid(); }
 	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
+	if (!m_parameters_analyzed) {
+		if (!analyzeParameters()       ) { return isValid(); }
+	}
 	if (!analyzeTokenDurations()   ) { return isValid(); }
-	analyzeSignifiers();
 	return isValid();
 }
 
@@ -310,12 +366,161 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 	}
 
 	HTp firstspine = getSpineStart(0);
-	if (firstspine && firstspine->isDataType("**recip")) {
+	if (firstspine && firstspine->isDataType(datatype_recip)) {
 		assignRhythmFromRecip(firstspine);
 	} else {
 		if (!analyzeRhythm()           ) { return isValid(); }
 		if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	}
+	if (isValid()) {
+		analyzeTicks();
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeEdits -- Update the file after tokens
+//    have been changed with HumdrumToken::setText(), without having to
+//    print and re-parse the whole file.  Only lines with edited tokens
+//    are regenerated.  Edits which do not change durations or the spine
+//    structure do not need any re-analysis.  If token durations changed,
+//    then the rhythm analysis is updated starting at the last line
+//    before the first edit where all rhythmic spines have notes or rests
+//    (see analyzeRhythmFrom()).
+//    Edits to spine manipulators, null tokens or layout parameters
+//    require the spine structure to be analyzed again from the tokens.
+//
+
+bool HumdrumFileStructure::analyzeEdits(void) {
+	int rhythmline = -1;
+	bool structureQ = false;
+	bool editQ = false;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		int change = m_lines[i]->classifyEdits();
+		if (change == EDIT_NONE) {
+			continue;
+		}
+		editQ = true;
+		if (change & EDIT_TEXT) {
+			m_lines[i]->createLineFromTokens();
+		}
+		if (change & EDIT_STRUCTURE) {
+			structureQ = true;
+		}
+		if (change & EDIT_RHYTHM) {
+			// HumdrumToken::setText() does not update token durations.
+			if (!m_lines[i]->analyzeTokenDurations(m_parseError)) {
+				return isValid();
+			}
+			if (rhythmline < 0) {
+				rhythmline = i;
+			}
+		}
+		m_lines[i]->clearModified();
+	}
+	if (!editQ) {
+		return isValid();
+	}
+
+	// analyses of token contents have to be done again:
+	m_slurs_analyzed = false;
+	m_phrases_analyzed = false;
+	m_timesigs_analyzed = false;
+
+	if (structureQ) {
+		if (!analyzeBaseFromTokens()) { return isValid(); }
+		return analyzeStructure();
+	}
+	if ((rhythmline >= 0) && m_rhythm_analyzed) {
+		return analyzeRhythmFrom(rhythmline);
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeRhythmFrom -- Update the rhythm analysis
+//    after token durations on the given line (or later lines) have been
+//    changed.  The analysis restarts at the last data line before the
+//    given line which has a note or rest in every rhythmic spine, since
+//    the start time of that line does not depend on the changed
+//    durations.  If there is no such line, then the structure of the
+//    file is analyzed again from the tokens.
+//
+
+bool HumdrumFileStructure::analyzeRhythmFrom(int lineindex) {
+	int anchor = -1;
+	HTp firstspine = getSpineStart(0);
+	if (!(firstspine && firstspine->isDataType(datatype_recip))) {
+		// Edited tokens have to be checked against the previous notes in
+		// their spines, so the search starts before the edited line.
+		for (int i=lineindex-1; i>=0; i--) {
+			HumdrumLine* line = m_lines[i];
+			if (!line->isData() || line->m_durationFromStart.isNegative()) {
+				continue;
+			}
+			bool rhythmQ = false;
+			bool nullQ = false;
+			for (int j=0; j<line->getTokenCount(); j++) {
+				HTp token = line->token(j);
+				if (!token->hasRhythm()) {
+					continue;
+				}
+				rhythmQ = true;
+				if (token->isNull() || token->getDuration().isNegative()) {
+					nullQ = true;
+					break;
+				}
+			}
+			if (rhythmQ && !nullQ) {
+				anchor = i;
+				break;
+			}
+		}
+	}
+	if (anchor < 0) {
+		if (!analyzeBaseFromTokens()) { return isValid(); }
+		return analyzeStructure();
+	}
+
+	// clear the rhythm analysis after the anchor line:
+	for (int i=anchor; i<(int)m_lines.size(); i++) {
+		HumdrumLine* line = m_lines[i];
+		if (i > anchor) {
+			line->m_durationFromStart = -1;
+		}
+		for (int j=0; j<line->getTokenCount(); j++) {
+			line->token(j)->m_rhycheck = 0;
+		}
+	}
+
+	HumNum startdur = m_lines[anchor]->m_durationFromStart;
+	HumdrumLine* line = m_lines[anchor];
+	for (int j=0; j<line->getTokenCount(); j++) {
+		if (!assignDurationsToTrack(line->token(j), startdur)) {
+			return isValid();
+		}
+	}
+	// spines which start after the anchor line:
+	for (int i=1; i<=getMaxTrack(); i++) {
+		HTp start = getTrackStart(i);
+		if (!start->hasRhythm() || (start->getLineIndex() <= anchor)) {
+			continue;
+		}
+		if (!analyzeRhythmOfFloatingSpine(start)) { return isValid(); }
+	}
+
+	if (!analyzeNullLineRhythms(anchor)) { return isValid(); }
+	fillInNegativeStartTimes(anchor);
+	assignLineDurations(anchor);
+	if (!analyzeMeter(anchor)) { return isValid(); }
+	if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
+	analyzeTicks(anchor);
 	return isValid();
 }
 
@@ -437,6 +642,18 @@ bool HumdrumFileStructure::readStringNoRhythm(const string& contents) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::readLinesNoRhythm -- Read lines, but do not
+//    parse rhythm (or parameters).  The strings in lines are emptied.
+//
+
+bool HumdrumFileStructure::readLinesNoRhythm(vector<string>& lines) {
+	return HumdrumFileBase::readLines(lines);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::readStringNoRhythmCsv -- Read a string, but
@@ -506,6 +723,21 @@ int HumdrumFileStructure::tpq(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::getScoreTickDuration -- Return the total duration
+//    of the score in ticks (see tpq()).
+//
+
+int64_t HumdrumFileStructure::getScoreTickDuration(void) const {
+	if (m_lines.size() == 0) {
+		return 0;
+	}
+	return m_lines.back()->m_tickFromStart;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::getPositiveLineDurations -- Return a list of all
@@ -540,6 +772,21 @@ ostream& HumdrumFileStructure::printDurationInfo(ostream& out) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::ensureRhythm -- Analyze the rhythm of the file
+//    if it has not been done yet, so that the const barline functions can
+//    be used on a file which was read without rhythm analysis.
+//
+
+void HumdrumFileStructure::ensureRhythm(void) const {
+	if (!m_rhythm_analyzed) {
+		const_cast<HumdrumFileStructure*>(this)->analyzeRhythmStructure();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::getBarline -- Return the given barline from the file
@@ -549,6 +796,7 @@ ostream& HumdrumFileStructure::printDurationInfo(ostream& out) {
 //
 
 HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -572,6 +820,7 @@ HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
 //
 
 int HumdrumFileStructure::getBarlineCount(void) const {
+	ensureRhythm();
 	return (int)m_barlines.size();
 }
 
@@ -587,6 +836,7 @@ int HumdrumFileStructure::getBarlineCount(void) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -615,6 +865,7 @@ HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -636,6 +887,7 @@ HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationToEnd(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -649,6 +901,128 @@ HumNum HumdrumFileStructure::getBarlineDurationToEnd(int index) const {
 }
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::getTimeSigChange -- Return the time signature
+//     which is active on the given line in a track (which can be on
+//     that line or an earlier one).  Returns NULL if there is no time
+//     signature in the track before the line.
+//
+
+const TimeSigChange* HumdrumFileStructure::getTimeSigChange(int lineindex,
+		int track) {
+	if (!m_timesigs_analyzed) {
+		analyzeTimeSignatures();
+	}
+	if ((track < 0) || (track >= (int)m_timesigs.size())) {
+		return NULL;
+	}
+	const vector<TimeSigChange>& changes = m_timesigs[track];
+	auto it = std::upper_bound(changes.begin(), changes.end(), lineindex,
+			[](int line, const TimeSigChange& change) {
+				return line < change.line;
+			});
+	if (it == changes.begin()) {
+		return NULL;
+	}
+	--it;
+	return &(*it);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getTimeSigTop -- Return the top number of the
+//     time signature active on the given line in a track, or 0 if there
+//     is no time signature.
+//
+
+int HumdrumFileStructure::getTimeSigTop(int lineindex, int track) {
+	const TimeSigChange* change = getTimeSigChange(lineindex, track);
+	if (!change) {
+		return 0;
+	}
+	return change->top;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getTimeSigBottom -- Return the bottom of the time
+//     signature active on the given line in a track as a rhythm (3/2
+//     for *M3/3%2), or 0 if there is no time signature.
+//
+
+HumNum HumdrumFileStructure::getTimeSigBottom(int lineindex, int track) {
+	const TimeSigChange* change = getTimeSigChange(lineindex, track);
+	if (!change) {
+		return 0;
+	}
+	return change->bottom;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeTimeSignatures -- Store the time signatures
+//     of each track so that they do not need to be parsed again by
+//     each analysis which needs them.  This is done the first time that
+//     a time signature is requested.  Only the first time signature for
+//     a track on a line is used.  Multimeters such as 2+3/4 or 3/4+6/8 are
+//     not handled.
+//
+
+bool HumdrumFileStructure::analyzeTimeSignatures(void) {
+	m_timesigs_analyzed = true;
+	m_timesigs.clear();
+	m_timesigs.resize(getMaxTrack() + 1);
+	int top;
+	int bot;
+	int bot2;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (!line.isInterpretation()) {
+			continue;
+		}
+		for (int j=0; j<line.getFieldCount(); j++) {
+			HTp token = line.token(j);
+			if ((token->size() < 3) || (token->compare(0, 2, "*M") != 0) ||
+					!isdigit((*token)[2])) {
+				continue;
+			}
+			int track = token->getTrack();
+			if ((track < 1) || (track >= (int)m_timesigs.size())) {
+				continue;
+			}
+			vector<TimeSigChange>& changes = m_timesigs[track];
+			if (!changes.empty() && (changes.back().line == i)) {
+				// already found a time signature for the track on this line.
+				continue;
+			}
+			TimeSigChange change;
+			int count = sscanf(token->c_str(), "*M%d/%d%%%d", &top, &bot, &bot2);
+			if (count < 2) {
+				continue;
+			}
+			change.line = i;
+			change.top = top;
+			change.bot = bot;
+			if ((count == 3) && (bot2 > 0)) {
+				change.bottom.setValue(bot, bot2);
+			} else {
+				change.bottom = bot;
+			}
+			changes.push_back(change);
+		}
+	}
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::setLineRhythmAnalyzed --
@@ -729,32 +1103,44 @@ bool HumdrumFileStructure::analyzeRhythm(void) {
 //     for barlines, where the getDurationToBarline() will store the
 //     duration of the measure staring at that barline.  To get the
 //     beat, you will have to figure out the current time signature.
+//     If startline is given, then only the lines affected by changes
+//     in durations from that line onwards are updated, and the list of
+//     barlines is kept.  Default value: startline = 0.
 //
 
-bool HumdrumFileStructure::analyzeMeter(void) {
-
-	m_barlines.resize(0);
+bool HumdrumFileStructure::analyzeMeter(int startline) {
 
+	// the barlines do not change when only durations are updated:
+	bool barlinesQ = startline <= 0;
 	int i;
 	HumNum sum = 0;
 	bool foundbarline = false;
-	for (i=0; i<getLineCount(); i++) {
+	if (barlinesQ) {
+		startline = 0;
+		m_barlines.resize(0);
+	} else {
+		sum = m_lines[startline]->m_durationFromBarline;
+	}
+	for (i=startline; i<getLineCount(); i++) {
 		m_lines[i]->setDurationFromBarline(sum);
 		sum += m_lines[i]->getDuration();
 		if (m_lines[i]->isBarline()) {
 			foundbarline = true;
-			m_barlines.push_back(m_lines[i]);
+			if (barlinesQ) {
+				m_barlines.push_back(m_lines[i]);
+			}
 			sum = 0;
 		}
-		if (m_lines[i]->isData() && !foundbarline) {
+		if (barlinesQ && m_lines[i]->isData() && !foundbarline) {
 			// pickup measure, so set the first measure to the start of the file.
 			m_barlines.push_back(m_lines[0]);
 			foundbarline = 1;
 		}
 	}
 
+	int stopline = getPreviousBarlineIndex(startline);
 	sum = 0;
-	for (i=getLineCount()-1; i>=0; i--) {
+	for (i=getLineCount()-1; i>=stopline; i--) {
 		sum += m_lines[i]->getDuration();
 		m_lines[i]->setDurationToBarline(sum);
 		if (m_lines[i]->isBarline()) {
@@ -767,6 +1153,107 @@ bool HumdrumFileStructure::analyzeMeter(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::getPreviousBarlineIndex -- Return the index of the
+//    last barline at or before the given line, or 0 if there is no
+//    barline before the line.  The duration to the next barline does not
+//    change for lines before this barline when durations are changed at
+//    or after the given line.
+//
+
+int HumdrumFileStructure::getPreviousBarlineIndex(int lineindex) {
+	for (int i=lineindex; i>0; i--) {
+		if (m_lines[i]->isBarline()) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeTicks -- Store the rhythmic positions and
+//     durations of lines and tokens as integer counts of ticks, where
+//     there are tpq() ticks in a quarter note.  This allows timeline
+//     calculations with integer arithmetic rather than with HumNum
+//     fractions.  The offsets from barlines are calculated in the same
+//     manner as analyzeMeter().  If startline is given, then only lines
+//     from that line onwards are updated, unless the change in durations
+//     also changes tpq().  Default value: startline = 0.
+//
+
+bool HumdrumFileStructure::analyzeTicks(int startline) {
+	// line durations may have changed since tpq() was last called:
+	int oldticks = m_ticksperquarternote;
+	m_ticksperquarternote = -1;
+	int64_t ticks = tpq();
+	if ((startline < 0) || (ticks != oldticks)) {
+		startline = 0;
+	}
+
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (i >= startline) {
+			HumNum start = line.m_durationFromStart;
+			line.m_tickFromStart = (int64_t)start.getNumerator() * ticks /
+					start.getDenominator();
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			if ((i < startline) && line.m_tokens[j]->hasRhythm()) {
+				// durations of non-rhythmic tokens before startline may
+				// extend past it, so only they have to be updated.
+				continue;
+			}
+			HumNum dur = line.m_tokens[j]->getDuration();
+			if (dur.isNegative()) {
+				line.m_tokens[j]->m_tickDuration = -1;
+			} else {
+				line.m_tokens[j]->m_tickDuration = (int64_t)dur.getNumerator() * ticks /
+						dur.getDenominator();
+			}
+		}
+	}
+
+	int64_t sum = 0;
+	if (startline > 0) {
+		sum = m_lines[startline]->m_tickFromBarline;
+	}
+	for (int i=startline; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (i < (int)m_lines.size() - 1) {
+			line.m_tickDuration = m_lines[i+1]->m_tickFromStart - line.m_tickFromStart;
+			if (line.m_tickDuration < 0) {
+				line.m_tickDuration = 0;
+			}
+		} else {
+			line.m_tickDuration = 0;
+		}
+		line.m_tickFromBarline = sum;
+		sum += line.m_tickDuration;
+		if (line.isBarline()) {
+			sum = 0;
+		}
+	}
+
+	int stopline = getPreviousBarlineIndex(startline);
+	sum = 0;
+	for (int i=(int)m_lines.size()-1; i>=stopline; i--) {
+		HumdrumLine& line = *m_lines[i];
+		sum += line.m_tickDuration;
+		line.m_tickToBarline = sum;
+		if (line.isBarline()) {
+			sum = 0;
+		}
+	}
+
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeTokenDurations -- Calculate the duration of
@@ -1179,9 +1666,10 @@ bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
 //    lines.  For example if a data line starts at time 15, and there is one
 //    null-token line before another data line at time 16, then the null-token
 //    line will be assigned to the position 15.5 in the score.
+//    Default value: startline = 0.
 //
 
-bool HumdrumFileStructure::analyzeNullLineRhythms(void) {
+bool HumdrumFileStructure::analyzeNullLineRhythms(int startline) {
 	vector<HumdrumLine*> nulllines;
 	HumdrumLine* previous = NULL;
 	HumdrumLine* next = NULL;
@@ -1189,7 +1677,7 @@ bool HumdrumFileStructure::analyzeNullLineRhythms(void) {
 	HumNum startdur;
 	HumNum enddur;
 	int i, j;
-	for (i=0; i<(int)m_lines.size(); i++) {
+	for (i=startline; i<(int)m_lines.size(); i++) {
 		if (!m_lines[i]->hasSpines()) {
 			continue;
 		}
@@ -1237,14 +1725,14 @@ bool HumdrumFileStructure::analyzeNullLineRhythms(void) {
 // HumdrumFileStructure::fillInNegativeStartTimes -- Negative line durations
 //    after the initial rhythmAnalysis mean that the lines are not data line.
 //    Duplicate the duration of the next non-negative duration for all negative
-//    durations.
+//    durations.  Default value: startline = 0.
 //
 
-void HumdrumFileStructure::fillInNegativeStartTimes(void) {
+void HumdrumFileStructure::fillInNegativeStartTimes(int startline) {
 	int i;
 	HumNum lastdur = -1;
 	HumNum dur;
-	for (i=(int)m_lines.size()-1; i>=0; i--) {
+	for (i=(int)m_lines.size()-1; i>=startline; i--) {
 		dur = m_lines[i]->getDurationFromStart();
 		if (dur.isNegative() && lastdur.isNonNegative()) {
 			m_lines[i]->setDurationFromStart(lastdur);
@@ -1256,7 +1744,7 @@ void HumdrumFileStructure::fillInNegativeStartTimes(void) {
 	}
 
 	// fill in start times for ending comments
-	for (i=0; i<(int)m_lines.size(); i++) {
+	for (i=startline; i<(int)m_lines.size(); i++) {
 		dur = m_lines[i]->getDurationFromStart();
 		if (dur.isNonNegative()) {
 			lastdur = dur;
@@ -1272,13 +1760,14 @@ void HumdrumFileStructure::fillInNegativeStartTimes(void) {
 //
 // HumdrumFileStructure::assignLineDurations --  Calculate the duration of lines
 //   based on the durationFromStart of the current line and the next line.
+//   Default value: startline = 0.
 //
 
-void HumdrumFileStructure::assignLineDurations(void) {
+void HumdrumFileStructure::assignLineDurations(int startline) {
 	HumNum startdur;
 	HumNum enddur;
 	HumNum dur;
-	for (int i=0; i<(int)m_lines.size()-1; i++) {
+	for (int i=startline; i<(int)m_lines.size()-1; i++) {
 		startdur = m_lines[i]->getDurationFromStart();
 		enddur = m_lines[i+1]->getDurationFromStart();
 		dur = enddur - startdur;
@@ -1471,6 +1960,10 @@ void HumdrumFileStructure::checkForLocalParameters(HTp token,
 
 bool HumdrumFileStructure::analyzeStrands(void) {
 	m_strands_analyzed = true;
+	if (!m_parseError.empty()) {
+		// spine structure is not valid, so strands cannot be followed.
+		return false;
+	}
 	int spines = getSpineCount();
 	m_strand1d.clear();
 	m_strand2d.clear();
@@ -1743,6 +2236,7 @@ bool HumdrumFileStructure::hasUniversalFilters(void) {
 
 void HumdrumFileStructure::analyzeSignifiers(void) {
 	HumdrumFileStructure& infile = *this;
+	m_signifiers.clear();
 	for (int i=0; i<getLineCount(); i++) {
 		if (!infile[i].isSignifier()) {
 			continue;
@@ -1760,6 +2254,9 @@ void HumdrumFileStructure::analyzeSignifiers(void) {
 //
 
 std::string HumdrumFileStructure::getKernLinkSignifier(void) {
+	if (!m_parameters_analyzed) {
+		analyzeParameters();
+	}
 	return m_signifiers.getKernLinkSignifier();
 }
 
@@ -1773,6 +2270,9 @@ std::string HumdrumFileStructure::getKernLinkSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernAboveSignifier(void) {
+	if (!m_parameters_analyzed) {
+		analyzeParameters();
+	}
 	return m_signifiers.getKernAboveSignifier();
 }
 
@@ -1786,6 +2286,9 @@ std::string HumdrumFileStructure::getKernAboveSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernBelowSignifier(void) {
+	if (!m_parameters_analyzed) {
+		analyzeParameters();
+	}
 	return m_signifiers.getKernBelowSignifier();
 }
 
@@ -17,6 +17,7 @@
 #include "Convert.h"
 
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 
 using namespace std;
@@ -68,6 +69,7 @@ HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line) {
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_modified            = line.m_modified;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -86,6 +88,7 @@ HumdrumLine::HumdrumLine(HumdrumLine& line, void* owner) : string((string)line)
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_modified            = line.m_modified;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -110,6 +113,7 @@ HumdrumLine& HumdrumLine::operator=(HumdrumLine& line) {
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_modified            = line.m_modified;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -141,6 +145,32 @@ HumdrumLine::~HumdrumLine() {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::operator new -- Allocate lines from the arena of the
+//    HumdrumFile which is reading them (see HumPoolScope) rather than
+//    individually from the heap.
+//
+
+void* HumdrumLine::operator new(size_t size) {
+	return HumPool::allocateObject(size);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::operator delete -- Release the memory of a line.  Arena
+//    memory is returned to the system when all objects in its slab are
+//    deleted.
+//
+
+void HumdrumLine::operator delete(void* ptr) {
+	HumPool::releaseObject(ptr);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::setLineFromCsv -- Read a HumdrumLine from a CSV line.
@@ -240,6 +270,7 @@ void HumdrumLine::clear(void) {
 	m_tokens.clear();
 	m_tabs.clear();
 	m_rhythm_analyzed = false;
+	m_modified = EDIT_NONE;
 }
 
 
@@ -278,7 +309,7 @@ bool HumdrumLine::isKernBoundaryStart(void) const {
 		return false;
 	}
 	for (int i=0; i<getFieldCount(); i++) {
-		if (!token(i)->isDataType("**kern")) {
+		if (!token(i)->isKern()) {
 			continue;
 		}
 		if (token(i)->isNull()) {
@@ -304,7 +335,7 @@ bool HumdrumLine::isKernBoundaryEnd(void) const {
 	}
 	HTp ntok;
 	for (int i=0; i<getFieldCount(); i++) {
-		if (!token(i)->isDataType("**kern")) {
+		if (!token(i)->isKern()) {
 			continue;
 		}
 		ntok = token(i)->getNextToken();
@@ -1076,6 +1107,117 @@ void HumdrumLine::setDuration(HumNum aDur) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::getTickDuration -- Return the duration of the line in
+//    ticks (see HumdrumFileStructure::tpq()).  The tick values are integer
+//    versions of the HumNum durations which can be added and compared
+//    without fraction arithmetic.
+//
+
+int64_t HumdrumLine::getTickDuration(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickDuration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickFromStart -- Return the duration in ticks from the
+//    start of the file to the start of the line.
+//
+
+int64_t HumdrumLine::getTickFromStart(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickFromStart;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickToEnd -- Return the duration in ticks from the
+//    start of the line to the end of the file.
+//
+
+int64_t HumdrumLine::getTickToEnd(void) {
+	HumdrumFile* owner = getOwner();
+	if (owner == NULL) {
+		return 0;
+	}
+	if (!m_rhythm_analyzed) {
+		owner->analyzeRhythmStructure();
+	}
+	return owner->getScoreTickDuration() - m_tickFromStart;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickFromBarline -- Return the duration in ticks from
+//    the previous barline to the start of the line.
+//
+
+int64_t HumdrumLine::getTickFromBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickFromBarline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickToBarline -- Return the duration in ticks from the
+//    start of the line to the next barline.
+//
+
+int64_t HumdrumLine::getTickToBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickToBarline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getBarlineTickDuration -- Return the duration in ticks of
+//    the measure which contains the line (or which starts at the line
+//    if it is a barline).
+//
+
+int64_t HumdrumLine::getBarlineTickDuration(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	if (isBarline()) {
+		return m_tickToBarline;
+	} else {
+		return m_tickFromBarline + m_tickToBarline;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::hasSpines -- Returns true if the line contains spines.  This
@@ -1197,7 +1339,9 @@ string HumdrumLine::getTokenString(int index) const {
 //////////////////////////////
 //
 // HumdrumLine::createTokensFromLine -- Chop up a HumdrumLine string into
-//     individual tokens.
+//     individual tokens.  Tabs are found with memchr() so that each token
+//     is copied from the line in one piece.  Repeated tabs between tokens
+//     are treated as a single separator and counted in m_tabs.
 //
 
 int HumdrumLine::createTokensFromLine(void) {
@@ -1209,57 +1353,77 @@ int HumdrumLine::createTokensFromLine(void) {
 	}
 	m_tokens.clear();
 	m_tabs.clear();
+	// tokens now match the text of the line:
+	m_modified = EDIT_NONE;
 	HTp token;
-	char ch = 0;
-	char lastch = 0;
-	string tstring;
 
 	if (this->size() == 0) {
 		token = new HumdrumToken();
 		token->setOwner(this);
 		m_tokens.push_back(token);
-		m_tokens.push_back(0);
+		m_tabs.push_back(0);
 	} else if (this->compare(0, 2, "!!") == 0) {
 		token = new HumdrumToken(this->c_str());
 		token->setOwner(this);
 		m_tokens.push_back(token);
 		m_tabs.push_back(0);
 	} else {
-		for (int i=0; i<(int)size(); i++) {
-			lastch = ch;
-			ch = getChar(i);
-			if (ch == '\t') {
-				// Parser now allows multiple tab characters in a
-				// row to represent a single tab.
-				if (lastch != '\t') {
-					token = new HumdrumToken(tstring);
-					token->setOwner(this);
-					m_tokens.push_back(token);
-					m_tabs.push_back(1);
-					tstring.clear();
-				} else {
-					if (m_tabs.size() > 0) {
-						m_tabs.back()++;
-					}
-				}
-			} else {
-				tstring += ch;
+		const char* ptr = this->data();
+		const char* end = ptr + this->size();
+		const char* tab;
+		const char* next;
+		while (ptr < end) {
+			tab = (const char*)memchr(ptr, '\t', end - ptr);
+			if (tab == NULL) {
+				tab = end;
+			}
+			token = new HumdrumToken(ptr, tab - ptr);
+			token->setOwner(this);
+			m_tokens.push_back(token);
+			if (tab == end) {
+				m_tabs.push_back(0);
+				break;
+			}
+			// Parser now allows multiple tab characters in a
+			// row to represent a single tab.
+			next = tab + 1;
+			while ((next < end) && (*next == '\t')) {
+				next++;
 			}
+			m_tabs.push_back((int)(next - tab));
+			ptr = next;
 		}
 	}
-	if (tstring.size() > 0) {
-		token = new HumdrumToken(tstring);
-		token->setOwner(this);
-		m_tokens.push_back(token);
-		m_tabs.push_back(0);
-		tstring.clear();
-	}
 
 	return (int)m_tokens.size();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::clearTokenLinkInfo -- Prepare the tokens on the line for
+//    a new structural analysis after they were edited in place: tokens
+//    which were added with insertToken() or appendToken() are given this
+//    line as their owner, spine links are removed from all tokens, and the
+//    rhythm analysis of the line is reset.
+//
+
+void HumdrumLine::clearTokenLinkInfo(void) {
+	for (int i=0; i<(int)m_tokens.size(); i++) {
+		if (m_tokens[i] == NULL) {
+			continue;
+		}
+		m_tokens[i]->setOwner(this);
+		m_tokens[i]->clearLinkInfo();
+	}
+	m_duration = -1;
+	m_durationFromStart = -1;
+	m_rhythm_analyzed = false;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::createLineFromTokens --  Re-generate a HumdrumLine string from
@@ -1294,6 +1458,84 @@ void HumdrumLine::createLineFromTokens(void) {
 			}
 		}
 	}
+	m_modified &= ~EDIT_TEXT;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::isModified -- Returns true if any tokens on the line have
+//    been changed with HumdrumToken::setText() since the line was last
+//    regenerated or analyzed.
+//
+
+bool HumdrumLine::isModified(void) const {
+	return m_modified != EDIT_NONE;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getModified -- Returns the EDIT_* flags for changes to the
+//    tokens on the line.
+//
+
+int HumdrumLine::getModified(void) const {
+	return m_modified;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::setModified -- Mark the line as having changed tokens.
+//    This is done automatically by HumdrumToken::setText(), but should
+//    be called if a token is changed directly through its std::string
+//    interface.  Default value: change = EDIT_TEXT.
+//
+
+void HumdrumLine::setModified(int change) {
+	m_modified |= change;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::clearModified -- Remove the given EDIT_* flags from the
+//    line.  Clearing EDIT_PENDING discards the edits of the tokens which
+//    have not been classified yet.  Default value: change = all flags.
+//
+
+void HumdrumLine::clearModified(int change) {
+	if ((change & EDIT_PENDING) && (m_modified & EDIT_PENDING)) {
+		for (int i=0; i<(int)m_tokens.size(); i++) {
+			m_tokens[i]->clearEdit();
+		}
+	}
+	m_modified &= ~change;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::classifyEdits -- Classify the changes made to tokens
+//    with HumdrumToken::setText() as text, rhythm or structure edits
+//    (see HumdrumToken::classifyEdit()).  Returns the EDIT_* flags of
+//    the line.
+//
+
+int HumdrumLine::classifyEdits(void) {
+	if (m_modified & EDIT_PENDING) {
+		for (int i=0; i<(int)m_tokens.size(); i++) {
+			m_modified |= m_tokens[i]->classifyEdit();
+		}
+		m_modified &= ~EDIT_PENDING;
+	}
+	return m_modified;
 }
 
 
@@ -1965,6 +2207,7 @@ void HumdrumLine::appendToken(HTp token, int tabcount) {
 	// deletion will be handled by class.
 	m_tokens.push_back(token);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -1972,6 +2215,7 @@ void HumdrumLine::appendToken(const HumdrumToken& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -1979,6 +2223,7 @@ void HumdrumLine::appendToken(const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -1986,6 +2231,7 @@ void HumdrumLine::appendToken(const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -2021,6 +2267,7 @@ void HumdrumLine::insertToken(int index, HTp token, int tabcount) {
 	// already belongs to another HumdrumLine or HumdrumFile.
 	m_tokens.insert(m_tokens.begin() + index, token);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -2028,6 +2275,7 @@ void HumdrumLine::insertToken(int index, const HumdrumToken& token, int tabcount
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -2035,6 +2283,7 @@ void HumdrumLine::insertToken(int index, const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -2042,6 +2291,7 @@ void HumdrumLine::insertToken(int index, const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
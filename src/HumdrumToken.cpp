@@ -70,6 +70,15 @@ HumdrumToken::HumdrumToken(const char* aString) : string(aString) {
 }
 
 
+HumdrumToken::HumdrumToken(const char* aString, size_t length) :
+		string(aString, length) {
+	m_rhycheck = 0;
+	setPrefix("!");
+	m_strand = -1;
+	m_nullresolve = NULL;
+}
+
+
 HumdrumToken::HumdrumToken(const HumdrumToken& token) :
 		string((string)token), HumHash((HumHash)token) {
 	m_address         = token.m_address;
@@ -211,9 +220,41 @@ HumdrumToken::~HumdrumToken() {
 		delete m_parameterSet;
 		m_parameterSet = NULL;
 	}
+	if (m_noteinfo) {
+		delete m_noteinfo;
+		m_noteinfo = NULL;
+	}
+	clearEdit();
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumToken::operator new -- Allocate tokens from the arena of the
+//    HumdrumFile which is reading them (see HumPoolScope) rather than
+//    individually from the heap, since a file creates one token for
+//    every field on every line.
+//
+
+void* HumdrumToken::operator new(size_t size) {
+	return HumPool::allocateObject(size);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::operator delete -- Release the memory of a token.  Arena memory
+//    is returned to the system when all objects in its slab are deleted.
+//
+
+void HumdrumToken::operator delete(void* ptr) {
+	HumPool::releaseObject(ptr);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::equalChar -- Returns true if the character at the given
@@ -321,13 +362,15 @@ HumdrumToken* HumdrumToken::getNextNonNullDataToken(int index) {
 //
 
 HumNum HumdrumToken::getSlurDuration(HumNum scale) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 		return 0;
 	}
-	if (isDefined("auto", "slurDuration")) {
-		return getValueFraction("auto", "slurDuration");
-	} else if (isDefined("auto", "slurEnd")) {
-		HTp slurend = getValueHTp("auto", "slurEnd");
+	static const HumParamKey slurDurationKey("auto", "slurDuration");
+	static const HumParamKey slurEndKey("auto", "slurEnd");
+	if (isDefined(slurDurationKey)) {
+		return getValueFraction(slurDurationKey);
+	} else if (isDefined(slurEndKey)) {
+		HTp slurend = getValueHTp(slurEndKey);
 		return slurend->getDurationFromStart(scale) -
 				getDurationFromStart(scale);
 	} else {
@@ -366,6 +409,126 @@ bool HumdrumToken::isDataType(const string& dtype) const {
 }
 
 
+bool HumdrumToken::isDataType(int dtypeid) const {
+	return getDataTypeId() == dtypeid;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeId -- Returns the interned ID of the exclusive
+//    interpretation for the token (see the datatype_id enum).  The ID is
+//    stored in the token by HumdrumFileBase::analyzeTracks(), and tokens
+//    which have not been analyzed yet will look up their data type.
+// @SEEALSO: registerDataType getDataTypeName
+//
+
+int HumdrumToken::getDataTypeId(void) const {
+	if (m_datatype != datatype_unknown) {
+		return m_datatype;
+	}
+	return registerDataType(getDataType());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::setDataTypeId -- Set the exclusive interpretation ID
+//    of the token.
+//
+
+void HumdrumToken::setDataTypeId(int dtypeid) {
+	m_datatype = dtypeid;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::registerDataType -- Return the ID of an exclusive
+//    interpretation, giving it the next free ID if it has not been seen
+//    before.  The "**" at the start of the data type is optional.  An
+//    empty string returns datatype_none.
+//
+
+int HumdrumToken::registerDataType(const string& dtype) {
+	if (dtype.empty()) {
+		return datatype_none;
+	}
+	string name;
+	if (dtype.compare(0, 2, "**") == 0) {
+		name = dtype;
+	} else {
+		name = "**" + dtype;
+	}
+	std::lock_guard<std::mutex> lock(getDataTypeMutex());
+	vector<string>& list = getDataTypeList();
+	for (int i=1; i<(int)list.size(); i++) {
+		if (list[i] == name) {
+			return i;
+		}
+	}
+	list.push_back(name);
+	return (int)list.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeName -- Return the exclusive interpretation
+//    for an ID returned by registerDataType(), or an empty string if the
+//    ID is not used.
+//
+
+string HumdrumToken::getDataTypeName(int dtypeid) {
+	std::lock_guard<std::mutex> lock(getDataTypeMutex());
+	vector<string>& list = getDataTypeList();
+	if ((dtypeid < 0) || (dtypeid >= (int)list.size())) {
+		return "";
+	}
+	return list[dtypeid];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeList -- Exclusive interpretations indexed by
+//    their ID.  The entries must match the order of the datatype_id enum.
+//
+
+vector<string>& HumdrumToken::getDataTypeList(void) {
+	static vector<string> list = {
+		"",           // datatype_none
+		"**kern",     // datatype_kern
+		"**mens",     // datatype_mens
+		"**recip",    // datatype_recip
+		"**text",     // datatype_text
+		"**silbe",    // datatype_silbe
+		"**sylb",     // datatype_sylb
+		"**dynam",    // datatype_dynam
+		"**harm"      // datatype_harm
+	};
+	return list;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeMutex -- Used to access the data type list
+//    from more than one thread.
+//
+
+std::mutex& HumdrumToken::getDataTypeMutex(void) {
+	static std::mutex datatypemutex;
+	return datatypemutex;
+}
+
+
 
 //////////////////////////////
 //
@@ -375,7 +538,7 @@ bool HumdrumToken::isDataType(const string& dtype) const {
 //
 
 bool HumdrumToken::isKern(void) const {
-	return isDataType("**kern");
+	return getDataTypeId() == datatype_kern;
 }
 
 
@@ -388,7 +551,7 @@ bool HumdrumToken::isKern(void) const {
 //
 
 bool HumdrumToken::isMens(void) const {
-	return isDataType("**mens");
+	return getDataTypeId() == datatype_mens;
 }
 
 
@@ -848,6 +1011,9 @@ HumNum HumdrumToken::getTiedDuration(HumNum scale) {
 //
 
 int HumdrumToken::getDots(char separator) const {
+	if ((separator == ' ') && isNoteInfoCurrent()) {
+		return m_noteinfo->dots;
+	}
 	int count = 0;
 	for (int i=0; i<(int)this->size()-1; i++) {
 		if (this->at(i) == '.') {
@@ -862,6 +1028,219 @@ int HumdrumToken::getDots(char separator) const {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getNoteInfo -- Return note attributes parsed from the
+//    text of the token.  The attributes are parsed on the first call
+//    and then cached until the text of the token changes.  The pitch
+//    values are the same as those returned by the Convert::kernTo*
+//    functions, which also use this cache when given a token pointer.
+//
+
+const HumNoteInfo& HumdrumToken::getNoteInfo(void) {
+	if (isNoteInfoCurrent()) {
+		return *m_noteinfo;
+	}
+	if (m_noteinfo == NULL) {
+		HumdrumFile* infile = getOwner() ? getOwner()->getOwner() : NULL;
+		if (infile) {
+			HumPoolScope scope(infile->m_pool);
+			m_noteinfo = new HumNoteInfo;
+		} else {
+			m_noteinfo = new HumNoteInfo;
+		}
+	}
+	HumNoteInfo& info = *m_noteinfo;
+	info.length = (uint32_t)this->size();
+	info.hash   = getTextHash(*this);
+
+	const char* text = this->c_str();
+	int length = (int)this->size();
+	int diatonic = -2000;
+	int accid = 0;
+	int uc = 0;
+	int lc = 0;
+	int dots = 0;
+	bool hasrest = false;
+	bool first = true;   // still in first subtoken
+	bool note = false;
+	bool rest = false;
+	bool grace = false;
+	bool tieStart = false;
+	bool tieCont = false;
+	bool tieEnd = false;
+	bool slurStart = false;
+	bool slurEnd = false;
+
+	for (int i=0; i<length; i++) {
+		char ch = text[i];
+		switch (ch) {
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				note = true;
+				if (first) {
+					uc++;
+					if (diatonic == -2000) {
+						diatonic = (ch - 'A' + 5) % 7;
+					}
+				}
+				break;
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+				note = true;
+				if (first) {
+					lc++;
+					if (diatonic == -2000) {
+						diatonic = (ch - 'a' + 5) % 7;
+					}
+				}
+				break;
+			case 'r':
+				rest = true;
+				if (first) {
+					hasrest = true;
+					if (diatonic == -2000) {
+						diatonic = -1000;
+					}
+				}
+				break;
+			case '-': if (first) { accid--; } break;
+			case '#': if (first) { accid++; } break;
+			case '.': if (first && (i < length - 1)) { dots++; } break;
+			case 'q': grace     = true; break;
+			case '[': tieStart  = true; break;
+			case '_': tieCont   = true; break;
+			case ']': tieEnd    = true; break;
+			case '(': slurStart = true; break;
+			case ')': slurEnd   = true; break;
+			case ' ': first     = false; break;
+		}
+	}
+
+	int octave = -1000;
+	if (hasrest || (uc && lc)) {
+		octave = -1000;
+	} else if (uc) {
+		octave = 4 - uc;
+	} else if (lc) {
+		octave = 3 + lc;
+	}
+
+	static const int b40table[7] = {0, 6, 12, 17, 23, 29, 35};
+	static const int b12table[7] = {0, 2, 4, 5, 7, 9, 11};
+
+	info.note        = note;
+	info.rest        = rest;
+	info.null        = (length == 1) && (text[0] == '.');
+	info.grace       = grace;
+	info.tieStart    = tieStart;
+	info.tieCont     = tieCont;
+	info.tieEnd      = tieEnd;
+	info.slurStart   = slurStart;
+	info.slurEnd     = slurEnd;
+	info.diatonic    = diatonic;
+	info.accidentals = accid;
+	info.octave      = octave;
+	info.dots        = dots;
+	if (diatonic < 0) {
+		info.base40PC = diatonic;
+		info.base12PC = diatonic;
+	} else {
+		info.base40PC = b40table[diatonic] + accid + 2;
+		info.base12PC = b12table[diatonic] + accid;
+	}
+
+	return info;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::isNoteInfoCurrent -- Returns true if the note attributes
+//    have been parsed from the current text of the token.  The text can
+//    be changed through the std::string interface as well as setText(),
+//    so its length and hash are compared rather than an edit counter.
+//
+
+bool HumdrumToken::isNoteInfoCurrent(void) const {
+	if (m_noteinfo == NULL) {
+		return false;
+	}
+	if (m_noteinfo->length != (uint32_t)this->size()) {
+		return false;
+	}
+	return m_noteinfo->hash == getTextHash(*this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTextHash -- FNV-1a hash of the token text used to
+//    check if the cached note attributes are still valid.
+//
+
+uint32_t HumdrumToken::getTextHash(const string& text) {
+	uint32_t hash = 2166136261u;
+	for (int i=0; i<(int)text.size(); i++) {
+		hash ^= (unsigned char)text[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+
+//////////////////////////////
+//
+// HumNoteInfo::HumNoteInfo -- Constructor.  The attributes are filled
+//    in by HumdrumToken::getNoteInfo().
+//
+
+HumNoteInfo::HumNoteInfo(void) {
+	length      = 0;
+	hash        = 0;
+	diatonic    = -2000;
+	accidentals = 0;
+	octave      = -1000;
+	dots        = 0;
+	base40PC    = -2000;
+	base12PC    = -2000;
+	note        = false;
+	rest        = false;
+	null        = false;
+	grace       = false;
+	tieStart    = false;
+	tieCont     = false;
+	tieEnd      = false;
+	slurStart   = false;
+	slurEnd     = false;
+}
+
+
+
+//////////////////////////////
+//
+// HumNoteInfo::operator new -- Allocate the note attributes from the
+//    arena of the file which owns the token (see HumdrumToken::getNoteInfo).
+//
+
+void* HumNoteInfo::operator new(size_t size) {
+	return HumPool::allocateObject(size);
+}
+
+
+
+//////////////////////////////
+//
+// HumNoteInfo::operator delete -- Release the memory of the note attributes.
+//
+
+void HumNoteInfo::operator delete(void* ptr) {
+	HumPool::releaseObject(ptr);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getDurationNoDots -- Return the duration of the
@@ -927,6 +1306,104 @@ HumNum HumdrumToken::getDurationFromStart(HumNum scale) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getTickDuration -- Return the duration of the token in
+//    ticks (see HumdrumFileStructure::tpq()).  Non-rhythmic tokens have
+//    a tick duration of -1.
+//
+
+int64_t HumdrumToken::getTickDuration(void) {
+	HumdrumLine* own = getOwner();
+	if (own) {
+		// make sure that the rhythm of the file has been analyzed:
+		own->getTickFromStart();
+	}
+	return m_tickDuration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickFromStart -- Return the duration in ticks from the
+//    start of the file to the start of the token.
+//
+
+int64_t HumdrumToken::getTickFromStart(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickFromStart();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickToEnd -- Return the duration in ticks from the
+//    start of the token to the end of the file.
+//
+
+int64_t HumdrumToken::getTickToEnd(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickToEnd();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickFromBarline -- Return the duration in ticks from
+//    the previous barline to the start of the token.
+//
+
+int64_t HumdrumToken::getTickFromBarline(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickFromBarline();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickToBarline -- Return the duration in ticks from
+//    the start of the token to the next barline.
+//
+
+int64_t HumdrumToken::getTickToBarline(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickToBarline();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getBarlineTickDuration -- Return the duration in ticks
+//    of the measure which contains the token.
+//
+
+int64_t HumdrumToken::getBarlineTickDuration(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getBarlineTickDuration();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getDurationToEnd -- Returns the duration from the
@@ -1035,15 +1512,11 @@ HumNum HumdrumToken::getDurationFromBarline(HumNum scale) {
 //
 
 bool HumdrumToken::hasRhythm(void) const {
-	string type = getDataType();
-	if (type == "**kern") {
-		return true;
-	}
-	if (type == "**recip") {
-		return true;
-	}
-	if (type == "**mens") {
-		return true;
+	switch (getDataTypeId()) {
+		case datatype_kern:
+		case datatype_recip:
+		case datatype_mens:
+			return true;
 	}
 	return false;
 }
@@ -1107,9 +1580,9 @@ bool HumdrumToken::equalTo(const string& pattern) {
 
 bool HumdrumToken::isRest(void) {
 	if (isKern()) {
-		if (isNull() && Convert::isKernRest((string)(*resolveNull()))) {
+		if (isNull() && resolveNull()->getNoteInfo().rest) {
 			return true;
-		} else if (Convert::isKernRest((string)(*this))) {
+		} else if (getNoteInfo().rest) {
 			return true;
 		}
 	} else if (isMens()) {
@@ -1132,7 +1605,7 @@ bool HumdrumToken::isRest(void) {
 
 bool HumdrumToken::isNote(void) {
 	if (isKern()) {
-		if (Convert::isKernNote((string)(*this))) {
+		if (getNoteInfo().note) {
 			return true;
 		}
 	} else if (isMens()) {
@@ -1190,7 +1663,7 @@ bool HumdrumToken::isNoteAttack(void) {
 //
 
 bool HumdrumToken::isInvisible(void) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 			return false;
 	}
 	if (isBarline()) {
@@ -1214,12 +1687,12 @@ bool HumdrumToken::isInvisible(void) {
 //
 
 bool HumdrumToken::isGrace(void) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 			return false;
 	}
 	if (!isData()) {
 		return false;
-	} else if (this->find("q") != string::npos) {
+	} else if (getNoteInfo().grace) {
 		return true;
 	}
 
@@ -1234,7 +1707,7 @@ bool HumdrumToken::isGrace(void) {
 //
 
 bool HumdrumToken::isClef(void) {
-	if (!(isDataType("**kern") || isDataType("**mens"))) {
+	if (!(isKern() || isMens())) {
 			return false;
 	}
 	if (!isInterpretation()) {
@@ -1414,8 +1887,8 @@ bool HumdrumToken::isInstrumentAbbreviation(void) {
 //
 
 bool HumdrumToken::hasSlurStart(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurStart((string)(*this))) {
+	if (isKern()) {
+		if (getNoteInfo().slurStart) {
 			return true;
 		}
 	}
@@ -1431,8 +1904,8 @@ bool HumdrumToken::hasSlurStart(void) {
 //
 
 bool HumdrumToken::hasSlurEnd(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurEnd((string)(*this))) {
+	if (isKern()) {
+		if (getNoteInfo().slurEnd) {
 			return true;
 		}
 	}
@@ -1460,7 +1933,8 @@ int HumdrumToken::hasVisibleAccidental(int subtokenIndex) const {
 	if (humfile == NULL) {
 		return -1;
 	}
-	if (!humfile->getValueBool("auto", "accidentalAnalysis")) {
+	static const HumParamKey analysisKey("auto", "accidentalAnalysis");
+	if (!humfile->getValueBool(analysisKey)) {
 		int status = humfile->analyzeKernAccidentals();
 		if (!status) {
 			return -1;
@@ -1490,7 +1964,8 @@ int HumdrumToken::hasCautionaryAccidental(int subtokenIndex) const {
 	if (humfile == NULL) {
 		return -1;
 	}
-	if (!humfile->getValueBool("auto", "accidentalAnalysis")) {
+	static const HumParamKey analysisKey("auto", "accidentalAnalysis");
+	if (!humfile->getValueBool(analysisKey)) {
 		int status = humfile->analyzeKernAccidentals();
 		if (!status) {
 			return -1;
@@ -1613,8 +2088,9 @@ bool HumdrumToken::hasObliquaLigatureEnd(void) {
 //
 
 bool HumdrumToken::isSecondaryTiedNote(void) {
-	if (isDataType("**kern")) {
-		if (Convert::isKernSecondaryTiedNote((string)(*this))) {
+	if (isKern()) {
+		const HumNoteInfo& info = getNoteInfo();
+		if (info.note && (info.tieCont || info.tieEnd)) {
 			return true;
 		}
 	}
@@ -2117,11 +2593,145 @@ void HumdrumToken::setParameters(const string& pdata, HumdrumToken* ptok) {
 
 //////////////////////////////
 //
-// HumdrumToken::setText --
+// HumdrumToken::setText -- Change the text of the token.  If the token
+//    is on a line, then the line is marked as modified so that
+//    HumdrumFileBase::updateLinesFromTokens() only has to regenerate lines
+//    with edited tokens.  The text of the token before its first edit is
+//    kept so that HumdrumFileStructure::analyzeEdits() can decide later
+//    if rhythm or spine re-analysis is needed (see classifyEdit()).
+//    Renaming an exclusive interpretation updates the data-type IDs
+//    stored in the tokens of its track.
 //
 
 void HumdrumToken::setText(const string& text) {
+	if (this->compare(text) == 0) {
+		return;
+	}
+	bool exinterpQ = (this->compare(0, 2, "**") == 0) ||
+			(text.compare(0, 2, "**") == 0);
+	HumdrumLine* line = getOwner();
+	if (line == NULL) {
+		if (exinterpQ) {
+			m_datatype = datatype_unknown;
+		}
+		string::assign(text);
+		return;
+	}
+
+	if (m_edittext == NULL) {
+		m_edittext = new string(*this);
+	}
 	string::assign(text);
+
+	if (exinterpQ) {
+		HumdrumFile* infile = line->getOwner();
+		if (infile) {
+			infile->analyzeDataType(getTrack());
+		}
+	}
+	line->setModified(EDIT_TEXT | EDIT_PENDING);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::classifyEdit -- Compare the text of the token to its
+//    text before it was changed by setText() and return EDIT_RHYTHM or
+//    EDIT_STRUCTURE if the change needs re-analysis of the file, or
+//    EDIT_NONE if only the text changed (see HumdrumLine.h).  The stored
+//    text is then discarded.  Stored token durations are not changed,
+//    since tools may still read the old values until the file is
+//    re-analyzed.
+//
+
+int HumdrumToken::classifyEdit(void) {
+	if (m_edittext == NULL) {
+		return EDIT_NONE;
+	}
+	HumdrumToken oldtoken(*m_edittext);
+	clearEdit();
+	if (oldtoken == *this) {
+		return EDIT_NONE;
+	}
+
+	char oldclass = oldtoken.getEditClass();
+	char newclass = getEditClass();
+	if ((oldclass != newclass) || (oldtoken.isNull() != isNull()) ||
+			oldtoken.isManipulator() || isManipulator()) {
+		return EDIT_STRUCTURE;
+	}
+	if ((newclass == '!') && ((oldtoken.find(':') != string::npos) ||
+			(this->find(':') != string::npos))) {
+		// layout parameters
+		return EDIT_STRUCTURE;
+	}
+	if ((newclass != 'd') || isNull() || !hasRhythm()) {
+		return EDIT_NONE;
+	}
+	if (!(isKern() || isMens())) {
+		// **recip durations are assigned by the owning file.
+		return EDIT_STRUCTURE;
+	}
+	if (getTextDuration(oldtoken) != getTextDuration(*this)) {
+		return EDIT_RHYTHM;
+	}
+	return EDIT_NONE;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::clearEdit -- Forget the text of the token before it
+//    was changed by setText().
+//
+
+void HumdrumToken::clearEdit(void) {
+	if (m_edittext) {
+		delete m_edittext;
+		m_edittext = NULL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTextDuration -- Return the duration of the given text
+//    in the data type of the token, without using the stored duration.
+//
+
+HumNum HumdrumToken::getTextDuration(const string& text) const {
+	if (isMens()) {
+		return Convert::mensToDuration(text);
+	} else if (text.find('q') != string::npos) {
+		return 0;
+	} else {
+		return Convert::recipToDuration(text);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getEditClass -- Returns the type of token used to check
+//    if an edit changes the structure of a line: '*' for interpretations,
+//    '!' for comments, '=' for barlines and 'd' for data tokens.
+//
+
+char HumdrumToken::getEditClass(void) const {
+	if (this->empty()) {
+		return 'd';
+	}
+	switch ((*this)[0]) {
+		case '*':
+		case '!':
+		case '=':
+			return (*this)[0];
+	}
+	return 'd';
 }
 
 
@@ -2189,6 +2799,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 //
 
 bool HumdrumToken::linkedParameterIsGlobal(int index) {
+	checkParameterAnalysis();
 	return m_linkedParameterTokens.at(index)->isCommentGlobal();
 }
 
@@ -2200,6 +2811,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterSetCount(void) {
+	checkParameterAnalysis();
 	return (int)m_linkedParameterTokens.size();
 }
 
@@ -2222,11 +2834,32 @@ HumParamSet* HumdrumToken::getParameterSet(void) {
 //
 
 HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
+	checkParameterAnalysis();
 	return m_linkedParameterTokens.at(index)->getParameterSet();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::checkParameterAnalysis -- Analyze the layout parameters
+//    of the owning file if this has not been done when reading it, so
+//    that the linked parameters of the token are available.
+//
+
+void HumdrumToken::checkParameterAnalysis(void) {
+	HumdrumLine* line = getOwner();
+	if (!line) {
+		return;
+	}
+	HumdrumFile* infile = line->getOwner();
+	if (infile && !infile->areParametersAnalyzed()) {
+		infile->analyzeParameters();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::storeParameterSet -- Store the contents of the token
@@ -2273,6 +2906,26 @@ void HumdrumToken::makeBackwardLink(HumdrumToken& previousToken) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::clearLinkInfo -- Remove spine links and other
+//    analysis state which is generated from the spine structure of the
+//    file.  Used by HumdrumFileBase::analyzeBaseFromTokens() so that the
+//    structure can be analyzed again after tokens have been edited in place.
+//
+
+void HumdrumToken::clearLinkInfo(void) {
+	m_nextTokens.clear();
+	m_previousTokens.clear();
+	m_nextNonNullTokens.clear();
+	m_previousNonNullTokens.clear();
+	m_rhycheck    = 0;
+	m_strand      = -1;
+	m_nullresolve = NULL;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getVisualDuration -- Returns LO:N:vis parameter if it is attached
@@ -2722,10 +3375,21 @@ int HumdrumToken::getState(void) const {
 //
 // HumdrumToken::getStrandIndex -- Returns the 1-D strand index
 //    that the token belongs to in the owning HumdrumFile.
-//    Returns -1 if there is no strand assignment.
+//    Returns -1 if there is no strand assignment.  If the strands of the
+//    owning file have not been analyzed yet, they are analyzed first, so
+//    this const function may change the owning file.
 //
 
 int  HumdrumToken::getStrandIndex(void) const {
+	if (m_strand < 0) {
+		HumdrumLine* hline = getOwner();
+		if (hline) {
+			HumdrumFile* infile = hline->getOwner();
+			if (infile && !infile->areStrandsAnalyzed()) {
+				infile->analyzeStrands();
+			}
+		}
+	}
 	return m_strand;
 }
 
@@ -2740,7 +3404,7 @@ int  HumdrumToken::getStrandIndex(void) const {
 //
 
 int HumdrumToken::getSlurStartElisionLevel(int index) const {
-	if (isDataType("**kern") || isDataType("**mens")) {
+	if (isKern() || isMens()) {
 		return Convert::getKernSlurStartElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -2758,7 +3422,7 @@ int HumdrumToken::getSlurStartElisionLevel(int index) const {
 //
 
 int HumdrumToken::getPhraseStartElisionLevel(int index) const {
-	if (isDataType("**kern") || isDataType("**mens")) {
+	if (isKern() || isMens()) {
 		return Convert::getKernPhraseStartElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -2776,7 +3440,7 @@ int HumdrumToken::getPhraseStartElisionLevel(int index) const {
 //
 
 int HumdrumToken::getSlurEndElisionLevel(int index) const {
-	if (isDataType("**kern") || isDataType("**mens")) {
+	if (isKern() || isMens()) {
 		return Convert::getKernSlurEndElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -2794,7 +3458,7 @@ int HumdrumToken::getSlurEndElisionLevel(int index) const {
 //
 
 int HumdrumToken::getPhraseEndElisionLevel(int index) const {
-	if (isDataType("**kern")) {
+	if (isKern()) {
 		return Convert::getKernPhraseEndElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -3015,7 +3679,7 @@ ostream& HumdrumToken::printXmlBaseInfo(ostream& out, int level,
 	out << "</tokenType>\n";
 
 	// <tokenFunction>
-	if (isDataType("**kern")) {
+	if (isKern()) {
 		if (isNote()) {
 			out << Convert::repeatString(indent, level) << "<tokenFunction>";
 			out << "note" << "</tokenFunction>\n";
@@ -23,14 +23,14 @@ namespace hum {
 
 //////////////////////////////
 //
-// NoteCell::NoteCell -- Constructor.
+// NoteCell::NoteCell -- Constructor.  The pitch information for the
+//     cell is calculated by the owning NoteGrid.
 //
 
 NoteCell::NoteCell(NoteGrid* owner, HTp token) {
 	clear();
 	m_owner = owner;
 	m_token = token;
-	calculateNumericPitches();
 }
 
 
@@ -43,13 +43,6 @@ NoteCell::NoteCell(NoteGrid* owner, HTp token) {
 void NoteCell::clear(void) {
 	m_owner = NULL;
 	m_token = NULL;
-	m_b7  = 0;
-	m_b12 = 0;
-	m_b40 = 0;
-	m_accidental = 0;
-	m_nextAttackIndex = -1;
-	m_prevAttackIndex = -1;
-	m_currAttackIndex = -1;
 	m_timeslice = -1;
 	m_voice = -1;
 }
@@ -58,48 +51,96 @@ void NoteCell::clear(void) {
 
 //////////////////////////////
 //
-// NoteCell::calculateNumericPitches -- Fills in b7, b12, and b40 variables.
-//    0 = rest, negative values for sustained notes.
+// NoteCell::getSgnDiatonicPitch -- Return the diatonic note number
+//    of the cell.  NaN=rest; negative=sustain.
 //
 
-void NoteCell::calculateNumericPitches(void) {
-	if (!m_token) {
-		m_b40        = NAN;
-		m_b12        = NAN;
-		m_b7         = NAN;
-		m_accidental = NAN;
-		return;
+double NoteCell::getSgnDiatonicPitch(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
 	}
+	return m_owner->m_b7[m_voice][m_timeslice];
+}
 
-	bool sustain = m_token->isNull() || m_token->isSecondaryTiedNote();
-	if (m_token->isRest()) {
-		m_b40 = NAN;
-	} else {
-		HTp resolve = m_token->resolveNull();
-		if (resolve->isRest()) {
-			m_b40 = NAN;
-		} else if (resolve->isNull()) {
-			m_b40 = NAN;
-		} else {
-			m_b40 = Convert::kernToBase40(resolve);
-			m_b40 = (sustain ? -m_b40 : m_b40);
-		}
+
+
+//////////////////////////////
+//
+// NoteCell::getSgnMidiPitch -- Return the MIDI note number of the cell.
+//    NaN=rest; negative=sustain.
+//
+
+double NoteCell::getSgnMidiPitch(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
 	}
+	return m_owner->m_b12[m_voice][m_timeslice];
+}
 
-	// convert to base-7 (diatonic pitch numbers)
-	if (m_b40 > 0) {
-		m_b7         = Convert::base40ToDiatonic((int)m_b40);
-		m_b12        = Convert::base40ToMidiNoteNumber((int)m_b40);
-		m_accidental = Convert::base40ToAccidental((int)m_b40);
-	} else if (m_b40 < 0) {
-		m_b7         = -Convert::base40ToDiatonic(-(int)m_b40);
-		m_b12        = -Convert::base40ToMidiNoteNumber(-(int)m_b40);
-		m_accidental = -Convert::base40ToAccidental(-(int)m_b40);
-	} else {
-		m_b7         = NAN;
-		m_b12        = NAN;
-		m_accidental = NAN;
+
+
+//////////////////////////////
+//
+// NoteCell::getSgnBase40Pitch -- Return the base-40 note number of
+//    the cell.  NaN=rest; negative=sustain.
+//
+
+double NoteCell::getSgnBase40Pitch(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & GRID_REST) {
+		return GRIDREST;
+	}
+	return m_owner->m_b40[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getSgnAccidental -- Return the chromatic alteration of
+//    the diatonic pitch of the cell.  NaN=rest; negative=sustain.
+//
+
+double NoteCell::getSgnAccidental(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
 	}
+	return m_owner->m_accidental[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getPrevAttackIndex -- Return the slice index of the
+//    previous note attack.
+//
+
+int NoteCell::getPrevAttackIndex(void) {
+	return m_owner->m_prevattack[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getCurrAttackIndex -- Return the slice index of the current
+//    note attack (useful for finding the start of a sustained note).
+//
+
+int NoteCell::getCurrAttackIndex(void) {
+	return m_owner->m_currattack[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getNextAttackIndex -- Return the slice index of the next
+//    note attack (or rest), -1 for undefined (interpred as rest).
+//
+
+int NoteCell::getNextAttackIndex(void) {
+	return m_owner->m_nextattack[m_voice][m_timeslice];
 }
 
 
@@ -146,17 +187,7 @@ string NoteCell::getAbsKernPitch(void) {
 //
 
 bool NoteCell::isSustained(void) {
-	if (m_b40 < 0) {
-		return true;
-	} else if (m_b40 > 0) {
-		return false;
-	}
-	// calculate if rest is a "sustain" or an "attack"
-	if (m_currAttackIndex == m_timeslice) {
-		return false;
-	} else {
-		return true;
-	}
+	return m_owner->m_state[m_voice][m_timeslice] & GRID_SUSTAIN;
 }
 
 
@@ -275,8 +306,7 @@ double NoteCell::getDiatonicIntervalToNextAttack(void) {
 //
 
 bool NoteCell::isRest(void) {
-	// bug in GCC requires :: prefix to resolve two different isnan() defs.
-	return Convert::isNaN(m_b40);
+	return m_owner->m_state[m_voice][m_timeslice] & GRID_REST;
 }
 
 
@@ -364,12 +394,13 @@ HumNum NoteCell::getMeterBottom(void) {
 //
 
 double NoteCell::getSgnDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	double b7 = getSgnDiatonicPitch();
+	if (Convert::isNaN(b7)) {
 		return GRIDREST;
-	} else if (m_b7 < 0) {
-		return -(double)(((int)-m_b7) % 7);
+	} else if (b7 < 0) {
+		return -(double)(((int)-b7) % 7);
 	} else {
-		return (double)(((int)m_b7) % 7);
+		return (double)(((int)b7) % 7);
 	}
 }
 
@@ -381,10 +412,11 @@ double NoteCell::getSgnDiatonicPitchClass(void) {
 //
 
 double NoteCell::getAbsDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	double b7 = getSgnDiatonicPitch();
+	if (Convert::isNaN(b7)) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b7)) % 7);
+		return (double)(((int)fabs(b7)) % 7);
 	}
 }
 
@@ -396,12 +428,13 @@ double NoteCell::getAbsDiatonicPitchClass(void) {
 //
 
 double NoteCell::getSgnBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	double b40 = getSgnBase40Pitch();
+	if (Convert::isNaN(b40)) {
 		return GRIDREST;
-	} else if (m_b40 < 0) {
-		return -(double)(((int)-m_b40) % 40);
+	} else if (b40 < 0) {
+		return -(double)(((int)-b40) % 40);
 	} else {
-		return (double)(((int)m_b40) % 40);
+		return (double)(((int)b40) % 40);
 	}
 }
 
@@ -413,10 +446,11 @@ double NoteCell::getSgnBase40PitchClass(void) {
 //
 
 double NoteCell::getAbsBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	double b40 = getSgnBase40Pitch();
+	if (Convert::isNaN(b40)) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b40)) % 40);
+		return (double)(((int)fabs(b40)) % 40);
 	}
 }
 
@@ -427,10 +461,7 @@ double NoteCell::getAbsBase40PitchClass(void) {
 //
 
 bool NoteCell::isAttack(void) {
-	if (Convert::isNaN(m_b40)) {
-		return false;
-	}
-	return m_b40>0? true:false;
+	return m_owner->m_state[m_voice][m_timeslice] & GRID_ATTACK;
 }
 
 
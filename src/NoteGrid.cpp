@@ -12,7 +12,7 @@
 //
 
 #include "NoteGrid.h"
-#include "HumRegex.h"
+#include "Convert.h"
 
 using namespace std;
 
@@ -51,19 +51,17 @@ NoteGrid::~NoteGrid() {
 void NoteGrid::clear(void) {
 	m_infile = NULL;
 	m_kernspines.clear();
-
-	vector<vector<NoteCell* > >& grid = m_grid;
-	for (int i=0; i<(int)grid.size(); i++) {
-		for (int j=0; j<(int)grid[i].size(); j++) {
-			if (grid[i][j]) {
-				grid[i][j]->clear();
-				delete grid[i][j];
-				grid[i][j] = NULL;
-			}
-		}
-		grid[i].clear();
-	}
-	grid.clear();
+	m_metriclevels.clear();
+	m_cells.clear();
+	m_b7.clear();
+	m_b12.clear();
+	m_b40.clear();
+	m_accidental.clear();
+	m_state.clear();
+	m_prevattack.clear();
+	m_currattack.clear();
+	m_nextattack.clear();
+	m_lines.clear();
 }
 
 
@@ -74,7 +72,7 @@ void NoteGrid::clear(void) {
 //
 
 int NoteGrid::getVoiceCount(void) {
-	return (int)m_grid.size();
+	return (int)m_cells.size();
 }
 
 
@@ -86,11 +84,7 @@ int NoteGrid::getVoiceCount(void) {
 //
 
 int NoteGrid::getSliceCount(void) {
-	if (m_grid.size() == 0) {
-		return 0;
-	} else {
-		return (int)m_grid[0].size();
-	}
+	return (int)m_lines.size();
 }
 
 
@@ -111,44 +105,41 @@ bool NoteGrid::load(HumdrumFile& infile) {
 	m_kernspines = infile.getKernSpineStartList();
 	vector<HTp>& kernspines = m_kernspines;
 
-	vector<int> metertops(infile.getMaxTrack() + 1, 0);
-	vector<HumNum> meterbots(infile.getMaxTrack() + 1, 0);
-
 	if (kernspines.size() == 0) {
 		cerr << "Warning: no **kern spines in file" << endl;
 		return false;
 	}
 
-	vector<vector<NoteCell* > >& grid = m_grid;
-	grid.resize(kernspines.size());
-	for (int i=0; i<(int)grid.size(); i++) {
-		grid[i].reserve(infile.getLineCount());
+	int datacount = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isData()) {
+			datacount++;
+		}
+	}
+
+	// The cells must not be reallocated after they are created, since
+	// tools store pointers to them:
+	int voicecount = (int)kernspines.size();
+	m_cells.resize(voicecount);
+	m_b7.resize(voicecount);
+	m_b12.resize(voicecount);
+	m_b40.resize(voicecount);
+	m_accidental.resize(voicecount);
+	m_state.resize(voicecount);
+	for (int i=0; i<voicecount; i++) {
+		m_cells[i].reserve(datacount);
+		m_b7[i].reserve(datacount);
+		m_b12[i].reserve(datacount);
+		m_b40[i].reserve(datacount);
+		m_accidental[i].reserve(datacount);
+		m_state[i].reserve(datacount);
 	}
+	m_lines.reserve(datacount);
 
 	int attack = 0;
 	int track, lasttrack;
 	vector<HTp> current;
-	HumRegex hre;
 	for (int i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isInterpretation()) {
-			for (int j=0; j<infile[i].getFieldCount(); j++) {
-				if (!infile[i].token(j)->isKern()) {
-					continue;
-				}
-				track = infile.token(i, j)->getTrack();
-				if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)%(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-					meterbots[track] /= hre.getMatchInt(3);
-				} else if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-				} else {
-					continue;
-				}
-
-			}
-		}
 		if (!infile[i].isData()) {
 			continue;
 		}
@@ -158,7 +149,7 @@ bool NoteGrid::load(HumdrumFile& infile) {
 		for (int j=0; j<infile[i].getFieldCount(); j++) {
 			lasttrack = track;
 			track = infile.token(i, j)->getTrack();
-			if (!infile[i].token(j)->isDataType("**kern")) {
+			if (!infile[i].token(j)->isKern()) {
 				continue;
 			}
 			if (track == lasttrack) {
@@ -176,14 +167,19 @@ bool NoteGrid::load(HumdrumFile& infile) {
 			     << " compared to " << kernspines.size() << endl;
 			return false;
 		}
+		int sindex = (int)m_lines.size();
 		for (int j=0; j<(int)current.size(); j++) {
-			NoteCell* cell = new NoteCell(this, current[j]);
+			m_cells[j].emplace_back(this, current[j]);
+			NoteCell& cell = m_cells[j].back();
 			track = current[j]->getTrack();
-			cell->setVoiceIndex(j);
-			cell->setSliceIndex((int)grid[j].size());
-			cell->setMeter(metertops[track], meterbots[track]);
-			grid[j].push_back(cell);
+			cell.setVoiceIndex(j);
+			cell.setSliceIndex(sindex);
+			// time signatures are parsed in analyzeTimeSignatures():
+			cell.setMeter(infile.getTimeSigTop(i, track),
+					infile.getTimeSigBottom(i, track));
+			appendNumericPitches(j, current[j]);
 		}
+		m_lines.push_back(i);
 	}
 
 	buildAttackIndexes();
@@ -199,7 +195,60 @@ bool NoteGrid::load(HumdrumFile& infile) {
 //
 
 NoteCell* NoteGrid::cell(int voiceindex, int sliceindex) {
-	return m_grid.at(voiceindex).at(sliceindex);
+	return &m_cells.at(voiceindex).at(sliceindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::appendNumericPitches -- Add the diatonic, MIDI and base-40
+//    pitches of a token to the columns of a voice.  The values are
+//    negative for sustained notes.
+//
+
+void NoteGrid::appendNumericPitches(int vindex, HTp token) {
+	int b40 = 0;
+	bool rest = false;
+	bool sustain = token->isNull() || token->isSecondaryTiedNote();
+	if (token->isRest()) {
+		rest = true;
+	} else {
+		HTp resolve = token->resolveNull();
+		if (resolve->isRest()) {
+			rest = true;
+		} else if (resolve->isNull()) {
+			rest = true;
+		} else {
+			b40 = Convert::kernToBase40(resolve);
+			b40 = (sustain ? -b40 : b40);
+		}
+	}
+
+	int b7 = 0;
+	int b12 = 0;
+	int accidental = 0;
+	uint8_t state = 0;
+	if (rest) {
+		state = GRID_REST | GRID_NOPITCH;
+	} else if (b40 > 0) {
+		b7         = Convert::base40ToDiatonic(b40);
+		b12        = Convert::base40ToMidiNoteNumber(b40);
+		accidental = Convert::base40ToAccidental(b40);
+		state      = GRID_ATTACK;
+	} else if (b40 < 0) {
+		b7         = -Convert::base40ToDiatonic(-b40);
+		b12        = -Convert::base40ToMidiNoteNumber(-b40);
+		accidental = -Convert::base40ToAccidental(-b40);
+	} else {
+		state = GRID_NOPITCH;
+	}
+
+	m_b7[vindex].push_back((int16_t)b7);
+	m_b12[vindex].push_back((int16_t)b12);
+	m_b40[vindex].push_back((int16_t)b40);
+	m_accidental[vindex].push_back((int16_t)accidental);
+	m_state[vindex].push_back(state);
 }
 
 
@@ -307,7 +356,11 @@ void NoteGrid::printKernGrid(ostream& output) {
 //
 
 void NoteGrid::buildAttackIndexes(void) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
+	int slicecount = getSliceCount();
+	m_prevattack.assign(m_cells.size(), vector<int>(slicecount, -1));
+	m_currattack.assign(m_cells.size(), vector<int>(slicecount, -1));
+	m_nextattack.assign(m_cells.size(), vector<int>(slicecount, -1));
+	for (int i=0; i<(int)m_cells.size(); i++) {
 		buildAttackIndex(i);
 	}
 }
@@ -321,7 +374,12 @@ void NoteGrid::buildAttackIndexes(void) {
 //
 
 void NoteGrid::buildAttackIndex(int vindex) {
-	vector<NoteCell*>& part = m_grid[vindex];
+	vector<NoteCell>& part  = m_cells[vindex];
+	vector<uint8_t>&  state = m_state[vindex];
+	vector<int16_t>&  b40   = m_b40[vindex];
+	vector<int>&      prev  = m_prevattack[vindex];
+	vector<int>&      curr  = m_currattack[vindex];
+	vector<int>&      next  = m_nextattack[vindex];
 
 	// Set the slice index for the attack of the current note.  This
 	// will be the same as the current slice if the NoteCell is an attack.
@@ -332,44 +390,54 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	NoteCell* currentcell = NULL;
 	for (int i=0; i<(int)part.size(); i++) {
 		if (i == 0) {
-			part[0]->setCurrAttackIndex(0);
+			curr[0] = 0;
 			continue;
 		}
-		if (part[i]->isRest()) {
+		if (state[i] & GRID_REST) {
 			// This is a rest, so check for a rest sustain or start
 			// of a rest sequence.
-			if (part[i-1]->isRest()) {
+			if (state[i-1] & GRID_REST) {
 				// rest "sustain"
-				if (currentcell && !part[i]->getToken()->isNull()) {
-					currentcell->m_tiedtokens.push_back(part[i]->getToken());
+				if (currentcell && !part[i].getToken()->isNull()) {
+					currentcell->m_tiedtokens.push_back(part[i].getToken());
 				}
-				part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
+				curr[i] = curr[i-1];
 			} else {
 				// rest "attack";
-				part[i]->setCurrAttackIndex(i);
+				curr[i] = i;
 			}
-		} else if (part[i]->isAttack()) {
-			part[i]->setCurrAttackIndex(i);
-			currentcell = part[i];
+		} else if (state[i] & GRID_ATTACK) {
+			curr[i] = i;
+			currentcell = &part[i];
 		} else {
 			// This is a sustain, so get the attack index of the
 			// note from the previous slice index.
-			part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			if (currentcell && !part[i]->getToken()->isNull()) {
-				currentcell->m_tiedtokens.push_back(part[i]->getToken());
+			curr[i] = curr[i-1];
+			if (currentcell && !part[i].getToken()->isNull()) {
+				currentcell->m_tiedtokens.push_back(part[i].getToken());
 			}
 		}
 	}
 
+	// Mark sustained notes, and rests which are not the first rest in
+	// a sequence of rests:
+	for (int i=0; i<(int)part.size(); i++) {
+		if ((b40[i] < 0) && !(state[i] & GRID_REST)) {
+			state[i] |= GRID_SUSTAIN;
+		} else if ((b40[i] == 0) && (curr[i] != i)) {
+			state[i] |= GRID_SUSTAIN;
+		}
+	}
+
 	// start with note attacks marked in the previous and next note slots:
 	for (int i=0; i<(int)part.size(); i++) {
-		if (part[i]->isAttack()) {
-			part[i]->setNextAttackIndex(i);
-			part[i]->setPrevAttackIndex(i);
-		} else if (part[i]->isRest()) {
-			if (part[i]->getCurrAttackIndex() == i) {
-				part[i]->setNextAttackIndex(i);
-				part[i]->setPrevAttackIndex(i);
+		if (state[i] & GRID_ATTACK) {
+			next[i] = i;
+			prev[i] = i;
+		} else if (state[i] & GRID_REST) {
+			if (curr[i] == i) {
+				next[i] = i;
+				prev[i] = i;
 			}
 		}
 	}
@@ -378,12 +446,12 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	int value = -1;
 	int temp  = -1;
 	for (int i=(int)part.size()-1; i>=0; i--) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getNextAttackIndex();
-			part[i]->setNextAttackIndex(value);
+		if (!(state[i] & GRID_SUSTAIN)) {
+			temp = next[i];
+			next[i] = value;
 			value = temp;
 		} else {
-			part[i]->setNextAttackIndex(value);
+			next[i] = value;
 		}
 	}
 
@@ -391,13 +459,13 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	value = -1;
 	temp  = -1;
 	for (int i=0; i<(int)part.size(); i++) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getPrevAttackIndex();
-			part[i]->setPrevAttackIndex(value);
+		if (!(state[i] & GRID_SUSTAIN)) {
+			temp = prev[i];
+			prev[i] = value;
 			value = temp;
 		} else {
 			if (i != 0) {
-				part[i]->setPrevAttackIndex(part[i-1]->getPrevAttackIndex());
+				prev[i] = prev[i-1];
 			}
 		}
 	}
@@ -413,7 +481,7 @@ void NoteGrid::buildAttackIndex(int vindex) {
 //
 
 double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsDiatonicPitch();
+	return fabs(getSgnDiatonicPitch(vindex, sindex));
 }
 
 
@@ -425,7 +493,10 @@ double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnDiatonicPitch();
+	if (m_state.at(vindex).at(sindex) & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
+	}
+	return m_b7[vindex][sindex];
 }
 
 
@@ -437,7 +508,7 @@ double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsMidiPitch();
+	return fabs(getSgnMidiPitch(vindex, sindex));
 }
 
 
@@ -449,7 +520,10 @@ double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnMidiPitch();
+	if (m_state.at(vindex).at(sindex) & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
+	}
+	return m_b12[vindex][sindex];
 }
 
 
@@ -461,7 +535,7 @@ double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsBase40Pitch();
+	return fabs(getSgnBase40Pitch(vindex, sindex));
 }
 
 
@@ -473,7 +547,10 @@ double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnBase40Pitch();
+	if (m_state.at(vindex).at(sindex) & GRID_REST) {
+		return GRIDREST;
+	}
+	return m_b40[vindex][sindex];
 }
 
 
@@ -485,7 +562,7 @@ double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsKernPitch();
+	return cell(vindex, sindex)->getAbsKernPitch();
 }
 
 
@@ -497,7 +574,7 @@ string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnKernPitch();
+	return cell(vindex, sindex)->getSgnKernPitch();
 }
 
 
@@ -509,7 +586,138 @@ string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
 //
 
 HTp NoteGrid::getToken(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getToken();
+	return m_cells.at(vindex).at(sindex).getToken();
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::isRest -- Returns true if the given cell is a rest.
+//
+
+bool NoteGrid::isRest(int vindex, int sindex) {
+	return m_state.at(vindex).at(sindex) & GRID_REST;
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::isSustained -- Returns true if the given cell is a sustained
+//     note, or a rest which is not the first in a sequence of rests.
+//
+
+bool NoteGrid::isSustained(int vindex, int sindex) {
+	return m_state.at(vindex).at(sindex) & GRID_SUSTAIN;
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::isAttack -- Returns true if the given cell is a note attack.
+//
+
+bool NoteGrid::isAttack(int vindex, int sindex) {
+	return m_state.at(vindex).at(sindex) & GRID_ATTACK;
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getPrevAttackIndex -- Return the slice index of the previous
+//     note (or rest) attack for the given cell, or -1 if none.
+//
+
+int NoteGrid::getPrevAttackIndex(int vindex, int sindex) {
+	return m_prevattack.at(vindex).at(sindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getCurrAttackIndex -- Return the slice index of the attack
+//     of the note (or first rest) which the given cell belongs to.
+//
+
+int NoteGrid::getCurrAttackIndex(int vindex, int sindex) {
+	return m_currattack.at(vindex).at(sindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getNextAttackIndex -- Return the slice index of the next
+//     note (or rest) attack for the given cell, or -1 if none.
+//
+
+int NoteGrid::getNextAttackIndex(int vindex, int sindex) {
+	return m_nextattack.at(vindex).at(sindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getDiatonicColumn -- Return the diatonic pitches of all
+//     slices in a voice.  Sustained notes are negative, and rests
+//     are 0 (check the state column for rests).
+//
+
+const vector<int16_t>& NoteGrid::getDiatonicColumn(int vindex) {
+	return m_b7.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getMidiColumn -- Return the MIDI pitches of all slices in
+//     a voice.  Sustained notes are negative, and rests are 0.
+//
+
+const vector<int16_t>& NoteGrid::getMidiColumn(int vindex) {
+	return m_b12.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getBase40Column -- Return the base-40 pitches of all slices
+//     in a voice.  Sustained notes are negative, and rests are 0.
+//
+
+const vector<int16_t>& NoteGrid::getBase40Column(int vindex) {
+	return m_b40.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getStateColumn -- Return the notegrid_state bits (attack,
+//     rest, sustain) of all slices in a voice.
+//
+
+const vector<uint8_t>& NoteGrid::getStateColumn(int vindex) {
+	return m_state.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getLineColumn -- Return the line index in the Humdrum file
+//     of each slice.
+//
+
+const vector<int>& NoteGrid::getLineColumn(void) {
+	return m_lines;
 }
 
 
@@ -523,12 +731,11 @@ HTp NoteGrid::getToken(int vindex, int sindex) {
 //
 
 int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getPrevAttackIndex();
+	int index = m_prevattack.at(vindex).at(sindex);
 	if (index < 0) {
 		return 0;
 	} else {
-		return (int)this->cell(vindex, index)->getAbsDiatonicPitch();
+		return (int)getAbsDiatonicPitch(vindex, index);
 	}
 }
 
@@ -543,12 +750,11 @@ int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getNextAttackIndex();
+	int index = m_nextattack.at(vindex).at(sindex);
 	if (index < 0) {
 		return 0;
 	} else {
-		return (int)(this->cell(vindex, index)->getAbsDiatonicPitch());
+		return (int)getAbsDiatonicPitch(vindex, index);
 	}
 }
 
@@ -561,10 +767,10 @@ int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getLineIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_cells.size() == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getLineIndex();
+	return m_lines.at(sindex);
 }
 
 
@@ -576,10 +782,10 @@ int NoteGrid::getLineIndex(int sindex) {
 //
 
 int NoteGrid::getFieldIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_cells.size() == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getFieldIndex();
+	return m_cells[0].at(sindex).getToken()->getFieldIndex();
 }
 
 
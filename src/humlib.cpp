@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Wed Mar 11 22:03:03 PDT 2020
+// Last Modified: Sun Oct 18 14:28:34 UTC 2026
 // Filename:      /include/humlib.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/humlib.cpp
 // Syntax:        C++11
@@ -37,6 +37,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "humlib.h"
 
+// Files given by name are read through a memory map when possible
+// (see HumdrumFileBase::readMappedFile()), and segment indexes check the
+// modification time of archives (see HumSegmentIndex::isCurrent()).
+#if defined(__unix__) || defined(__APPLE__)
+	#include <fcntl.h>       /* open            */
+	#include <sys/mman.h>    /* mmap, munmap    */
+	#include <sys/stat.h>    /* fstat, stat     */
+	#include <unistd.h>      /* close           */
+#endif
+
 namespace hum {
 
 
@@ -11668,6 +11678,73 @@ HumParameter::HumParameter(const string& str) : string(str) {
 
 
 
+//////////////////////////////
+//
+// HumParamKey::HumParamKey -- HumParamKey constructor.  The single-string
+//    version splits the namespaces and key at colons in the same manner
+//    as HumHash::getValue(key).
+//
+
+HumParamKey::HumParamKey(const string& key) {
+	auto loc1 = key.find(':');
+	if (loc1 == string::npos) {
+		m_ns1 = HumHash::internName("");
+		m_ns2 = m_ns1;
+		m_key = HumHash::internName(key);
+		return;
+	}
+	auto loc2 = key.find(':', loc1 + 1);
+	if (loc2 == string::npos) {
+		m_ns1 = HumHash::internName("");
+		m_ns2 = HumHash::internName(key.substr(0, loc1));
+		m_key = HumHash::internName(key.substr(loc1 + 1));
+		return;
+	}
+	auto loc3 = key.find(':', loc2 + 1);
+	m_ns1 = HumHash::internName(key.substr(0, loc1));
+	m_ns2 = HumHash::internName(key.substr(loc1 + 1, loc2 - loc1 - 1));
+	if (loc3 == string::npos) {
+		m_key = HumHash::internName(key.substr(loc2 + 1));
+	} else {
+		m_key = HumHash::internName(key.substr(loc2 + 1, loc3 - loc2 - 1));
+	}
+}
+
+
+HumParamKey::HumParamKey(const string& ns2, const string& key) {
+	m_ns1 = HumHash::internName("");
+	m_ns2 = HumHash::internName(ns2);
+	m_key = HumHash::internName(key);
+}
+
+
+HumParamKey::HumParamKey(const string& ns1, const string& ns2,
+		const string& key) {
+	m_ns1 = HumHash::internName(ns1);
+	m_ns2 = HumHash::internName(ns2);
+	m_key = HumHash::internName(key);
+}
+
+
+
+//////////////////////////////
+//
+// HumParamKey::operator< -- Order parameter keys by the addresses of their
+//     interned strings.
+//
+
+bool HumParamKey::operator<(const HumParamKey& key) const {
+	if (m_ns1 != key.m_ns1) {
+		return std::less<const string*>()(m_ns1, key.m_ns1);
+	}
+	if (m_ns2 != key.m_ns2) {
+		return std::less<const string*>()(m_ns2, key.m_ns2);
+	}
+	return std::less<const string*>()(m_key, key.m_key);
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::HumHash -- HumHash constructor.  The data storage is empty
@@ -11679,6 +11756,37 @@ HumHash::HumHash(void) {
 }
 
 
+HumHash::HumHash(const HumHash& hash) {
+	parameters = NULL;
+	if (hash.parameters) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	}
+	prefix = hash.prefix;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::operator= -- Copy the parameters of another HumHash.
+//
+
+HumHash& HumHash::operator=(const HumHash& hash) {
+	if (this == &hash) {
+		return *this;
+	}
+	if (parameters) {
+		delete parameters;
+		parameters = NULL;
+	}
+	if (hash.parameters) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	}
+	prefix = hash.prefix;
+	return *this;
+}
+
+
 
 //////////////////////////////
 //
@@ -11735,23 +11843,20 @@ string HumHash::getValue(const string& ns2, const string& key) const {
 
 string HumHash::getValue(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return "";
 	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return "";
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return "";
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	return *parameter;
+}
+
+
+string HumHash::getValue(const HumParamKey& key) const {
+	const HumParameter* parameter = findParameter(key);
+	if (parameter == NULL) {
 		return "";
 	}
-	return it3->second;
+	return *parameter;
 }
 
 
@@ -11768,7 +11873,7 @@ HTp HumHash::getValueHTp(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueHTp("", "", keys[2]);
+		return getValueHTp("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueHTp(keys[0], keys[1]);
 	} else {
@@ -11790,7 +11895,19 @@ HTp HumHash::getValueHTp(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return NULL;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return NULL;
+	}
+	return getValueHTp(pkey);
+}
+
+
+HTp HumHash::getValueHTp(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	string value = getValue(key);
 	if (value.find("HT_") != 0) {
 		return NULL;
 	} else {
@@ -11824,7 +11941,7 @@ int HumHash::getValueInt(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueInt("", "", keys[2]);
+		return getValueInt("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueInt(keys[0], keys[1]);
 	} else {
@@ -11846,7 +11963,19 @@ int HumHash::getValueInt(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return 0;
+	}
+	return getValueInt(pkey);
+}
+
+
+int HumHash::getValueInt(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return 0;
+	}
+	string value = getValue(key);
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return  nvalue.getInteger();
@@ -11902,11 +12031,21 @@ HumNum HumHash::getValueFraction(const string& ns2, const string& key) const {
 
 HumNum HumHash::getValueFraction(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (!isDefined(ns1, ns2, key)) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
+		return 0;
+	}
+	HumNum fractionvalue(*parameter);
+	return fractionvalue;
+}
+
+
+HumNum HumHash::getValueFraction(const HumParamKey& key) const {
+	const HumParameter* parameter = findParameter(key);
+	if (parameter == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
-	HumNum fractionvalue(value);
+	HumNum fractionvalue(*parameter);
 	return fractionvalue;
 }
 
@@ -11929,7 +12068,7 @@ double HumHash::getValueFloat(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueFloat("", "", keys[2]);
+		return getValueFloat("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueFloat(keys[0], keys[1]);
 	} else {
@@ -11951,7 +12090,19 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return 0.0;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return 0.0;
+	}
+	return getValueFloat(pkey);
+}
+
+
+double HumHash::getValueFloat(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return 0.0;
+	}
+	string value = getValue(key);
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return nvalue.getFloat();
@@ -11983,7 +12134,7 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 bool HumHash::getValueBool(const string& key) const {
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueBool("", "", keys[2]);
+		return getValueBool("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueBool(keys[0], keys[1]);
 	} else {
@@ -11999,15 +12150,28 @@ bool HumHash::getValueBool(const string& ns2, const string& key) const {
 
 bool HumHash::getValueBool(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return false;
 	}
-	if (!isDefined(ns1, ns2, key)) {
+	if (*parameter == "false") {
+		return false;
+	} else if (*parameter == "0") {
 		return false;
+	} else {
+		return true;
 	}
-	if ((*parameters)[ns1][ns2][key] == "false") {
+}
+
+
+bool HumHash::getValueBool(const HumParamKey& key) const {
+	const HumParameter* parameter = findParameter(key);
+	if (parameter == NULL) {
 		return false;
-	} else if ((*parameters)[ns1][ns2][key] == "0") {
+	}
+	if (*parameter == "false") {
+		return false;
+	} else if (*parameter == "0") {
 		return false;
 	} else {
 		return true;
@@ -12048,8 +12212,19 @@ void HumHash::setValue(const string& ns2, const string& key,
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, const string& value) {
-	initializeParameters();
-	(*parameters)[ns1][ns2][key] = value;
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, const string& value) {
+	HumParameter& parameter = insertParameter(key);
+	parameter.assign(value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, const char* value) {
+	HumParameter& parameter = insertParameter(key);
+	parameter.assign(value);
 }
 
 
@@ -12089,10 +12264,14 @@ void HumHash::setValue(const string& ns2, const string& key, int value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, int value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, int value) {
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -12115,10 +12294,14 @@ void HumHash::setValue(const string& ns2, const string& key, HTp value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HTp value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, HTp value) {
 	stringstream ss;
 	ss << "HT_" << ((long long)value);
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -12141,10 +12324,14 @@ void HumHash::setValue(const string& ns2, const string& key, HumNum value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HumNum value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, HumNum value) {
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -12167,10 +12354,14 @@ void HumHash::setValue(const string& ns2, const string& key, double value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, double value) {
-	initializeParameters();
+	setValue(HumParamKey(ns1, ns2, key), value);
+}
+
+
+void HumHash::setValue(const HumParamKey& key, double value) {
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	insertParameter(key).assign(ss.str());
 }
 
 
@@ -12187,8 +12378,10 @@ map<string, string> HumHash::getParameters(const string& ns1, const string& ns2)
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output[it.first] = it.second;
+	for (auto& entry : *parameters) {
+		if ((entry.name.getNamespace1() == ns1) && (entry.name.getNamespace2() == ns2)) {
+			output[entry.name.getKey()] = entry.value;
+		}
 	}
 	return output;
 }
@@ -12228,8 +12421,10 @@ vector<string> HumHash::getKeys(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output.push_back(it.first);
+	for (auto entry : getSortedEntries()) {
+		if ((entry->name.getNamespace1() == ns1) && (entry->name.getNamespace2() == ns2)) {
+			output.push_back(entry->name.getKey());
+		}
 	}
 	return output;
 }
@@ -12247,9 +12442,9 @@ vector<string> HumHash::getKeys(const string& ns) const {
 		return getKeys(ns1, ns2);
 	}
 
-	for (auto& it1 : (*parameters)[ns]) {
-		for (auto& it2 : it1.second) {
-			output.push_back(it1.first + ":" + it2.first);
+	for (auto entry : getSortedEntries()) {
+		if (entry->name.getNamespace1() == ns) {
+			output.push_back(entry->name.getNamespace2() + ":" + entry->name.getKey());
 		}
 	}
 	return output;
@@ -12261,12 +12456,9 @@ vector<string> HumHash::getKeys(void) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			for (auto it3 : it2.second) {
-				output.push_back(it1.first + ":" + it2.first + ":" + it3.first);
-			}
-		}
+	for (auto entry : getSortedEntries()) {
+		output.push_back(entry->name.getNamespace1() + ":" +
+				entry->name.getNamespace2() + ":" + entry->name.getKey());
 	}
 	return output;
 }
@@ -12284,22 +12476,7 @@ vector<string> HumHash::getKeys(void) const {
 //
 
 bool HumHash::hasParameters(const string& ns1, const string& ns2) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	auto it2 = (*parameters)[ns1].find(ns2);
-	if (it2 == (*parameters)[ns1].end()) {
-		return false;
-	} else {
-		return true;
-	}
+	return getParameterCount(ns1, ns2) > 0;
 }
 
 
@@ -12314,12 +12491,12 @@ bool HumHash::hasParameters(const string& ns) const {
 		return hasParameters(ns1, ns2);
 	}
 
-	auto it = parameters->find(ns);
-	if (it == parameters->end()) {
-		return false;
-	} else {
-		return true;
+	for (auto& entry : *parameters) {
+		if (entry.name.getNamespace1() == ns) {
+			return true;
+		}
 	}
+	return false;
 }
 
 
@@ -12327,19 +12504,7 @@ bool HumHash::hasParameters(void) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	for (auto& it1 : *parameters) {
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			} else {
-				return true;
-			}
-		}
-	}
-	return false;
+	return !parameters->empty();
 }
 
 
@@ -12359,18 +12524,13 @@ int HumHash::getParameterCount(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return 0;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return 0;
+	int sum = 0;
+	for (auto& entry : *parameters) {
+		if ((entry.name.getNamespace1() == ns1) && (entry.name.getNamespace2() == ns2)) {
+			sum++;
+		}
 	}
-	return (int)it2->second.size();
+	return sum;
 }
 
 
@@ -12385,13 +12545,11 @@ int HumHash::getParameterCount(const string& ns) const {
 		return getParameterCount(ns1, ns2);
 	}
 
-	auto it1 = parameters->find(ns);
-	if (it1 == parameters->end()) {
-		return false;
-	}
 	int sum = 0;
-	for (auto& it2 : it1->second) {
-		sum += (int)it2.second.size();
+	for (auto& entry : *parameters) {
+		if (entry.name.getNamespace1() == ns) {
+			sum++;
+		}
 	}
 	return sum;
 }
@@ -12401,16 +12559,7 @@ int HumHash::getParameterCount(void) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	int sum = 0;
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			sum += (int)it2.second.size();
-		}
-	}
-	return sum;
+	return (int)parameters->size();
 }
 
 
@@ -12429,29 +12578,28 @@ bool HumHash::isDefined(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return (*parameters)[""][""].count(keys[0]) ? true : false;
+		return findParameter("", "", keys[0]) ? true : false;
 	} else if (keys.size() == 2) {
-		return (*parameters)[""][keys[0]].count(keys[1]) ? true : false;
+		return findParameter("", keys[0], keys[1]) ? true : false;
 	} else {
-		return (*parameters)[keys[0]][keys[1]].count(keys[2]) ? true : false;
+		return findParameter(keys[0], keys[1], keys[2]) ? true : false;
 	}
 }
 
 
 bool HumHash::isDefined(const string& ns2, const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[""][ns2].count(key) ? true : false;
+	return findParameter("", ns2, key) ? true : false;
 }
 
 
 bool HumHash::isDefined(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[ns1][ns2].count(key) ? true : false;
+	return findParameter(ns1, ns2, key) ? true : false;
+}
+
+
+bool HumHash::isDefined(const HumParamKey& key) const {
+	return findParameter(key) ? true : false;
 }
 
 
@@ -12491,22 +12639,25 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return;
 	}
-	(*parameters)[ns1][ns2].erase(key);
-
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
 		return;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
+	deleteValue(pkey);
+}
+
+
+void HumHash::deleteValue(const HumParamKey& key) {
+	if (parameters == NULL) {
 		return;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
+	auto it = std::lower_bound(parameters->begin(), parameters->end(), key,
+			[](const HumHashEntry& entry, const HumParamKey& k) {
+				return entry.name < k;
+			});
+	if ((it != parameters->end()) && !(key < it->name)) {
+		parameters->erase(it);
 	}
-	it2->second.erase(key);
 }
 
 
@@ -12519,8 +12670,264 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 
 void HumHash::initializeParameters(void) {
 	if (parameters == NULL) {
-		parameters = new MapNNKV;
+		parameters = new vector<HumHashEntry>;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::internName -- Return a pointer to the single stored copy of
+//     a namespace or key string, adding the string to the list of names
+//     if it is not already present.  The returned pointer is valid for the
+//     rest of the program, and two names are equal when their pointers are
+//     equal.  Names already seen by the current thread are found in its
+//     name cache without locking the shared list.
+//
+
+const string* HumHash::internName(const string& name) {
+	HumNameCache& cache = getNameCache();
+	auto it = cache.found.find(name);
+	if (it != cache.found.end()) {
+		return it->second;
+	}
+	const string* output;
+	{
+		std::lock_guard<std::mutex> lock(getNameMutex());
+		auto result = getNameList().insert(name);
+		if (result.second) {
+			getNameCount().fetch_add(1, std::memory_order_release);
+		}
+		output = &(*result.first);
+	}
+	cache.found.emplace(name, output);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findName -- Return a pointer to the interned copy of a name,
+//     or NULL if the name has not been interned, without adding it to the
+//     list of names.  Names which were not found are remembered by the
+//     thread until another name is interned, so repeated queries for
+//     undefined parameters also do not lock the shared list.
+//
+
+const string* HumHash::findName(const string& name) {
+	HumNameCache& cache = getNameCache();
+	auto it = cache.found.find(name);
+	if (it != cache.found.end()) {
+		return it->second;
+	}
+	size_t count = getNameCount().load(std::memory_order_acquire);
+	if (cache.count != count) {
+		cache.missing.clear();
+		cache.count = count;
+	} else if (cache.missing.find(name) != cache.missing.end()) {
+		return NULL;
+	}
+	const string* output = NULL;
+	{
+		std::lock_guard<std::mutex> lock(getNameMutex());
+		std::unordered_set<string>& names = getNameList();
+		auto it2 = names.find(name);
+		if (it2 != names.end()) {
+			output = &(*it2);
+		}
+	}
+	if (output) {
+		cache.found.emplace(name, output);
+	} else {
+		cache.missing.insert(name);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameList -- Return the list of interned names.  The list
+//     is never deleted so that names remain valid while static objects
+//     are being destroyed.
+//
+
+std::unordered_set<string>& HumHash::getNameList(void) {
+	static std::unordered_set<string>* names = new std::unordered_set<string>;
+	return *names;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameMutex -- Return the mutex which protects the list of
+//     interned names.
+//
+
+std::mutex& HumHash::getNameMutex(void) {
+	static std::mutex* namemutex = new std::mutex;
+	return *namemutex;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameCount -- Return the number of interned names.  The
+//     count is used by the thread name caches to notice that a name which
+//     was missing may have been added since.
+//
+
+std::atomic<size_t>& HumHash::getNameCount(void) {
+	static std::atomic<size_t>* namecount = new std::atomic<size_t>(0);
+	return *namecount;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getNameCache -- Return the interned-name cache for the
+//     current thread.
+//
+
+HumNameCache& HumHash::getNameCache(void) {
+	static thread_local HumNameCache cache;
+	return cache;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findParameter -- Return the stored parameter for a given
+//     namespace/key, or NULL if the parameter is not defined.
+//
+
+const HumParameter* HumHash::findParameter(const HumParamKey& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	auto it = std::lower_bound(parameters->begin(), parameters->end(), key,
+			[](const HumHashEntry& entry, const HumParamKey& k) {
+				return entry.name < k;
+			});
+	if ((it == parameters->end()) || (key < it->name)) {
+		return NULL;
+	}
+	return &it->value;
+}
+
+
+const HumParameter* HumHash::findParameter(const string& ns1,
+		const string& ns2, const string& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	HumParamKey pkey;
+	if (!findKey(ns1, ns2, key, pkey)) {
+		return NULL;
+	}
+	return findParameter(pkey);
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findKey -- Fill in a HumParamKey from namespace and key strings
+//     without interning them.  Returns false if any of the names has not
+//     been interned, in which case no parameter can exist for the key.
+//
+
+bool HumHash::findKey(const string& ns1, const string& ns2, const string& key,
+		HumParamKey& output) {
+	output.m_ns1 = findName(ns1);
+	if (output.m_ns1 == NULL) {
+		return false;
+	}
+	output.m_ns2 = findName(ns2);
+	if (output.m_ns2 == NULL) {
+		return false;
+	}
+	output.m_key = findName(key);
+	if (output.m_key == NULL) {
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::insertParameter -- Return the stored parameter for a given
+//     namespace/key, adding an empty parameter if it does not exist.
+//
+
+HumParameter& HumHash::insertParameter(const HumParamKey& key) {
+	initializeParameters();
+	auto it = std::lower_bound(parameters->begin(), parameters->end(), key,
+			[](const HumHashEntry& entry, const HumParamKey& k) {
+				return entry.name < k;
+			});
+	if ((it == parameters->end()) || (key < it->name)) {
+		it = parameters->insert(it, HumHashEntry{key, HumParameter()});
+	}
+	return it->value;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getSortedEntries -- Return the parameters sorted alphabetically
+//     by namespace 1, namespace 2 and then key.  This is the order in which
+//     parameters are printed.
+//
+
+vector<const HumHashEntry*> HumHash::getSortedEntries(void) const {
+	vector<const HumHashEntry*> output;
+	if (parameters == NULL) {
+		return output;
+	}
+	output.reserve(parameters->size());
+	for (auto& entry : *parameters) {
+		output.push_back(&entry);
 	}
+	std::sort(output.begin(), output.end(),
+			[](const HumHashEntry* a, const HumHashEntry* b) {
+				int cmp = a->name.getNamespace1().compare(b->name.getNamespace1());
+				if (cmp != 0) {
+					return cmp < 0;
+				}
+				cmp = a->name.getNamespace2().compare(b->name.getNamespace2());
+				if (cmp != 0) {
+					return cmp < 0;
+				}
+				return a->name.getKey() < b->name.getKey();
+			});
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getEntryTree -- Return the parameters grouped by namespace 1 and
+//     namespace 2, with the groups and keys sorted alphabetically.
+//
+
+HumHashTree HumHash::getEntryTree(void) const {
+	HumHashTree output;
+	for (auto entry : getSortedEntries()) {
+		output[entry->name.getNamespace1()][entry->name.getNamespace2()].push_back(entry);
+	}
+	return output;
 }
 
 
@@ -12532,11 +12939,16 @@ void HumHash::initializeParameters(void) {
 //
 
 vector<string> HumHash::getKeyList(const string& keys) const {
-	stringstream ss(keys);
-	string key;
 	vector<string> output;
-	while (getline(ss, key, ':')) {
-		output.push_back(key);
+	size_t start = 0;
+	while (start < keys.size()) {
+		size_t loc = keys.find(':', start);
+		if (loc == string::npos) {
+			output.push_back(keys.substr(start));
+			break;
+		}
+		output.push_back(keys.substr(start, loc - start));
+		start = loc + 1;
 	}
 	if (output.size() == 0) {
 		output.push_back(keys);
@@ -12616,23 +13028,11 @@ void HumHash::setOrigin(const string& ns2, const string& key,
 
 void HumHash::setOrigin(const string& ns1, const string& ns2,
 		const string& key, HumdrumToken* tok) {
-	if (parameters == NULL) {
-		return;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
+	HumParameter* parameter = (HumParameter*)findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
-	}
-	it3->second.origin = tok;
+	parameter->origin = tok;
 }
 
 
@@ -12676,23 +13076,11 @@ HumdrumToken* HumHash::getOrigin(const string& ns2, const string& key) const {
 
 HumdrumToken* HumHash::getOrigin(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	const HumParameter* parameter = findParameter(ns1, ns2, key);
+	if (parameter == NULL) {
 		return NULL;
 	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return NULL;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return NULL;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return NULL;
-	}
-	return it3->second.origin;
+	return parameter->origin;
 }
 
 
@@ -12711,13 +13099,14 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 	if (parameters->size() == 0) {
 		return out;
 	}
+	HumHashTree tree = getEntryTree();
 
 	stringstream str;
 	bool found = 0;
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : tree) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -12736,10 +13125,10 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 			for (auto& it3 : it2.second) {
 				str << Convert::repeatString(indent, level);
-				str << "<parameter key=\"" << it3.first << "\"";
+				str << "<parameter key=\"" << it3->name.getKey() << "\"";
 				str << " value=\"";
-				str << Convert::encodeXml(it3.second) << "\"";
-				ref = it3.second.origin;
+				str << Convert::encodeXml(it3->value) << "\"";
+				ref = it3->value.origin;
 				if (ref != NULL) {
 					str << " idref=\"";
 					str << ref->getXmlId();
@@ -12777,6 +13166,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 	if (parameters->size() == 0) {
 		return out;
 	}
+	HumHashTree tree = getEntryTree();
 
 	stringstream str;
 	stringstream str2;
@@ -12787,7 +13177,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : tree) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -12820,15 +13210,15 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 			for (auto& it3 : it2.second) {
 				if ((it2.first == "") && (it2.first == "")) {
 
-					if ((it3.first == "global") && (it3.second == "true")) {
+					if ((it3->name.getKey() == "global") && (it3->value == "true")) {
 						// don't do anything because parameter should be removed
 					} else {
 						str2count++;
 						str2 << Convert::repeatString(indent, level);
-						str2 << "<parameter key=\"" << it3.first << "\"";
+						str2 << "<parameter key=\"" << it3->name.getKey() << "\"";
 						str2 << " value=\"";
-						str2 << Convert::encodeXml(it3.second) << "\"";
-						ref = it3.second.origin;
+						str2 << Convert::encodeXml(it3->value) << "\"";
+						ref = it3->value.origin;
 						if (ref != NULL) {
 							str2 << " idref=\"";
 							str2 << ref->getXmlId();
@@ -12838,10 +13228,10 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 					}
 				} else {
 					str << Convert::repeatString(indent, level);
-					str << "<parameter key=\"" << it3.first << "\"";
+					str << "<parameter key=\"" << it3->name.getKey() << "\"";
 					str << " value=\"";
-					str << Convert::encodeXml(it3.second) << "\"";
-					ref = it3.second.origin;
+					str << Convert::encodeXml(it3->value) << "\"";
+					ref = it3->value.origin;
 					if (ref != NULL) {
 						str << " idref=\"";
 						str << ref->getXmlId();
@@ -12890,10 +13280,11 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 	if (hash.parameters->size() == 0) {
 		return out;
 	}
+	HumHashTree tree = hash.getEntryTree();
 
 	string cleaned;
 
-	for (auto& it1 : *(hash.parameters)) {
+	for (auto& it1 : tree) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -12904,9 +13295,9 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 			out << hash.prefix;
 			out << it1.first << ":" << it2.first;
 			for (auto& it3 : it2.second) {
-				out << ":" << it3.first;
-				if (it3.second != "true") {
-					cleaned = it3.second;
+				out << ":" << it3->name.getKey();
+				if (it3->value != "true") {
+					cleaned = it3->value;
 					Convert::replaceOccurrences(cleaned, ":", "&colon;");
 					out << "=" << cleaned;
 				}
@@ -14529,6 +14920,207 @@ ostream& operator<<(ostream& out, HumParamSet& hps) {
 
 
 
+//////////////////////////////
+//
+// HumPoolSlab -- Header at the start of each slab of an arena.  The
+//    reference count is the number of objects in the slab which have not
+//    been deleted, plus one while the arena is allocating from the slab.
+//    Objects can be deleted in a different thread than the one which
+//    created them, so the count is atomic.
+//
+
+class HumPoolSlab {
+	public:
+		std::atomic<int> refcount;
+};
+
+
+// Every object is preceded by a header which stores a pointer to its
+// slab (or NULL if the object was allocated individually):
+static const size_t HUMPOOL_HEADER = alignof(std::max_align_t);
+
+// The arena used for new objects in the current thread (see HumPoolScope):
+static thread_local HumPool* humpool_current = NULL;
+
+
+
+//////////////////////////////
+//
+// HumPool::HumPool -- Constructor.  No memory is allocated until the
+//     first object is created in the arena.
+// default value: slabsize = 65536
+//
+
+HumPool::HumPool(size_t slabsize) {
+	m_slabsize = slabsize < 4096 ? 4096 : slabsize;
+	m_slab = NULL;
+	m_used = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::~HumPool -- Slabs which still have objects in them (such as
+//     tokens moved to another file) are freed when their last object is
+//     deleted.
+//
+
+HumPool::~HumPool() {
+	releaseSlab();
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::allocate -- Return memory for an object of the given size
+//    from the current slab of the arena.  Memory of deleted objects is
+//    not reused until all objects in its slab have been deleted.
+//
+
+void* HumPool::allocate(size_t size) {
+	size_t align = HUMPOOL_HEADER;
+	size_t total = HUMPOOL_HEADER + ((size + align - 1) / align) * align;
+	if (total > m_slabsize / 4) {
+		char* block = (char*)::operator new(HUMPOOL_HEADER + size);
+		*((HumPoolSlab**)block) = NULL;
+		return block + HUMPOOL_HEADER;
+	}
+	if ((m_slab == NULL) || (m_used + total > m_slabsize)) {
+		addSlab();
+	}
+	char* block = (char*)m_slab + m_used;
+	m_used += total;
+	m_slab->refcount.fetch_add(1, std::memory_order_relaxed);
+	*((HumPoolSlab**)block) = m_slab;
+	return block + HUMPOOL_HEADER;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::clear -- Called when the file which owns the arena has deleted
+//    its lines and tokens.  If no objects are left in the current slab,
+//    then it is kept for the next file read into the arena; otherwise,
+//    it will be freed when its last object is deleted.
+//
+
+void HumPool::clear(void) {
+	if (m_slab == NULL) {
+		return;
+	}
+	if (m_slab->refcount.load(std::memory_order_acquire) == 1) {
+		// Only the arena refers to the slab, so it can be reused.
+		m_used = HUMPOOL_HEADER;
+	} else {
+		releaseSlab();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::allocateObject -- Allocate memory for a HumdrumLine or
+//    HumdrumToken from the arena of the current HumPoolScope, or
+//    individually if there is no scope.
+//
+
+void* HumPool::allocateObject(size_t size) {
+	if (humpool_current) {
+		return humpool_current->allocate(size);
+	}
+	char* block = (char*)::operator new(HUMPOOL_HEADER + size);
+	*((HumPoolSlab**)block) = NULL;
+	return block + HUMPOOL_HEADER;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::releaseObject -- Free the memory of an object allocated with
+//    allocate() or allocateObject().  A slab is returned to the system
+//    when its last object is deleted.
+//
+
+void HumPool::releaseObject(void* ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	char* block = (char*)ptr - HUMPOOL_HEADER;
+	HumPoolSlab* slab = *((HumPoolSlab**)block);
+	if (slab == NULL) {
+		::operator delete(block);
+	} else if (slab->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		slab->~HumPoolSlab();
+		::operator delete(slab);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::addSlab -- Start allocating from a new slab.
+//
+
+void HumPool::addSlab(void) {
+	releaseSlab();
+	void* memory = ::operator new(m_slabsize);
+	m_slab = new (memory) HumPoolSlab;
+	m_slab->refcount.store(1, std::memory_order_relaxed);
+	m_used = HUMPOOL_HEADER;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::releaseSlab -- Stop allocating from the current slab.
+//
+
+void HumPool::releaseSlab(void) {
+	if (m_slab == NULL) {
+		return;
+	}
+	if (m_slab->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		m_slab->~HumPoolSlab();
+		::operator delete(m_slab);
+	}
+	m_slab = NULL;
+	m_used = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumPoolScope::HumPoolScope -- Use the arena for new lines and tokens
+//    in the current thread.
+//
+
+HumPoolScope::HumPoolScope(HumPool& pool) {
+	m_previous = humpool_current;
+	humpool_current = &pool;
+}
+
+
+
+//////////////////////////////
+//
+// HumPoolScope::~HumPoolScope -- Go back to the previous arena.
+//
+
+HumPoolScope::~HumPoolScope() {
+	humpool_current = m_previous;
+}
+
+
+
+
 //////////////////////////////
 //
 // HumRegex::HumRegex -- Constructor.
@@ -14539,6 +15131,9 @@ HumRegex::HumRegex(void) {
 	m_regexflags  = std::regex_constants::ECMAScript;
 
 	m_searchflags = std::regex_constants::format_first_only;
+
+	m_patternflags  = m_regexflags;
+	m_compiledflags = m_searchflags;
 }
 
 
@@ -14550,9 +15145,12 @@ HumRegex::HumRegex(const string& exp, const string& options) {
 		// explicitly set the default syntax
 		m_regexflags = std::regex_constants::ECMAScript;
 	}
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	m_patternflags = m_regexflags;
 	m_searchflags = (std::regex_constants::match_flag_type)0;
 	m_searchflags = getTemporarySearchFlags(options);
+	setRegex(exp, getTemporaryRegexFlags(options));
+	m_compiled = m_regex;
+	m_compiledflags = m_searchflags;
 }
 
 
@@ -14567,6 +15165,184 @@ HumRegex::~HumRegex() {
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// compiled regular expressions
+//
+
+//////////////////////////////
+//
+// HumRegex::RegexCache -- Compiled regular expressions shared by all
+//    HumRegex objects.  The oldest entry is removed when the cache is full.
+//
+
+struct HumRegex::RegexCache {
+	std::mutex mutex;
+	std::unordered_map<string, std::shared_ptr<const std::regex>> entries;
+	std::list<string> order;  // keys in order of insertion
+	int size = 256;
+};
+
+
+
+//////////////////////////////
+//
+// HumRegex::getRegexCache -- Return the compiled regular expression
+//    cache.  The cache is never deleted so that it may be used while
+//    static objects are being destroyed.
+//
+
+HumRegex::RegexCache& HumRegex::getRegexCache(void) {
+	static RegexCache* cache = new RegexCache;
+	return *cache;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCachedRegex -- Return a compiled regular expression for
+//    the given expression and syntax flags, compiling it only if it is
+//    not already in the cache.  Invalid expressions throw std::regex_error
+//    as when constructing a std::regex.
+//
+
+std::shared_ptr<const std::regex> HumRegex::getCachedRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	RegexCache& cache = getRegexCache();
+	string key = to_string((int)flags);
+	key += ':';
+	key += exp;
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		auto it = cache.entries.find(key);
+		if (it != cache.entries.end()) {
+			return it->second;
+		}
+	}
+
+	// compile outside of the lock so that other threads are not blocked:
+	std::shared_ptr<const std::regex> output = std::make_shared<const std::regex>(exp, flags);
+
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	if (cache.size <= 0) {
+		return output;
+	}
+	auto status = cache.entries.emplace(key, output);
+	if (!status.second) {
+		// another thread compiled the same expression
+		return status.first->second;
+	}
+	cache.order.push_back(key);
+	while ((int)cache.entries.size() > cache.size) {
+		cache.entries.erase(cache.order.front());
+		cache.order.pop_front();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::setCacheSize -- Set the maximum number of compiled regular
+//    expressions to store in the cache.  A size of 0 disables the cache.
+//    The default size is 256.
+//
+
+void HumRegex::setCacheSize(int size) {
+	RegexCache& cache = getRegexCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.size = size < 0 ? 0 : size;
+	while ((int)cache.entries.size() > cache.size) {
+		cache.entries.erase(cache.order.front());
+		cache.order.pop_front();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCacheSize -- Return the maximum number of compiled regular
+//    expressions to store in the cache.
+//
+
+int HumRegex::getCacheSize(void) {
+	RegexCache& cache = getRegexCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	return cache.size;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::clearCache -- Remove all compiled regular expressions from the
+//    cache.  Expressions still in use by HumRegex objects are not affected.
+//
+
+void HumRegex::clearCache(void) {
+	RegexCache& cache = getRegexCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.entries.clear();
+	cache.order.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::setRegex -- Set the regular expression to use for searching,
+//    matching or replacing.  Nothing is done if the expression is the
+//    same as the last one used by the object.
+//
+
+void HumRegex::setRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_regex && (flags == m_patternflags) && (exp == m_pattern)) {
+		return;
+	}
+	m_regex = getCachedRegex(exp, flags);
+	m_pattern = exp;
+	m_patternflags = flags;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::compile -- Compile a regular expression to use with the
+//     search/match/replace functions which do not take an expression
+//     parameter.  Options are the same as the temporary options for
+//     the other functions (such as "i" for ignoring case and "g" for
+//     global replacements).  Returns false if the expression is invalid.
+//
+// default value: options = ""
+//
+//     Example:
+//        HumRegex hre;
+//        hre.compile("^=(\\d+)");
+//        for (int i=0; i<infile.getLineCount(); i++) {
+//           if (hre.search(infile[i])) { ... }
+//        }
+//
+
+bool HumRegex::compile(const string& exp, const string& options) {
+	try {
+		setRegex(exp, getTemporaryRegexFlags(options));
+	} catch (std::regex_error& e) {
+		cerr << "Error: invalid regular expression " << exp << ": " << e.what() << endl;
+		m_compiled.reset();
+		return false;
+	}
+	m_compiled = m_regex;
+	m_compiledflags = getTemporarySearchFlags(options);
+	return true;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // option setting
@@ -14657,8 +15433,8 @@ void HumRegex::unsetGlobal(void) {
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	bool result = regex_search(input, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -14672,10 +15448,10 @@ int HumRegex::search(const string& input, const string& exp) {
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
+	bool result = regex_search(startit, endit, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -14701,8 +15477,8 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	bool result = regex_search(input, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -14715,10 +15491,10 @@ int HumRegex::search(const string& input, const string& exp,
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
+	bool result = regex_search(startit, endit, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -14740,6 +15516,51 @@ int HumRegex::search(string* input, int startindex, const string& exp,
 	return HumRegex::search(*input, startindex, exp, options);
 }
 
+//
+// This version of HumRegex uses the expression given to compile().
+//
+
+int HumRegex::search(const string& input) {
+	if (!m_compiled) {
+		return 0;
+	}
+	bool result = regex_search(input, m_matches, *m_compiled, m_compiledflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+int HumRegex::search(const string& input, int startindex) {
+	if (!m_compiled) {
+		return 0;
+	}
+	auto startit = input.begin() + startindex;
+	auto endit   = input.end();
+	bool result = regex_search(startit, endit, m_matches, *m_compiled, m_compiledflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+int HumRegex::search(string* input) {
+	return HumRegex::search(*input);
+}
+
+
+int HumRegex::search(string* input, int startindex) {
+	return HumRegex::search(*input, startindex);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////
 //
@@ -14887,15 +15708,15 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	return regex_match(input, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	return regex_match(input, *m_regex, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	return regex_match(input, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	return regex_match(input, *m_regex, getTemporarySearchFlags(options));
 }
 
 
@@ -14910,6 +15731,22 @@ bool HumRegex::match(const string* input, const string& exp,
 	return HumRegex::match(*input, exp, options);
 }
 
+//
+// This version of HumRegex uses the expression given to compile().
+//
+
+bool HumRegex::match(const string& input) {
+	if (!m_compiled) {
+		return false;
+	}
+	return regex_match(input, *m_compiled, m_compiledflags);
+}
+
+
+bool HumRegex::match(const string* input) {
+	return HumRegex::match(*input);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -14926,8 +15763,8 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	input = regex_replace(input, m_regex, replacement, m_searchflags);
+	setRegex(exp, m_regexflags);
+	input = regex_replace(input, *m_regex, replacement, m_searchflags);
 	return input;
 }
 
@@ -14943,8 +15780,8 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	input = regex_replace(input, *m_regex, replacement, getTemporarySearchFlags(options));
 	return input;
 }
 
@@ -14954,6 +15791,18 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 	return HumRegex::replaceDestructive(*input, replacement, exp, options);
 }
 
+//
+// This version uses the expression given to compile().
+//
+
+string& HumRegex::replaceDestructive(string& input, const string& replacement) {
+	if (!m_compiled) {
+		return input;
+	}
+	input = regex_replace(input, *m_compiled, replacement, m_compiledflags);
+	return input;
+}
+
 
 
 //////////////////////////////
@@ -14964,10 +15813,10 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement);
+			input.end(), *m_regex, replacement);
 	return output;
 }
 
@@ -14983,10 +15832,10 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
+			input.end(), *m_regex, replacement, getTemporarySearchFlags(options));
 	return output;
 }
 
@@ -14996,6 +15845,20 @@ string HumRegex::replaceCopy(string* input, const string& exp,
 	return HumRegex::replaceCopy(*input, replacement, exp, options);
 }
 
+//
+// This version uses the expression given to compile().
+//
+
+string HumRegex::replaceCopy(const string& input, const string& replacement) {
+	if (!m_compiled) {
+		return input;
+	}
+	string output;
+	regex_replace(std::back_inserter(output), input.begin(),
+			input.end(), *m_compiled, replacement, m_compiledflags);
+	return output;
+}
+
 
 
 //////////////////////////////
@@ -15116,6 +15979,520 @@ std::regex_constants::match_flag_type HumRegex::getTemporarySearchFlags(
 
 
 
+//////////////////////////////
+//
+// HumSegmentIndex::HumSegmentIndex -- Constructor.  If an archive
+//    filename is given, then build the index for it.
+//
+
+HumSegmentIndex::HumSegmentIndex(void) {
+	// do nothing
+}
+
+
+HumSegmentIndex::HumSegmentIndex(const string& archive) {
+	build(archive);
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::~HumSegmentIndex -- Deconstructor.
+//
+
+HumSegmentIndex::~HumSegmentIndex() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::clear -- Remove all segments from the index.
+//
+
+void HumSegmentIndex::clear(void) {
+	m_archive.clear();
+	m_archivesize = 0;
+	m_archivetime = 0;
+	m_universals.clear();
+	m_segments.clear();
+	m_names.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::build -- Scan an archive of concatenated Humdrum
+//    files for !!!!SEGMENT: lines and store their byte ranges.  Each
+//    segment starts at a !!!!SEGMENT: line and ends before the next one
+//    (or at the end of the archive).  The universal comments which
+//    HumdrumFileStream applies to each segment when reading the archive
+//    sequentially are also stored, so that a segment can be read without
+//    reading anything before it.  Data before the first !!!!SEGMENT: line
+//    is not indexed.  Returns false if the archive cannot be read.
+//
+
+bool HumSegmentIndex::build(const string& archive) {
+	clear();
+	m_archive = archive;
+	m_archivetime = getFileTime(archive);
+	ifstream input(archive.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+
+	// The universal comments in effect are tracked in the same way as in
+	// HumdrumFileStream::getFileLines(): universal comments before any
+	// other content of a file (which starts at a !!!!SEGMENT: line after
+	// data, or at a second ** line) replace the previous ones.
+	vector<string> universals;  // universal comments currently in effect
+	int current = -1;           // index of universals in m_universals
+	bool dataQ = false;         // content other than universals found
+	bool foundQ = false;        // universal comment found in current file
+	bool starstarQ = false;     // exclusive interpretation found
+	bool starminusQ = false;    // spine terminator found
+
+	int64_t offset = 0;
+	string line;
+	while (getline(input, line)) {
+		int64_t lineoffset = offset;
+		offset += line.size();
+		if (!input.eof()) {
+			// add the newline which is removed by getline():
+			offset++;
+		}
+
+		if (line.compare(0, 11, "!!!!SEGMENT") == 0) {
+			if ((current < 0) && !universals.empty()) {
+				m_universals.push_back(universals);
+				current = (int)m_universals.size() - 1;
+			}
+			addSegment(line, lineoffset, current);
+			if (dataQ) {
+				// start of a new file
+				foundQ = false;
+				starstarQ = false;
+				starminusQ = false;
+				continue;
+			}
+		}
+
+		if (line.compare(0, 2, "**") == 0) {
+			if (starstarQ) {
+				// start of a new file (without a !!!!SEGMENT: line)
+				dataQ = false;
+				foundQ = false;
+				starminusQ = false;
+				continue;
+			}
+			starstarQ = true;
+		}
+
+		if ((line.size() > 4) && (line.compare(0, 4, "!!!!") == 0) &&
+				(line[4] != '!') && !dataQ &&
+				(line.compare(0, 11, "!!!!filter:") != 0) &&
+				(line.compare(0, 12, "!!!!SEGMENT:") != 0)) {
+			if (!foundQ) {
+				universals.clear();
+				foundQ = true;
+			}
+			universals.push_back(line);
+			current = -1;
+			continue;
+		}
+
+		if (line.compare(0, 2, "*-") == 0) {
+			starminusQ = true;
+		}
+		if ((starminusQ || !starstarQ) && !line.empty() &&
+				(line[0] != '*') && (line[0] != '!') && (line[0] != ' ')) {
+			// treated as a filename by HumdrumFileStream
+			continue;
+		}
+		dataQ = true;
+	}
+	m_archivesize = offset;
+
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		if (i < (int)m_segments.size() - 1) {
+			m_segments[i].size = m_segments[i+1].offset - m_segments[i].offset;
+		} else {
+			m_segments[i].size = m_archivesize - m_segments[i].offset;
+		}
+	}
+	buildNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::addSegment -- Store a segment starting at the given
+//    !!!!SEGMENT: line.  The size is calculated later in build().
+//
+
+void HumSegmentIndex::addSegment(const string& line, int64_t offset,
+		int universals) {
+	Segment segment;
+	segment.level = 0;
+	segment.offset = offset;
+	segment.size = 0;
+	segment.universals = universals;
+	HumRegex hre;
+	if (hre.search(line, R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*)\s*$)")) {
+		if (hre.getMatchLength(1) > 0) {
+			segment.level = atoi(hre.getMatch(1).c_str());
+		}
+		segment.name = hre.getMatch(2);
+	}
+	m_segments.push_back(segment);
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::buildNameIndex -- Create the lookup table for
+//    segment names.
+//
+
+void HumSegmentIndex::buildNameIndex(void) {
+	m_names.clear();
+	m_names.reserve(m_segments.size());
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		// emplace does not replace earlier segments with the same name:
+		m_names.emplace(m_segments[i].name, i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::write -- Save the index to a sidecar file or to
+//    an output stream.
+//
+
+bool HumSegmentIndex::write(const string& indexfile) const {
+	std::ofstream output(indexfile.c_str(), std::ios::out | std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	write(output);
+	output.close();
+	return !output.fail();
+}
+
+
+ostream& HumSegmentIndex::write(ostream& out) const {
+	out << "HumSegmentIndex\t1\n";
+	out << "archive\t" << m_archive << "\n";
+	out << "size\t" << m_archivesize << "\n";
+	out << "mtime\t" << m_archivetime << "\n";
+	for (int i=0; i<(int)m_universals.size(); i++) {
+		for (int j=0; j<(int)m_universals[i].size(); j++) {
+			out << "universal\t" << i << '\t' << m_universals[i][j] << '\n';
+		}
+	}
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		const Segment& segment = m_segments[i];
+		out << segment.offset << '\t' << segment.size << '\t'
+		    << segment.level << '\t' << segment.universals << '\t'
+		    << segment.name << '\n';
+	}
+	return out;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::read -- Load an index from a sidecar file or from an
+//    input stream.  Returns false if the input is not a segment index.
+//
+
+bool HumSegmentIndex::read(const string& indexfile) {
+	ifstream input(indexfile.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	return read(input);
+}
+
+
+bool HumSegmentIndex::read(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line.compare(0, 16, "HumSegmentIndex\t") != 0)) {
+		return false;
+	}
+	while (getline(input, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		if (line.compare(0, 8, "archive\t") == 0) {
+			m_archive = line.substr(8);
+			continue;
+		}
+		if (line.compare(0, 5, "size\t") == 0) {
+			m_archivesize = strtoll(line.c_str() + 5, NULL, 10);
+			continue;
+		}
+		if (line.compare(0, 6, "mtime\t") == 0) {
+			m_archivetime = strtoll(line.c_str() + 6, NULL, 10);
+			continue;
+		}
+		const char* ptr = line.c_str();
+		char* end;
+		if (line.compare(0, 10, "universal\t") == 0) {
+			// universal comment entry: set number, comment
+			long set = strtol(ptr + 10, &end, 10);
+			if ((*end != '\t') || (set < 0) || (set > (long)m_universals.size())) {
+				clear();
+				return false;
+			}
+			if (set == (long)m_universals.size()) {
+				m_universals.resize(set + 1);
+			}
+			m_universals[set].push_back(end + 1);
+			continue;
+		}
+		// segment entry: offset, size, level, set number, name
+		Segment segment;
+		segment.offset = strtoll(ptr, &end, 10);
+		if (*end != '\t') {
+			clear();
+			return false;
+		}
+		segment.size = strtoll(end + 1, &end, 10);
+		if (*end != '\t') {
+			clear();
+			return false;
+		}
+		segment.level = (int)strtol(end + 1, &end, 10);
+		if (*end != '\t') {
+			clear();
+			return false;
+		}
+		segment.universals = (int)strtol(end + 1, &end, 10);
+		if ((*end != '\t') || (segment.universals < -1) ||
+				(segment.universals >= (int)m_universals.size())) {
+			clear();
+			return false;
+		}
+		segment.name = end + 1;
+		m_segments.push_back(segment);
+	}
+	buildNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::isCurrent -- Returns true if the archive has the same
+//    size and modification time as when it was indexed.  If not, the index
+//    should be rebuilt.
+//
+
+bool HumSegmentIndex::isCurrent(void) const {
+	ifstream input(m_archive.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	if ((int64_t)input.tellg() != m_archivesize) {
+		return false;
+	}
+	return getFileTime(m_archive) == m_archivetime;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getFileTime -- Return the modification time of a file
+//    in seconds, or 0 if it is not available.
+//
+
+int64_t HumSegmentIndex::getFileTime(const string& filename) {
+	#if defined(__unix__) || defined(__APPLE__)
+		struct stat info;
+		if (stat(filename.c_str(), &info) == 0) {
+			return (int64_t)info.st_mtime;
+		}
+	#endif
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getArchive -- Return the filename of the indexed
+//    archive.
+//
+
+const string& HumSegmentIndex::getArchive(void) const {
+	return m_archive;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::setArchive -- Change the filename of the archive,
+//    such as when the archive and its index have been moved after
+//    the index was saved.
+//
+
+void HumSegmentIndex::setArchive(const string& archive) {
+	m_archive = archive;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getArchiveSize -- Return the size of the archive in
+//    bytes when it was indexed.
+//
+
+int64_t HumSegmentIndex::getArchiveSize(void) const {
+	return m_archivesize;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentCount -- Return the number of segments in
+//    the archive.
+//
+
+int HumSegmentIndex::getSegmentCount(void) const {
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentIndex -- Return the index of the segment
+//    with the given name, or -1 if there is no segment with that name.
+//
+
+int HumSegmentIndex::getSegmentIndex(const string& name) const {
+	auto it = m_names.find(name);
+	if (it == m_names.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentName -- Return the name of a segment (the
+//    text after the colon in the !!!!SEGMENT: line).
+//
+
+const string& HumSegmentIndex::getSegmentName(int index) const {
+	static string empty;
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return empty;
+	}
+	return m_segments[index].name;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentLevel -- Return the level of a segment.
+//
+
+int HumSegmentIndex::getSegmentLevel(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return 0;
+	}
+	return m_segments[index].level;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentOffset -- Return the byte offset of
+//    the !!!!SEGMENT: line of a segment in the archive.
+//
+
+int64_t HumSegmentIndex::getSegmentOffset(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return -1;
+	}
+	return m_segments[index].offset;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentSize -- Return the number of bytes in
+//    a segment.
+//
+
+int64_t HumSegmentIndex::getSegmentSize(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return 0;
+	}
+	return m_segments[index].size;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegmentUniversals -- Return the universal comments
+//    which are applied to a segment when the archive is read with
+//    HumdrumFileStream.
+//
+
+const vector<string>& HumSegmentIndex::getSegmentUniversals(int index) const {
+	static vector<string> empty;
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return empty;
+	}
+	int set = m_segments[index].universals;
+	if (set < 0) {
+		return empty;
+	}
+	return m_universals[set];
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSidecarName -- Return the default filename for
+//    saving the index of an archive.
+//
+
+string HumSegmentIndex::getSidecarName(const string& archive) {
+	return archive + ".segidx";
+}
+
+
+
+
+
 //////////////////////////////
 //
 // HumSignifier::HumSignifier --
@@ -15444,7 +16821,7 @@ HumSignifier* HumSignifiers::getSignifier(int index) {
 //
 
 HumTool::HumTool(void) {
-	// do nothing
+	define("prefetch=i:0", "number of input files to read ahead in background");
 }
 
 
@@ -15693,6 +17070,7 @@ void HumTool::clearOutput(void) {
 	m_free_text.str("");
   	m_warning_text.str("");
   	m_error_text.str("");
+	m_modified_structure = false;
 }
 
 
@@ -15708,6 +17086,47 @@ void HumTool::setError(const string& message) {
 
 
 
+//////////////////////////////
+//
+// HumTool::setModifiedStructure -- Indicate that the tool has edited
+//    the input file in place in a way which invalidates its spine or rhythm
+//    analysis (such as adding a data spine or appending lines).  Tools which
+//    only change the text of existing tokens do not need to call this
+//    function.
+//
+
+void HumTool::setModifiedStructure(void) {
+	m_modified_structure = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::hasModifiedStructure -- Returns true if the structure of the
+//    input file was changed by the tool, and the file needs to be
+//    re-analyzed before further processing.
+//
+
+bool HumTool::hasModifiedStructure(void) {
+	return m_modified_structure;
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::getAnalysisLevel -- Returns the analyses of the input file
+//    which the tool needs (see the ANALYZE_* defines in HumdrumFileBase.h).
+//    Default value: ANALYZE_ALL.
+//
+
+int HumTool::getAnalysisLevel(void) {
+	return m_analysis_level;
+}
+
+
+
 
 
 //////////////////////////////
@@ -16324,7 +17743,9 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysis_level = infile.m_analysis_level;
 
+	HumPoolScope scope(m_pool);
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
 		m_lines[i] = new HumdrumLine(infile.m_lines[i]->getText());
@@ -16360,7 +17781,9 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysis_level = infile.m_analysis_level;
 
+	HumPoolScope scope(m_pool);
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
 		m_lines[i] = new HumdrumLine(infile.m_lines[i]->getText());
@@ -16398,6 +17821,8 @@ void HumdrumFileBase::clear(void) {
 		}
 	}
 	m_lines.clear();
+	// return the memory of the deleted lines and tokens to the system:
+	m_pool.clear();
 
 	// clear state variables which are now invalid:
 	m_trackstarts.clear();
@@ -16411,8 +17836,12 @@ void HumdrumFileBase::clear(void) {
 	m_segmentlevel = 0;
 	m_structure_analyzed = false;
 	m_rhythm_analyzed = false;
+	m_strands_analyzed = false;
+	m_parameters_analyzed = false;
 	m_slurs_analyzed = false;
+	m_phrases_analyzed = false;
 	m_nulls_analyzed = false;
+	m_timesigs_analyzed = false;
 }
 
 
@@ -16450,6 +17879,42 @@ bool HumdrumFileBase::areStrandsAnalyzed(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::areParametersAnalyzed --
+//
+
+bool HumdrumFileBase::areParametersAnalyzed(void) {
+	return m_parameters_analyzed;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::setAnalysisLevel -- Select which analyses are done
+//    when reading a file (see the ANALYZE_* defines in HumdrumFileBase.h).
+//    The level is kept when the file is cleared or read again.
+//
+
+void HumdrumFileBase::setAnalysisLevel(int level) {
+	m_analysis_level = level;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getAnalysisLevel -- Return the analyses which are
+//    done when reading a file.  Default value: ANALYZE_ALL.
+//
+
+int HumdrumFileBase::getAnalysisLevel(void) const {
+	return m_analysis_level;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::setXmlIdPrefix -- Set the prefix for a HumdrumXML ID
@@ -16519,7 +17984,7 @@ bool HumdrumFileBase::setParseError(const char* format, ...) {
 	char buffer[1024] = {0};
 	va_list ap;
 	va_start(ap, format);
-	snprintf(buffer, 1024, format, ap);
+	vsnprintf(buffer, 1024, format, ap);
 	va_end(ap);
 	m_parseError = buffer;
 	return !m_parseError.size();
@@ -16561,40 +18026,140 @@ bool HumdrumFileBase::read(const char* filename) {
 	}
 #endif
 
-	ifstream infile;
 	if (fname.empty() || (fname ==  "-")) {
 		return HumdrumFileBase::read(cin);
-	} else {
-		infile.open(filename);
-		if (!infile.is_open()) {
-			return setParseError("Cannot open file >>%s<< for reading. A", filename);
-		}
 	}
-	HumdrumFileBase::read(infile);
-	infile.close();
+	readMappedFile(filename);
 	return isValid();
 }
 
 
 bool HumdrumFileBase::read(istream& contents) {
+	stringstream buffer;
+	buffer << contents.rdbuf();
+	string data = buffer.str();
+	return readBuffer(data.data(), data.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readMappedFile -- Read a file by mapping it into memory,
+//     so that lines are copied only once from the operating system's file
+//     cache.  On systems without mmap(), such as Windows, the file contents
+//     are read into a single string instead.
+//
+
+bool HumdrumFileBase::readMappedFile(const char* filename) {
+#if defined(__unix__) || defined(__APPLE__)
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)) {
+		// not a regular file (such as a pipe), so read it as a stream:
+		::close(fd);
+		ifstream infile(filename);
+		return HumdrumFileBase::read(infile);
+	}
+	size_t size = (size_t)info.st_size;
+	if (size == 0) {
+		::close(fd);
+		return readBuffer("", 0);
+	}
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		ifstream infile(filename);
+		return HumdrumFileBase::read(infile);
+	}
+	madvise(data, size, MADV_SEQUENTIAL);
+	readBuffer((const char*)data, size);
+	munmap(data, size);
+	return isValid();
+#else
+	ifstream infile;
+	infile.open(filename, ios::in | ios::binary);
+	if (!infile.is_open()) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	return HumdrumFileBase::read(infile);
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBuffer -- Split Humdrum data in memory into lines
+//     and then analyze them.  Lines are separated by newlines, and a
+//     carriage return at the end of a line is removed.  There is no limit
+//     on the length of a line.
+//
+
+bool HumdrumFileBase::readBuffer(const char* contents, size_t size) {
 	clear();
+	HumPoolScope scope(m_pool);
 	m_displayError = true;
-	char buffer[123123] = {0};
+	m_lines.reserve(std::count(contents, contents + size, '\n') + 1);
+	const char* ptr = contents;
+	const char* end = contents + size;
 	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
-		s = new HumdrumLine(buffer);
+	while (ptr < end) {
+		const char* newline = (const char*)memchr(ptr, '\n', end - ptr);
+		const char* next;
+		if (newline == NULL) {
+			newline = end;
+			next = end;
+		} else {
+			next = newline + 1;
+		}
+		if ((newline > ptr) && (*(newline - 1) == 0x0d)) {
+			newline--;
+		}
+		// Tokens are created later in analyzeTokens(), so do not use
+		// the HumdrumLine(const char*) constructor which also creates them.
+		s = new HumdrumLine;
+		s->assign(ptr, newline - ptr);
+		s->setOwner(this);
+		m_lines.push_back(s);
+		ptr = next;
+	}
+	return analyzeBaseFromLines();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readLines -- Read Humdrum data which has already been
+//     split into lines (without newlines).  The contents of the strings
+//     are moved into the HumdrumLines of the file rather than copied, so
+//     lines will only contain empty strings afterwards.  A carriage return
+//     at the end of a line is removed.
+//
+
+bool HumdrumFileBase::readLines(std::vector<std::string>& lines) {
+	clear();
+	HumPoolScope scope(m_pool);
+	m_displayError = true;
+	m_lines.reserve(lines.size());
+	HumdrumLine* s;
+	for (int i=0; i<(int)lines.size(); i++) {
+		string& line = lines[i];
+		if (!line.empty() && (line.back() == 0x0d)) {
+			line.pop_back();
+		}
+		// Tokens are created later in analyzeTokens(), so do not use
+		// the HumdrumLine(const string&) constructor which also creates them.
+		s = new HumdrumLine;
+		s->string::swap(line);
 		s->setOwner(this);
 		m_lines.push_back(s);
 	}
 	return analyzeBaseFromLines();
-/*
-	if (!analyzeTokens()) { return isValid(); }
-	if (!analyzeLines() ) { return isValid(); }
-	if (!analyzeSpines()) { return isValid(); }
-	if (!analyzeLinks() ) { return isValid(); }
-	if (!analyzeTracks()) { return isValid(); }
-	return isValid();
-*/
 }
 
 
@@ -16628,10 +18193,11 @@ bool HumdrumFileBase::readCsv(const char* filename, const string& separator) {
 
 
 bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
+	HumPoolScope scope(m_pool);
 	m_displayError = true;
-	char buffer[123123] = {0};
+	string buffer;
 	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
+	while (getline(contents, buffer)) {
 		s = new HumdrumLine;
 		s->setLineFromCsv(buffer);
 		s->setOwner(this);
@@ -16644,12 +18210,18 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 
 //////////////////////////////
 //
-// HumdrumFileBase::analyzeBaseFromLines --
+// HumdrumFileBase::analyzeBaseFromLines -- Create tokens from the text
+//    of the lines and analyze the spine structure of the file (unless
+//    the analysis level is ANALYZE_TOKENS).
 //
 
 bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
+	if (m_analysis_level == ANALYZE_TOKENS) {
+		// spines are analyzed later with analyzeBaseFromTokens().
+		return isValid();
+	}
 	if (!analyzeSpines()) { return isValid(); }
 	if (!analyzeLinks() ) { return isValid(); }
 	if (!analyzeTracks()) { return isValid(); }
@@ -16660,11 +18232,31 @@ bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 
 //////////////////////////////
 //
-// HumdrumFileBase::analyzeBaseFromTokens --
+// HumdrumFileBase::analyzeBaseFromTokens -- Analyze the spine structure
+//    of the file from the current tokens on each line rather than from
+//    the text of the lines.  This allows tokens and lines to be edited
+//    in place (such as adding a spine with insertToken()) without having
+//    to print and then re-parse the entire file.  Analyses which depend
+//    on the spine structure (strands, rhythm, slurs) will need to be
+//    redone after calling this function.
 //
 
 bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 	// if (!analyzeTokens()) { return isValid(); } // this creates tokens from lines
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setOwner(this);
+		m_lines[i]->clearTokenLinkInfo();
+		// lines still need to be regenerated if tokens were edited:
+		m_lines[i]->clearModified(EDIT_RHYTHM | EDIT_STRUCTURE | EDIT_PENDING);
+	}
+	m_structure_analyzed = false;
+	m_rhythm_analyzed = false;
+	m_strands_analyzed = false;
+	m_parameters_analyzed = false;
+	m_slurs_analyzed = false;
+	m_phrases_analyzed = false;
+	m_nulls_analyzed = false;
+	m_timesigs_analyzed = false;
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
 	if (!analyzeLinks() ) { return isValid(); }
@@ -16681,17 +18273,12 @@ bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 //
 
 bool HumdrumFileBase::readString(const string& contents) {
-	stringstream infile;
-	infile << contents;
-	bool status = read(infile);
-	return status;
+	return readBuffer(contents.data(), contents.size());
 }
 
 
 bool HumdrumFileBase::readString(const char* contents) {
-	stringstream infile;
-	infile << contents;
-	return read(infile);
+	return readBuffer(contents, strlen(contents));
 }
 
 
@@ -16945,6 +18532,7 @@ HumdrumLine* HumdrumFileBase::getLine(int index) {
 //
 
 bool HumdrumFileBase::analyzeTokens(void) {
+	HumPoolScope scope(m_pool);
 	for (int i=0; i<(int)m_lines.size(); i++) {
 		m_lines[i]->createTokensFromLine();
 	}
@@ -17029,6 +18617,25 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::updateLinesFromTokens -- Generate Humdrum line strings
+//   only for lines which have tokens that were changed with
+//   HumdrumToken::setText() (or lines marked with
+//   HumdrumLine::setModified()).  Use createLinesFromTokens() if tokens
+//   were changed directly through their std::string interface.
+//
+
+void HumdrumFileBase::updateLinesFromTokens(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->getModified() & EDIT_TEXT) {
+			m_lines[i]->createLineFromTokens();
+		}
+	}
+}
+
+
+
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
@@ -17658,11 +19265,74 @@ bool HumdrumFileBase::analyzeTracks(void) {
 			return false;
 		}
 	}
+	analyzeDataTypes();
 	return isValid();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::analyzeDataTypes -- Store the interned ID of the
+//    exclusive interpretation in each token, so that HumdrumToken::isKern()
+//    and similar functions do not have to compare strings.
+//
+
+void HumdrumFileBase::analyzeDataTypes(void) {
+	vector<int> ids(m_trackstarts.size(), datatype_none);
+	for (int i=1; i<(int)m_trackstarts.size(); i++) {
+		if (m_trackstarts[i] != NULL) {
+			ids[i] = HumdrumToken::registerDataType(*m_trackstarts[i]);
+		}
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine* line = m_lines[i];
+		for (int j=0; j<line->getTokenCount(); j++) {
+			HTp token = line->token(j);
+			if (token == NULL) {
+				continue;
+			}
+			int track = token->getTrack();
+			if ((track > 0) && (track < (int)ids.size())) {
+				token->setDataTypeId(ids[track]);
+			} else {
+				token->setDataTypeId(datatype_none);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::analyzeDataType -- Update the interned data-type ID of
+//    the tokens in a single track.  This is needed when the exclusive
+//    interpretation at the start of the track is changed with
+//    HumdrumToken::setText().
+//
+
+void HumdrumFileBase::analyzeDataType(int track) {
+	if ((track < 1) || (track >= (int)m_trackstarts.size())) {
+		return;
+	}
+	int id = datatype_none;
+	if (m_trackstarts[track] != NULL) {
+		id = HumdrumToken::registerDataType(*m_trackstarts[track]);
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine* line = m_lines[i];
+		for (int j=0; j<line->getTokenCount(); j++) {
+			HTp token = line->token(j);
+			if ((token != NULL) && (token->getTrack() == track)) {
+				token->setDataTypeId(id);
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::analyzeLinks -- Generate forward and backwards spine links
@@ -19170,24 +20840,19 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 
 	for (int i=0; i<lineCount; i++) {
 		if (infile[i].isInterpretation()) {
-			// check for time signature:
-			HumdrumLine& line = *infile.getLine(i);
-			for (int j=0; j<line.getFieldCount(); j++) {
-				int ttrack = line.token(j)->getTrack();
-				if (ttrack != track) {
-					continue;
-				}
-				if (sscanf(infile.token(i,j)->c_str(), "*M%d/%d", &top, &bot)) {
-					beatdur.setValue(1*4, bot); // converted to quarter-note units
-					if ((top % 3 == 0) && (top != 3)) {
-						// if meter top is a multiple of 3 but not 3, then compound
-						// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
-						compoundQ = true;
-						beatdur *= 3;
-					} else {
-						compoundQ = false;
-					}
-					break;
+			// check for time signature (parsed in analyzeTimeSignatures()):
+			const TimeSigChange* change = getTimeSigChange(i, track);
+			if (change && (change->line == i)) {
+				top = change->top;
+				bot = change->bot;
+				beatdur.setValue(1*4, bot); // converted to quarter-note units
+				if ((top % 3 == 0) && (top != 3)) {
+					// if meter top is a multiple of 3 but not 3, then compound
+					// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
+					compoundQ = true;
+					beatdur *= 3;
+				} else {
+					compoundQ = false;
 				}
 			}
 		}
@@ -19697,7 +21362,7 @@ bool HumdrumFileContent::analyzeKernPhrasings(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)kernspines.size(); i++) {
 		output = output && analyzeKernPhrasings(kernspines[i], phrasestarts, phraseends, labels, endings, linkSignifier);
 	}
@@ -20758,7 +22423,7 @@ bool HumdrumFileContent::analyzeMensSlurs(void) {
 	vector<HTp> mensspines;
 	getSpineStartList(mensspines, "**mens");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)mensspines.size(); i++) {
 		output = output && analyzeKernSlurs(mensspines[i], slurstarts, slurends, labels, endings, linkSignifier);
 	}
@@ -20829,7 +22494,7 @@ bool HumdrumFileContent::analyzeKernSlurs(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)kernspines.size(); i++) {
 		output = output && analyzeKernSlurs(kernspines[i], slurstarts, slurends, labels, endings, linkSignifier);
 	}
@@ -21262,7 +22927,7 @@ bool HumdrumFileContent::analyzeTextRepetition(void) {
 		startij = false;
 		lastword = NULL;
 		HTp start = sstarts[i];
-		if (!(start->isDataType("**text") || start->isDataType("**sylb"))) {
+		if (!(start->isDataType(datatype_text) || start->isDataType(datatype_sylb))) {
 			continue;
 		}
 		HTp current = start;
@@ -21323,7 +22988,7 @@ bool HumdrumFileContent::analyzeKernTies(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	output = analyzeKernTies(linkedtiestarts, linkedtieends, linkSignifier);
 	createLinkedTies(linkedtiestarts, linkedtieends);
 	return output;
@@ -21504,7 +23169,7 @@ void HumdrumFileContent::linkTieEndpoints(HTp tiestart,
 // HumdrumFileStructure::getTimeSigs -- Return the prevailing time signature
 //     top and bottom for a particular spine for each line in the HumdrumFile.
 //     This version does not handle mulimeters such as 2+3/4 or 3/4+6/8.
-//     Only checks the primary strand of a spine/track for time signatures.
+//     Only the first time signature of a track on a line is used.
 //
 //     default value: track = 0: 0 means use the time signature
 //         of the first **kern spine in the file; otherwise, use the
@@ -21530,42 +23195,32 @@ void HumdrumFileContent::getTimeSigs(vector<pair<int, HumNum> >& output,
 		track = 1;
 	}
 
-	int top  = 0;   // top number of time signature (0 for no meter)
-	int bot  = 0;   // bottom number of time signature
-	int bot2 = 0;   // such as the 2 in 3%2.
-
+	// The time signatures are parsed in
+	// HumdrumFileStructure::analyzeTimeSignatures().
+	if (!m_timesigs_analyzed) {
+		analyzeTimeSignatures();
+	}
 	int firstsig  = -1;
 	int firstdata = -1;
-
-	HTp token = getTrackStart(track);
-	while (token) {
-		if (token->isData()) {
-			if (firstdata < 0) {
-				firstdata = token->getLineIndex();
+	if ((track < (int)m_timesigs.size()) && !m_timesigs[track].empty()) {
+		firstsig = m_timesigs[track][0].line;
+	}
+	HTp start = getTrackStart(track);
+	if (start) {
+		for (int i=start->getLineIndex(); i<lineCount; i++) {
+			if (infile[i].isData()) {
+				firstdata = i;
+				break;
 			}
-			token = token->getNextToken();
-			continue;
 		}
-		if (!token->isInterpretation()) {
-			token = token->getNextToken();
-			continue;
-		}
-		// check for time signature:
-		if (sscanf(token->c_str(), "*M%d/%d%%%d", &top, &bot, &bot2) == 3) {
-			current.first = top;
-			current.second.setValue(bot, bot2);
-			if (firstsig < 0) {
-				firstsig = token->getLineIndex();
-			}
-		} else if (sscanf(token->c_str(), "*M%d/%d", &top, &bot) == 2) {
-			current.first = top;
-			current.second = bot;
-			if (firstsig < 0) {
-				firstsig = token->getLineIndex();
-			}
+	}
+
+	for (int i=0; i<lineCount; i++) {
+		const TimeSigChange* change = getTimeSigChange(i, track);
+		if (change) {
+			output[i].first  = change->top;
+			output[i].second = change->bottom;
 		}
-		output[token->getLineIndex()] = current;
-		token = token->getNextToken();
 	}
 
 	// Back-fill the list if the first time signature occurs before
@@ -21576,20 +23231,6 @@ void HumdrumFileContent::getTimeSigs(vector<pair<int, HumNum> >& output,
 			output[i] = current;
 		}
 	}
-
-	// In-fill the list:
-	int starti = firstsig;
-	if (starti < 0) {
-		starti = 0;
-	}
-	current = output[starti];
-	for (int i=starti+1; i<(int)output.size(); i++) {
-		if (output[i].first == 0) {
-			output[i] = current;
-		} else {
-			current = output[i];
-		}
-	}
 }
 
 
@@ -22109,6 +23750,9 @@ HumdrumFileStream::HumdrumFileStream(Options& options) {
 	vector<string> list;
 	options.getArgList(list);
 	setFileList(list);
+	if (options.isDefined("prefetch")) {
+		setPrefetch(options.getInteger("prefetch"));
+	}
 }
 
 HumdrumFileStream::HumdrumFileStream(const string& datastring) {
@@ -22118,18 +23762,34 @@ HumdrumFileStream::HumdrumFileStream(const string& datastring) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::~HumdrumFileStream -- Deconstructor.
+//
+
+HumdrumFileStream::~HumdrumFileStream() {
+	stopPrefetch();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::clear -- reset the contents of the class.
 //
 
 void HumdrumFileStream::clear(void) {
+	stopPrefetch();
 	m_curfile = 0;
 	m_filelist.resize(0);
 	m_universals.resize(0);
 	m_newfilebuffer.resize(0);
 	// m_stringbuffer.clear(0);
 	m_stringbuffer.str("");
+	m_readsegments = false;
+	m_segmentindex.clear();
+	m_segmentlist.clear();
+	m_segmentpos = 0;
 }
 
 
@@ -22140,6 +23800,7 @@ void HumdrumFileStream::clear(void) {
 //
 
 int HumdrumFileStream::setFileList(char** list) {
+	stopPrefetch();
 	m_filelist.reserve(1000);
 	m_filelist.resize(0);
 	int i = 0;
@@ -22152,12 +23813,207 @@ int HumdrumFileStream::setFileList(char** list) {
 
 
 int HumdrumFileStream::setFileList(const vector<string>& list) {
+	stopPrefetch();
 	m_filelist = list;
 	return (int)list.size();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::setPrefetch -- Read up to the given number of
+//    files (or URLs) of the file list in a background thread while the
+//    current file is being processed.  A count of 0 (the default) reads
+//    each file only when it is needed.
+//
+
+void HumdrumFileStream::setPrefetch(int count) {
+	stopPrefetch();
+	m_prefetch = count > 0 ? count : 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getPrefetch -- Return the maximum number of files
+//    read ahead by the prefetch thread.
+//
+
+int HumdrumFileStream::getPrefetch(void) const {
+	return m_prefetch;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::startPrefetch -- Start the prefetch thread, reading
+//    files of the file list starting at the given index.
+//
+
+void HumdrumFileStream::startPrefetch(int index) {
+	stopPrefetch();
+	m_prefetchnext = index;
+	m_prefetchstop = false;
+	m_prefetchthread = std::thread(&HumdrumFileStream::prefetchFiles, this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::stopPrefetch -- Stop the prefetch thread and
+//    discard any files which it has read but have not been used.
+//
+
+void HumdrumFileStream::stopPrefetch(void) {
+	if (m_prefetchthread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_prefetchmutex);
+			m_prefetchstop = true;
+		}
+		m_prefetchcv.notify_all();
+		m_prefetchthread.join();
+	}
+	m_prefetchqueue.clear();
+	m_prefetchactive = false;
+	m_prefetchbuffer.str("");
+	m_prefetchbuffer.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::prefetchFiles -- Function of the prefetch thread:
+//    read files of the file list in order until the queue is full, then
+//    wait for the queue to be emptied by getPrefetchedFile().
+//
+
+void HumdrumFileStream::prefetchFiles(void) {
+	while (true) {
+		PrefetchFile file;
+		string filename;
+		{
+			std::unique_lock<std::mutex> lock(m_prefetchmutex);
+			m_prefetchcv.wait(lock, [this](void) {
+				return m_prefetchstop ||
+						((m_prefetchnext < (int)m_filelist.size()) &&
+						((int)m_prefetchqueue.size() < m_prefetch));
+			});
+			if (m_prefetchstop) {
+				return;
+			}
+			file.index = m_prefetchnext++;
+			filename = m_filelist[file.index];
+		}
+		file.ok = readFileContents(filename, file.contents);
+		{
+			std::lock_guard<std::mutex> lock(m_prefetchmutex);
+			m_prefetchqueue.push_back(std::move(file));
+		}
+		m_prefetchcv.notify_all();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getPrefetchedFile -- Return the contents of a file
+//    in the file list which was read by the prefetch thread, waiting for
+//    it if necessary.  Returns false if the file could not be read.
+//
+
+bool HumdrumFileStream::getPrefetchedFile(int index, string& contents) {
+	if (!m_prefetchthread.joinable()) {
+		startPrefetch(index);
+	}
+	std::unique_lock<std::mutex> lock(m_prefetchmutex);
+	while (true) {
+		// files skipped by the reader are not needed anymore:
+		while (!m_prefetchqueue.empty() && (m_prefetchqueue.front().index < index)) {
+			m_prefetchqueue.pop_front();
+		}
+		if (!m_prefetchqueue.empty()) {
+			break;
+		}
+		if (m_prefetchnext > index + 1) {
+			// The thread has moved beyond the requested file, which
+			// should not happen, so restart it at the requested file.
+			lock.unlock();
+			startPrefetch(index);
+			lock.lock();
+		}
+		m_prefetchcv.notify_all();
+		m_prefetchcv.wait(lock);
+	}
+	PrefetchFile& file = m_prefetchqueue.front();
+	bool status = file.ok && (file.index == index);
+	contents.swap(file.contents);
+	m_prefetchqueue.pop_front();
+	lock.unlock();
+	// notify the thread that there is space in the queue:
+	m_prefetchcv.notify_all();
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readFileContents -- Read a file (or URL) into a
+//    string.  Returns false if the file cannot be read.
+//
+
+bool HumdrumFileStream::readFileContents(const string& filename,
+		string& contents) {
+	contents.clear();
+	if (strstr(filename.c_str(), "://") != NULL) {
+		stringstream uribuffer;
+		fillUrlBuffer(uribuffer, filename);
+		contents = uribuffer.str();
+		return !contents.empty();
+	}
+	ifstream input(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	std::streamoff size = input.tellg();
+	input.seekg(0, std::ios::beg);
+	if (size > 0) {
+		contents.resize((size_t)size);
+		input.read(&contents[0], size);
+		contents.resize((size_t)input.gcount());
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::addToFileList -- Append a filename found in the
+//    input data to the file list.
+//
+
+void HumdrumFileStream::addToFileList(const string& filename) {
+	if (m_prefetchthread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_prefetchmutex);
+			m_filelist.push_back(filename);
+		}
+		m_prefetchcv.notify_all();
+	} else {
+		m_filelist.push_back(filename);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::loadString --
@@ -22193,6 +24049,57 @@ int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::read -- Read all segments of the input, and parse
+//    them into HumdrumFiles with more than one thread.  The files are
+//    stored in infiles in the same order as they occur in the input.
+//
+
+int HumdrumFileStream::read(HumdrumFileSet& infiles, int threadcount) {
+	if (threadcount <= 1) {
+		return read(infiles);
+	}
+	infiles.clear();
+	vector<vector<string>> contents;
+	vector<string> filenames;
+	vector<string> lines;
+	string filename;
+	while (getFileLines(lines, filename)) {
+		contents.push_back(std::move(lines));
+		filenames.push_back(filename);
+		lines.clear();
+	}
+
+	vector<HumdrumFile*> files(contents.size(), NULL);
+	std::atomic<int> next(0);
+	auto parser = [&](void) {
+		int i;
+		while ((i = next++) < (int)contents.size()) {
+			files[i] = new HumdrumFile;
+			files[i]->readLinesNoRhythm(contents[i]);
+			if (!filenames[i].empty()) {
+				files[i]->setFilename(filenames[i]);
+			}
+			vector<string>().swap(contents[i]);
+		}
+	};
+	vector<std::thread> threads;
+	for (int i=0; i<threadcount; i++) {
+		threads.emplace_back(parser);
+	}
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+
+	for (int i=0; i<(int)files.size(); i++) {
+		infiles.appendHumdrumPointer(files[i]);
+	}
+	return 0;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::readSingleSegment -- Get a single file for a set structure.
@@ -22221,6 +24128,10 @@ int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 int HumdrumFileStream::eof(void) {
 	istream* newinput = NULL;
 
+	if (m_readsegments) {
+		return m_segmentpos >= (int)m_segmentlist.size();
+	}
+
 	// Read HumdrumFile contents from:
 	// (1) Current ifstream if open
 	// (2) Next filename if ifstream is done
@@ -22236,6 +24147,11 @@ int HumdrumFileStream::eof(void) {
 		return 0;
 	}
 
+	// (1c) Is there a prefetched file being read?
+	else if (m_prefetchactive && !m_prefetchbuffer.eof()) {
+		return 0;
+	}
+
 	// (2) If ifstream is closed but there is a file to be processed,
 	// load it into the ifstream and start processing it immediately.
 	else if ((m_filelist.size() > 0) && (m_curfile < (int)m_filelist.size()-1)) {
@@ -22267,8 +24183,48 @@ int HumdrumFileStream::eof(void) {
 
 int HumdrumFileStream::getFile(HumdrumFile& infile) {
 	infile.clear();
+	vector<string> lines;
+	string filename;
+	if (!getFileLines(lines, filename)) {
+		return 0;
+	}
+	infile.readLinesNoRhythm(lines);
+	if (!filename.empty()) {
+		infile.setFilename(filename);
+	}
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getFileLines -- Extract the lines of the next
+//    HumdrumFile from the input stream or next input file in the list
+//    without parsing them.  Universal comments are demoted to global
+//    comments at the start of the lines.  The filename is set from the
+//    input file list or from a !!!!SEGMENT: record.  Returns true if
+//    content was extracted, fails if there is no more HumdrumFiles in
+//    the input stream.  The lines can be given to
+//    HumdrumFile::readLinesNoRhythm() without copying their contents.
+//
+
+int HumdrumFileStream::getFileLines(vector<string>& lines, string& filename) {
+	lines.clear();
+	filename.clear();
 	istream* newinput = NULL;
 
+	if (m_readsegments) {
+		// only read segments given to setSegmentList():
+		while (m_segmentpos < (int)m_segmentlist.size()) {
+			int segment = m_segmentlist[m_segmentpos++];
+			if (getSegmentLines(lines, filename, m_segmentindex, segment)) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
 restarting:
 
 	newinput = NULL;
@@ -22300,6 +24256,11 @@ restarting:
 		newinput = &m_urlbuffer;
 	}
 
+	// (2c) Is a file read by the prefetch thread being processed?
+	else if (m_prefetchactive && !m_prefetchbuffer.eof()) {
+		newinput = &m_prefetchbuffer;
+	}
+
 	// (3) If ifstream is closed but there is a file to be processed,
 	// load it into the ifstream and start processing it immediately.
 	else if (((int)m_filelist.size() > 0) &&
@@ -22308,25 +24269,38 @@ restarting:
 		if (m_instream.is_open()) {
 			m_instream.close();
 		}
-		if (strstr(m_filelist[m_curfile].c_str(), "://") != NULL) {
+		if (m_prefetch > 0) {
+			// The file (or URL) has been read by the prefetch thread.
+			string contents;
+			if (!getPrefetchedFile(m_curfile, contents)) {
+				m_prefetchactive = false;
+				goto restarting;
+			}
+			m_prefetchbuffer.str(contents);
+			m_prefetchbuffer.clear();
+			m_prefetchactive = true;
+			filename = m_filelist[m_curfile];
+			newinput = &m_prefetchbuffer;
+		} else if (strstr(m_filelist[m_curfile].c_str(), "://") != NULL) {
 			// The next file to read is a URL/URI, so buffer the
 			// data from the internet and start reading that instead
 			// of reading from a file on the hard disk.
 			fillUrlBuffer(m_urlbuffer, m_filelist[m_curfile].c_str());
-			infile.setFilename(m_filelist[m_curfile].c_str());
-			goto restarting;
-		}
-		m_instream.open(m_filelist[m_curfile].c_str());
-		infile.setFilename(m_filelist[m_curfile].c_str());
-		if (!m_instream.is_open()) {
-			// file does not exist or cannot be opened close
-			// the file and try luck with next file in the list
-			// (perhaps given an error or warning?).
-			infile.setFilename("");
-			m_instream.close();
+			filename = m_filelist[m_curfile];
 			goto restarting;
+		} else {
+			m_instream.open(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
+			if (!m_instream.is_open()) {
+				// file does not exist or cannot be opened close
+				// the file and try luck with next file in the list
+				// (perhaps given an error or warning?).
+				filename.clear();
+				m_instream.close();
+				goto restarting;
+			}
+			newinput = &m_instream;
 		}
-		newinput = &m_instream;
 	} else {
 		// no input fstream open and no list of files to process, so
 		// start (or continue) reading from standard input.
@@ -22346,15 +24320,10 @@ restarting:
 		HumRegex hre;
 		if (hre.search(m_newfilebuffer,
 				R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*)\s*$)")) {
-			if (hre.getMatchLength(1) > 0) {
-				infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-			} else {
-				infile.setSegmentLevel(0);
-			}
-			infile.setFilename(hre.getMatch(2));
+			filename = hre.getMatch(2);
 		} else if ((m_curfile >=0) && (m_curfile < (int)m_filelist.size())
 				&& (m_filelist.size() > 0)) {
-			infile.setFilename(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
 		} else {
 			// reading from standard input, but no name.
 		}
@@ -22365,7 +24334,6 @@ restarting:
 		return 0;
 	}
 
-	stringstream buffer;
 	int foundUniversalQ = 0;
 
 	// Start reading the input stream.  If !!!!SEGMENT: universal comment
@@ -22381,7 +24349,7 @@ restarting:
 	if (m_newfilebuffer.size() < 4) {
 		//searchName = 1;
 	}
-	char templine[123123] = {0};
+	string templine;
 
 	if (newinput->eof()) {
 		if (m_curfile < (int)m_filelist.size()-1) {
@@ -22398,30 +24366,29 @@ restarting:
 	// then treat it as part of the current file.
 	if ((m_newfilebuffer.size() > 1) &&
 		 (strncmp(m_newfilebuffer.c_str(), "**", 2)) == 0) {
-		buffer << m_newfilebuffer << "\n";
+		lines.push_back(m_newfilebuffer);
 		m_newfilebuffer = "";
 		starstarFoundQ = 1;
+	} else if (strncmp(m_newfilebuffer.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
+		// The previous read stopped at the !!!!SEGMENT: line which
+		// starts the current file.
+		lines.push_back(m_newfilebuffer);
+		m_newfilebuffer = "";
+		dataFoundQ = 1;
 	}
 
 	while (!input.eof()) {
-		input.getline(templine, 123123, '\n');
+		getline(input, templine);
 		if ((!dataFoundQ) &&
-				(strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0)) {
-			string tempstring;
-			tempstring = templine;
+				(strncmp(templine.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0)) {
 			HumRegex hre;
-			if (hre.search(tempstring,
+			if (hre.search(templine,
 					"^!!!!SEGMENT\\s*([+-]?\\d+)?\\s*:\\s*(.*)\\s*$")) {
-				if (hre.getMatchLength(1) > 0) {
-					infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-				} else {
-					infile.setSegmentLevel(0);
-				}
-				infile.setFilename(hre.getMatch(2));
+				filename = hre.getMatch(2);
 			}
 		}
 
-		if (strncmp(templine, "**", 2) == 0) {
+		if (strncmp(templine.c_str(), "**", 2) == 0) {
 			if (starstarFoundQ == 1) {
 				m_newfilebuffer = templine;
 				// already found a **, so this one is defined as a file
@@ -22433,7 +24400,7 @@ restarting:
 			starstarFoundQ = 1;
 		}
 
-		if (input.eof() && (strcmp(templine, "") == 0)) {
+		if (input.eof() && templine.empty()) {
 			// No more data coming from current stream, so this is
 			// the end of the HumdrumFile.  Break from the while loop
 			// and then store the read contents of the stream in the
@@ -22445,36 +24412,27 @@ restarting:
 		// (1a) this is the name of the current file to process if no
 		// data has yet been found,
 		// (1b) or a name is being actively searched for.
-		if (strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
-			m_newfilebuffer = templine;
+		if (strncmp(templine.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
 			if (dataFoundQ) {
 				// this new filename is for the next chunk to process in the
 				// current file stream, not this one, so stop reading the
 				// HumdrumFile content and send what has already been read back
-				// out with new contents.
-			}  else {
-				// !!!!SEGMENT: came before any real data was read, so
-				// it is most likely the name of the current file
-				// (i.e., it comes at the start of the file stream and
-				// is the name of the first HumdrumFile in the stream).
-				HumRegex hre;
-				if (hre.search(m_newfilebuffer,
-						R"(^!!!!SEGMENT\s*([+-]?\d+)?\s:\s*(.*)\s*$)")) {
-					if (hre.getMatchLength(1) > 0) {
-						infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-					} else {
-						infile.setSegmentLevel(0);
-					}
-					infile.setFilename(hre.getMatch(2));
-				}
+				// out with new contents.  The !!!!SEGMENT: line will be the
+				// first line of the next file.
+				m_newfilebuffer = templine;
+				break;
 			}
+			// Otherwise !!!!SEGMENT: came before any real data was read, so
+			// it is the name of the current file (i.e., it comes at the
+			// start of the file stream and is the name of the first
+			// HumdrumFile in the stream), which was stored above.
 		}
-		int len = (int)strlen(templine);
-		if ((len > 4) && (strncmp(templine, "!!!!", 4) == 0) &&
+		int len = (int)templine.size();
+		if ((len > 4) && (strncmp(templine.c_str(), "!!!!", 4) == 0) &&
 				(templine[4] != '!') &&
 				(dataFoundQ == 0) &&
-				(strncmp(templine, "!!!!filter:", strlen("!!!!filter:")) != 0) &&
-				(strncmp(templine, "!!!!SEGMENT:", strlen("!!!!SEGMENT:")) != 0)) {
+				(strncmp(templine.c_str(), "!!!!filter:", strlen("!!!!filter:")) != 0) &&
+				(strncmp(templine.c_str(), "!!!!SEGMENT:", strlen("!!!!SEGMENT:")) != 0)) {
 			// This is a universal comment.  Should it be appended
 			// to the list or should the current list be erased and
 			// this record placed into the first entry?
@@ -22492,7 +24450,7 @@ restarting:
 			continue;
 		}
 
-		if (strncmp(templine, "*-", 2) == 0) {
+		if (strncmp(templine.c_str(), "*-", 2) == 0) {
 			starminusFoundQ = 1;
 		}
 
@@ -22506,12 +24464,12 @@ restarting:
 				// so that infinite loops are prevented.
 				int found = 0;
 				for (int mm=0; mm<(int)m_filelist.size(); mm++) {
-					if (strcmp(m_filelist[mm].c_str(), templine) == 0) {
+					if (m_filelist[mm] == templine) {
 						found = 1;
 					}
 				}
 				if (!found) {
-					m_filelist.push_back(templine);
+					addToFileList(templine);
 					addedFilename = 1;
 				}
 				continue;
@@ -22521,8 +24479,9 @@ restarting:
 		dataFoundQ = 1; // found something other than universal comments
 		// should empty lines be treated somewhat as universal comments?
 
-		// store the data line for later parsing into HumdrumFile record:
-		buffer << templine << "\n";
+		// store the data line for later parsing into HumdrumFile record
+		// (templine keeps its capacity for reading the next line):
+		lines.push_back(templine);
 	}
 
 	if (dataFoundQ == 0) {
@@ -22534,25 +24493,44 @@ restarting:
 	}
 
 	// Arriving here means that reading of the data stream is complete.
-	// The string stream variable "buffer" contains the HumdrumFile
-	// content, so send it to the HumdrumFile variable.  Also, prepend
+	// The "lines" variable contains the HumdrumFile content.  Also, prepend
 	// Universal comments (demoted into Global comments) at the start
 	// of the data stream (maybe allow for postpending Universal comments
 	// in the future).
-	stringstream contents;
-	contents.str(""); // empty any contents in buffer
-	contents.clear(); // reset error flags in buffer
-
+	vector<string> globals;
 	for (int i=0; i<(int)m_universals.size(); i++) {
 		// Convert universals reference records to globals, but do not demote !!!!filter:
 		if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
 			continue;
 		}
-		contents << &(m_universals[i][1]) << "\n";
+		globals.emplace_back(m_universals[i], 1, string::npos);
 	}
-	contents << buffer.str();
-	string filename = infile.getFilename();
-	infile.readNoRhythm(contents);
+	if (!globals.empty()) {
+		lines.insert(lines.begin(), std::make_move_iterator(globals.begin()),
+				std::make_move_iterator(globals.end()));
+	}
+	return 1;
+}
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegment -- Read a single segment of an archive
+//    of concatenated Humdrum files, given its index number or name in
+//    a HumSegmentIndex.  Only the bytes of the segment are read, and the
+//    universal comments for the segment are taken from the index.  Returns
+//    true if the segment was read.
+//
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile,
+		const HumSegmentIndex& index, int segment) {
+	infile.clear();
+	vector<string> lines;
+	string filename;
+	if (!getSegmentLines(lines, filename, index, segment)) {
+		return 0;
+	}
+	infile.readLinesNoRhythm(lines);
 	if (!filename.empty()) {
 		infile.setFilename(filename);
 	}
@@ -22560,6 +24538,87 @@ restarting:
 }
 
 
+int HumdrumFileStream::readSegment(HumdrumFile& infile,
+		const HumSegmentIndex& index, const string& name) {
+	int segment = index.getSegmentIndex(name);
+	if (segment < 0) {
+		infile.clear();
+		return 0;
+	}
+	return readSegment(infile, index, segment);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::setSegmentList -- Only read the given segments of
+//    an archive (in the given order) with getFile() and read() rather
+//    than the input files of the stream.  Use clear() to return to
+//    reading the input files.
+//
+
+void HumdrumFileStream::setSegmentList(const HumSegmentIndex& index,
+		const vector<int>& segments) {
+	m_readsegments = true;
+	m_segmentindex = index;
+	m_segmentlist = segments;
+	m_segmentpos = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentLines -- Read the lines of a segment in
+//    an archive.  The segment is split into lines in the same way as
+//    getFileLines(), with the universal comments which apply to the
+//    segment when reading the archive sequentially (as stored in the
+//    index) placed before it.
+//
+
+int HumdrumFileStream::getSegmentLines(vector<string>& lines,
+		string& filename, const HumSegmentIndex& index, int segment) {
+	lines.clear();
+	filename.clear();
+	if ((segment < 0) || (segment >= index.getSegmentCount())) {
+		return 0;
+	}
+	if ((!m_segmentstream.is_open()) || (m_segmentarchive != index.getArchive())) {
+		if (m_segmentstream.is_open()) {
+			m_segmentstream.close();
+		}
+		m_segmentstream.clear();
+		m_segmentarchive = index.getArchive();
+		m_segmentstream.open(m_segmentarchive.c_str(), std::ios::in | std::ios::binary);
+		if (!m_segmentstream.is_open()) {
+			return 0;
+		}
+	}
+
+	const vector<string>& universals = index.getSegmentUniversals(segment);
+	string contents;
+	for (int i=0; i<(int)universals.size(); i++) {
+		contents += universals[i];
+		contents += '\n';
+	}
+	int64_t start = contents.size();
+	int64_t size = index.getSegmentSize(segment);
+	contents.resize(start + size);
+	m_segmentstream.clear();
+	m_segmentstream.seekg(index.getSegmentOffset(segment));
+	m_segmentstream.read(&contents[start], size);
+	if (!m_segmentstream) {
+		// the archive is smaller than the index expects.
+		return 0;
+	}
+
+	HumdrumFileStream segmentstream(contents);
+	return segmentstream.getFileLines(lines, filename);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::fillUrlBuffer --
@@ -22649,6 +24708,22 @@ bool HumdrumFileStructure::read(const string& filename) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::readLines -- Read Humdrum data which has already
+//    been split into lines.  The strings in lines are emptied.
+//
+
+bool HumdrumFileStructure::readLines(vector<string>& lines) {
+	m_displayError = false;
+	if (!readLinesNoRhythm(lines)) {
+		return isValid();
+	}
+	return analyzeStructure();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::readCsv --  Read the contents of a file from a file or
@@ -22744,21 +24819,59 @@ bool HumdrumFileStructure::readStringCsv(const string& contents,
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeStructure -- Analyze global/local
-//    parameters and rhythmic structure.
+// HumdrumFileStructure::analyzeStructure -- Analyze strands, global/local
+//    parameters and rhythmic structure, as selected by the analysis level
+//    of the file (see setAnalysisLevel()).  Analyses which are not
+//    selected are done later when they are needed.
 //
 
 bool HumdrumFileStructure::analyzeStructure(void) {
 	m_structure_analyzed = false;
+	int level = m_analysis_level;
+	if (level == ANALYZE_TOKENS) {
+		// no spine information for the other analyses.
+		return isValid();
+	}
+	if (level & ANALYZE_RHYTHM) {
+		level |= ANALYZE_PARAMETERS;
+	}
+	if (level & ANALYZE_PARAMETERS) {
+		// local parameters are linked to tokens along strands.
+		level |= ANALYZE_STRANDS;
+	}
+
+	if ((level & ANALYZE_STRANDS) && !m_strands_analyzed) {
+		if (!analyzeStrands()          ) { return isValid(); }
+	}
+	if (level & ANALYZE_PARAMETERS) {
+		if (!analyzeParameters()       ) { return isValid(); }
+	}
+	if (level & ANALYZE_RHYTHM) {
+		if (!analyzeTokenDurations()   ) { return isValid(); }
+		m_structure_analyzed = true;
+		if (!analyzeRhythmStructure()  ) { return isValid(); }
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeParameters -- Analyze global and local
+//    layout parameters and signifiers.  Local parameters are analyzed
+//    together with the strands.
+//
+
+bool HumdrumFileStructure::analyzeParameters(void) {
+	m_parameters_analyzed = true;
+	if (!m_parseError.empty()) {
+		return false;
+	}
 	if (!m_strands_analyzed) {
-		if (!analyzeStrands()       ) { return isValid(); }
+		if (!analyzeStrands()          ) { return isValid(); }
 	}
 	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	m_structure_analyzed = true;
-	if (!analyzeRhythmStructure()  ) { return isValid(); }
 	analyzeSignifiers();
 	return isValid();
 }
@@ -22839,10 +24952,10 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 	if (!m_strands_analyzed) {
 		if (!analyzeStrands()          ) { return isValid(); }
 	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
+	if (!m_parameters_analyzed) {
+		if (!analyzeParameters()       ) { return isValid(); }
+	}
 	if (!analyzeTokenDurations()   ) { return isValid(); }
-	analyzeSignifiers();
 	return isValid();
 }
 
@@ -22861,12 +24974,161 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 	}
 
 	HTp firstspine = getSpineStart(0);
-	if (firstspine && firstspine->isDataType("**recip")) {
+	if (firstspine && firstspine->isDataType(datatype_recip)) {
 		assignRhythmFromRecip(firstspine);
 	} else {
 		if (!analyzeRhythm()           ) { return isValid(); }
 		if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	}
+	if (isValid()) {
+		analyzeTicks();
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeEdits -- Update the file after tokens
+//    have been changed with HumdrumToken::setText(), without having to
+//    print and re-parse the whole file.  Only lines with edited tokens
+//    are regenerated.  Edits which do not change durations or the spine
+//    structure do not need any re-analysis.  If token durations changed,
+//    then the rhythm analysis is updated starting at the last line
+//    before the first edit where all rhythmic spines have notes or rests
+//    (see analyzeRhythmFrom()).
+//    Edits to spine manipulators, null tokens or layout parameters
+//    require the spine structure to be analyzed again from the tokens.
+//
+
+bool HumdrumFileStructure::analyzeEdits(void) {
+	int rhythmline = -1;
+	bool structureQ = false;
+	bool editQ = false;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		int change = m_lines[i]->classifyEdits();
+		if (change == EDIT_NONE) {
+			continue;
+		}
+		editQ = true;
+		if (change & EDIT_TEXT) {
+			m_lines[i]->createLineFromTokens();
+		}
+		if (change & EDIT_STRUCTURE) {
+			structureQ = true;
+		}
+		if (change & EDIT_RHYTHM) {
+			// HumdrumToken::setText() does not update token durations.
+			if (!m_lines[i]->analyzeTokenDurations(m_parseError)) {
+				return isValid();
+			}
+			if (rhythmline < 0) {
+				rhythmline = i;
+			}
+		}
+		m_lines[i]->clearModified();
+	}
+	if (!editQ) {
+		return isValid();
+	}
+
+	// analyses of token contents have to be done again:
+	m_slurs_analyzed = false;
+	m_phrases_analyzed = false;
+	m_timesigs_analyzed = false;
+
+	if (structureQ) {
+		if (!analyzeBaseFromTokens()) { return isValid(); }
+		return analyzeStructure();
+	}
+	if ((rhythmline >= 0) && m_rhythm_analyzed) {
+		return analyzeRhythmFrom(rhythmline);
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeRhythmFrom -- Update the rhythm analysis
+//    after token durations on the given line (or later lines) have been
+//    changed.  The analysis restarts at the last data line before the
+//    given line which has a note or rest in every rhythmic spine, since
+//    the start time of that line does not depend on the changed
+//    durations.  If there is no such line, then the structure of the
+//    file is analyzed again from the tokens.
+//
+
+bool HumdrumFileStructure::analyzeRhythmFrom(int lineindex) {
+	int anchor = -1;
+	HTp firstspine = getSpineStart(0);
+	if (!(firstspine && firstspine->isDataType(datatype_recip))) {
+		// Edited tokens have to be checked against the previous notes in
+		// their spines, so the search starts before the edited line.
+		for (int i=lineindex-1; i>=0; i--) {
+			HumdrumLine* line = m_lines[i];
+			if (!line->isData() || line->m_durationFromStart.isNegative()) {
+				continue;
+			}
+			bool rhythmQ = false;
+			bool nullQ = false;
+			for (int j=0; j<line->getTokenCount(); j++) {
+				HTp token = line->token(j);
+				if (!token->hasRhythm()) {
+					continue;
+				}
+				rhythmQ = true;
+				if (token->isNull() || token->getDuration().isNegative()) {
+					nullQ = true;
+					break;
+				}
+			}
+			if (rhythmQ && !nullQ) {
+				anchor = i;
+				break;
+			}
+		}
+	}
+	if (anchor < 0) {
+		if (!analyzeBaseFromTokens()) { return isValid(); }
+		return analyzeStructure();
+	}
+
+	// clear the rhythm analysis after the anchor line:
+	for (int i=anchor; i<(int)m_lines.size(); i++) {
+		HumdrumLine* line = m_lines[i];
+		if (i > anchor) {
+			line->m_durationFromStart = -1;
+		}
+		for (int j=0; j<line->getTokenCount(); j++) {
+			line->token(j)->m_rhycheck = 0;
+		}
+	}
+
+	HumNum startdur = m_lines[anchor]->m_durationFromStart;
+	HumdrumLine* line = m_lines[anchor];
+	for (int j=0; j<line->getTokenCount(); j++) {
+		if (!assignDurationsToTrack(line->token(j), startdur)) {
+			return isValid();
+		}
+	}
+	// spines which start after the anchor line:
+	for (int i=1; i<=getMaxTrack(); i++) {
+		HTp start = getTrackStart(i);
+		if (!start->hasRhythm() || (start->getLineIndex() <= anchor)) {
+			continue;
+		}
+		if (!analyzeRhythmOfFloatingSpine(start)) { return isValid(); }
+	}
+
+	if (!analyzeNullLineRhythms(anchor)) { return isValid(); }
+	fillInNegativeStartTimes(anchor);
+	assignLineDurations(anchor);
+	if (!analyzeMeter(anchor)) { return isValid(); }
+	if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
+	analyzeTicks(anchor);
 	return isValid();
 }
 
@@ -22988,6 +25250,18 @@ bool HumdrumFileStructure::readStringNoRhythm(const string& contents) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::readLinesNoRhythm -- Read lines, but do not
+//    parse rhythm (or parameters).  The strings in lines are emptied.
+//
+
+bool HumdrumFileStructure::readLinesNoRhythm(vector<string>& lines) {
+	return HumdrumFileBase::readLines(lines);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::readStringNoRhythmCsv -- Read a string, but
@@ -23057,6 +25331,21 @@ int HumdrumFileStructure::tpq(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::getScoreTickDuration -- Return the total duration
+//    of the score in ticks (see tpq()).
+//
+
+int64_t HumdrumFileStructure::getScoreTickDuration(void) const {
+	if (m_lines.size() == 0) {
+		return 0;
+	}
+	return m_lines.back()->m_tickFromStart;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::getPositiveLineDurations -- Return a list of all
@@ -23091,6 +25380,21 @@ ostream& HumdrumFileStructure::printDurationInfo(ostream& out) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::ensureRhythm -- Analyze the rhythm of the file
+//    if it has not been done yet, so that the const barline functions can
+//    be used on a file which was read without rhythm analysis.
+//
+
+void HumdrumFileStructure::ensureRhythm(void) const {
+	if (!m_rhythm_analyzed) {
+		const_cast<HumdrumFileStructure*>(this)->analyzeRhythmStructure();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::getBarline -- Return the given barline from the file
@@ -23100,6 +25404,7 @@ ostream& HumdrumFileStructure::printDurationInfo(ostream& out) {
 //
 
 HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -23123,6 +25428,7 @@ HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
 //
 
 int HumdrumFileStructure::getBarlineCount(void) const {
+	ensureRhythm();
 	return (int)m_barlines.size();
 }
 
@@ -23138,6 +25444,7 @@ int HumdrumFileStructure::getBarlineCount(void) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -23166,6 +25473,7 @@ HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -23187,6 +25495,7 @@ HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationToEnd(int index) const {
+	ensureRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -23200,6 +25509,128 @@ HumNum HumdrumFileStructure::getBarlineDurationToEnd(int index) const {
 }
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::getTimeSigChange -- Return the time signature
+//     which is active on the given line in a track (which can be on
+//     that line or an earlier one).  Returns NULL if there is no time
+//     signature in the track before the line.
+//
+
+const TimeSigChange* HumdrumFileStructure::getTimeSigChange(int lineindex,
+		int track) {
+	if (!m_timesigs_analyzed) {
+		analyzeTimeSignatures();
+	}
+	if ((track < 0) || (track >= (int)m_timesigs.size())) {
+		return NULL;
+	}
+	const vector<TimeSigChange>& changes = m_timesigs[track];
+	auto it = std::upper_bound(changes.begin(), changes.end(), lineindex,
+			[](int line, const TimeSigChange& change) {
+				return line < change.line;
+			});
+	if (it == changes.begin()) {
+		return NULL;
+	}
+	--it;
+	return &(*it);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getTimeSigTop -- Return the top number of the
+//     time signature active on the given line in a track, or 0 if there
+//     is no time signature.
+//
+
+int HumdrumFileStructure::getTimeSigTop(int lineindex, int track) {
+	const TimeSigChange* change = getTimeSigChange(lineindex, track);
+	if (!change) {
+		return 0;
+	}
+	return change->top;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getTimeSigBottom -- Return the bottom of the time
+//     signature active on the given line in a track as a rhythm (3/2
+//     for *M3/3%2), or 0 if there is no time signature.
+//
+
+HumNum HumdrumFileStructure::getTimeSigBottom(int lineindex, int track) {
+	const TimeSigChange* change = getTimeSigChange(lineindex, track);
+	if (!change) {
+		return 0;
+	}
+	return change->bottom;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeTimeSignatures -- Store the time signatures
+//     of each track so that they do not need to be parsed again by
+//     each analysis which needs them.  This is done the first time that
+//     a time signature is requested.  Only the first time signature for
+//     a track on a line is used.  Multimeters such as 2+3/4 or 3/4+6/8 are
+//     not handled.
+//
+
+bool HumdrumFileStructure::analyzeTimeSignatures(void) {
+	m_timesigs_analyzed = true;
+	m_timesigs.clear();
+	m_timesigs.resize(getMaxTrack() + 1);
+	int top;
+	int bot;
+	int bot2;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (!line.isInterpretation()) {
+			continue;
+		}
+		for (int j=0; j<line.getFieldCount(); j++) {
+			HTp token = line.token(j);
+			if ((token->size() < 3) || (token->compare(0, 2, "*M") != 0) ||
+					!isdigit((*token)[2])) {
+				continue;
+			}
+			int track = token->getTrack();
+			if ((track < 1) || (track >= (int)m_timesigs.size())) {
+				continue;
+			}
+			vector<TimeSigChange>& changes = m_timesigs[track];
+			if (!changes.empty() && (changes.back().line == i)) {
+				// already found a time signature for the track on this line.
+				continue;
+			}
+			TimeSigChange change;
+			int count = sscanf(token->c_str(), "*M%d/%d%%%d", &top, &bot, &bot2);
+			if (count < 2) {
+				continue;
+			}
+			change.line = i;
+			change.top = top;
+			change.bot = bot;
+			if ((count == 3) && (bot2 > 0)) {
+				change.bottom.setValue(bot, bot2);
+			} else {
+				change.bottom = bot;
+			}
+			changes.push_back(change);
+		}
+	}
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::setLineRhythmAnalyzed --
@@ -23280,32 +25711,44 @@ bool HumdrumFileStructure::analyzeRhythm(void) {
 //     for barlines, where the getDurationToBarline() will store the
 //     duration of the measure staring at that barline.  To get the
 //     beat, you will have to figure out the current time signature.
+//     If startline is given, then only the lines affected by changes
+//     in durations from that line onwards are updated, and the list of
+//     barlines is kept.  Default value: startline = 0.
 //
 
-bool HumdrumFileStructure::analyzeMeter(void) {
-
-	m_barlines.resize(0);
+bool HumdrumFileStructure::analyzeMeter(int startline) {
 
+	// the barlines do not change when only durations are updated:
+	bool barlinesQ = startline <= 0;
 	int i;
 	HumNum sum = 0;
 	bool foundbarline = false;
-	for (i=0; i<getLineCount(); i++) {
+	if (barlinesQ) {
+		startline = 0;
+		m_barlines.resize(0);
+	} else {
+		sum = m_lines[startline]->m_durationFromBarline;
+	}
+	for (i=startline; i<getLineCount(); i++) {
 		m_lines[i]->setDurationFromBarline(sum);
 		sum += m_lines[i]->getDuration();
 		if (m_lines[i]->isBarline()) {
 			foundbarline = true;
-			m_barlines.push_back(m_lines[i]);
+			if (barlinesQ) {
+				m_barlines.push_back(m_lines[i]);
+			}
 			sum = 0;
 		}
-		if (m_lines[i]->isData() && !foundbarline) {
+		if (barlinesQ && m_lines[i]->isData() && !foundbarline) {
 			// pickup measure, so set the first measure to the start of the file.
 			m_barlines.push_back(m_lines[0]);
 			foundbarline = 1;
 		}
 	}
 
+	int stopline = getPreviousBarlineIndex(startline);
 	sum = 0;
-	for (i=getLineCount()-1; i>=0; i--) {
+	for (i=getLineCount()-1; i>=stopline; i--) {
 		sum += m_lines[i]->getDuration();
 		m_lines[i]->setDurationToBarline(sum);
 		if (m_lines[i]->isBarline()) {
@@ -23318,6 +25761,107 @@ bool HumdrumFileStructure::analyzeMeter(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::getPreviousBarlineIndex -- Return the index of the
+//    last barline at or before the given line, or 0 if there is no
+//    barline before the line.  The duration to the next barline does not
+//    change for lines before this barline when durations are changed at
+//    or after the given line.
+//
+
+int HumdrumFileStructure::getPreviousBarlineIndex(int lineindex) {
+	for (int i=lineindex; i>0; i--) {
+		if (m_lines[i]->isBarline()) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeTicks -- Store the rhythmic positions and
+//     durations of lines and tokens as integer counts of ticks, where
+//     there are tpq() ticks in a quarter note.  This allows timeline
+//     calculations with integer arithmetic rather than with HumNum
+//     fractions.  The offsets from barlines are calculated in the same
+//     manner as analyzeMeter().  If startline is given, then only lines
+//     from that line onwards are updated, unless the change in durations
+//     also changes tpq().  Default value: startline = 0.
+//
+
+bool HumdrumFileStructure::analyzeTicks(int startline) {
+	// line durations may have changed since tpq() was last called:
+	int oldticks = m_ticksperquarternote;
+	m_ticksperquarternote = -1;
+	int64_t ticks = tpq();
+	if ((startline < 0) || (ticks != oldticks)) {
+		startline = 0;
+	}
+
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (i >= startline) {
+			HumNum start = line.m_durationFromStart;
+			line.m_tickFromStart = (int64_t)start.getNumerator() * ticks /
+					start.getDenominator();
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			if ((i < startline) && line.m_tokens[j]->hasRhythm()) {
+				// durations of non-rhythmic tokens before startline may
+				// extend past it, so only they have to be updated.
+				continue;
+			}
+			HumNum dur = line.m_tokens[j]->getDuration();
+			if (dur.isNegative()) {
+				line.m_tokens[j]->m_tickDuration = -1;
+			} else {
+				line.m_tokens[j]->m_tickDuration = (int64_t)dur.getNumerator() * ticks /
+						dur.getDenominator();
+			}
+		}
+	}
+
+	int64_t sum = 0;
+	if (startline > 0) {
+		sum = m_lines[startline]->m_tickFromBarline;
+	}
+	for (int i=startline; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (i < (int)m_lines.size() - 1) {
+			line.m_tickDuration = m_lines[i+1]->m_tickFromStart - line.m_tickFromStart;
+			if (line.m_tickDuration < 0) {
+				line.m_tickDuration = 0;
+			}
+		} else {
+			line.m_tickDuration = 0;
+		}
+		line.m_tickFromBarline = sum;
+		sum += line.m_tickDuration;
+		if (line.isBarline()) {
+			sum = 0;
+		}
+	}
+
+	int stopline = getPreviousBarlineIndex(startline);
+	sum = 0;
+	for (int i=(int)m_lines.size()-1; i>=stopline; i--) {
+		HumdrumLine& line = *m_lines[i];
+		sum += line.m_tickDuration;
+		line.m_tickToBarline = sum;
+		if (line.isBarline()) {
+			sum = 0;
+		}
+	}
+
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeTokenDurations -- Calculate the duration of
@@ -23730,9 +26274,10 @@ bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
 //    lines.  For example if a data line starts at time 15, and there is one
 //    null-token line before another data line at time 16, then the null-token
 //    line will be assigned to the position 15.5 in the score.
+//    Default value: startline = 0.
 //
 
-bool HumdrumFileStructure::analyzeNullLineRhythms(void) {
+bool HumdrumFileStructure::analyzeNullLineRhythms(int startline) {
 	vector<HumdrumLine*> nulllines;
 	HumdrumLine* previous = NULL;
 	HumdrumLine* next = NULL;
@@ -23740,7 +26285,7 @@ bool HumdrumFileStructure::analyzeNullLineRhythms(void) {
 	HumNum startdur;
 	HumNum enddur;
 	int i, j;
-	for (i=0; i<(int)m_lines.size(); i++) {
+	for (i=startline; i<(int)m_lines.size(); i++) {
 		if (!m_lines[i]->hasSpines()) {
 			continue;
 		}
@@ -23788,14 +26333,14 @@ bool HumdrumFileStructure::analyzeNullLineRhythms(void) {
 // HumdrumFileStructure::fillInNegativeStartTimes -- Negative line durations
 //    after the initial rhythmAnalysis mean that the lines are not data line.
 //    Duplicate the duration of the next non-negative duration for all negative
-//    durations.
+//    durations.  Default value: startline = 0.
 //
 
-void HumdrumFileStructure::fillInNegativeStartTimes(void) {
+void HumdrumFileStructure::fillInNegativeStartTimes(int startline) {
 	int i;
 	HumNum lastdur = -1;
 	HumNum dur;
-	for (i=(int)m_lines.size()-1; i>=0; i--) {
+	for (i=(int)m_lines.size()-1; i>=startline; i--) {
 		dur = m_lines[i]->getDurationFromStart();
 		if (dur.isNegative() && lastdur.isNonNegative()) {
 			m_lines[i]->setDurationFromStart(lastdur);
@@ -23807,7 +26352,7 @@ void HumdrumFileStructure::fillInNegativeStartTimes(void) {
 	}
 
 	// fill in start times for ending comments
-	for (i=0; i<(int)m_lines.size(); i++) {
+	for (i=startline; i<(int)m_lines.size(); i++) {
 		dur = m_lines[i]->getDurationFromStart();
 		if (dur.isNonNegative()) {
 			lastdur = dur;
@@ -23823,13 +26368,14 @@ void HumdrumFileStructure::fillInNegativeStartTimes(void) {
 //
 // HumdrumFileStructure::assignLineDurations --  Calculate the duration of lines
 //   based on the durationFromStart of the current line and the next line.
+//   Default value: startline = 0.
 //
 
-void HumdrumFileStructure::assignLineDurations(void) {
+void HumdrumFileStructure::assignLineDurations(int startline) {
 	HumNum startdur;
 	HumNum enddur;
 	HumNum dur;
-	for (int i=0; i<(int)m_lines.size()-1; i++) {
+	for (int i=startline; i<(int)m_lines.size()-1; i++) {
 		startdur = m_lines[i]->getDurationFromStart();
 		enddur = m_lines[i+1]->getDurationFromStart();
 		dur = enddur - startdur;
@@ -24022,6 +26568,10 @@ void HumdrumFileStructure::checkForLocalParameters(HTp token,
 
 bool HumdrumFileStructure::analyzeStrands(void) {
 	m_strands_analyzed = true;
+	if (!m_parseError.empty()) {
+		// spine structure is not valid, so strands cannot be followed.
+		return false;
+	}
 	int spines = getSpineCount();
 	m_strand1d.clear();
 	m_strand2d.clear();
@@ -24294,6 +26844,7 @@ bool HumdrumFileStructure::hasUniversalFilters(void) {
 
 void HumdrumFileStructure::analyzeSignifiers(void) {
 	HumdrumFileStructure& infile = *this;
+	m_signifiers.clear();
 	for (int i=0; i<getLineCount(); i++) {
 		if (!infile[i].isSignifier()) {
 			continue;
@@ -24311,6 +26862,9 @@ void HumdrumFileStructure::analyzeSignifiers(void) {
 //
 
 std::string HumdrumFileStructure::getKernLinkSignifier(void) {
+	if (!m_parameters_analyzed) {
+		analyzeParameters();
+	}
 	return m_signifiers.getKernLinkSignifier();
 }
 
@@ -24324,6 +26878,9 @@ std::string HumdrumFileStructure::getKernLinkSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernAboveSignifier(void) {
+	if (!m_parameters_analyzed) {
+		analyzeParameters();
+	}
 	return m_signifiers.getKernAboveSignifier();
 }
 
@@ -24337,6 +26894,9 @@ std::string HumdrumFileStructure::getKernAboveSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernBelowSignifier(void) {
+	if (!m_parameters_analyzed) {
+		analyzeParameters();
+	}
 	return m_signifiers.getKernBelowSignifier();
 }
 
@@ -24386,6 +26946,7 @@ HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line) {
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_modified            = line.m_modified;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -24404,6 +26965,7 @@ HumdrumLine::HumdrumLine(HumdrumLine& line, void* owner) : string((string)line)
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_modified            = line.m_modified;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -24428,6 +26990,7 @@ HumdrumLine& HumdrumLine::operator=(HumdrumLine& line) {
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_modified            = line.m_modified;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -24459,6 +27022,32 @@ HumdrumLine::~HumdrumLine() {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::operator new -- Allocate lines from the arena of the
+//    HumdrumFile which is reading them (see HumPoolScope) rather than
+//    individually from the heap.
+//
+
+void* HumdrumLine::operator new(size_t size) {
+	return HumPool::allocateObject(size);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::operator delete -- Release the memory of a line.  Arena
+//    memory is returned to the system when all objects in its slab are
+//    deleted.
+//
+
+void HumdrumLine::operator delete(void* ptr) {
+	HumPool::releaseObject(ptr);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::setLineFromCsv -- Read a HumdrumLine from a CSV line.
@@ -24558,6 +27147,7 @@ void HumdrumLine::clear(void) {
 	m_tokens.clear();
 	m_tabs.clear();
 	m_rhythm_analyzed = false;
+	m_modified = EDIT_NONE;
 }
 
 
@@ -24596,7 +27186,7 @@ bool HumdrumLine::isKernBoundaryStart(void) const {
 		return false;
 	}
 	for (int i=0; i<getFieldCount(); i++) {
-		if (!token(i)->isDataType("**kern")) {
+		if (!token(i)->isKern()) {
 			continue;
 		}
 		if (token(i)->isNull()) {
@@ -24622,7 +27212,7 @@ bool HumdrumLine::isKernBoundaryEnd(void) const {
 	}
 	HTp ntok;
 	for (int i=0; i<getFieldCount(); i++) {
-		if (!token(i)->isDataType("**kern")) {
+		if (!token(i)->isKern()) {
 			continue;
 		}
 		ntok = token(i)->getNextToken();
@@ -25394,6 +27984,117 @@ void HumdrumLine::setDuration(HumNum aDur) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::getTickDuration -- Return the duration of the line in
+//    ticks (see HumdrumFileStructure::tpq()).  The tick values are integer
+//    versions of the HumNum durations which can be added and compared
+//    without fraction arithmetic.
+//
+
+int64_t HumdrumLine::getTickDuration(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickDuration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickFromStart -- Return the duration in ticks from the
+//    start of the file to the start of the line.
+//
+
+int64_t HumdrumLine::getTickFromStart(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickFromStart;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickToEnd -- Return the duration in ticks from the
+//    start of the line to the end of the file.
+//
+
+int64_t HumdrumLine::getTickToEnd(void) {
+	HumdrumFile* owner = getOwner();
+	if (owner == NULL) {
+		return 0;
+	}
+	if (!m_rhythm_analyzed) {
+		owner->analyzeRhythmStructure();
+	}
+	return owner->getScoreTickDuration() - m_tickFromStart;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickFromBarline -- Return the duration in ticks from
+//    the previous barline to the start of the line.
+//
+
+int64_t HumdrumLine::getTickFromBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickFromBarline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTickToBarline -- Return the duration in ticks from the
+//    start of the line to the next barline.
+//
+
+int64_t HumdrumLine::getTickToBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickToBarline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getBarlineTickDuration -- Return the duration in ticks of
+//    the measure which contains the line (or which starts at the line
+//    if it is a barline).
+//
+
+int64_t HumdrumLine::getBarlineTickDuration(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	if (isBarline()) {
+		return m_tickToBarline;
+	} else {
+		return m_tickFromBarline + m_tickToBarline;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::hasSpines -- Returns true if the line contains spines.  This
@@ -25515,7 +28216,9 @@ string HumdrumLine::getTokenString(int index) const {
 //////////////////////////////
 //
 // HumdrumLine::createTokensFromLine -- Chop up a HumdrumLine string into
-//     individual tokens.
+//     individual tokens.  Tabs are found with memchr() so that each token
+//     is copied from the line in one piece.  Repeated tabs between tokens
+//     are treated as a single separator and counted in m_tabs.
 //
 
 int HumdrumLine::createTokensFromLine(void) {
@@ -25527,57 +28230,77 @@ int HumdrumLine::createTokensFromLine(void) {
 	}
 	m_tokens.clear();
 	m_tabs.clear();
+	// tokens now match the text of the line:
+	m_modified = EDIT_NONE;
 	HTp token;
-	char ch = 0;
-	char lastch = 0;
-	string tstring;
 
 	if (this->size() == 0) {
 		token = new HumdrumToken();
 		token->setOwner(this);
 		m_tokens.push_back(token);
-		m_tokens.push_back(0);
+		m_tabs.push_back(0);
 	} else if (this->compare(0, 2, "!!") == 0) {
 		token = new HumdrumToken(this->c_str());
 		token->setOwner(this);
 		m_tokens.push_back(token);
 		m_tabs.push_back(0);
 	} else {
-		for (int i=0; i<(int)size(); i++) {
-			lastch = ch;
-			ch = getChar(i);
-			if (ch == '\t') {
-				// Parser now allows multiple tab characters in a
-				// row to represent a single tab.
-				if (lastch != '\t') {
-					token = new HumdrumToken(tstring);
-					token->setOwner(this);
-					m_tokens.push_back(token);
-					m_tabs.push_back(1);
-					tstring.clear();
-				} else {
-					if (m_tabs.size() > 0) {
-						m_tabs.back()++;
-					}
-				}
-			} else {
-				tstring += ch;
+		const char* ptr = this->data();
+		const char* end = ptr + this->size();
+		const char* tab;
+		const char* next;
+		while (ptr < end) {
+			tab = (const char*)memchr(ptr, '\t', end - ptr);
+			if (tab == NULL) {
+				tab = end;
+			}
+			token = new HumdrumToken(ptr, tab - ptr);
+			token->setOwner(this);
+			m_tokens.push_back(token);
+			if (tab == end) {
+				m_tabs.push_back(0);
+				break;
+			}
+			// Parser now allows multiple tab characters in a
+			// row to represent a single tab.
+			next = tab + 1;
+			while ((next < end) && (*next == '\t')) {
+				next++;
 			}
+			m_tabs.push_back((int)(next - tab));
+			ptr = next;
 		}
 	}
-	if (tstring.size() > 0) {
-		token = new HumdrumToken(tstring);
-		token->setOwner(this);
-		m_tokens.push_back(token);
-		m_tabs.push_back(0);
-		tstring.clear();
-	}
 
 	return (int)m_tokens.size();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::clearTokenLinkInfo -- Prepare the tokens on the line for
+//    a new structural analysis after they were edited in place: tokens
+//    which were added with insertToken() or appendToken() are given this
+//    line as their owner, spine links are removed from all tokens, and the
+//    rhythm analysis of the line is reset.
+//
+
+void HumdrumLine::clearTokenLinkInfo(void) {
+	for (int i=0; i<(int)m_tokens.size(); i++) {
+		if (m_tokens[i] == NULL) {
+			continue;
+		}
+		m_tokens[i]->setOwner(this);
+		m_tokens[i]->clearLinkInfo();
+	}
+	m_duration = -1;
+	m_durationFromStart = -1;
+	m_rhythm_analyzed = false;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::createLineFromTokens --  Re-generate a HumdrumLine string from
@@ -25612,6 +28335,84 @@ void HumdrumLine::createLineFromTokens(void) {
 			}
 		}
 	}
+	m_modified &= ~EDIT_TEXT;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::isModified -- Returns true if any tokens on the line have
+//    been changed with HumdrumToken::setText() since the line was last
+//    regenerated or analyzed.
+//
+
+bool HumdrumLine::isModified(void) const {
+	return m_modified != EDIT_NONE;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getModified -- Returns the EDIT_* flags for changes to the
+//    tokens on the line.
+//
+
+int HumdrumLine::getModified(void) const {
+	return m_modified;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::setModified -- Mark the line as having changed tokens.
+//    This is done automatically by HumdrumToken::setText(), but should
+//    be called if a token is changed directly through its std::string
+//    interface.  Default value: change = EDIT_TEXT.
+//
+
+void HumdrumLine::setModified(int change) {
+	m_modified |= change;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::clearModified -- Remove the given EDIT_* flags from the
+//    line.  Clearing EDIT_PENDING discards the edits of the tokens which
+//    have not been classified yet.  Default value: change = all flags.
+//
+
+void HumdrumLine::clearModified(int change) {
+	if ((change & EDIT_PENDING) && (m_modified & EDIT_PENDING)) {
+		for (int i=0; i<(int)m_tokens.size(); i++) {
+			m_tokens[i]->clearEdit();
+		}
+	}
+	m_modified &= ~change;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::classifyEdits -- Classify the changes made to tokens
+//    with HumdrumToken::setText() as text, rhythm or structure edits
+//    (see HumdrumToken::classifyEdit()).  Returns the EDIT_* flags of
+//    the line.
+//
+
+int HumdrumLine::classifyEdits(void) {
+	if (m_modified & EDIT_PENDING) {
+		for (int i=0; i<(int)m_tokens.size(); i++) {
+			m_modified |= m_tokens[i]->classifyEdit();
+		}
+		m_modified &= ~EDIT_PENDING;
+	}
+	return m_modified;
 }
 
 
@@ -26283,6 +29084,7 @@ void HumdrumLine::appendToken(HTp token, int tabcount) {
 	// deletion will be handled by class.
 	m_tokens.push_back(token);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26290,6 +29092,7 @@ void HumdrumLine::appendToken(const HumdrumToken& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26297,6 +29100,7 @@ void HumdrumLine::appendToken(const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26304,6 +29108,7 @@ void HumdrumLine::appendToken(const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26339,6 +29144,7 @@ void HumdrumLine::insertToken(int index, HTp token, int tabcount) {
 	// already belongs to another HumdrumLine or HumdrumFile.
 	m_tokens.insert(m_tokens.begin() + index, token);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26346,6 +29152,7 @@ void HumdrumLine::insertToken(int index, const HumdrumToken& token, int tabcount
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26353,6 +29160,7 @@ void HumdrumLine::insertToken(int index, const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26360,6 +29168,7 @@ void HumdrumLine::insertToken(int index, const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	m_modified |= EDIT_TEXT | EDIT_STRUCTURE;
 }
 
 
@@ -26493,6 +29302,15 @@ HumdrumToken::HumdrumToken(const char* aString) : string(aString) {
 }
 
 
+HumdrumToken::HumdrumToken(const char* aString, size_t length) :
+		string(aString, length) {
+	m_rhycheck = 0;
+	setPrefix("!");
+	m_strand = -1;
+	m_nullresolve = NULL;
+}
+
+
 HumdrumToken::HumdrumToken(const HumdrumToken& token) :
 		string((string)token), HumHash((HumHash)token) {
 	m_address         = token.m_address;
@@ -26634,9 +29452,41 @@ HumdrumToken::~HumdrumToken() {
 		delete m_parameterSet;
 		m_parameterSet = NULL;
 	}
+	if (m_noteinfo) {
+		delete m_noteinfo;
+		m_noteinfo = NULL;
+	}
+	clearEdit();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::operator new -- Allocate tokens from the arena of the
+//    HumdrumFile which is reading them (see HumPoolScope) rather than
+//    individually from the heap, since a file creates one token for
+//    every field on every line.
+//
+
+void* HumdrumToken::operator new(size_t size) {
+	return HumPool::allocateObject(size);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::operator delete -- Release the memory of a token.  Arena memory
+//    is returned to the system when all objects in its slab are deleted.
+//
+
+void HumdrumToken::operator delete(void* ptr) {
+	HumPool::releaseObject(ptr);
 }
 
 
+
 //////////////////////////////
 //
 // HumdrumToken::equalChar -- Returns true if the character at the given
@@ -26744,13 +29594,15 @@ HumdrumToken* HumdrumToken::getNextNonNullDataToken(int index) {
 //
 
 HumNum HumdrumToken::getSlurDuration(HumNum scale) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 		return 0;
 	}
-	if (isDefined("auto", "slurDuration")) {
-		return getValueFraction("auto", "slurDuration");
-	} else if (isDefined("auto", "slurEnd")) {
-		HTp slurend = getValueHTp("auto", "slurEnd");
+	static const HumParamKey slurDurationKey("auto", "slurDuration");
+	static const HumParamKey slurEndKey("auto", "slurEnd");
+	if (isDefined(slurDurationKey)) {
+		return getValueFraction(slurDurationKey);
+	} else if (isDefined(slurEndKey)) {
+		HTp slurend = getValueHTp(slurEndKey);
 		return slurend->getDurationFromStart(scale) -
 				getDurationFromStart(scale);
 	} else {
@@ -26789,6 +29641,126 @@ bool HumdrumToken::isDataType(const string& dtype) const {
 }
 
 
+bool HumdrumToken::isDataType(int dtypeid) const {
+	return getDataTypeId() == dtypeid;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeId -- Returns the interned ID of the exclusive
+//    interpretation for the token (see the datatype_id enum).  The ID is
+//    stored in the token by HumdrumFileBase::analyzeTracks(), and tokens
+//    which have not been analyzed yet will look up their data type.
+// @SEEALSO: registerDataType getDataTypeName
+//
+
+int HumdrumToken::getDataTypeId(void) const {
+	if (m_datatype != datatype_unknown) {
+		return m_datatype;
+	}
+	return registerDataType(getDataType());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::setDataTypeId -- Set the exclusive interpretation ID
+//    of the token.
+//
+
+void HumdrumToken::setDataTypeId(int dtypeid) {
+	m_datatype = dtypeid;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::registerDataType -- Return the ID of an exclusive
+//    interpretation, giving it the next free ID if it has not been seen
+//    before.  The "**" at the start of the data type is optional.  An
+//    empty string returns datatype_none.
+//
+
+int HumdrumToken::registerDataType(const string& dtype) {
+	if (dtype.empty()) {
+		return datatype_none;
+	}
+	string name;
+	if (dtype.compare(0, 2, "**") == 0) {
+		name = dtype;
+	} else {
+		name = "**" + dtype;
+	}
+	std::lock_guard<std::mutex> lock(getDataTypeMutex());
+	vector<string>& list = getDataTypeList();
+	for (int i=1; i<(int)list.size(); i++) {
+		if (list[i] == name) {
+			return i;
+		}
+	}
+	list.push_back(name);
+	return (int)list.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeName -- Return the exclusive interpretation
+//    for an ID returned by registerDataType(), or an empty string if the
+//    ID is not used.
+//
+
+string HumdrumToken::getDataTypeName(int dtypeid) {
+	std::lock_guard<std::mutex> lock(getDataTypeMutex());
+	vector<string>& list = getDataTypeList();
+	if ((dtypeid < 0) || (dtypeid >= (int)list.size())) {
+		return "";
+	}
+	return list[dtypeid];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeList -- Exclusive interpretations indexed by
+//    their ID.  The entries must match the order of the datatype_id enum.
+//
+
+vector<string>& HumdrumToken::getDataTypeList(void) {
+	static vector<string> list = {
+		"",           // datatype_none
+		"**kern",     // datatype_kern
+		"**mens",     // datatype_mens
+		"**recip",    // datatype_recip
+		"**text",     // datatype_text
+		"**silbe",    // datatype_silbe
+		"**sylb",     // datatype_sylb
+		"**dynam",    // datatype_dynam
+		"**harm"      // datatype_harm
+	};
+	return list;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeMutex -- Used to access the data type list
+//    from more than one thread.
+//
+
+std::mutex& HumdrumToken::getDataTypeMutex(void) {
+	static std::mutex datatypemutex;
+	return datatypemutex;
+}
+
+
 
 //////////////////////////////
 //
@@ -26798,7 +29770,7 @@ bool HumdrumToken::isDataType(const string& dtype) const {
 //
 
 bool HumdrumToken::isKern(void) const {
-	return isDataType("**kern");
+	return getDataTypeId() == datatype_kern;
 }
 
 
@@ -26811,7 +29783,7 @@ bool HumdrumToken::isKern(void) const {
 //
 
 bool HumdrumToken::isMens(void) const {
-	return isDataType("**mens");
+	return getDataTypeId() == datatype_mens;
 }
 
 
@@ -27271,6 +30243,9 @@ HumNum HumdrumToken::getTiedDuration(HumNum scale) {
 //
 
 int HumdrumToken::getDots(char separator) const {
+	if ((separator == ' ') && isNoteInfoCurrent()) {
+		return m_noteinfo->dots;
+	}
 	int count = 0;
 	for (int i=0; i<(int)this->size()-1; i++) {
 		if (this->at(i) == '.') {
@@ -27285,6 +30260,219 @@ int HumdrumToken::getDots(char separator) const {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getNoteInfo -- Return note attributes parsed from the
+//    text of the token.  The attributes are parsed on the first call
+//    and then cached until the text of the token changes.  The pitch
+//    values are the same as those returned by the Convert::kernTo*
+//    functions, which also use this cache when given a token pointer.
+//
+
+const HumNoteInfo& HumdrumToken::getNoteInfo(void) {
+	if (isNoteInfoCurrent()) {
+		return *m_noteinfo;
+	}
+	if (m_noteinfo == NULL) {
+		HumdrumFile* infile = getOwner() ? getOwner()->getOwner() : NULL;
+		if (infile) {
+			HumPoolScope scope(infile->m_pool);
+			m_noteinfo = new HumNoteInfo;
+		} else {
+			m_noteinfo = new HumNoteInfo;
+		}
+	}
+	HumNoteInfo& info = *m_noteinfo;
+	info.length = (uint32_t)this->size();
+	info.hash   = getTextHash(*this);
+
+	const char* text = this->c_str();
+	int length = (int)this->size();
+	int diatonic = -2000;
+	int accid = 0;
+	int uc = 0;
+	int lc = 0;
+	int dots = 0;
+	bool hasrest = false;
+	bool first = true;   // still in first subtoken
+	bool note = false;
+	bool rest = false;
+	bool grace = false;
+	bool tieStart = false;
+	bool tieCont = false;
+	bool tieEnd = false;
+	bool slurStart = false;
+	bool slurEnd = false;
+
+	for (int i=0; i<length; i++) {
+		char ch = text[i];
+		switch (ch) {
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				note = true;
+				if (first) {
+					uc++;
+					if (diatonic == -2000) {
+						diatonic = (ch - 'A' + 5) % 7;
+					}
+				}
+				break;
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+				note = true;
+				if (first) {
+					lc++;
+					if (diatonic == -2000) {
+						diatonic = (ch - 'a' + 5) % 7;
+					}
+				}
+				break;
+			case 'r':
+				rest = true;
+				if (first) {
+					hasrest = true;
+					if (diatonic == -2000) {
+						diatonic = -1000;
+					}
+				}
+				break;
+			case '-': if (first) { accid--; } break;
+			case '#': if (first) { accid++; } break;
+			case '.': if (first && (i < length - 1)) { dots++; } break;
+			case 'q': grace     = true; break;
+			case '[': tieStart  = true; break;
+			case '_': tieCont   = true; break;
+			case ']': tieEnd    = true; break;
+			case '(': slurStart = true; break;
+			case ')': slurEnd   = true; break;
+			case ' ': first     = false; break;
+		}
+	}
+
+	int octave = -1000;
+	if (hasrest || (uc && lc)) {
+		octave = -1000;
+	} else if (uc) {
+		octave = 4 - uc;
+	} else if (lc) {
+		octave = 3 + lc;
+	}
+
+	static const int b40table[7] = {0, 6, 12, 17, 23, 29, 35};
+	static const int b12table[7] = {0, 2, 4, 5, 7, 9, 11};
+
+	info.note        = note;
+	info.rest        = rest;
+	info.null        = (length == 1) && (text[0] == '.');
+	info.grace       = grace;
+	info.tieStart    = tieStart;
+	info.tieCont     = tieCont;
+	info.tieEnd      = tieEnd;
+	info.slurStart   = slurStart;
+	info.slurEnd     = slurEnd;
+	info.diatonic    = diatonic;
+	info.accidentals = accid;
+	info.octave      = octave;
+	info.dots        = dots;
+	if (diatonic < 0) {
+		info.base40PC = diatonic;
+		info.base12PC = diatonic;
+	} else {
+		info.base40PC = b40table[diatonic] + accid + 2;
+		info.base12PC = b12table[diatonic] + accid;
+	}
+
+	return info;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::isNoteInfoCurrent -- Returns true if the note attributes
+//    have been parsed from the current text of the token.  The text can
+//    be changed through the std::string interface as well as setText(),
+//    so its length and hash are compared rather than an edit counter.
+//
+
+bool HumdrumToken::isNoteInfoCurrent(void) const {
+	if (m_noteinfo == NULL) {
+		return false;
+	}
+	if (m_noteinfo->length != (uint32_t)this->size()) {
+		return false;
+	}
+	return m_noteinfo->hash == getTextHash(*this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTextHash -- FNV-1a hash of the token text used to
+//    check if the cached note attributes are still valid.
+//
+
+uint32_t HumdrumToken::getTextHash(const string& text) {
+	uint32_t hash = 2166136261u;
+	for (int i=0; i<(int)text.size(); i++) {
+		hash ^= (unsigned char)text[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+
+//////////////////////////////
+//
+// HumNoteInfo::HumNoteInfo -- Constructor.  The attributes are filled
+//    in by HumdrumToken::getNoteInfo().
+//
+
+HumNoteInfo::HumNoteInfo(void) {
+	length      = 0;
+	hash        = 0;
+	diatonic    = -2000;
+	accidentals = 0;
+	octave      = -1000;
+	dots        = 0;
+	base40PC    = -2000;
+	base12PC    = -2000;
+	note        = false;
+	rest        = false;
+	null        = false;
+	grace       = false;
+	tieStart    = false;
+	tieCont     = false;
+	tieEnd      = false;
+	slurStart   = false;
+	slurEnd     = false;
+}
+
+
+
+//////////////////////////////
+//
+// HumNoteInfo::operator new -- Allocate the note attributes from the
+//    arena of the file which owns the token (see HumdrumToken::getNoteInfo).
+//
+
+void* HumNoteInfo::operator new(size_t size) {
+	return HumPool::allocateObject(size);
+}
+
+
+
+//////////////////////////////
+//
+// HumNoteInfo::operator delete -- Release the memory of the note attributes.
+//
+
+void HumNoteInfo::operator delete(void* ptr) {
+	HumPool::releaseObject(ptr);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getDurationNoDots -- Return the duration of the
@@ -27350,6 +30538,104 @@ HumNum HumdrumToken::getDurationFromStart(HumNum scale) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getTickDuration -- Return the duration of the token in
+//    ticks (see HumdrumFileStructure::tpq()).  Non-rhythmic tokens have
+//    a tick duration of -1.
+//
+
+int64_t HumdrumToken::getTickDuration(void) {
+	HumdrumLine* own = getOwner();
+	if (own) {
+		// make sure that the rhythm of the file has been analyzed:
+		own->getTickFromStart();
+	}
+	return m_tickDuration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickFromStart -- Return the duration in ticks from the
+//    start of the file to the start of the token.
+//
+
+int64_t HumdrumToken::getTickFromStart(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickFromStart();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickToEnd -- Return the duration in ticks from the
+//    start of the token to the end of the file.
+//
+
+int64_t HumdrumToken::getTickToEnd(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickToEnd();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickFromBarline -- Return the duration in ticks from
+//    the previous barline to the start of the token.
+//
+
+int64_t HumdrumToken::getTickFromBarline(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickFromBarline();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTickToBarline -- Return the duration in ticks from
+//    the start of the token to the next barline.
+//
+
+int64_t HumdrumToken::getTickToBarline(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getTickToBarline();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getBarlineTickDuration -- Return the duration in ticks
+//    of the measure which contains the token.
+//
+
+int64_t HumdrumToken::getBarlineTickDuration(void) {
+	HumdrumLine* own = getOwner();
+	if (own == NULL) {
+		return 0;
+	}
+	return own->getBarlineTickDuration();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getDurationToEnd -- Returns the duration from the
@@ -27458,15 +30744,11 @@ HumNum HumdrumToken::getDurationFromBarline(HumNum scale) {
 //
 
 bool HumdrumToken::hasRhythm(void) const {
-	string type = getDataType();
-	if (type == "**kern") {
-		return true;
-	}
-	if (type == "**recip") {
-		return true;
-	}
-	if (type == "**mens") {
-		return true;
+	switch (getDataTypeId()) {
+		case datatype_kern:
+		case datatype_recip:
+		case datatype_mens:
+			return true;
 	}
 	return false;
 }
@@ -27530,9 +30812,9 @@ bool HumdrumToken::equalTo(const string& pattern) {
 
 bool HumdrumToken::isRest(void) {
 	if (isKern()) {
-		if (isNull() && Convert::isKernRest((string)(*resolveNull()))) {
+		if (isNull() && resolveNull()->getNoteInfo().rest) {
 			return true;
-		} else if (Convert::isKernRest((string)(*this))) {
+		} else if (getNoteInfo().rest) {
 			return true;
 		}
 	} else if (isMens()) {
@@ -27555,7 +30837,7 @@ bool HumdrumToken::isRest(void) {
 
 bool HumdrumToken::isNote(void) {
 	if (isKern()) {
-		if (Convert::isKernNote((string)(*this))) {
+		if (getNoteInfo().note) {
 			return true;
 		}
 	} else if (isMens()) {
@@ -27613,7 +30895,7 @@ bool HumdrumToken::isNoteAttack(void) {
 //
 
 bool HumdrumToken::isInvisible(void) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 			return false;
 	}
 	if (isBarline()) {
@@ -27637,12 +30919,12 @@ bool HumdrumToken::isInvisible(void) {
 //
 
 bool HumdrumToken::isGrace(void) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 			return false;
 	}
 	if (!isData()) {
 		return false;
-	} else if (this->find("q") != string::npos) {
+	} else if (getNoteInfo().grace) {
 		return true;
 	}
 
@@ -27657,7 +30939,7 @@ bool HumdrumToken::isGrace(void) {
 //
 
 bool HumdrumToken::isClef(void) {
-	if (!(isDataType("**kern") || isDataType("**mens"))) {
+	if (!(isKern() || isMens())) {
 			return false;
 	}
 	if (!isInterpretation()) {
@@ -27837,8 +31119,8 @@ bool HumdrumToken::isInstrumentAbbreviation(void) {
 //
 
 bool HumdrumToken::hasSlurStart(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurStart((string)(*this))) {
+	if (isKern()) {
+		if (getNoteInfo().slurStart) {
 			return true;
 		}
 	}
@@ -27854,8 +31136,8 @@ bool HumdrumToken::hasSlurStart(void) {
 //
 
 bool HumdrumToken::hasSlurEnd(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurEnd((string)(*this))) {
+	if (isKern()) {
+		if (getNoteInfo().slurEnd) {
 			return true;
 		}
 	}
@@ -27883,7 +31165,8 @@ int HumdrumToken::hasVisibleAccidental(int subtokenIndex) const {
 	if (humfile == NULL) {
 		return -1;
 	}
-	if (!humfile->getValueBool("auto", "accidentalAnalysis")) {
+	static const HumParamKey analysisKey("auto", "accidentalAnalysis");
+	if (!humfile->getValueBool(analysisKey)) {
 		int status = humfile->analyzeKernAccidentals();
 		if (!status) {
 			return -1;
@@ -27913,7 +31196,8 @@ int HumdrumToken::hasCautionaryAccidental(int subtokenIndex) const {
 	if (humfile == NULL) {
 		return -1;
 	}
-	if (!humfile->getValueBool("auto", "accidentalAnalysis")) {
+	static const HumParamKey analysisKey("auto", "accidentalAnalysis");
+	if (!humfile->getValueBool(analysisKey)) {
 		int status = humfile->analyzeKernAccidentals();
 		if (!status) {
 			return -1;
@@ -28036,8 +31320,9 @@ bool HumdrumToken::hasObliquaLigatureEnd(void) {
 //
 
 bool HumdrumToken::isSecondaryTiedNote(void) {
-	if (isDataType("**kern")) {
-		if (Convert::isKernSecondaryTiedNote((string)(*this))) {
+	if (isKern()) {
+		const HumNoteInfo& info = getNoteInfo();
+		if (info.note && (info.tieCont || info.tieEnd)) {
 			return true;
 		}
 	}
@@ -28540,11 +31825,145 @@ void HumdrumToken::setParameters(const string& pdata, HumdrumToken* ptok) {
 
 //////////////////////////////
 //
-// HumdrumToken::setText --
+// HumdrumToken::setText -- Change the text of the token.  If the token
+//    is on a line, then the line is marked as modified so that
+//    HumdrumFileBase::updateLinesFromTokens() only has to regenerate lines
+//    with edited tokens.  The text of the token before its first edit is
+//    kept so that HumdrumFileStructure::analyzeEdits() can decide later
+//    if rhythm or spine re-analysis is needed (see classifyEdit()).
+//    Renaming an exclusive interpretation updates the data-type IDs
+//    stored in the tokens of its track.
 //
 
 void HumdrumToken::setText(const string& text) {
+	if (this->compare(text) == 0) {
+		return;
+	}
+	bool exinterpQ = (this->compare(0, 2, "**") == 0) ||
+			(text.compare(0, 2, "**") == 0);
+	HumdrumLine* line = getOwner();
+	if (line == NULL) {
+		if (exinterpQ) {
+			m_datatype = datatype_unknown;
+		}
+		string::assign(text);
+		return;
+	}
+
+	if (m_edittext == NULL) {
+		m_edittext = new string(*this);
+	}
 	string::assign(text);
+
+	if (exinterpQ) {
+		HumdrumFile* infile = line->getOwner();
+		if (infile) {
+			infile->analyzeDataType(getTrack());
+		}
+	}
+	line->setModified(EDIT_TEXT | EDIT_PENDING);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::classifyEdit -- Compare the text of the token to its
+//    text before it was changed by setText() and return EDIT_RHYTHM or
+//    EDIT_STRUCTURE if the change needs re-analysis of the file, or
+//    EDIT_NONE if only the text changed (see HumdrumLine.h).  The stored
+//    text is then discarded.  Stored token durations are not changed,
+//    since tools may still read the old values until the file is
+//    re-analyzed.
+//
+
+int HumdrumToken::classifyEdit(void) {
+	if (m_edittext == NULL) {
+		return EDIT_NONE;
+	}
+	HumdrumToken oldtoken(*m_edittext);
+	clearEdit();
+	if (oldtoken == *this) {
+		return EDIT_NONE;
+	}
+
+	char oldclass = oldtoken.getEditClass();
+	char newclass = getEditClass();
+	if ((oldclass != newclass) || (oldtoken.isNull() != isNull()) ||
+			oldtoken.isManipulator() || isManipulator()) {
+		return EDIT_STRUCTURE;
+	}
+	if ((newclass == '!') && ((oldtoken.find(':') != string::npos) ||
+			(this->find(':') != string::npos))) {
+		// layout parameters
+		return EDIT_STRUCTURE;
+	}
+	if ((newclass != 'd') || isNull() || !hasRhythm()) {
+		return EDIT_NONE;
+	}
+	if (!(isKern() || isMens())) {
+		// **recip durations are assigned by the owning file.
+		return EDIT_STRUCTURE;
+	}
+	if (getTextDuration(oldtoken) != getTextDuration(*this)) {
+		return EDIT_RHYTHM;
+	}
+	return EDIT_NONE;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::clearEdit -- Forget the text of the token before it
+//    was changed by setText().
+//
+
+void HumdrumToken::clearEdit(void) {
+	if (m_edittext) {
+		delete m_edittext;
+		m_edittext = NULL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTextDuration -- Return the duration of the given text
+//    in the data type of the token, without using the stored duration.
+//
+
+HumNum HumdrumToken::getTextDuration(const string& text) const {
+	if (isMens()) {
+		return Convert::mensToDuration(text);
+	} else if (text.find('q') != string::npos) {
+		return 0;
+	} else {
+		return Convert::recipToDuration(text);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getEditClass -- Returns the type of token used to check
+//    if an edit changes the structure of a line: '*' for interpretations,
+//    '!' for comments, '=' for barlines and 'd' for data tokens.
+//
+
+char HumdrumToken::getEditClass(void) const {
+	if (this->empty()) {
+		return 'd';
+	}
+	switch ((*this)[0]) {
+		case '*':
+		case '!':
+		case '=':
+			return (*this)[0];
+	}
+	return 'd';
 }
 
 
@@ -28612,6 +32031,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 //
 
 bool HumdrumToken::linkedParameterIsGlobal(int index) {
+	checkParameterAnalysis();
 	return m_linkedParameterTokens.at(index)->isCommentGlobal();
 }
 
@@ -28623,6 +32043,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterSetCount(void) {
+	checkParameterAnalysis();
 	return (int)m_linkedParameterTokens.size();
 }
 
@@ -28645,11 +32066,32 @@ HumParamSet* HumdrumToken::getParameterSet(void) {
 //
 
 HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
+	checkParameterAnalysis();
 	return m_linkedParameterTokens.at(index)->getParameterSet();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::checkParameterAnalysis -- Analyze the layout parameters
+//    of the owning file if this has not been done when reading it, so
+//    that the linked parameters of the token are available.
+//
+
+void HumdrumToken::checkParameterAnalysis(void) {
+	HumdrumLine* line = getOwner();
+	if (!line) {
+		return;
+	}
+	HumdrumFile* infile = line->getOwner();
+	if (infile && !infile->areParametersAnalyzed()) {
+		infile->analyzeParameters();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::storeParameterSet -- Store the contents of the token
@@ -28696,6 +32138,26 @@ void HumdrumToken::makeBackwardLink(HumdrumToken& previousToken) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::clearLinkInfo -- Remove spine links and other
+//    analysis state which is generated from the spine structure of the
+//    file.  Used by HumdrumFileBase::analyzeBaseFromTokens() so that the
+//    structure can be analyzed again after tokens have been edited in place.
+//
+
+void HumdrumToken::clearLinkInfo(void) {
+	m_nextTokens.clear();
+	m_previousTokens.clear();
+	m_nextNonNullTokens.clear();
+	m_previousNonNullTokens.clear();
+	m_rhycheck    = 0;
+	m_strand      = -1;
+	m_nullresolve = NULL;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getVisualDuration -- Returns LO:N:vis parameter if it is attached
@@ -29145,10 +32607,21 @@ int HumdrumToken::getState(void) const {
 //
 // HumdrumToken::getStrandIndex -- Returns the 1-D strand index
 //    that the token belongs to in the owning HumdrumFile.
-//    Returns -1 if there is no strand assignment.
+//    Returns -1 if there is no strand assignment.  If the strands of the
+//    owning file have not been analyzed yet, they are analyzed first, so
+//    this const function may change the owning file.
 //
 
 int  HumdrumToken::getStrandIndex(void) const {
+	if (m_strand < 0) {
+		HumdrumLine* hline = getOwner();
+		if (hline) {
+			HumdrumFile* infile = hline->getOwner();
+			if (infile && !infile->areStrandsAnalyzed()) {
+				infile->analyzeStrands();
+			}
+		}
+	}
 	return m_strand;
 }
 
@@ -29163,7 +32636,7 @@ int  HumdrumToken::getStrandIndex(void) const {
 //
 
 int HumdrumToken::getSlurStartElisionLevel(int index) const {
-	if (isDataType("**kern") || isDataType("**mens")) {
+	if (isKern() || isMens()) {
 		return Convert::getKernSlurStartElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -29181,7 +32654,7 @@ int HumdrumToken::getSlurStartElisionLevel(int index) const {
 //
 
 int HumdrumToken::getPhraseStartElisionLevel(int index) const {
-	if (isDataType("**kern") || isDataType("**mens")) {
+	if (isKern() || isMens()) {
 		return Convert::getKernPhraseStartElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -29199,7 +32672,7 @@ int HumdrumToken::getPhraseStartElisionLevel(int index) const {
 //
 
 int HumdrumToken::getSlurEndElisionLevel(int index) const {
-	if (isDataType("**kern") || isDataType("**mens")) {
+	if (isKern() || isMens()) {
 		return Convert::getKernSlurEndElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -29217,7 +32690,7 @@ int HumdrumToken::getSlurEndElisionLevel(int index) const {
 //
 
 int HumdrumToken::getPhraseEndElisionLevel(int index) const {
-	if (isDataType("**kern")) {
+	if (isKern()) {
 		return Convert::getKernPhraseEndElisionLevel((string)(*this), index);
 	} else {
 		return -1;
@@ -29438,7 +32911,7 @@ ostream& HumdrumToken::printXmlBaseInfo(ostream& out, int level,
 	out << "</tokenType>\n";
 
 	// <tokenFunction>
-	if (isDataType("**kern")) {
+	if (isKern()) {
 		if (isNote()) {
 			out << Convert::repeatString(indent, level) << "<tokenFunction>";
 			out << "note" << "</tokenFunction>\n";
@@ -41416,14 +44889,14 @@ string MxmlPart::cleanSpaces(const string& input) {
 
 //////////////////////////////
 //
-// NoteCell::NoteCell -- Constructor.
+// NoteCell::NoteCell -- Constructor.  The pitch information for the
+//     cell is calculated by the owning NoteGrid.
 //
 
 NoteCell::NoteCell(NoteGrid* owner, HTp token) {
 	clear();
 	m_owner = owner;
 	m_token = token;
-	calculateNumericPitches();
 }
 
 
@@ -41436,13 +44909,6 @@ NoteCell::NoteCell(NoteGrid* owner, HTp token) {
 void NoteCell::clear(void) {
 	m_owner = NULL;
 	m_token = NULL;
-	m_b7  = 0;
-	m_b12 = 0;
-	m_b40 = 0;
-	m_accidental = 0;
-	m_nextAttackIndex = -1;
-	m_prevAttackIndex = -1;
-	m_currAttackIndex = -1;
 	m_timeslice = -1;
 	m_voice = -1;
 }
@@ -41451,48 +44917,96 @@ void NoteCell::clear(void) {
 
 //////////////////////////////
 //
-// NoteCell::calculateNumericPitches -- Fills in b7, b12, and b40 variables.
-//    0 = rest, negative values for sustained notes.
+// NoteCell::getSgnDiatonicPitch -- Return the diatonic note number
+//    of the cell.  NaN=rest; negative=sustain.
 //
 
-void NoteCell::calculateNumericPitches(void) {
-	if (!m_token) {
-		m_b40        = NAN;
-		m_b12        = NAN;
-		m_b7         = NAN;
-		m_accidental = NAN;
-		return;
+double NoteCell::getSgnDiatonicPitch(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
 	}
+	return m_owner->m_b7[m_voice][m_timeslice];
+}
 
-	bool sustain = m_token->isNull() || m_token->isSecondaryTiedNote();
-	if (m_token->isRest()) {
-		m_b40 = NAN;
-	} else {
-		HTp resolve = m_token->resolveNull();
-		if (resolve->isRest()) {
-			m_b40 = NAN;
-		} else if (resolve->isNull()) {
-			m_b40 = NAN;
-		} else {
-			m_b40 = Convert::kernToBase40(resolve);
-			m_b40 = (sustain ? -m_b40 : m_b40);
-		}
+
+
+//////////////////////////////
+//
+// NoteCell::getSgnMidiPitch -- Return the MIDI note number of the cell.
+//    NaN=rest; negative=sustain.
+//
+
+double NoteCell::getSgnMidiPitch(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
 	}
+	return m_owner->m_b12[m_voice][m_timeslice];
+}
 
-	// convert to base-7 (diatonic pitch numbers)
-	if (m_b40 > 0) {
-		m_b7         = Convert::base40ToDiatonic((int)m_b40);
-		m_b12        = Convert::base40ToMidiNoteNumber((int)m_b40);
-		m_accidental = Convert::base40ToAccidental((int)m_b40);
-	} else if (m_b40 < 0) {
-		m_b7         = -Convert::base40ToDiatonic(-(int)m_b40);
-		m_b12        = -Convert::base40ToMidiNoteNumber(-(int)m_b40);
-		m_accidental = -Convert::base40ToAccidental(-(int)m_b40);
-	} else {
-		m_b7         = NAN;
-		m_b12        = NAN;
-		m_accidental = NAN;
+
+
+//////////////////////////////
+//
+// NoteCell::getSgnBase40Pitch -- Return the base-40 note number of
+//    the cell.  NaN=rest; negative=sustain.
+//
+
+double NoteCell::getSgnBase40Pitch(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & GRID_REST) {
+		return GRIDREST;
+	}
+	return m_owner->m_b40[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getSgnAccidental -- Return the chromatic alteration of
+//    the diatonic pitch of the cell.  NaN=rest; negative=sustain.
+//
+
+double NoteCell::getSgnAccidental(void) {
+	if (m_owner->m_state[m_voice][m_timeslice] & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
 	}
+	return m_owner->m_accidental[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getPrevAttackIndex -- Return the slice index of the
+//    previous note attack.
+//
+
+int NoteCell::getPrevAttackIndex(void) {
+	return m_owner->m_prevattack[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getCurrAttackIndex -- Return the slice index of the current
+//    note attack (useful for finding the start of a sustained note).
+//
+
+int NoteCell::getCurrAttackIndex(void) {
+	return m_owner->m_currattack[m_voice][m_timeslice];
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell::getNextAttackIndex -- Return the slice index of the next
+//    note attack (or rest), -1 for undefined (interpred as rest).
+//
+
+int NoteCell::getNextAttackIndex(void) {
+	return m_owner->m_nextattack[m_voice][m_timeslice];
 }
 
 
@@ -41539,17 +45053,7 @@ string NoteCell::getAbsKernPitch(void) {
 //
 
 bool NoteCell::isSustained(void) {
-	if (m_b40 < 0) {
-		return true;
-	} else if (m_b40 > 0) {
-		return false;
-	}
-	// calculate if rest is a "sustain" or an "attack"
-	if (m_currAttackIndex == m_timeslice) {
-		return false;
-	} else {
-		return true;
-	}
+	return m_owner->m_state[m_voice][m_timeslice] & GRID_SUSTAIN;
 }
 
 
@@ -41668,8 +45172,7 @@ double NoteCell::getDiatonicIntervalToNextAttack(void) {
 //
 
 bool NoteCell::isRest(void) {
-	// bug in GCC requires :: prefix to resolve two different isnan() defs.
-	return Convert::isNaN(m_b40);
+	return m_owner->m_state[m_voice][m_timeslice] & GRID_REST;
 }
 
 
@@ -41757,12 +45260,13 @@ HumNum NoteCell::getMeterBottom(void) {
 //
 
 double NoteCell::getSgnDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	double b7 = getSgnDiatonicPitch();
+	if (Convert::isNaN(b7)) {
 		return GRIDREST;
-	} else if (m_b7 < 0) {
-		return -(double)(((int)-m_b7) % 7);
+	} else if (b7 < 0) {
+		return -(double)(((int)-b7) % 7);
 	} else {
-		return (double)(((int)m_b7) % 7);
+		return (double)(((int)b7) % 7);
 	}
 }
 
@@ -41774,10 +45278,11 @@ double NoteCell::getSgnDiatonicPitchClass(void) {
 //
 
 double NoteCell::getAbsDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	double b7 = getSgnDiatonicPitch();
+	if (Convert::isNaN(b7)) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b7)) % 7);
+		return (double)(((int)fabs(b7)) % 7);
 	}
 }
 
@@ -41789,12 +45294,13 @@ double NoteCell::getAbsDiatonicPitchClass(void) {
 //
 
 double NoteCell::getSgnBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	double b40 = getSgnBase40Pitch();
+	if (Convert::isNaN(b40)) {
 		return GRIDREST;
-	} else if (m_b40 < 0) {
-		return -(double)(((int)-m_b40) % 40);
+	} else if (b40 < 0) {
+		return -(double)(((int)-b40) % 40);
 	} else {
-		return (double)(((int)m_b40) % 40);
+		return (double)(((int)b40) % 40);
 	}
 }
 
@@ -41806,10 +45312,11 @@ double NoteCell::getSgnBase40PitchClass(void) {
 //
 
 double NoteCell::getAbsBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	double b40 = getSgnBase40Pitch();
+	if (Convert::isNaN(b40)) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b40)) % 40);
+		return (double)(((int)fabs(b40)) % 40);
 	}
 }
 
@@ -41820,10 +45327,7 @@ double NoteCell::getAbsBase40PitchClass(void) {
 //
 
 bool NoteCell::isAttack(void) {
-	if (Convert::isNaN(m_b40)) {
-		return false;
-	}
-	return m_b40>0? true:false;
+	return m_owner->m_state[m_voice][m_timeslice] & GRID_ATTACK;
 }
 
 
@@ -41859,19 +45363,17 @@ NoteGrid::~NoteGrid() {
 void NoteGrid::clear(void) {
 	m_infile = NULL;
 	m_kernspines.clear();
-
-	vector<vector<NoteCell* > >& grid = m_grid;
-	for (int i=0; i<(int)grid.size(); i++) {
-		for (int j=0; j<(int)grid[i].size(); j++) {
-			if (grid[i][j]) {
-				grid[i][j]->clear();
-				delete grid[i][j];
-				grid[i][j] = NULL;
-			}
-		}
-		grid[i].clear();
-	}
-	grid.clear();
+	m_metriclevels.clear();
+	m_cells.clear();
+	m_b7.clear();
+	m_b12.clear();
+	m_b40.clear();
+	m_accidental.clear();
+	m_state.clear();
+	m_prevattack.clear();
+	m_currattack.clear();
+	m_nextattack.clear();
+	m_lines.clear();
 }
 
 
@@ -41882,7 +45384,7 @@ void NoteGrid::clear(void) {
 //
 
 int NoteGrid::getVoiceCount(void) {
-	return (int)m_grid.size();
+	return (int)m_cells.size();
 }
 
 
@@ -41894,11 +45396,7 @@ int NoteGrid::getVoiceCount(void) {
 //
 
 int NoteGrid::getSliceCount(void) {
-	if (m_grid.size() == 0) {
-		return 0;
-	} else {
-		return (int)m_grid[0].size();
-	}
+	return (int)m_lines.size();
 }
 
 
@@ -41919,44 +45417,41 @@ bool NoteGrid::load(HumdrumFile& infile) {
 	m_kernspines = infile.getKernSpineStartList();
 	vector<HTp>& kernspines = m_kernspines;
 
-	vector<int> metertops(infile.getMaxTrack() + 1, 0);
-	vector<HumNum> meterbots(infile.getMaxTrack() + 1, 0);
-
 	if (kernspines.size() == 0) {
 		cerr << "Warning: no **kern spines in file" << endl;
 		return false;
 	}
 
-	vector<vector<NoteCell* > >& grid = m_grid;
-	grid.resize(kernspines.size());
-	for (int i=0; i<(int)grid.size(); i++) {
-		grid[i].reserve(infile.getLineCount());
+	int datacount = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isData()) {
+			datacount++;
+		}
+	}
+
+	// The cells must not be reallocated after they are created, since
+	// tools store pointers to them:
+	int voicecount = (int)kernspines.size();
+	m_cells.resize(voicecount);
+	m_b7.resize(voicecount);
+	m_b12.resize(voicecount);
+	m_b40.resize(voicecount);
+	m_accidental.resize(voicecount);
+	m_state.resize(voicecount);
+	for (int i=0; i<voicecount; i++) {
+		m_cells[i].reserve(datacount);
+		m_b7[i].reserve(datacount);
+		m_b12[i].reserve(datacount);
+		m_b40[i].reserve(datacount);
+		m_accidental[i].reserve(datacount);
+		m_state[i].reserve(datacount);
 	}
+	m_lines.reserve(datacount);
 
 	int attack = 0;
 	int track, lasttrack;
 	vector<HTp> current;
-	HumRegex hre;
 	for (int i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isInterpretation()) {
-			for (int j=0; j<infile[i].getFieldCount(); j++) {
-				if (!infile[i].token(j)->isKern()) {
-					continue;
-				}
-				track = infile.token(i, j)->getTrack();
-				if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)%(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-					meterbots[track] /= hre.getMatchInt(3);
-				} else if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-				} else {
-					continue;
-				}
-
-			}
-		}
 		if (!infile[i].isData()) {
 			continue;
 		}
@@ -41966,7 +45461,7 @@ bool NoteGrid::load(HumdrumFile& infile) {
 		for (int j=0; j<infile[i].getFieldCount(); j++) {
 			lasttrack = track;
 			track = infile.token(i, j)->getTrack();
-			if (!infile[i].token(j)->isDataType("**kern")) {
+			if (!infile[i].token(j)->isKern()) {
 				continue;
 			}
 			if (track == lasttrack) {
@@ -41984,14 +45479,19 @@ bool NoteGrid::load(HumdrumFile& infile) {
 			     << " compared to " << kernspines.size() << endl;
 			return false;
 		}
+		int sindex = (int)m_lines.size();
 		for (int j=0; j<(int)current.size(); j++) {
-			NoteCell* cell = new NoteCell(this, current[j]);
+			m_cells[j].emplace_back(this, current[j]);
+			NoteCell& cell = m_cells[j].back();
 			track = current[j]->getTrack();
-			cell->setVoiceIndex(j);
-			cell->setSliceIndex((int)grid[j].size());
-			cell->setMeter(metertops[track], meterbots[track]);
-			grid[j].push_back(cell);
+			cell.setVoiceIndex(j);
+			cell.setSliceIndex(sindex);
+			// time signatures are parsed in analyzeTimeSignatures():
+			cell.setMeter(infile.getTimeSigTop(i, track),
+					infile.getTimeSigBottom(i, track));
+			appendNumericPitches(j, current[j]);
 		}
+		m_lines.push_back(i);
 	}
 
 	buildAttackIndexes();
@@ -42007,7 +45507,60 @@ bool NoteGrid::load(HumdrumFile& infile) {
 //
 
 NoteCell* NoteGrid::cell(int voiceindex, int sliceindex) {
-	return m_grid.at(voiceindex).at(sliceindex);
+	return &m_cells.at(voiceindex).at(sliceindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::appendNumericPitches -- Add the diatonic, MIDI and base-40
+//    pitches of a token to the columns of a voice.  The values are
+//    negative for sustained notes.
+//
+
+void NoteGrid::appendNumericPitches(int vindex, HTp token) {
+	int b40 = 0;
+	bool rest = false;
+	bool sustain = token->isNull() || token->isSecondaryTiedNote();
+	if (token->isRest()) {
+		rest = true;
+	} else {
+		HTp resolve = token->resolveNull();
+		if (resolve->isRest()) {
+			rest = true;
+		} else if (resolve->isNull()) {
+			rest = true;
+		} else {
+			b40 = Convert::kernToBase40(resolve);
+			b40 = (sustain ? -b40 : b40);
+		}
+	}
+
+	int b7 = 0;
+	int b12 = 0;
+	int accidental = 0;
+	uint8_t state = 0;
+	if (rest) {
+		state = GRID_REST | GRID_NOPITCH;
+	} else if (b40 > 0) {
+		b7         = Convert::base40ToDiatonic(b40);
+		b12        = Convert::base40ToMidiNoteNumber(b40);
+		accidental = Convert::base40ToAccidental(b40);
+		state      = GRID_ATTACK;
+	} else if (b40 < 0) {
+		b7         = -Convert::base40ToDiatonic(-b40);
+		b12        = -Convert::base40ToMidiNoteNumber(-b40);
+		accidental = -Convert::base40ToAccidental(-b40);
+	} else {
+		state = GRID_NOPITCH;
+	}
+
+	m_b7[vindex].push_back((int16_t)b7);
+	m_b12[vindex].push_back((int16_t)b12);
+	m_b40[vindex].push_back((int16_t)b40);
+	m_accidental[vindex].push_back((int16_t)accidental);
+	m_state[vindex].push_back(state);
 }
 
 
@@ -42115,7 +45668,11 @@ void NoteGrid::printKernGrid(ostream& output) {
 //
 
 void NoteGrid::buildAttackIndexes(void) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
+	int slicecount = getSliceCount();
+	m_prevattack.assign(m_cells.size(), vector<int>(slicecount, -1));
+	m_currattack.assign(m_cells.size(), vector<int>(slicecount, -1));
+	m_nextattack.assign(m_cells.size(), vector<int>(slicecount, -1));
+	for (int i=0; i<(int)m_cells.size(); i++) {
 		buildAttackIndex(i);
 	}
 }
@@ -42129,7 +45686,12 @@ void NoteGrid::buildAttackIndexes(void) {
 //
 
 void NoteGrid::buildAttackIndex(int vindex) {
-	vector<NoteCell*>& part = m_grid[vindex];
+	vector<NoteCell>& part  = m_cells[vindex];
+	vector<uint8_t>&  state = m_state[vindex];
+	vector<int16_t>&  b40   = m_b40[vindex];
+	vector<int>&      prev  = m_prevattack[vindex];
+	vector<int>&      curr  = m_currattack[vindex];
+	vector<int>&      next  = m_nextattack[vindex];
 
 	// Set the slice index for the attack of the current note.  This
 	// will be the same as the current slice if the NoteCell is an attack.
@@ -42140,44 +45702,54 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	NoteCell* currentcell = NULL;
 	for (int i=0; i<(int)part.size(); i++) {
 		if (i == 0) {
-			part[0]->setCurrAttackIndex(0);
+			curr[0] = 0;
 			continue;
 		}
-		if (part[i]->isRest()) {
+		if (state[i] & GRID_REST) {
 			// This is a rest, so check for a rest sustain or start
 			// of a rest sequence.
-			if (part[i-1]->isRest()) {
+			if (state[i-1] & GRID_REST) {
 				// rest "sustain"
-				if (currentcell && !part[i]->getToken()->isNull()) {
-					currentcell->m_tiedtokens.push_back(part[i]->getToken());
+				if (currentcell && !part[i].getToken()->isNull()) {
+					currentcell->m_tiedtokens.push_back(part[i].getToken());
 				}
-				part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
+				curr[i] = curr[i-1];
 			} else {
 				// rest "attack";
-				part[i]->setCurrAttackIndex(i);
+				curr[i] = i;
 			}
-		} else if (part[i]->isAttack()) {
-			part[i]->setCurrAttackIndex(i);
-			currentcell = part[i];
+		} else if (state[i] & GRID_ATTACK) {
+			curr[i] = i;
+			currentcell = &part[i];
 		} else {
 			// This is a sustain, so get the attack index of the
 			// note from the previous slice index.
-			part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			if (currentcell && !part[i]->getToken()->isNull()) {
-				currentcell->m_tiedtokens.push_back(part[i]->getToken());
+			curr[i] = curr[i-1];
+			if (currentcell && !part[i].getToken()->isNull()) {
+				currentcell->m_tiedtokens.push_back(part[i].getToken());
 			}
 		}
 	}
 
+	// Mark sustained notes, and rests which are not the first rest in
+	// a sequence of rests:
+	for (int i=0; i<(int)part.size(); i++) {
+		if ((b40[i] < 0) && !(state[i] & GRID_REST)) {
+			state[i] |= GRID_SUSTAIN;
+		} else if ((b40[i] == 0) && (curr[i] != i)) {
+			state[i] |= GRID_SUSTAIN;
+		}
+	}
+
 	// start with note attacks marked in the previous and next note slots:
 	for (int i=0; i<(int)part.size(); i++) {
-		if (part[i]->isAttack()) {
-			part[i]->setNextAttackIndex(i);
-			part[i]->setPrevAttackIndex(i);
-		} else if (part[i]->isRest()) {
-			if (part[i]->getCurrAttackIndex() == i) {
-				part[i]->setNextAttackIndex(i);
-				part[i]->setPrevAttackIndex(i);
+		if (state[i] & GRID_ATTACK) {
+			next[i] = i;
+			prev[i] = i;
+		} else if (state[i] & GRID_REST) {
+			if (curr[i] == i) {
+				next[i] = i;
+				prev[i] = i;
 			}
 		}
 	}
@@ -42186,12 +45758,12 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	int value = -1;
 	int temp  = -1;
 	for (int i=(int)part.size()-1; i>=0; i--) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getNextAttackIndex();
-			part[i]->setNextAttackIndex(value);
+		if (!(state[i] & GRID_SUSTAIN)) {
+			temp = next[i];
+			next[i] = value;
 			value = temp;
 		} else {
-			part[i]->setNextAttackIndex(value);
+			next[i] = value;
 		}
 	}
 
@@ -42199,13 +45771,13 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	value = -1;
 	temp  = -1;
 	for (int i=0; i<(int)part.size(); i++) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getPrevAttackIndex();
-			part[i]->setPrevAttackIndex(value);
+		if (!(state[i] & GRID_SUSTAIN)) {
+			temp = prev[i];
+			prev[i] = value;
 			value = temp;
 		} else {
 			if (i != 0) {
-				part[i]->setPrevAttackIndex(part[i-1]->getPrevAttackIndex());
+				prev[i] = prev[i-1];
 			}
 		}
 	}
@@ -42221,7 +45793,7 @@ void NoteGrid::buildAttackIndex(int vindex) {
 //
 
 double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsDiatonicPitch();
+	return fabs(getSgnDiatonicPitch(vindex, sindex));
 }
 
 
@@ -42233,7 +45805,10 @@ double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnDiatonicPitch();
+	if (m_state.at(vindex).at(sindex) & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
+	}
+	return m_b7[vindex][sindex];
 }
 
 
@@ -42245,7 +45820,7 @@ double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsMidiPitch();
+	return fabs(getSgnMidiPitch(vindex, sindex));
 }
 
 
@@ -42257,7 +45832,10 @@ double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnMidiPitch();
+	if (m_state.at(vindex).at(sindex) & (GRID_REST | GRID_NOPITCH)) {
+		return GRIDREST;
+	}
+	return m_b12[vindex][sindex];
 }
 
 
@@ -42269,7 +45847,7 @@ double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsBase40Pitch();
+	return fabs(getSgnBase40Pitch(vindex, sindex));
 }
 
 
@@ -42281,7 +45859,10 @@ double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnBase40Pitch();
+	if (m_state.at(vindex).at(sindex) & GRID_REST) {
+		return GRIDREST;
+	}
+	return m_b40[vindex][sindex];
 }
 
 
@@ -42293,7 +45874,7 @@ double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsKernPitch();
+	return cell(vindex, sindex)->getAbsKernPitch();
 }
 
 
@@ -42305,7 +45886,7 @@ string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnKernPitch();
+	return cell(vindex, sindex)->getSgnKernPitch();
 }
 
 
@@ -42317,7 +45898,138 @@ string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
 //
 
 HTp NoteGrid::getToken(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getToken();
+	return m_cells.at(vindex).at(sindex).getToken();
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::isRest -- Returns true if the given cell is a rest.
+//
+
+bool NoteGrid::isRest(int vindex, int sindex) {
+	return m_state.at(vindex).at(sindex) & GRID_REST;
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::isSustained -- Returns true if the given cell is a sustained
+//     note, or a rest which is not the first in a sequence of rests.
+//
+
+bool NoteGrid::isSustained(int vindex, int sindex) {
+	return m_state.at(vindex).at(sindex) & GRID_SUSTAIN;
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::isAttack -- Returns true if the given cell is a note attack.
+//
+
+bool NoteGrid::isAttack(int vindex, int sindex) {
+	return m_state.at(vindex).at(sindex) & GRID_ATTACK;
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getPrevAttackIndex -- Return the slice index of the previous
+//     note (or rest) attack for the given cell, or -1 if none.
+//
+
+int NoteGrid::getPrevAttackIndex(int vindex, int sindex) {
+	return m_prevattack.at(vindex).at(sindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getCurrAttackIndex -- Return the slice index of the attack
+//     of the note (or first rest) which the given cell belongs to.
+//
+
+int NoteGrid::getCurrAttackIndex(int vindex, int sindex) {
+	return m_currattack.at(vindex).at(sindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getNextAttackIndex -- Return the slice index of the next
+//     note (or rest) attack for the given cell, or -1 if none.
+//
+
+int NoteGrid::getNextAttackIndex(int vindex, int sindex) {
+	return m_nextattack.at(vindex).at(sindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getDiatonicColumn -- Return the diatonic pitches of all
+//     slices in a voice.  Sustained notes are negative, and rests
+//     are 0 (check the state column for rests).
+//
+
+const vector<int16_t>& NoteGrid::getDiatonicColumn(int vindex) {
+	return m_b7.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getMidiColumn -- Return the MIDI pitches of all slices in
+//     a voice.  Sustained notes are negative, and rests are 0.
+//
+
+const vector<int16_t>& NoteGrid::getMidiColumn(int vindex) {
+	return m_b12.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getBase40Column -- Return the base-40 pitches of all slices
+//     in a voice.  Sustained notes are negative, and rests are 0.
+//
+
+const vector<int16_t>& NoteGrid::getBase40Column(int vindex) {
+	return m_b40.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getStateColumn -- Return the notegrid_state bits (attack,
+//     rest, sustain) of all slices in a voice.
+//
+
+const vector<uint8_t>& NoteGrid::getStateColumn(int vindex) {
+	return m_state.at(vindex);
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::getLineColumn -- Return the line index in the Humdrum file
+//     of each slice.
+//
+
+const vector<int>& NoteGrid::getLineColumn(void) {
+	return m_lines;
 }
 
 
@@ -42331,12 +46043,11 @@ HTp NoteGrid::getToken(int vindex, int sindex) {
 //
 
 int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getPrevAttackIndex();
+	int index = m_prevattack.at(vindex).at(sindex);
 	if (index < 0) {
 		return 0;
 	} else {
-		return (int)this->cell(vindex, index)->getAbsDiatonicPitch();
+		return (int)getAbsDiatonicPitch(vindex, index);
 	}
 }
 
@@ -42351,12 +46062,11 @@ int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getNextAttackIndex();
+	int index = m_nextattack.at(vindex).at(sindex);
 	if (index < 0) {
 		return 0;
 	} else {
-		return (int)(this->cell(vindex, index)->getAbsDiatonicPitch());
+		return (int)getAbsDiatonicPitch(vindex, index);
 	}
 }
 
@@ -42369,10 +46079,10 @@ int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getLineIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_cells.size() == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getLineIndex();
+	return m_lines.at(sindex);
 }
 
 
@@ -42384,10 +46094,10 @@ int NoteGrid::getLineIndex(int sindex) {
 //
 
 int NoteGrid::getFieldIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_cells.size() == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getFieldIndex();
+	return m_cells[0].at(sindex).getToken()->getFieldIndex();
 }
 
 
@@ -44102,7 +47812,7 @@ void Tool_autobeam::breakBeamsByLyrics(HumdrumFile& infile) {
 		HTp curtok = starttok->getNextFieldToken();
 		bool hastext = false;
 		while (curtok && !curtok->isKern()) {
-			if (curtok->isDataType("**text")) {
+			if (curtok->isDataType(datatype_text)) {
 				hastext = true;
 				break;
 			}
@@ -44553,7 +48263,7 @@ void Tool_autobeam::getBeamedNotes(vector<HTp>& toks, HTp tok, HTp stok, HTp eto
 bool Tool_autobeam::hasSyllable(HTp token) {
 	HTp current = token->getNextFieldToken();
 	while (current && !current->isKern()) {
-		if (current->isDataType("**text")) {
+		if (current->isDataType(datatype_text)) {
 			if (current->isNull()) {
 				return false;
 			} else {
@@ -44602,11 +48312,7 @@ void Tool_autobeam::addBeams(HumdrumFile& infile) {
 void Tool_autobeam::initialize(HumdrumFile& infile) {
 	m_splitcount = 0;
 	m_kernspines = infile.getKernSpineStartList();
-	vector<HTp>& ks = m_kernspines;
-	m_timesigs.resize(infile.getTrackCount() + 1);
-	for (int i=0; i<(int)ks.size(); i++) {
-		infile.getTimeSigs(m_timesigs[ks[i]->getTrack()], ks[i]->getTrack());
-	}
+	m_infile = &infile;
 	m_overwriteQ = getBoolean("overwrite");
 	m_track = getInteger("track");
 	m_includerests = getBoolean("include-rests");
@@ -44674,12 +48380,15 @@ void Tool_autobeam::processMeasure(vector<HTp>& measure) {
 	HumNum beatdur(1);
 
 	// First, get the beat positions of all notes in the measure:
-	vector<pair<int, HumNum> >& timesig = m_timesigs[measure[0]->getTrack()];
+	int track = measure[0]->getTrack();
 	for (int i=0; i<(int)measure.size(); i++) {
 		int line = measure[i]->getLineIndex();
-		if ((current.first != timesig[line].first) ||
-		    (current.second != timesig[line].second)) {
-			current = timesig[line];
+		const TimeSigChange* timesig = m_infile->getTimeSigChange(line, track);
+		int top = timesig ? timesig->top : 0;
+		HumNum bottom = timesig ? timesig->bottom : 0;
+		if ((current.first != top) || (current.second != bottom)) {
+			current.first = top;
+			current.second = bottom;
 			beatdur = 1;
 			beatdur /= current.second;
 			beatdur *= 4; // convert to quarter-notes units from whole-notes.
@@ -44786,8 +48495,8 @@ void Tool_autobeam::addBeam(HTp startnote, HTp endnote) {
 			token = token->getNextToken();
 		}
 	}
-	startnote->push_back('L');
-	endnote->push_back('J');
+	startnote->setText(*startnote + "L");
+	endnote->setText(*endnote + "J");
 }
 
 
@@ -46112,6 +49821,7 @@ void Tool_autostem::countBeamStuff(const string& token, int& start, int& stop,
 Tool_binroll::Tool_binroll(void) {
 	// add options here
 	define("t|timebase=s:16", "timebase to do analysis at");
+	define("m|measures=i:0",  "print roll in windows of the given number of measures");
 }
 
 
@@ -46132,30 +49842,26 @@ bool Tool_binroll::run(HumdrumFileSet& infiles) {
 
 bool Tool_binroll::run(const string& indata, ostream& out) {
 	HumdrumFile infile(indata);
-	bool status = run(infile);
-	if (hasAnyText()) {
-		getAllText(out);
-	} else {
-		out << infile;
-	}
-	return status;
+	return run(infile, out);
 }
 
 
+//
+// The roll is written directly to the output stream rather than being
+// stored in the tool's text buffer, so that the memory used by the -m
+// option does not depend on the length of the score.
+//
+
 bool Tool_binroll::run(HumdrumFile& infile, ostream& out) {
-	bool status = run(infile);
-	if (hasAnyText()) {
-		getAllText(out);
-	} else {
-		out << infile;
-	}
-	return status;
+	initialize();
+	processFile(infile, out);
+	return true;
 }
 
 
 bool Tool_binroll::run(HumdrumFile& infile) {
-	m_duration.setValue(1, 4); // 16th note
-	processFile(infile);
+	initialize();
+	processFile(infile, m_free_text);
 	return true;
 }
 
@@ -46163,73 +49869,293 @@ bool Tool_binroll::run(HumdrumFile& infile) {
 
 //////////////////////////////
 //
-// Tool_binroll::processFile --
+// Tool_binroll::initialize --
+//
+
+void Tool_binroll::initialize(void) {
+	m_duration = Convert::recipToDuration(getString("timebase"));
+	if (m_duration <= 0) {
+		m_duration.setValue(1, 4); // 16th note
+	}
+	m_measures = getInteger("measures");
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::processFile -- The piano roll is stored in two bit planes:
+//    m_onsets has a bit for the time step at the start of each note, and
+//    m_sustains has bits for the rest of the time steps during the note.
+//    If the -m option is given, the roll is calculated and printed for
+//    that number of measures at a time, and notes which continue past
+//    the end of a window are carried over to the next one.  Otherwise
+//    the whole score is processed as a single window.
 //
 
-void Tool_binroll::processFile(HumdrumFile& infile) {
-	vector<vector<char>> output;
-	output.resize(128);
+void Tool_binroll::processFile(HumdrumFile& infile, ostream& out) {
+	int tpq = infile.tpq();
+	m_stepnum = (int64_t)m_duration.getNumerator() * tpq;
+	m_stepden = m_duration.getDenominator();
 	int count = (infile.getScoreDuration() / m_duration).getInteger() + 1;
-	for (int i=0; i<(int)output.size(); i++) {
-		output[i].resize(count);
-		std::fill(output[i].begin(), output[i].end(), 0);
+
+	printHeader(infile, out);
+
+	vector<BinrollNote> pending;
+	vector<BinrollNote> carry;
+	vector<BinrollNote> notes;
+	m_windowstart = 0;
+	int startline = 0;
+	while (startline < infile.getLineCount()) {
+		int endline = getWindowEndLine(infile, startline);
+		if (endline < infile.getLineCount()) {
+			m_windowend = getStepIndex(infile[endline].getTickFromStart());
+		} else {
+			m_windowend = count;
+		}
+		clearRoll(m_windowend - m_windowstart);
+
+		carry.clear();
+		for (int i=0; i<(int)pending.size(); i++) {
+			addNote(pending[i], carry);
+		}
+		for (int i=startline; i<endline; i++) {
+			notes.clear();
+			storeLineNotes(notes, infile[i]);
+			for (int j=0; j<(int)notes.size(); j++) {
+				addNote(notes[j], carry);
+			}
+		}
+		pending.swap(carry);
+
+		printRoll(out, m_windowend - m_windowstart);
+		m_windowstart = m_windowend;
+		startline = endline;
 	}
 
-	int strandcount = infile.getStrandCount();
-	for (int i=0; i<strandcount; i++) {
-		HTp starting = infile.getStrandStart(i);
-		if (!starting->isKern()) {
+	printTrailer(infile, out);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::getWindowEndLine -- Return the index of the line which
+//    starts the next window: the barline which ends the m_measures-th
+//    measure after the start line.  If the -m option is not used, then
+//    the line count of the file is returned.
+//
+
+int Tool_binroll::getWindowEndLine(HumdrumFile& infile, int startline) {
+	if (m_measures <= 0) {
+		return infile.getLineCount();
+	}
+	int barcount = 0;
+	for (int i=startline+1; i<infile.getLineCount(); i++) {
+		if (!infile[i].isBarline()) {
 			continue;
 		}
-		HTp ending = infile.getStrandEnd(i);
-		processStrand(output, starting, ending);
+		barcount++;
+		if (barcount >= m_measures) {
+			return i;
+		}
 	}
+	return infile.getLineCount();
+}
+
+
 
-	printAnalysis(infile, output);
+//////////////////////////////
+//
+// Tool_binroll::getStepIndex -- Convert a time in ticks into the index of
+//    the time step that contains it.
+//
 
+int Tool_binroll::getStepIndex(int64_t tick) {
+	return (int)(tick * m_stepden / m_stepnum);
 }
 
 
 
 //////////////////////////////
 //
-// Tool_binroll::printAnalysis --
+// Tool_binroll::storeLineNotes -- Store the notes which start on the given
+//    line in **kern spines.  Rests and null tokens are ignored.
 //
 
-void Tool_binroll::printAnalysis(HumdrumFile& infile,
-		vector<vector<char>>& roll) {
-	HumRegex hre;
-
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isExclusive()) {
-			break;
+void Tool_binroll::storeLineNotes(vector<BinrollNote>& notes, HumdrumLine& line) {
+	if (!line.isData()) {
+		return;
+	}
+	BinrollNote note;
+	int64_t starttick = line.getTickFromStart();
+	note.startindex = getStepIndex(starttick);
+	for (int i=0; i<line.getFieldCount(); i++) {
+		HTp current = line.token(i);
+		if (!current->isKern()) {
+			continue;
 		}
-		if (infile[i].isEmpty()) {
+		if (!current->isNonNullData()) {
 			continue;
 		}
-		string line = infile[i].getText();
-		int found = 0;
-		for (int j=0; j<(int)line.size(); j++) {
-			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
-			} else {
-				found = 1;
-				m_free_text << line[j];
+		if (current->isRest()) {
+			continue;
+		}
+
+		if (current->isChord()) {
+			HumNum starttime = line.getDurationFromStart();
+			int stcount = current->getSubtokenCount();
+			for (int s=0; s<stcount; s++) {
+				string tok = current->getSubtoken(s);
+				note.pitch = Convert::kernToMidiNoteNumber(tok);
+				if ((note.pitch < 0) || (note.pitch > 127)) {
+					continue;
+				}
+				HumNum duration = Convert::recipToDuration(tok);
+				note.endindex = ((starttime+duration) / m_duration).getInteger();
+				notes.push_back(note);
 			}
+		} else {
+			note.pitch = Convert::kernToMidiNoteNumber(current);
+			if ((note.pitch < 0) || (note.pitch > 127)) {
+				continue;
+			}
+			note.endindex = getStepIndex(starttick + current->getTickDuration());
+			notes.push_back(note);
 		}
-		m_free_text << "\n";
 	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::addNote -- Add the part of a note which falls in the
+//    current window to the roll.  Notes which continue after the
+//    window are stored in carry.
+//
+
+void Tool_binroll::addNote(const BinrollNote& note, vector<BinrollNote>& carry) {
+	if ((note.endindex > m_windowend) || (note.startindex >= m_windowend)) {
+		carry.push_back(note);
+	}
+	if (note.startindex >= m_windowend) {
+		return;
+	}
+	int startindex = note.startindex;
+	if (startindex >= m_windowstart) {
+		int index = startindex - m_windowstart;
+		m_onsets[note.pitch][index >> 6] |= (uint64_t)1 << (index & 63);
+	}
+	startindex = std::max(startindex + 1, m_windowstart);
+	int endindex = std::min(note.endindex, m_windowend);
+	setBitRange(m_sustains[note.pitch], startindex - m_windowstart,
+			endindex - m_windowstart);
+}
+
 
-	for (int i=0; i<(int)roll[0].size(); i++) {
-		for (int j=0; j<(int)roll.size(); j++) {
-			m_free_text << (int)roll[j][i];
-			if (j < (int)roll.size() - 1) {
-				m_free_text << ' ';
+
+//////////////////////////////
+//
+// Tool_binroll::clearRoll -- Allocate and clear the bit planes for a window
+//    of the given number of time steps.
+//
+
+void Tool_binroll::clearRoll(int width) {
+	int words = (width + 63) / 64;
+	m_onsets.resize(128);
+	m_sustains.resize(128);
+	for (int i=0; i<128; i++) {
+		m_onsets[i].assign(words, 0);
+		m_sustains[i].assign(words, 0);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::setBitRange -- Set the bits from startindex up to (but not
+//    including) endindex, filling whole words at a time.
+//
+
+void Tool_binroll::setBitRange(vector<uint64_t>& row, int startindex,
+		int endindex) {
+	if (endindex <= startindex) {
+		return;
+	}
+	int startword = startindex >> 6;
+	int endword   = (endindex - 1) >> 6;
+	uint64_t startmask = ~(uint64_t)0 << (startindex & 63);
+	uint64_t endmask   = ~(uint64_t)0 >> (63 - ((endindex - 1) & 63));
+	if (startword == endword) {
+		row[startword] |= startmask & endmask;
+		return;
+	}
+	row[startword] |= startmask;
+	for (int i=startword+1; i<endword; i++) {
+		row[i] = ~(uint64_t)0;
+	}
+	row[endword] |= endmask;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::printRoll -- Print the time steps of the current window,
+//    one line per time step with 128 pitch values: 2 for a note attack,
+//    1 for a sustained note and 0 otherwise.
+//
+
+void Tool_binroll::printRoll(ostream& out, int width) {
+	string line(128 * 2, ' ');
+	line.back() = '\n';
+	for (int i=0; i<width; i++) {
+		int word = i >> 6;
+		uint64_t mask = (uint64_t)1 << (i & 63);
+		for (int j=0; j<128; j++) {
+			if (m_onsets[j][word] & mask) {
+				line[j*2] = '2';
+			} else if (m_sustains[j][word] & mask) {
+				line[j*2] = '1';
+			} else {
+				line[j*2] = '0';
 			}
 		}
-		m_free_text << "\n";
+		out << line;
 	}
+}
 
+
+
+//////////////////////////////
+//
+// Tool_binroll::printHeader -- Print the comments before the start of the
+//    data as "#" comments.
+//
+
+void Tool_binroll::printHeader(HumdrumFile& infile, ostream& out) {
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isExclusive()) {
+			break;
+		}
+		if (infile[i].isEmpty()) {
+			continue;
+		}
+		printComment(infile[i].getText(), out);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::printTrailer -- Print the comments after the end of the
+//    data as "#" comments.
+//
+
+void Tool_binroll::printTrailer(HumdrumFile& infile, ostream& out) {
 	int startindex = infile.getLineCount() - 1;
 	for (int i=infile.getLineCount()-1; i>=0; i--) {
 		if (infile[i].isManipulator()) {
@@ -46243,17 +50169,7 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 		if (infile[i].isEmpty()) {
 			continue;
 		}
-		string line = infile[i].getText();
-		int found = 0;
-		for (int j=0; j<(int)line.size(); j++) {
-			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
-			} else {
-				found = 1;
-				m_free_text << line[j];
-			}
-		}
-		m_free_text << "\n";
+		printComment(infile[i].getText(), out);
 	}
 }
 
@@ -46261,61 +50177,21 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 
 //////////////////////////////
 //
-// Tool_binroll::processStrand --
+// Tool_binroll::printComment -- Print a line with its leading "!"
+//    characters changed to "#".
 //
 
-void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
-		HTp ending) {
-	HTp current = starting;
-	int base12;
-	HumNum starttime;
-	HumNum duration;
-	int startindex;
-	int endindex;
-	while (current && (current != ending)) {
-		if (!current->isNonNullData()) {
-			current = current->getNextToken();
-			continue;
-		}
-		if (current->isRest()) {
-			current = current->getNextToken();
-			continue;
-		}
-
-		if (current->isChord()) {
-			int stcount = current->getSubtokenCount();
-			starttime = current->getDurationFromStart();
-			startindex = (starttime / m_duration).getInteger();
-			for (int s=0; s<stcount; s++) {
-				string tok = current->getSubtoken(s);
-				base12 = Convert::kernToMidiNoteNumber(tok);
-				if ((base12 < 0) || (base12 > 127)) {
-					continue;
-				}
-				duration = Convert::recipToDuration(tok);
-				endindex = ((starttime+duration) / m_duration).getInteger();
-				roll[base12][startindex] = 2;
-				for (int i=startindex+1; i<endindex; i++) {
-					roll[base12][i] = 1;
-				}
-			}
+void Tool_binroll::printComment(const string& line, ostream& out) {
+	int found = 0;
+	for (int j=0; j<(int)line.size(); j++) {
+		if ((line[j] == '!') && !found) {
+			out << "#";
 		} else {
-			base12 = Convert::kernToMidiNoteNumber(current);
-			if ((base12 < 0) || (base12 > 127)) {
-				current = current->getNextToken();
-				continue;
-			}
-			starttime = current->getDurationFromStart();
-			duration = current->getDuration();
-			startindex = (starttime / m_duration).getInteger();
-			endindex   = ((starttime+duration) / m_duration).getInteger();
-			roll[base12][startindex] = 2;
-			for (int i=startindex+1; i<endindex; i++) {
-				roll[base12][i] = 1;
-			}
+			found = 1;
+			out << line[j];
 		}
-		current = current->getNextToken();
 	}
+	out << "\n";
 }
 
 
@@ -49516,8 +53392,7 @@ bool Tool_composite::run(HumdrumFile& infile) {
 	initialize();
 	processFile(infile);
 	infile.createLinesFromTokens();
-	// need to convert to text for now:
-	m_humdrum_text << infile;
+	setModifiedStructure();
 	return true;
 }
 
@@ -49771,6 +53646,7 @@ Tool_dissonant::Tool_dissonant(void) {
 	define("i|x|e|exinterp=s:**cdata","specify exinterp for **cdata spine");
 	define("color|colorize|color-by-rhythm=b", "color dissonant notes by beat level");
 	define("color2|colorize2|color-by-interval=b", "color dissonant notes by dissonant interval");
+	define("threads=i:1",             "number of segments to process in parallel");
 }
 
 
@@ -49921,6 +53797,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 
 			adjustColorization(infile);
 			infile.createLinesFromTokens();
+			setModifiedStructure();
 
 			return true;
 		}
@@ -49949,8 +53826,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 
 		adjustColorization(infile);
 		infile.createLinesFromTokens();
-
-		infile.createLinesFromTokens();
+		setModifiedStructure();
 		return true;
 	} else {
 		if (getBoolean("count")) {
@@ -49967,6 +53843,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 			printColorLegend(infile);
 			adjustColorization(infile);
 			infile.createLinesFromTokens();
+			setModifiedStructure();
 			return true;
 		}
 	}
@@ -56121,9 +59998,24 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 
 
 
+//
+// Tools which edit the input file in place (without generating
+// Humdrum text output) are chained without re-parsing the file.  If
+// such a tool changes the spine or rhythm structure of the file, it
+// calls setModifiedStructure() and the spines are re-analyzed from
+// the edited tokens.  Tools which generate new Humdrum text output
+// have their output parsed as input for the next tool.  In both cases
+// only the spines are analyzed after the tool, and the file is analyzed
+// at the level which the next tool declares (see
+// HumTool::getAnalysisLevel()) before the next tool is run.  The
+// analyses for the analysis level of the file are done after the last
+// tool.
+//
+
 #define RUNTOOL(NAME, INFILE, COMMAND, STATUS)     \
 	Tool_##NAME *tool = new Tool_##NAME;            \
 	tool->process(COMMAND);                         \
+	analyzeInput(INFILE, analyzed, tool->getAnalysisLevel()); \
 	tool->run(INFILE);                              \
 	if (tool->hasError()) {                         \
 		status = false;                              \
@@ -56131,13 +60023,18 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE.readString(tool->getHumdrumText());   \
+		INFILE.readStringNoRhythm(tool->getHumdrumText()); \
+		analyzed = ANALYZE_SPINES;                   \
+	} else if (tool->hasModifiedStructure()) {      \
+		INFILE.analyzeBaseFromTokens();              \
+		analyzed = ANALYZE_SPINES;                   \
 	}                                               \
 	delete tool;
 
 #define RUNTOOL2(NAME, INFILE1, INFILE2, COMMAND, STATUS) \
 	Tool_##NAME *tool = new Tool_##NAME;            \
 	tool->process(COMMAND);                         \
+	analyzeInput(INFILE1, analyzed, tool->getAnalysisLevel()); \
 	tool->run(INFILE1, INFILE2);                    \
 	if (tool->hasError()) {                         \
 		status = false;                              \
@@ -56145,7 +60042,11 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE1.readString(tool->getHumdrumText());  \
+		INFILE1.readStringNoRhythm(tool->getHumdrumText()); \
+		analyzed = ANALYZE_SPINES;                   \
+	} else if (tool->hasModifiedStructure()) {      \
+		INFILE1.analyzeBaseFromTokens();             \
+		analyzed = ANALYZE_SPINES;                   \
 	}                                               \
 	delete tool;
 
@@ -56221,7 +60122,7 @@ bool Tool_filter::runUniversal(HumdrumFileSet& infiles) {
 		} else if (commands[i].first == "chooser") {
 			RUNTOOLSET(chooser, infiles, commands[i].second, status);
 		} else if (commands[i].first == "myank") {
-			RUNTOOL(myank, infiles, commands[i].second, status);
+			RUNTOOLSET(myank, infiles, commands[i].second, status);
 		}
 	}
 
@@ -56245,6 +60146,9 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 	HumdrumFile& infile = infiles[0];
 
 	bool status = true;
+	// analyses which are up to date for the current contents of infile
+	// (the input file is given to the first tool as it is):
+	int analyzed = ANALYZE_ALL;
 	vector<pair<string, string> > commands;
 	getCommandList(commands, infile);
 	for (int i=0; i<(int)commands.size(); i++) {
@@ -56331,6 +60235,8 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 		}
 	}
 
+	analyzeInput(infile, analyzed, infile.getAnalysisLevel());
+
 	removeGlobalFilterLines(infile);
 
 	// Re-load the text for each line from their tokens in case any
@@ -56341,6 +60247,34 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// Tool_filter::analyzeInput -- Analyze the file at the given level (see
+//    the ANALYZE_* defines in HumdrumFileBase.h) if some of the analyses
+//    are not up to date since the file was last changed by a tool.
+//    The analyses which are done are added to analyzed.  The analysis
+//    level stored in the file is not changed.
+//
+
+void Tool_filter::analyzeInput(HumdrumFile& infile, int& analyzed, int level) {
+	if (level & ANALYZE_RHYTHM) {
+		level |= ANALYZE_PARAMETERS;
+	}
+	if (level & ANALYZE_PARAMETERS) {
+		level |= ANALYZE_STRANDS;
+	}
+	if ((level & ~analyzed) == 0) {
+		return;
+	}
+	int filelevel = infile.getAnalysisLevel();
+	infile.setAnalysisLevel(level);
+	infile.analyzeStructure();
+	infile.setAnalysisLevel(filelevel);
+	analyzed |= level;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_filter::removeGlobalFilterLines --
@@ -57320,6 +61254,8 @@ Tool_humdiff::Tool_humdiff(void) {
 	define("time-points|times=b", "display timepoint lists for each file");
 	define("note-points|notes=b", "display notepoint lists for each file");
 	define("c|color=s:red",       "color for difference markers");
+	define("b|band=i:256",        "maximum drift between files in timepoints when aligning");
+	define("threads=i:1",         "number of input files to parse in parallel");
 }
 
 
@@ -57349,15 +61285,6 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 		cerr << "Usage: " << getCommand() << " files" << endl;
 		return false;
 	} else {
-		HumNum targetdur = infiles[0].getScoreDuration();
-		for (int i=1; i<infiles.getSize(); i++) {
-			HumNum dur = infiles[i].getScoreDuration();
-			if (dur != targetdur) {
-				cerr << "Error: all files must have the same duration" << endl;
-				return false;
-			}
-		}
-
 		for (int i=0; i<infiles.getCount(); i++) {
 			if (i == reference) {
 				continue;
@@ -57419,67 +61346,295 @@ void Tool_humdiff::printTimePoints(vector<TimePoint>& timepoints) {
 
 //////////////////////////////
 //
-// Tool_humdiff::compareTimePoints --
+// Tool_humdiff::compareTimePoints -- Align the timepoints of the two files
+//    (see alignTimePoints()), and then compare the notes at each aligned
+//    pair of timepoints.  Notes in the reference file at timepoints which
+//    do not have an equivalent timepoint in the other file are marked
+//    as differences.
 //
 
 void Tool_humdiff::compareTimePoints(vector<vector<TimePoint>>& timepoints,
 		HumdrumFile& reference, HumdrumFile& alternate) {
-	vector<int> indexes(timepoints.size(), 0);
-	HumNum minval;
-	HumNum value;
-	int found;
-
 	vector<HumdrumFile*> infiles(2, NULL);
 	infiles[0] = &reference;
 	infiles[1] = &alternate;
 
-	vector<int> increment(timepoints.size(), 0);
+	vector<pair<int, int>> alignment;
+	alignTimePoints(alignment, timepoints);
 
-	while ((1)) {
-		if (indexes.at(0) >= (int)timepoints.at(0).size()) {
-			// at the end of the list of notes for the first file.
-			// break from the comparison for now and figure out how
-			// to report differences of added notes in the other file(s)
-			// later.
-			break;
+	vector<int> indexes(timepoints.size(), -1);
+	for (int i=0; i<(int)alignment.size(); i++) {
+		indexes.at(0) = alignment[i].first;
+		indexes.at(1) = alignment[i].second;
+		if (indexes.at(0) >= 0) {
+			TimePoint& tp = timepoints.at(0).at(indexes.at(0));
+			tp.index.resize(timepoints.size());
+			tp.index.at(1) = -1;
+			if (indexes.at(1) >= 0) {
+				tp.index.at(1) = timepoints.at(1).at(indexes.at(1)).index.at(0);
+			}
 		}
-		timepoints.at(0).at(indexes.at(0)).index.resize(timepoints.size());
-		for (int i=1; i<(int)timepoints.size(); i++) {
-			timepoints.at(0).at(indexes.at(0)).index.at(i) = -1;
+		compareLines(indexes, timepoints, infiles);
+	}
+
+	if (getBoolean("report")) {
+		reportMeasureGaps(alignment, timepoints);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignTimePoints -- Find the lowest-cost alignment of the
+//    timepoints in two files, so that an added or missing measure in one
+//    file does not shift the comparison of all later notes.  Each entry
+//    in the alignment is a pair of indexes into timepoints[0] and
+//    timepoints[1], where -1 means that the timepoint in the other file
+//    has no equivalent.  Matching two timepoints costs the number of
+//    notes which are only in one of them (see getMatchCost()), and
+//    skipping a timepoint costs its number of notes plus one.
+//
+//    The dynamic program is limited to a band of cells around the
+//    diagonal between the start and end of both files (--band option),
+//    so time and memory grow linearly with the length of the files.
+//    Each cell of the band stores only its traceback direction.  If the
+//    files drift apart by more than the band, such as when one file has
+//    many more measures than the other, the alignment is the best one
+//    inside of the band, and a warning is given.
+//
+
+void Tool_humdiff::alignTimePoints(vector<pair<int, int>>& alignment,
+		vector<vector<TimePoint>>& timepoints) {
+	alignment.clear();
+	int rows = (int)timepoints.at(0).size();
+	int cols = (int)timepoints.at(1).size();
+
+	vector<vector<vector<pair<int, HumNum>>>> notes(2);
+	vector<vector<HumNum>> durations(2);
+	for (int i=0; i<2; i++) {
+		notes[i].resize(timepoints.at(i).size());
+		durations[i].resize(timepoints.at(i).size());
+		for (int j=0; j<(int)timepoints.at(i).size(); j++) {
+			TimePoint& tp = timepoints.at(i).at(j);
+			getTimePointNotes(notes[i][j], tp);
+			durations[i][j] = (*tp.file.at(0))[tp.index.at(0)].getDuration();
 		}
-		minval = timepoints.at(0).at(indexes.at(0)).timestamp;
-		for (int i=1; i<(int)timepoints.size(); i++) {
-			if (indexes.at(i) >= (int)timepoints.at(i).size()) {
-				continue;
+	}
+
+	// The band must be at least as wide as the average number of
+	// timepoints in the second file for each timepoint in the first file
+	// so that neighboring rows of the band overlap.  It is not widened
+	// further for files with very different lengths, since the time would
+	// then grow with the product of the length and the difference; instead
+	// a warning is given if the best alignment touches the edge of the band.
+	int band = getInteger("band");
+	if (band < 1) {
+		band = 1;
+	}
+	if (rows > 0) {
+		band = std::max(band, cols / rows + 2);
+	}
+
+	// Row i of the band contains the columns [lo[i], hi[i]] centered on
+	// the diagonal.
+	vector<int> lo(rows + 1);
+	vector<int> hi(rows + 1);
+	vector<int64_t> offset(rows + 2, 0);
+	for (int i=0; i<=rows; i++) {
+		int center = rows ? (int)((int64_t)i * cols / rows) : cols;
+		lo[i] = std::max(0, center - band);
+		hi[i] = std::min(cols, center + band);
+		if (i == 0) {
+			lo[i] = 0;
+		}
+		if (i == rows) {
+			hi[i] = cols;
+		}
+		offset[i+1] = offset[i] + (hi[i] - lo[i] + 1);
+	}
+
+	// Traceback directions: 0 = match both timepoints, 1 = skip the
+	// timepoint in the first file, 2 = skip the timepoint in the second file.
+	vector<uint8_t> trace(offset[rows+1], 0);
+
+	const int infinity = std::numeric_limits<int>::max() / 2;
+	vector<int> previous(cols + 1, infinity);
+	vector<int> current(cols + 1, infinity);
+
+	for (int i=0; i<=rows; i++) {
+		for (int j=lo[i]; j<=hi[i]; j++) {
+			int best = infinity;
+			uint8_t direction = 0;
+			if ((i == 0) && (j == 0)) {
+				best = 0;
+			}
+			if ((i > 0) && (j > 0) && (j-1 >= lo[i-1]) && (j-1 <= hi[i-1])) {
+				int cost = previous[j-1] + getMatchCost(notes[0][i-1],
+						durations[0][i-1], notes[1][j-1], durations[1][j-1]);
+				if (cost < best) {
+					best = cost;
+					direction = 0;
+				}
+			}
+			if ((i > 0) && (j >= lo[i-1]) && (j <= hi[i-1])) {
+				int cost = previous[j] + (int)notes[0][i-1].size() + 1;
+				if (cost < best) {
+					best = cost;
+					direction = 1;
+				}
 			}
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
-			if (value < minval) {
-				minval = value;
+			if ((j > lo[i])) {
+				int cost = current[j-1] + (int)notes[1][j-1].size() + 1;
+				if (cost < best) {
+					best = cost;
+					direction = 2;
+				}
 			}
+			current[j] = best;
+			trace[offset[i] + j - lo[i]] = direction;
 		}
-		found = 0;
-		fill(increment.begin(), increment.end(), 0);
-
-		for (int i=0; i<(int)timepoints.size(); i++) {
-			if (indexes.at(i) >= (int)timepoints.at(i).size()) {
-				// index is too large for file, so skip checking it.
-				continue;
+		if (i > 0) {
+			for (int j=lo[i-1]; j<=hi[i-1]; j++) {
+				previous[j] = infinity;
 			}
-			found = 1;
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
+		}
+		for (int j=lo[i]; j<=hi[i]; j++) {
+			previous[j] = current[j];
+			current[j] = infinity;
+		}
+	}
 
-			if (value == minval) {
-				timepoints.at(0).at(indexes.at(0)).index.at(i) = timepoints.at(i).at(indexes.at(i)).index.at(0);
-				increment.at(i)++;
-			}
+	int i = rows;
+	int j = cols;
+	bool truncated = false;
+	while ((i > 0) || (j > 0)) {
+		if (((j == lo[i]) && (j > 0)) || ((j == hi[i]) && (j < cols))) {
+			truncated = true;
 		}
-		if (!found) {
-			break;
+		uint8_t direction = trace[offset[i] + j - lo[i]];
+		if ((direction == 0) && (i > 0) && (j > 0)) {
+			alignment.emplace_back(i-1, j-1);
+			i--;
+			j--;
+		} else if ((direction == 1) || (j == 0)) {
+			alignment.emplace_back(i-1, -1);
+			i--;
 		} else {
-			compareLines(minval, indexes, timepoints, infiles);
+			alignment.emplace_back(-1, j-1);
+			j--;
+		}
+	}
+	std::reverse(alignment.begin(), alignment.end());
+
+	if (truncated) {
+		m_warning_text << "Warning: the alignment of the files reached the edge "
+		               << "of the band (" << band << " timepoints), so the files "
+		               << "may be better aligned with a larger --band value."
+		               << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getTimePointNotes -- Return a sorted list of the pitches
+//    (base-40) and tied durations of notes which start at the timepoint.
+//
+
+void Tool_humdiff::getTimePointNotes(vector<pair<int, HumNum>>& notes,
+		TimePoint& tp) {
+	vector<NotePoint> notelist;
+	getNoteList(notelist, *tp.file.at(0), tp.index.at(0), tp.measure, 0, -1);
+	notes.resize(notelist.size());
+	for (int i=0; i<(int)notelist.size(); i++) {
+		notes[i].first = notelist[i].b40;
+		notes[i].second = notelist[i].duration;
+	}
+	std::sort(notes.begin(), notes.end());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getMatchCost -- Return the cost of aligning two timepoints:
+//    the number of notes which are found at only one of the timepoints,
+//    plus one if the durations of the timepoints differ.  The note lists
+//    must be sorted.
+//
+
+int Tool_humdiff::getMatchCost(vector<pair<int, HumNum>>& notes1, HumNum dur1,
+		vector<pair<int, HumNum>>& notes2, HumNum dur2) {
+	int cost = (dur1 == dur2) ? 0 : 1;
+	int i = 0;
+	int j = 0;
+	while ((i < (int)notes1.size()) && (j < (int)notes2.size())) {
+		if (notes1[i] < notes2[j]) {
+			cost++;
+			i++;
+		} else if (notes2[j] < notes1[i]) {
+			cost++;
+			j++;
+		} else {
+			i++;
+			j++;
+		}
+	}
+	cost += (int)notes1.size() - i;
+	cost += (int)notes2.size() - j;
+	return cost;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::reportMeasureGaps -- Report measures for which none of the
+//    timepoints have an equivalent in the other file (measures which
+//    were added to or removed from the second file).
+//
+
+void Tool_humdiff::reportMeasureGaps(vector<pair<int, int>>& alignment,
+		vector<vector<TimePoint>>& timepoints) {
+	for (int f=0; f<2; f++) {
+		// paired[i] is true if timepoint i of file f has an equivalent:
+		vector<bool> paired(timepoints.at(f).size(), false);
+		for (int i=0; i<(int)alignment.size(); i++) {
+			int index = f ? alignment[i].second : alignment[i].first;
+			int other = f ? alignment[i].first : alignment[i].second;
+			if ((index >= 0) && (other >= 0)) {
+				paired[index] = true;
+			}
 		}
-		for (int i=0; i<(int)increment.size(); i++) {
-			indexes.at(i) += increment.at(i);
+		int start = 0;
+		while (start < (int)timepoints.at(f).size()) {
+			int measure = timepoints.at(f).at(start).measure;
+			int end = start;
+			bool found = false;
+			while ((end < (int)timepoints.at(f).size()) &&
+					(timepoints.at(f).at(end).measure == measure)) {
+				found |= paired[end];
+				end++;
+			}
+			if (!found) {
+				HumdrumFile& infile = *timepoints.at(f).at(start).file.at(0);
+				int line = timepoints.at(f).at(start).index.at(0);
+				if (f == 0) {
+					cout << "MEASURE " << measure
+					     << " OF REFERENCE IS MISSING IN SOURCE 1" << endl;
+					cout << "\tREFERENCE LINE NO.\t: " << line+1 << endl;
+					cout << "\tREFERENCE LINE TEXT\t: " << infile[line] << endl;
+				} else {
+					cout << "MEASURE " << measure
+					     << " OF SOURCE 1 IS MISSING IN REFERENCE" << endl;
+					cout << "\tTARGET  1 LINE NO. :\t" << line+1 << endl;
+					cout << "\tTARGET  1 LINE TEXT:\t" << infile[line] << endl;
+				}
+				cout << endl;
+			}
+			start = end;
 		}
 	}
 }
@@ -57534,10 +61689,12 @@ void Tool_humdiff::markNote(NotePoint& np) {
 
 //////////////////////////////
 //
-// Tool_humdiff::compareLines --
+// Tool_humdiff::compareLines -- Compare the notes at a pair of aligned
+//    timepoints.  An index of -1 means that the file does not have an
+//    equivalent timepoint.
 //
 
-void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
+void Tool_humdiff::compareLines(vector<int>& indexes,
 		vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles) {
 
 	bool reportQ = getBoolean("report");
@@ -57548,11 +61705,7 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 	// Note: timepoints size must be 2
 	// and infiles size must be 2
 	for (int i=0; i<(int)timepoints.size(); i++) {
-		if (indexes.at(i) >= (int)timepoints.at(i).size()) {
-			continue;
-		}
-		if (timepoints.at(i).at(indexes.at(i)).timestamp != minval) {
-			// not at the same time
+		if (indexes.at(i) < 0) {
 			continue;
 		}
 
@@ -57569,6 +61722,10 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 		for (int j=1; j<(int)notelist.size(); j++) {
 			int status = findNoteInList(notelist.at(0).at(i), notelist.at(j));
 			notelist.at(0).at(i).matched.at(j) = status;
+			if (status >= 0) {
+				// do not match the same note twice:
+				notelist.at(j).at(status).processed = 1;
+			}
 			if ((status < 0) && !reportQ) {
 				markNote(notelist.at(0).at(i));
 			}
@@ -57598,17 +61755,32 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 				cout << "\tREFERENCE LINE NO.\t: " << humindex+1 << endl;
 				cout << "\tREFERENCE LINE TEXT\t: " << (*infiles[0])[humindex] << endl;
 
+				int targetindex = -1;
+				if (indexes.at(j) >= 0) {
+					targetindex = timepoints.at(j).at(indexes.at(j)).index.at(0);
+				}
+
 				cout << "\tTARGET  " << j << " LINE NO. ";
 				if (j < 10) {
 					cout << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				cout << ":\t";
+				if (targetindex >= 0) {
+					cout << targetindex+1 << endl;
+				} else {
+					cout << "X" << endl;
+				}
 
 				cout << "\tTARGET  " << j << " LINE TEXT";
 				if (j < 10) {
 					cout << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				cout << ":\t";
+				if (targetindex >= 0) {
+					cout << (*infiles[j])[targetindex] << endl;
+				} else {
+					cout << "X" << endl;
+				}
 
 				cout << endl;
 			}
@@ -57678,7 +61850,7 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 			notelist.back().subtoken = subtok;
 			notelist.back().subindex = j;
 			notelist.back().measurequarter = token->getDurationFromBarline();
-			notelist.back().measure =
+			notelist.back().measure = measure;
 			notelist.back().track = track;
 			notelist.back().layer = layer;
 			notelist.back().sourceindex = sourceindex;
@@ -58971,9 +63143,6 @@ void Tool_humsort::processFile(HumdrumFile& infile) {
 
 
 
-int Tool_imitation::Enumerator = 0;
-
-
 /////////////////////////////////
 //
 // Tool_imitation::Tool_imitation -- Set the recognized options for the tool.
@@ -59057,7 +63226,7 @@ bool Tool_imitation::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_imitation::run(HumdrumFile& infile) {
-	Enumerator = 0;
+	m_enumerator = 0;
 
 	NoteGrid grid(infile);
 
@@ -59066,7 +63235,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		// return 1;
 	}
 
-	Enumerator = 0;
+	m_enumerator = 0;
 	m_threshold = getInteger("threshold") + 1;
 	if (m_threshold < 3) {
 		m_threshold = 3;
@@ -59162,7 +63331,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 			infile.insertDataSpineBefore(track, results.at(i-1), "", exinterp);
 		}
 	}
-	if (m_mark && Enumerator) {
+	if (m_mark && m_enumerator) {
 		string rdfline = "!!!RDF**kern: ";
 		rdfline += m_marker;
 		rdfline += " = marked note (color=\"chocolate\")";
@@ -59175,8 +63344,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		}
 	}
 	infile.createLinesFromTokens();
-	// new data spines not showing up after createLinesFromTokens(), so force to text for now:
-	m_humdrum_text << infile;
+	setModifiedStructure();
 	return true;
 }
 
@@ -59261,20 +63429,82 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 	vector<int> enum1(v1a.size(), 0);
 	vector<int> enum2(v2a.size(), 0);
 
+	// Group the start positions in the second voice by their first
+	// interval.  compareSequences() can only return a non-zero count when
+	// the first intervals match, so the other positions do not have to
+	// be compared (and do not affect the skipping over partial matches).
+	// Also group them by their first min-1 intervals: a match needs at
+	// least that many matching intervals, so only these positions can
+	// start a match (candidates).
+	int keysize = min - 1;
+	map<double, vector<int>> positions;
+	std::unordered_map<string, vector<int>> candidates;
+	for (int j=0; j<(int)v2i.size() - 1; j++) {
+		if (Convert::isNaN(v2i.at(j))) {
+			// sequences cannot start with rests
+			continue;
+		}
+		if (m_rest2) {
+			if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+				// match target must be preceded by a rest (or start of music)
+				continue;
+			}
+		}
+		positions[v2i.at(j)].push_back(j);
+		if (j + keysize <= (int)v2i.size()) {
+			candidates[getIntervalKey(v2i, j, keysize, false)].push_back(j);
+		}
+	}
+
 	for (int i=0; i<(int)v1i.size() - 1; i++) {
+		if (m_rest || m_rest2) {
+			if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
+				// match initiator must be preceded by a rest (or start of music)
+				continue;
+			}
+		}
+		if (Convert::isNaN(v1i.at(i))) {
+			continue;
+		}
+		if (i + keysize > (int)v1i.size()) {
+			continue;
+		}
+		auto cfound = candidates.find(getIntervalKey(v1i, i, keysize, m_inversion));
+		if (cfound == candidates.end()) {
+			continue;
+		}
+		vector<int>& clist = cfound->second;
+		vector<int>& jlist = positions[m_inversion ? -v1i.at(i) : v1i.at(i)];
 		count = 0;
-		for (int j=0; j<(int)v2i.size() - 1; j++) {
-			if (m_rest || m_rest2) {
-				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
-					// match initiator must be preceded by a rest (or start of music)
-					continue;
-				}
+		int nextj = 0;
+		int c = 0;
+		int jumped = -1;
+		for (int p=0; p<(int)jlist.size(); p++) {
+			while ((c < (int)clist.size()) && (clist[c] < jlist[p])) {
+				c++;
+			}
+			if (c >= (int)clist.size()) {
+				// no more matches are possible
+				break;
 			}
-			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
-					// match target must be preceded by a rest (or start of music)
-					continue;
+			if (jumped != c) {
+				// Jump to the last position before the next candidate
+				// which follows a gap of at least min positions.  Positions
+				// before the gap are not candidates, so they skip at most
+				// min-1 positions and cannot skip over the position after
+				// the gap.
+				jumped = c;
+				int target = (int)(std::lower_bound(jlist.begin() + p, jlist.end(),
+						clist[c]) - jlist.begin());
+				while ((target > p) && (jlist[target-1] > jlist[target] - min)) {
+					target--;
 				}
+				p = target;
+			}
+			int j = jlist[p];
+			if (j < nextj) {
+				// skipped over by the previous comparison
+				continue;
 			}
 			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
 				// avoid re-matching an existing match as a submatch
@@ -59285,7 +63515,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				count = checkForIntervalSequence(m_intervals, v1i, i, count);
 			}
 			if (count < min) {
-				j += count;
+				nextj = j + count + 1;
 				continue;
 			}
 
@@ -59298,14 +63528,14 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 			HumNum distance2 = time1 - time2;
 
 			if (m_maxdistanceQ && (distance1.getAbs().getFloat() > m_maxdistance)) {
-				j += count;
+				nextj = j + count + 1;
 				continue;
 			}
 
-			Enumerator++;
+			m_enumerator++;
 			for (int k=0; k<count; k++) {
-				enum1.at(i+k) = Enumerator;
-				enum2.at(j+k) = Enumerator;
+				enum1.at(i+k) = m_enumerator;
+				enum2.at(j+k) = m_enumerator;
 			}
 
 			int interval = int(*attacks.at(v2).at(j) - *attacks.at(v1).at(i));
@@ -59328,7 +63558,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v1).at(line1) += "n";
 						}
-						results.at(v1).at(line1) += to_string(Enumerator);
+						results.at(v1).at(line1) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -59435,7 +63665,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v2).at(line2) += "n";
 						}
-						results.at(v2).at(line2) += to_string(Enumerator);
+						results.at(v2).at(line2) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -59562,13 +63792,42 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 			}
 
 			// skip over match (need to do in i as well somehow)
-			j += count;
+			nextj = j + count + 1;
 		} // j loop
 	} // i loop
 }
 
 
 
+//////////////////////////////
+//
+// Tool_imitation::getIntervalKey -- Return a hash key for a sequence
+//    of intervals (inverted if negate is true).  Rests (NaN) are equal
+//    to each other as in compareSequences().
+//
+
+string Tool_imitation::getIntervalKey(vector<double>& intervals, int start,
+		int count, bool negate) {
+	string key;
+	key.resize(count * sizeof(double));
+	for (int i=0; i<count; i++) {
+		double value = intervals.at(start + i);
+		if (Convert::isNaN(value)) {
+			value = NAN;
+		} else if (negate) {
+			value = -value;
+		}
+		if (value == 0.0) {
+			// do not distinguish between -0.0 and 0.0
+			value = 0.0;
+		}
+		memcpy(&key[i * sizeof(double)], &value, sizeof(double));
+	}
+	return key;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_imitation::markedTiedNotes --
@@ -60091,6 +64350,7 @@ void Tool_kernview::processFile(HumdrumFile& infile) {
 
 	int line = kernish[0]->getLineIndex();
 	infile[line].createLineFromTokens();
+	setModifiedStructure();
 
 }
 
@@ -65150,6 +69410,10 @@ Tool_msearch::Tool_msearch(void) {
 	define("x|cross=b",         "search across parts");
 	define("c|color=s",         "highlight color");
 	define("m|mark|marker=s:@", "marking character");
+	define("index=s",           "n-gram index of the input files (skip files without matches)");
+	define("query-file=s",      "file of music queries, one per line");
+	define("l|list=b",          "list matches rather than marking them");
+	define("threads=i:1",       "number of segments to process in parallel");
 }
 
 
@@ -65192,21 +69456,42 @@ bool Tool_msearch::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_msearch::run(HumdrumFile& infile) {
-	NoteGrid grid(infile);
-	if (getBoolean("debug")) {
-		grid.printGridInfo(cerr);
-		// return 1;
-	}
 	initialize();
 
 	if (getBoolean("text")) {
 		m_text = getString("text");
 	}
 
+	if (m_text.empty() && !loadQueries()) {
+		return false;
+	}
+	if (m_text.empty() && getBoolean("list")) {
+		suppressHumdrumFileOutput();
+	}
+
+	if (getBoolean("index") && !loadIndex()) {
+		return false;
+	}
+
+	vector<MSearchPosting> candidates;
+	bool indexQ = false;
+	if (m_text.empty() && getBoolean("index")) {
+		indexQ = getIndexCandidates(infile, candidates);
+		if (indexQ && candidates.empty() && !getBoolean("debug")) {
+			// No matches in file, so do not create the note grid.  The
+			// file is printed unchanged as when there are no matches.
+			return true;
+		}
+	}
+
+	NoteGrid grid(infile);
+	if (getBoolean("debug")) {
+		grid.printGridInfo(cerr);
+		// return 1;
+	}
+
 	if (m_text.empty()) {
-		vector<MSearchQueryToken> query;
-		fillMusicQuery(query, getString("query"));
-		doMusicSearch(infile, grid, query);
+		doMusicSearch(infile, grid, indexQ ? &candidates : NULL);
 	} else {
 		vector<MSearchTextQuery> query;
 		fillTextQuery(query, getString("text"));
@@ -65230,6 +69515,158 @@ void Tool_msearch::initialize(void) {
 
 
 
+//////////////////////////////
+//
+// Tool_msearch::loadQueries -- Parse the music queries the first time
+//    that they are needed, and compile them into the matcher.  Returns
+//    false if the query file cannot be read.
+//
+
+bool Tool_msearch::loadQueries(void) {
+	if (m_queriesloaded) {
+		return true;
+	}
+	m_queries.clear();
+	m_querystrings.clear();
+	m_matcher.clear();
+	if (getBoolean("query-file")) {
+		ifstream input(getString("query-file").c_str());
+		if (!input.is_open()) {
+			m_error_text << "Error: cannot read query file "
+			             << getString("query-file") << endl;
+			return false;
+		}
+		string line;
+		while (getline(input, line)) {
+			if (!line.empty() && (line.back() == '\r')) {
+				line.pop_back();
+			}
+			if (line.empty()) {
+				continue;
+			}
+			m_querystrings.push_back(line);
+		}
+	} else {
+		m_querystrings.push_back(getString("query"));
+	}
+	m_queries.resize(m_querystrings.size());
+	for (int i=0; i<(int)m_querystrings.size(); i++) {
+		fillMusicQuery(m_queries[i], m_querystrings[i]);
+		m_matcher.addQuery(m_queries[i]);
+	}
+	m_queriesloaded = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::loadIndex -- Read the n-gram index given by the --index
+//    option the first time that it is needed, and look up the locations
+//    of the music queries in all of the indexed files.  Returns false if
+//    the index cannot be read.
+//
+
+bool Tool_msearch::loadIndex(void) {
+	if (m_indexloaded) {
+		return true;
+	}
+	if (!m_index.read(getString("index"))) {
+		m_error_text << "Error: cannot read index file "
+		             << getString("index") << endl;
+		return false;
+	}
+	m_indexloaded = true;
+	if (!m_text.empty()) {
+		return true;
+	}
+	// The candidates are the locations of any of the queries.  If one
+	// of the queries is too short to be looked up, all files are
+	// searched completely.
+	m_indexusable = true;
+	m_candidates.clear();
+	vector<MSearchPosting> matches;
+	for (int i=0; i<(int)m_queries.size(); i++) {
+		if (!m_index.search(m_queries[i], matches)) {
+			m_indexusable = false;
+			m_candidates.clear();
+			break;
+		}
+		m_candidates.insert(m_candidates.end(), matches.begin(), matches.end());
+	}
+	sort(m_candidates.begin(), m_candidates.end());
+	m_candidates.erase(unique(m_candidates.begin(), m_candidates.end()),
+			m_candidates.end());
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::filterFileList -- Remove the input files which are in
+//    the index (--index option) but have no possible matches for the
+//    music queries, so that they do not need to be read at all.  Files
+//    which are not in the index are kept and searched completely.
+//    Returns false if the list cannot be filtered, in which case it is
+//    not changed.
+//
+
+bool Tool_msearch::filterFileList(vector<string>& files) {
+	if (!getBoolean("index") || getBoolean("text") || getBoolean("debug")) {
+		return false;
+	}
+	if (!loadQueries() || !loadIndex() || !m_indexusable) {
+		return false;
+	}
+	// Filenames can be repeated in the index, so use the names of the
+	// files with candidates rather than their indexes:
+	std::unordered_set<string> matched;
+	for (int i=0; i<(int)m_candidates.size(); i++) {
+		matched.insert(m_index.getFileName(m_candidates[i].file));
+	}
+	vector<string> output;
+	for (int i=0; i<(int)files.size(); i++) {
+		if ((m_index.getFileIndex(files[i]) < 0) ||
+				(matched.find(files[i]) != matched.end())) {
+			output.push_back(files[i]);
+		}
+	}
+	files.swap(output);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::getIndexCandidates -- Return the possible match locations
+//    in a file as found in the index.  Returns false if the index cannot
+//    be used, either because the file is not in the index or because
+//    a query is too short, in which case the whole file is searched.
+//
+
+bool Tool_msearch::getIndexCandidates(HumdrumFile& infile,
+		vector<MSearchPosting>& candidates) {
+	candidates.clear();
+	if (!m_indexusable) {
+		return false;
+	}
+	int findex = m_index.getFileIndex(infile.getFilename());
+	if (findex < 0) {
+		return false;
+	}
+	auto first = lower_bound(m_candidates.begin(), m_candidates.end(),
+			MSearchPosting(findex, 0, 0));
+	auto last = lower_bound(first, m_candidates.end(),
+			MSearchPosting(findex + 1, 0, 0));
+	candidates.assign(first, last);
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::fillWords --
@@ -65354,6 +69791,7 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 		}
 		infile.appendLine(content);
 		infile.createLinesFromTokens();
+		setModifiedStructure();
 	}
 
 	for (int i=0; i<(int)words.size(); i++) {
@@ -65367,38 +69805,60 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 //////////////////////////////
 //
 // Tool_msearch::doMusicSearch -- do a basic melodic search of all parts.
+//    All queries are searched for in one pass through each voice.  If
+//    a list of candidates from the index is given, then only the voices
+//    which contain a candidate location are searched.
 //
 
 void Tool_msearch::doMusicSearch(HumdrumFile& infile, NoteGrid& grid,
-		vector<MSearchQueryToken>& query) {
+		vector<MSearchPosting>* candidates) {
 
-	vector<vector<NoteCell*>> attacks;
-	attacks.resize(grid.getVoiceCount());
-	for (int i=0; i<grid.getVoiceCount(); i++) {
-		grid.getNoteAndRestAttacks(attacks[i], i);
+	vector<bool> searchvoice(grid.getVoiceCount(), candidates == NULL);
+	if (candidates) {
+		for (int k=0; k<(int)candidates->size(); k++) {
+			int i = candidates->at(k).voice;
+			if ((i >= 0) && (i < (int)searchvoice.size())) {
+				searchvoice[i] = true;
+			}
+		}
 	}
 
-	vector<NoteCell*>  match;
+	bool listQ = getBoolean("list");
+	vector<NoteCell*> attacks;
+	vector<NoteCell*> match;
+	vector<MSearchMatch> matches;
 	int mcount = 0;
-	for (int i=0; i<(int)attacks.size(); i++) {
-		for (int j=0; j<(int)attacks[i].size(); j++) {
-			checkForMatchDiatonicPC(attacks[i], j, query, match);
-			if (!match.empty()) {
-				mcount++;
+	for (int i=0; i<grid.getVoiceCount(); i++) {
+		if (!searchvoice[i]) {
+			continue;
+		}
+		grid.getNoteAndRestAttacks(attacks, i);
+		m_matcher.search(attacks, matches);
+		for (int j=0; j<(int)matches.size(); j++) {
+			match.clear();
+			match.push_back(attacks[matches[j].start]);
+			if (matches[j].end < 0) {
+				match.push_back(NULL);
+			} else {
+				match.push_back(attacks[matches[j].end]);
+			}
+			mcount++;
+			if (listQ) {
+				printMatch(infile, matches[j].query, match);
+			} else {
 				markMatch(infile, match);
-				// cerr << "FOUND MATCH AT " << i << ", " << j << endl;
-				// markNotes(attacks[i], j, (int)query.size());
 			}
 		}
 	}
 
-	if (mcount) {
+	if (mcount && !listQ) {
 		string content = "!!!RDF**kern: " + m_marker + " = marked note";
 		if (getBoolean("color")) {
 			content += ", color=\"" + getString("color") + "\"";
 		}
 		infile.appendLine(content);
 		infile.createLinesFromTokens();
+		setModifiedStructure();
 	}
 }
 
@@ -65448,6 +69908,28 @@ void Tool_msearch::markMatch(HumdrumFile& infile, vector<NoteCell*>& match) {
 
 
 
+//////////////////////////////
+//
+// Tool_msearch::printMatch -- List the location of a match (filename,
+//    query, and line and field number of the first note).
+//
+
+void Tool_msearch::printMatch(HumdrumFile& infile, int query,
+		vector<NoteCell*>& match) {
+	if (match.empty()) {
+		return;
+	}
+	HTp mstart = match[0]->getToken();
+	m_free_text << infile.getFilename() << '\t' << m_querystrings.at(query);
+	if (mstart) {
+		m_free_text << '\t' << mstart->getLineNumber()
+		            << '\t' << mstart->getFieldNumber();
+	}
+	m_free_text << endl;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::markTextMatch -- assumes monophonic voices.
@@ -65765,6 +70247,758 @@ void Tool_msearch::fillMusicQuery(vector<MSearchQueryToken>& query,
 
 
 
+//////////////////////////////
+//
+// MSearchIndex::MSearchIndex -- Constructor.
+//
+
+MSearchIndex::MSearchIndex(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::~MSearchIndex -- Deconstructor.
+//
+
+MSearchIndex::~MSearchIndex() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::clear -- Remove all files from the index.
+//
+
+void MSearchIndex::clear(void) {
+	m_files.clear();
+	m_fileindex.clear();
+	m_postings.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::setNgramLength -- Set the number of attacks in each
+//    index key (default 3).  Changing the length clears the index.
+//
+
+void MSearchIndex::setNgramLength(int length) {
+	if (length < 1) {
+		length = 1;
+	}
+	if (length != m_ngram) {
+		clear();
+		m_ngram = length;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNgramLength -- Return the number of attacks in
+//    each index key.
+//
+
+int MSearchIndex::getNgramLength(void) const {
+	return m_ngram;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addFile -- Add the n-grams of diatonic pitch classes in
+//    all voices of a file to the index.  The attacks are counted in the
+//    same way as in Tool_msearch::doMusicSearch (notes and first rest
+//    slices).  Returns the index of the file.
+//
+
+int MSearchIndex::addFile(HumdrumFile& infile) {
+	NoteGrid grid(infile);
+	return addFile(infile.getFilename(), grid);
+}
+
+
+int MSearchIndex::addFile(const string& filename, NoteGrid& grid) {
+	int findex = (int)m_files.size();
+	m_files.push_back(filename);
+	m_fileindex.emplace(filename, findex);
+
+	vector<NoteCell*> attacks;
+	string symbols;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		symbols.clear();
+		for (int a=0; a<(int)attacks.size(); a++) {
+			symbols += getNoteSymbol(attacks[a]);
+		}
+		for (int a=0; a+m_ngram<=(int)symbols.size(); a++) {
+			m_postings[symbols.substr(a, m_ngram)].emplace_back(findex, v, a);
+		}
+	}
+	return findex;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::write -- Save the index to a file or to an output
+//    stream.  The format is:
+//       MSearchIndex   1
+//       ngram          <n-gram length>
+//       file           <filename>   (one line for each file, in order)
+//    followed by one line for each n-gram, sorted:
+//       <n-gram>   <file>,<voice>,<attack>   ...
+//
+
+bool MSearchIndex::write(const string& indexfile) const {
+	std::ofstream output(indexfile.c_str(), std::ios::out | std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	write(output);
+	output.close();
+	return !output.fail();
+}
+
+
+ostream& MSearchIndex::write(ostream& out) const {
+	out << "MSearchIndex\t1\n";
+	out << "ngram\t" << m_ngram << "\n";
+	for (int i=0; i<(int)m_files.size(); i++) {
+		out << "file\t" << m_files[i] << "\n";
+	}
+	vector<string> keys;
+	keys.reserve(m_postings.size());
+	for (auto& it : m_postings) {
+		keys.push_back(it.first);
+	}
+	sort(keys.begin(), keys.end());
+	for (int i=0; i<(int)keys.size(); i++) {
+		const vector<MSearchPosting>& postings = m_postings.at(keys[i]);
+		out << keys[i];
+		for (int j=0; j<(int)postings.size(); j++) {
+			out << (j == 0 ? '\t' : ' ') << postings[j].file << ','
+			    << postings[j].voice << ',' << postings[j].attack;
+		}
+		out << '\n';
+	}
+	return out;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::read -- Load an index from a file or from an input
+//    stream.  Returns false if the input is not an msearch index.
+//
+
+bool MSearchIndex::read(const string& indexfile) {
+	ifstream input(indexfile.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	return read(input);
+}
+
+
+bool MSearchIndex::read(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line.compare(0, 13, "MSearchIndex\t") != 0)) {
+		return false;
+	}
+	while (getline(input, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		if (line.compare(0, 6, "ngram\t") == 0) {
+			m_ngram = atoi(line.c_str() + 6);
+			if (m_ngram < 1) {
+				clear();
+				return false;
+			}
+			continue;
+		}
+		if (line.compare(0, 5, "file\t") == 0) {
+			int findex = (int)m_files.size();
+			m_files.push_back(line.substr(5));
+			m_fileindex.emplace(m_files.back(), findex);
+			continue;
+		}
+		// n-gram entry: key followed by comma-separated postings
+		size_t tab = line.find('\t');
+		if (tab == string::npos) {
+			clear();
+			return false;
+		}
+		vector<MSearchPosting>& postings = m_postings[line.substr(0, tab)];
+		const char* ptr = line.c_str() + tab;
+		char* end;
+		while ((*ptr == '\t') || (*ptr == ' ')) {
+			MSearchPosting posting;
+			posting.file = (int)strtol(ptr + 1, &end, 10);
+			if (*end != ',') {
+				clear();
+				return false;
+			}
+			posting.voice = (int)strtol(end + 1, &end, 10);
+			if (*end != ',') {
+				clear();
+				return false;
+			}
+			posting.attack = (int)strtol(end + 1, &end, 10);
+			postings.push_back(posting);
+			ptr = end;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileCount -- Return the number of indexed files.
+//
+
+int MSearchIndex::getFileCount(void) const {
+	return (int)m_files.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileIndex -- Return the index of a file, or -1 if
+//    the file is not in the index.
+//
+
+int MSearchIndex::getFileIndex(const string& filename) const {
+	auto it = m_fileindex.find(filename);
+	if (it == m_fileindex.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileName -- Return the filename of an indexed file.
+//
+
+const string& MSearchIndex::getFileName(int index) const {
+	static string empty;
+	if ((index < 0) || (index >= (int)m_files.size())) {
+		return empty;
+	}
+	return m_files[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNgramCount -- Return the number of different n-grams
+//    in the index.
+//
+
+int MSearchIndex::getNgramCount(void) const {
+	return (int)m_postings.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::search -- Find the possible match locations of a
+//    music query.  The longest run of pitches/rests in the query is
+//    looked up, and the returned postings give the attack indexes where
+//    Tool_msearch::checkForMatchDiatonicPC has to be tried (the rest of
+//    the query, such as rhythms, intervals and accidentals, has to be
+//    checked in the file).  The matches are sorted by file.  Returns
+//    false if the query does not contain enough pitches to use the index.
+//
+
+bool MSearchIndex::search(const vector<MSearchQueryToken>& query,
+		vector<MSearchPosting>& matches) const {
+	matches.clear();
+	string symbols;
+	int offset = getLongestPitchRun(query, symbols);
+	if ((int)symbols.size() < m_ngram) {
+		return false;
+	}
+
+	int count = (int)symbols.size() - m_ngram + 1;
+	vector<const vector<MSearchPosting>*> lists(count, NULL);
+	int best = 0;
+	for (int k=0; k<count; k++) {
+		auto it = m_postings.find(symbols.substr(k, m_ngram));
+		if (it == m_postings.end()) {
+			// no matches in any file
+			return true;
+		}
+		lists[k] = &it->second;
+		if (lists[k]->size() < lists[best]->size()) {
+			best = k;
+		}
+	}
+
+	// Start with the n-gram that has the fewest postings, and check that
+	// the other n-grams follow it:
+	for (int i=0; i<(int)lists[best]->size(); i++) {
+		const MSearchPosting& posting = lists[best]->at(i);
+		int start = posting.attack - best;
+		if (start - offset < 0) {
+			continue;
+		}
+		bool found = true;
+		for (int k=0; k<count; k++) {
+			if (k == best) {
+				continue;
+			}
+			MSearchPosting target(posting.file, posting.voice, start + k);
+			if (!binary_search(lists[k]->begin(), lists[k]->end(), target)) {
+				found = false;
+				break;
+			}
+		}
+		if (found) {
+			matches.emplace_back(posting.file, posting.voice, start - offset);
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getLongestPitchRun -- Return the symbols of the longest
+//    run of consecutive pitch/rest tokens in a query.  Query tokens are
+//    mapped to attacks in the same way as in
+//    Tool_msearch::checkForMatchDiatonicPC.  The return value is the attack
+//    offset of the run from the start of a match.
+//
+
+int MSearchIndex::getLongestPitchRun(const vector<MSearchQueryToken>& query,
+		string& symbols) const {
+	symbols.clear();
+	int offset = 0;
+	string current;
+	int currentoffset = 0;
+	bool lastIsInterval = false;
+	int c = 0;
+	for (int i=0; i<(int)query.size(); i++) {
+		char symbol = 0;
+		if (query[i].anything) {
+			// matches any note
+		} else if (query[i].base <= 0) {
+			lastIsInterval = true;
+		} else {
+			if (lastIsInterval) {
+				c++;
+				lastIsInterval = false;
+			}
+			symbol = getQuerySymbol(query[i]);
+		}
+		if (!symbol) {
+			current.clear();
+			continue;
+		}
+		if (current.empty()) {
+			currentoffset = i - c;
+		}
+		current += symbol;
+		if (current.size() > symbols.size()) {
+			symbols = current;
+			offset = currentoffset;
+		}
+	}
+	return offset;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNoteSymbol -- Return the index symbol of a note
+//    attack: c, d, e, f, g, a or b for the diatonic pitch class, or r for
+//    rests.
+//
+
+char MSearchIndex::getNoteSymbol(NoteCell* cell) {
+	static const char* letters = "cdefgab";
+	double dpc = cell->getAbsDiatonicPitchClass();
+	if (Convert::isNaN(dpc)) {
+		return 'r';
+	}
+	return letters[(int)dpc % 7];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getQuerySymbol -- Return the index symbol for a pitch
+//    or rest query token, or 0 if the token does not have a pitch.
+//
+
+char MSearchIndex::getQuerySymbol(const MSearchQueryToken& token) {
+	static const char* letters = "cdefgab";
+	if (Convert::isNaN(token.pc)) {
+		return 'r';
+	}
+	if (token.pc < 0) {
+		return 0;
+	}
+	if (token.base == 40) {
+		return letters[Convert::base40ToDiatonic((int)token.pc) % 7];
+	} else if (token.base == 7) {
+		return letters[(int)token.pc % 7];
+	}
+	return 0;
+}
+
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::MSearchMatcher -- Constructor.
+//
+
+MSearchMatcher::MSearchMatcher(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::~MSearchMatcher -- Deconstructor.
+//
+
+MSearchMatcher::~MSearchMatcher() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::clear -- Remove all queries.
+//
+
+void MSearchMatcher::clear(void) {
+	m_queries.clear();
+	m_bitcount = 0;
+	m_bitquery.clear();
+	m_start.clear();
+	m_final.clear();
+	m_dpcrows.assign(8, vector<uint64_t>());
+	m_b40rows.assign(41, vector<uint64_t>());
+	m_b40dirrows.assign(4, vector<uint64_t>());
+	m_midirows.assign(4, vector<uint64_t>());
+	m_durrows.clear();
+	m_durother.clear();
+	m_durations.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::addQuery -- Compile a query into the matcher (a
+//    bit-parallel Shift-And automaton with one state bit for each attack
+//    of each query).  Query tokens are mapped to attacks, and checked
+//    against the notes, in the same way as in
+//    Tool_msearch::checkForMatchDiatonicPC.  Returns the index of the
+//    query.
+//
+
+int MSearchMatcher::addQuery(const vector<MSearchQueryToken>& query) {
+	int qindex = (int)m_queries.size();
+
+	vector<int> positions(query.size());
+	bool lastIsInterval = false;
+	int c = 0;
+	for (int i=0; i<(int)query.size(); i++) {
+		if (query[i].anything) {
+			// matches any note
+		} else if (query[i].base <= 0) {
+			lastIsInterval = true;
+		} else if (lastIsInterval) {
+			// pitch is checked at the same note as the interval
+			c++;
+			lastIsInterval = false;
+		}
+		positions[i] = i - c;
+	}
+
+	QueryInfo info;
+	info.tokens = (int)query.size();
+	info.length = (int)query.size() - c;
+	info.firstbit = m_bitcount;
+	m_queries.push_back(info);
+	if (info.length == 0) {
+		return qindex;
+	}
+
+	m_bitcount += info.length;
+	m_bitquery.resize(m_bitcount, qindex);
+	int words = (m_bitcount + 63) / 64;
+	m_start.resize(words, 0);
+	m_final.resize(words, 0);
+	resizeRows(m_dpcrows, words);
+	resizeRows(m_b40rows, words);
+	resizeRows(m_b40dirrows, words);
+	resizeRows(m_midirows, words);
+	resizeRows(m_durrows, words);
+	m_durother.resize(words, ~0ULL);
+
+	int bit = info.firstbit;
+	m_start[bit / 64] |= 1ULL << (bit % 64);
+	bit = info.firstbit + info.length - 1;
+	m_final[bit / 64] |= 1ULL << (bit % 64);
+
+	for (int i=0; i<(int)query.size(); i++) {
+		const MSearchQueryToken& token = query[i];
+		bit = info.firstbit + positions[i];
+		if (token.anything) {
+			continue;
+		}
+		if (token.base <= 0) {
+			// gross contour (rhythm is not checked)
+			if (token.direction > 0) {
+				restrictBit(m_midirows, bit, 0);
+			} else if (token.direction < 0) {
+				restrictBit(m_midirows, bit, 1);
+			} else {
+				restrictBit(m_midirows, bit, 2);
+			}
+			continue;
+		}
+
+		int pc = Convert::isNaN(token.pc) ? -1 : (int)token.pc;
+		if (token.base == 40) {
+			if (Convert::isNaN(token.pc)) {
+				pc = 40;
+			} else if ((pc < 0) || (pc >= 40)) {
+				pc = -1;
+			}
+			restrictBit(m_b40rows, bit, pc);
+		} else {
+			if (Convert::isNaN(token.pc)) {
+				pc = 7;
+			} else if ((pc < 0) || (pc >= 7)) {
+				pc = -1;
+			}
+			restrictBit(m_dpcrows, bit, pc);
+		}
+
+		// direction is not checked for the first note of a voice (3):
+		if (token.direction > 0) {
+			restrictBit(m_b40dirrows, bit, 0, 3);
+		} else if (token.direction < 0) {
+			restrictBit(m_b40dirrows, bit, 1, 3);
+		}
+
+		if (!token.rhythm.empty()) {
+			int row = getDurationRow(token.duration);
+			restrictBit(m_durrows, bit, row);
+			m_durother[bit / 64] &= ~(1ULL << (bit % 64));
+		}
+	}
+
+	return qindex;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::getQueryCount -- Return the number of queries.
+//
+
+int MSearchMatcher::getQueryCount(void) const {
+	return (int)m_queries.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::resizeRows -- Add state words to each row of a
+//     feature table.  New query attacks accept all features until
+//     they are restricted.
+//
+
+void MSearchMatcher::resizeRows(vector<vector<uint64_t>>& rows, int words) {
+	for (int i=0; i<(int)rows.size(); i++) {
+		rows[i].resize(words, ~0ULL);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::restrictBit -- Clear a state bit in all rows of a
+//     feature table except for the allowed rows.
+//
+
+void MSearchMatcher::restrictBit(vector<vector<uint64_t>>& rows, int bit,
+		int allowed, int allowed2) {
+	uint64_t mask = ~(1ULL << (bit % 64));
+	for (int i=0; i<(int)rows.size(); i++) {
+		if ((i == allowed) || (i == allowed2)) {
+			continue;
+		}
+		rows[i][bit / 64] &= mask;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::getDurationRow -- Return the row in m_durrows for a
+//     duration, adding a new row if the duration is not in any previous
+//     query.
+//
+
+int MSearchMatcher::getDurationRow(HumNum duration) {
+	for (int i=0; i<(int)m_durations.size(); i++) {
+		if (m_durations[i] == duration) {
+			return i;
+		}
+	}
+	m_durations.push_back(duration);
+	// a new duration is accepted by the same attacks as other durations:
+	m_durrows.push_back(m_durother);
+	return (int)m_durrows.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::search -- Find all matches of all queries in a list of
+//     note and rest attacks with one pass through the list.  Matches are
+//     sorted by their last note, and then by query index.
+//
+
+void MSearchMatcher::search(vector<NoteCell*>& notes,
+		vector<MSearchMatch>& matches) {
+	matches.clear();
+	int count = (int)notes.size();
+	int words = (int)m_start.size();
+	vector<uint64_t> state(words, 0);
+
+	for (int k=0; k<count; k++) {
+		NoteCell* note = notes[k];
+
+		double value = note->getAbsDiatonicPitchClass();
+		int dpc = Convert::isNaN(value) ? 7 : (int)value;
+		value = note->getAbsBase40PitchClass();
+		int b40 = Convert::isNaN(value) ? 40 : (int)value;
+		int b40dir = 3;
+		int mididir = 3;
+		if (k > 0) {
+			int interval = (int)(note->getAbsBase40Pitch() -
+					notes[k-1]->getAbsBase40Pitch());
+			b40dir = interval > 0 ? 0 : (interval < 0 ? 1 : 2);
+			double midi = note->getAbsMidiPitch();
+			double lastmidi = notes[k-1]->getAbsMidiPitch();
+			if (midi > lastmidi) {
+				mididir = 0;
+			} else if (midi < lastmidi) {
+				mididir = 1;
+			} else if (midi == lastmidi) {
+				mididir = 2;
+			}
+		}
+		const uint64_t* durrow = m_durother.data();
+		if (!m_durations.empty()) {
+			HumNum duration = note->getDuration();
+			for (int i=0; i<(int)m_durations.size(); i++) {
+				if (m_durations[i] == duration) {
+					durrow = m_durrows[i].data();
+					break;
+				}
+			}
+		}
+		const uint64_t* dpcrow = m_dpcrows[dpc].data();
+		const uint64_t* b40row = m_b40rows[b40].data();
+		const uint64_t* b40dirrow = m_b40dirrows[b40dir].data();
+		const uint64_t* midirow = m_midirows[mididir].data();
+
+		uint64_t carry = 0;
+		for (int w=0; w<words; w++) {
+			uint64_t next = (state[w] << 1) | carry | m_start[w];
+			carry = state[w] >> 63;
+			state[w] = next & dpcrow[w] & b40row[w] & b40dirrow[w] &
+					midirow[w] & durrow[w];
+			uint64_t found = state[w] & m_final[w];
+			while (found) {
+				int b = 0;
+				while (!(found & (1ULL << b))) {
+					b++;
+				}
+				found &= ~(1ULL << b);
+				int qindex = m_bitquery[w * 64 + b];
+				addMatch(matches, qindex, k - m_queries[qindex].length + 1, count);
+			}
+		}
+
+		// Empty queries match at every note:
+		for (int q=0; q<(int)m_queries.size(); q++) {
+			if (m_queries[q].length == 0) {
+				addMatch(matches, q, k, count);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::addMatch -- Store a match if the query fits before the
+//     end of the voice.  The length check and the note after the match
+//     follow Tool_msearch::checkForMatchDiatonicPC, which counts query
+//     tokens rather than attacks.
+//
+
+void MSearchMatcher::addMatch(vector<MSearchMatch>& matches, int query,
+		int start, int count) {
+	const QueryInfo& info = m_queries[query];
+	if (start + info.tokens > count) {
+		return;
+	}
+	int end = -1;
+	if (start + info.tokens < count) {
+		end = start + info.length;
+	}
+	matches.emplace_back(query, start, end);
+}
+
+
+
+
 //////////////////////////////
 //
 // Tool_musedata2hum::Tool_musedata2hum --
@@ -74728,13 +79962,32 @@ void Tool_periodicity::printPeriodicityAnalysis(ostream& out, vector<vector<doub
 
 //////////////////////////////
 //
-// Tool_periodicity::doPeriodicAnalysis --
+// Tool_periodicity::doPeriodicAnalysis -- Fold the attack grid at each
+//    period from 1 to minrhy.  At fine rhythmic resolutions most of the
+//    grid is empty, so in that case only the attack positions are folded,
+//    which gives the same sums without visiting every grid element for
+//    every period.
 //
 
 void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, vector<double>& grid, HumNum minrhy) {
 	analysis.resize(minrhy.getNumerator());
+
+	vector<int> positions;
+	vector<double> weights;
+	for (int i=0; i<(int)grid.size(); i++) {
+		if (grid[i] != 0.0) {
+			positions.push_back(i);
+			weights.push_back(grid[i]);
+		}
+	}
+
+	bool sparseQ = (int)positions.size() * 8 < (int)grid.size();
 	for (int i=0; i<(int)analysis.size(); i++) {
-		doAnalysis(analysis, i, grid);
+		if (sparseQ) {
+			doSparseAnalysis(analysis, i, positions, weights);
+		} else {
+			doAnalysis(analysis, i, grid);
+		}
 	}
 }
 
@@ -74742,20 +79995,47 @@ void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, v
 
 //////////////////////////////
 //
-// Tool_periodicity::doAnalysis --
+// Tool_periodicity::doAnalysis -- Sum the grid into the bins of one
+//    period.  The grid is added one period-length block at a time so
+//    that the inner loop is over contiguous memory.
 //
 
 void Tool_periodicity::doAnalysis(vector<vector<double>>& analysis, int level, vector<double>& grid) {
 	int period = level + 1;
-	analysis[level].resize(period);
-	std::fill(analysis[level].begin(), analysis[level].end(), 0.0);
-	for (int i=0; i<period; i++) {
-		int j = i;
-		while (j < (int)grid.size()) {
-			analysis[level][i] += grid[j];
-			j += period;
+	vector<double>& bins = analysis[level];
+	bins.resize(period);
+	std::fill(bins.begin(), bins.end(), 0.0);
+	int size = (int)grid.size();
+	int j = 0;
+	for (j=0; j + period <= size; j += period) {
+		const double* block = grid.data() + j;
+		for (int i=0; i<period; i++) {
+			bins[i] += block[i];
 		}
 	}
+	for (int i=0; j + i < size; i++) {
+		bins[i] += grid[j + i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_periodicity::doSparseAnalysis -- Sum the attacks into the bins
+//    of one period, given the positions and weights of the non-zero
+//    elements of the grid.
+//
+
+void Tool_periodicity::doSparseAnalysis(vector<vector<double>>& analysis, int level,
+		vector<int>& positions, vector<double>& weights) {
+	int period = level + 1;
+	vector<double>& bins = analysis[level];
+	bins.resize(period);
+	std::fill(bins.begin(), bins.end(), 0.0);
+	for (int k=0; k<(int)positions.size(); k++) {
+		bins[positions[k] % period] += weights[k];
+	}
 }
 
 
@@ -75857,6 +81137,8 @@ void Tool_recip::initialize(HumdrumFile& infile) {
 Tool_restfill::Tool_restfill(void) {
 	define("y|hidden-rests=b",        "hide inserted rests");
 	define("i|exinterp=s:kern",       "type of spine to fill with rests");
+	// blank measures are hidden from the rhythm analysis in processFile():
+	m_analysis_level = ANALYZE_SPINES;
 }
 
 
@@ -78653,6 +83935,28 @@ MeasureComparisonGrid::~MeasureComparisonGrid() {
 
 void MeasureComparisonGrid::clear(void) {
 	m_grid.clear();
+	m_sparse.clear();
+	m_sparseQ = false;
+	m_hist1.clear();
+	m_hist2.clear();
+	m_sd1.clear();
+	m_sd2.clear();
+	m_empty1.clear();
+	m_empty2.clear();
+	m_rows = 0;
+	m_cols = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::setThreadCount -- Set the number of threads
+//    used to calculate the grid (default 1).
+//
+
+void MeasureComparisonGrid::setThreadCount(int count) {
+	m_threads = count < 1 ? 1 : count;
 }
 
 
@@ -78667,17 +83971,238 @@ void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2)
 }
 
 void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2) {
-	m_grid.resize(set1.size());
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		m_grid[i].resize(set2.size());
+	clear();
+	m_set1 = &set1;
+	m_set2 = &set2;
+	packHistograms(set1, m_hist1, m_sd1, m_empty1);
+	packHistograms(set2, m_hist2, m_sd2, m_empty2);
+	m_rows = set1.size();
+	m_cols = set2.size();
+	m_grid.resize((size_t)m_rows * m_cols);
+	runThreads();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::analyzeSparse -- Calculate the correlations
+//    without storing the full grid.  For each measure in the first set,
+//    only the topk highest correlations are kept (all if topk is 0),
+//    and only if they are at least the threshold.
+//
+
+void MeasureComparisonGrid::analyzeSparse(MeasureDataSet& set1,
+		MeasureDataSet& set2, int topk, double threshold) {
+	clear();
+	m_set1 = &set1;
+	m_set2 = &set2;
+	packHistograms(set1, m_hist1, m_sd1, m_empty1);
+	packHistograms(set2, m_hist2, m_sd2, m_empty2);
+	m_rows = set1.size();
+	m_cols = set2.size();
+	m_sparseQ = true;
+	m_topk = topk < 0 ? 0 : topk;
+	m_threshold = threshold;
+	m_sparse.resize(m_rows);
+	runThreads();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::packHistograms -- Store the 7-pc histograms of
+//    a set of measures in a contiguous array.  Each histogram is stored
+//    as the deviations from its running mean which are used in
+//    Convert::pearsonCorrelation(), together with its standard deviation,
+//    so that only the covariance has to be calculated for each pair of
+//    measures.
+//
+
+void MeasureComparisonGrid::packHistograms(MeasureDataSet& set,
+		vector<double>& hist, vector<double>& sd, vector<char>& empty) {
+	hist.assign((size_t)set.size() * HIST_STRIDE, 0.0);
+	sd.assign(set.size(), 0.0);
+	empty.assign(set.size(), 0);
+	for (int i=0; i<set.size(); i++) {
+		if (set[i].getSum7pc() == 0.0) {
+			empty[i] = 1;
+			continue;
+		}
+		vector<double>& x = set[i].getHistogram7pc();
+		double* delta = hist.data() + (size_t)i * HIST_STRIDE;
+		int size = (int)x.size();
+		double sumx = 0.0;
+		double meanx = x[0];
+		for (int k=2; k<=size; k++) {
+			double sweep = (k-1.0) / k;
+			double deltax = x[k-1] - meanx;
+			delta[k-2] = deltax;
+			sumx  += deltax * deltax * sweep;
+			meanx += deltax / k;
+		}
+		sd[i] = sqrt(sumx / size);
 	}
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			m_grid[i][j].compare(set1[i], set2[j]);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::correlate -- Return the correlation between a
+//    measure in the first set and one in the second set, calculated in
+//    the same way as MeasureComparison::compare().
+//
+
+double MeasureComparisonGrid::correlate(int index1, int index2) {
+	static const double sweep[HIST_STRIDE] = {
+		1.0/2.0, 2.0/3.0, 3.0/4.0, 4.0/5.0, 5.0/6.0, 6.0/7.0, 0.0, 0.0
+	};
+	if (m_empty1[index1] || m_empty2[index2]) {
+		if (m_empty1[index1] && m_empty2[index2]) {
+			return 1.0;
 		}
+		return 0.0;
 	}
-	m_set1 = &set1;
-	m_set2 = &set2;
+	const double* delta1 = m_hist1.data() + (size_t)index1 * HIST_STRIDE;
+	const double* delta2 = m_hist2.data() + (size_t)index2 * HIST_STRIDE;
+	double sumco = 0.0;
+	for (int k=0; k<HIST_STRIDE; k++) {
+		sumco += delta1[k] * delta2[k] * sweep[k];
+	}
+	double covxy = sumco / 7;
+	double correlation = covxy / (m_sd1[index1] * m_sd2[index2]);
+	if (fabs(correlation - 1.0) < 0.00000001) {
+		correlation = 1.0;
+	}
+	return correlation;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::runThreads -- Divide the rows of the grid into
+//    blocks and calculate them in separate threads.
+//
+
+void MeasureComparisonGrid::runThreads(void) {
+	const int blocksize = 32;
+	int blockcount = (m_rows + blocksize - 1) / blocksize;
+	int threadcount = std::min(m_threads, blockcount);
+	if (threadcount <= 1) {
+		analyzeRows(0, m_rows);
+		return;
+	}
+	std::atomic<int> nextblock(0);
+	vector<std::thread> threads;
+	for (int t=0; t<threadcount; t++) {
+		threads.emplace_back([this, &nextblock, blockcount, blocksize]() {
+			int block;
+			while ((block = nextblock++) < blockcount) {
+				int startrow = block * blocksize;
+				analyzeRows(startrow, std::min(startrow + blocksize, m_rows));
+			}
+		});
+	}
+	for (int t=0; t<(int)threads.size(); t++) {
+		threads[t].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::analyzeRows -- Calculate a block of rows of the
+//    grid, in tiles of columns so that the histograms of the rows and
+//    columns stay in the cache.  In sparse mode the best correlations of
+//    each row are kept in a min-heap.
+//
+
+void MeasureComparisonGrid::analyzeRows(int startrow, int stoprow) {
+	const int tilesize = 256;
+	auto greater = [](const pair<int, double>& a, const pair<int, double>& b) {
+		return a.second > b.second;
+	};
+	for (int tile=0; tile<m_cols; tile+=tilesize) {
+		int stopcol = std::min(tile + tilesize, m_cols);
+		for (int i=startrow; i<stoprow; i++) {
+			if (!m_sparseQ) {
+				double* row = m_grid.data() + (size_t)i * m_cols;
+				for (int j=tile; j<stopcol; j++) {
+					row[j] = correlate(i, j);
+				}
+				continue;
+			}
+			vector<pair<int, double>>& entries = m_sparse[i];
+			for (int j=tile; j<stopcol; j++) {
+				double correlation = correlate(i, j);
+				if (std::isnan(correlation) || (correlation < m_threshold)) {
+					continue;
+				}
+				if (m_topk <= 0) {
+					entries.emplace_back(j, correlation);
+				} else if ((int)entries.size() < m_topk) {
+					entries.emplace_back(j, correlation);
+					std::push_heap(entries.begin(), entries.end(), greater);
+				} else if (correlation > entries.front().second) {
+					std::pop_heap(entries.begin(), entries.end(), greater);
+					entries.back() = std::make_pair(j, correlation);
+					std::push_heap(entries.begin(), entries.end(), greater);
+				}
+			}
+		}
+	}
+	if (m_sparseQ && (m_topk > 0)) {
+		// sort the best matches in each row by column
+		for (int i=startrow; i<stoprow; i++) {
+			std::sort(m_sparse[i].begin(), m_sparse[i].end());
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getRowCount -- Return the number of measures
+//    in the first set.
+//
+
+int MeasureComparisonGrid::getRowCount(void) {
+	return m_rows;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getColumnCount -- Return the number of measures
+//    in the second set.
+//
+
+int MeasureComparisonGrid::getColumnCount(void) {
+	return m_cols;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getCorrelation7pc -- Return the correlation
+//    between a measure in the first set and one in the second set.
+//
+
+double MeasureComparisonGrid::getCorrelation7pc(int index1, int index2) {
+	if ((index1 < 0) || (index1 >= m_rows) || (index2 < 0) || (index2 >= m_cols)) {
+		return NAN;
+	}
+	if (m_sparseQ) {
+		return correlate(index1, index2);
+	}
+	return m_grid[(size_t)index1 * m_cols + index2];
 }
 
 
@@ -78689,15 +84214,15 @@ void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2)
 //
 
 ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			double correl = m_grid[i][j].getCorrelation7pc();
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			double correl = getCorrelation7pc(i, j);
 			if (correl > 0.0) {
 				out << int(correl * 100.0 + 0.5)/100.0;
 			} else {
 				out << -int(-correl * 100.0 + 0.5)/100.0;
 			}
-			if (j < (int)m_grid[i].size() - 1) {
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -78715,18 +84240,18 @@ ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
 //
 
 ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
 			if (i != j) {
 				continue;
 			}
-			double correl = m_grid[i][j].getCorrelation7pc();
+			double correl = getCorrelation7pc(i, j);
 			if (correl > 0.0) {
 				out << int(correl * 100.0 + 0.5)/100.0;
 			} else {
 				out << -int(-correl * 100.0 + 0.5)/100.0;
 			}
-			if (j < (int)m_grid[i].size() - 1) {
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -78737,6 +84262,33 @@ ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
 
 
 
+//////////////////////////////
+//
+// MeasureComparisonGrid::printSparseGrid -- Print the stored correlations
+//    after analyzeSparse(), one per line: row number, column number (both
+//    starting at 1 as in the lines/columns of printCorrelationGrid()) and
+//    correlation.
+//    default value: out = std::cout
+//
+
+ostream& MeasureComparisonGrid::printSparseGrid(ostream& out) {
+	for (int i=0; i<(int)m_sparse.size(); i++) {
+		for (int j=0; j<(int)m_sparse[i].size(); j++) {
+			double correl = m_sparse[i][j].second;
+			out << i + 1 << '\t' << m_sparse[i][j].first + 1 << '\t';
+			if (correl > 0.0) {
+				out << int(correl * 100.0 + 0.5)/100.0;
+			} else {
+				out << -int(-correl * 100.0 + 0.5)/100.0;
+			}
+			out << '\n';
+		}
+	}
+	return out;
+}
+
+
+
 //////////////////////////////
 //
 // MeasureComparisonGrid::getColorMapping --
@@ -79024,15 +84576,15 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 	double sdur1 = getScoreDuration1();
 	double sdur2 = getScoreDuration2();
 
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
 			width = getDuration2(j) / sdur2 * imagewidth;
 			height = getDuration1(i) / sdur1 * imageheight;
 
 			x = getStartTime2(j)/sdur2 * imageheight;
 			y = getStartTime1(i)/sdur1 * imagewidth;
 
-			getColorMapping(m_grid[i][j].getCorrelation7pc(), hue, saturation, lightness);
+			getColorMapping(getCorrelation7pc(i, j), hue, saturation, lightness);
 			ss << "hsl(" << hue << "," << saturation << "%," << lightness << "%)";
 			crect = grid.append_child("rect");
 			crect.append_attribute("x") = to_string(x).c_str();
@@ -79065,6 +84617,9 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 Tool_simat::Tool_simat(void) {
 	define("r|raw=b", "output raw correlation matrix");
 	define("d|diagonal=b", "output diagonal of correlation matrix");
+	define("k|top=i:0", "output only the k highest correlations for each measure");
+	define("t|threshold=d:-1.0", "output only correlations at or above threshold");
+	define("j|jobs=i:1", "number of threads for calculating the matrix");
 }
 
 
@@ -79147,6 +84702,15 @@ bool Tool_simat::run(HumdrumFile& infile1, HumdrumFile& infile2) {
 void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 	m_data1.parse(infile1);
 	m_data2.parse(infile2);
+	m_grid.setThreadCount(getInteger("jobs"));
+	if (getBoolean("top") || getBoolean("threshold")) {
+		// sparse output: do not store the full matrix.
+		m_grid.analyzeSparse(m_data1, m_data2, getInteger("top"),
+				getDouble("threshold"));
+		m_grid.printSparseGrid(m_free_text);
+		suppressHumdrumFileOutput();
+		return;
+	}
 	m_grid.analyze(m_data1, m_data2);
 	if (getBoolean("raw")) {
 		m_grid.printCorrelationGrid(m_free_text);
@@ -79457,6 +85021,8 @@ void Tool_spinetrace::processFile(HumdrumFile& infile) {
 Tool_tabber::Tool_tabber(void) {
 	// do nothing for now.
 	define("r|remove=b",    "remove any extra tabs");
+	// only the spine widths are needed:
+	m_analysis_level = ANALYZE_SPINES;
 }
 
 
@@ -81128,7 +86694,7 @@ void Tool_transpose::printNewKeyInterpretation(HumdrumLine& aRecord,
 	if (islower(aRecord.token(index)->at(1))) {
 		mode = 1;
 	}
-	int base40 = Convert::kernToBase40(*aRecord.token(index));
+	int base40 = Convert::kernToBase40(aRecord.token(index));
 	currentkey = base40;
 	base40 = base40 + transval;
 	base40 = base40 + 4000;
@@ -81424,10 +86990,11 @@ void Tool_transpose::doAutoTransposeAnalysis(HumdrumFile& infile) {
 	infile.getTrackStartList(tracks);
 	int i;
 	for (i=0; i<(int)tracks.size(); i++) {
+		int track = tracks[i]->getTrack();
 		if (tracks[i]->isKern()) {
-			ktracks[i] = tracks[i]->getTrack();
+			ktracks[track] = track;
 		} else {
-			ktracks[i] = 0;
+			ktracks[track] = 0;
 		}
 	}
 
@@ -81496,7 +87063,7 @@ void Tool_transpose::doTranspositionAnalysis(vector<vector<vector<double> > >& a
 	int value;
 
 	for (i=0; i<1; i++) {
-		for (j=2; j<3; j++) {
+		for (j=2; (j<3) && (j<(int)analysis.size()); j++) {
 			for (k=0; k<(int)analysis[i].size(); k++) {
 				if (analysis[i][k][24] >= 0 && analysis[j][k][24] >= 0) {
 					value1 = (int)analysis[i][k][25];
@@ -81535,6 +87102,9 @@ void Tool_transpose::printRawTrackAnalysis(vector<vector<vector<double> > >& ana
 	int value;
 	int value2;
 
+	if (analysis.empty()) {
+		return;
+	}
 	for (i=0; i<(int)analysis[0].size(); i++) {
 		m_free_text << "Frame\t" << i << ":";
 		for (j=0; j<(int)analysis.size(); j++) {
@@ -81560,16 +87130,18 @@ void Tool_transpose::printRawTrackAnalysis(vector<vector<vector<double> > >& ana
 
 //////////////////////////////
 //
-// doAutoKeyAnalysis --
+// doAutoKeyAnalysis -- The segment histograms of each track are first
+//     converted into cumulative sums, so that the histogram of any window
+//     of segments can be calculated with a single subtraction.  The
+//     cumulative sums can be reused for analyses at other window sizes.
 //
 
 void Tool_transpose::doAutoKeyAnalysis(vector<vector<vector<double> > >& analysis, int level,
 		int hop, int count, int segments, vector<int>& ktracks,
 		vector<vector<vector<double> > >& trackhist) {
 
-	vector<double> majorweights;
-	vector<double> minorweights;
-	fillWeightsWithKostkaPayne(majorweights, minorweights);
+	vector<vector<double> > profiles;
+	fillKeyProfileMatrix(profiles);
 
 	int size = 0;
 	int i;
@@ -81584,13 +87156,37 @@ void Tool_transpose::doAutoKeyAnalysis(vector<vector<vector<double> > >& analysi
 		analysis[i].reserve(count);
 	}
 
+	vector<vector<double> > prefixhist;
 	int aindex = 0;
 	for (i=1; i<(int)ktracks.size(); i++) {
 		if (!ktracks[i]) {
 			continue;
 		}
+		buildHistogramPrefixSums(prefixhist, trackhist[i]);
 		doTrackKeyAnalysis(analysis[aindex++], level, hop, count,
-				trackhist[i], majorweights, minorweights);
+				prefixhist, profiles);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::buildHistogramPrefixSums -- Store the cumulative pitch-class
+//   histogram of a track: prefixhist[i] is the sum of the segment histograms
+//   before segment i, so the histogram of segments [a, b) is
+//   prefixhist[b] - prefixhist[a].
+//
+
+void Tool_transpose::buildHistogramPrefixSums(vector<vector<double> >& prefixhist,
+		vector<vector<double> >& trackhist) {
+	prefixhist.resize(trackhist.size() + 1);
+	prefixhist[0].assign(12, 0.0);
+	for (int i=0; i<(int)trackhist.size(); i++) {
+		prefixhist[i+1].resize(12);
+		for (int k=0; k<12; k++) {
+			prefixhist[i+1][k] = prefixhist[i][k] + trackhist[i][k];
+		}
 	}
 }
 
@@ -81599,21 +87195,24 @@ void Tool_transpose::doAutoKeyAnalysis(vector<vector<vector<double> > >& analysi
 //////////////////////////////
 //
 // Tool_transpose::doTrackKeyAnalysis -- Do individual key analyses of sections of the
-//   given track.
+//   given track.  The window of each analysis is level segments long, and
+//   successive windows start hop segments apart.
 //
 
 void Tool_transpose::doTrackKeyAnalysis(vector<vector<double> >& analysis, int level, int hop,
-		int count, vector<vector<double> >& trackhist,
-		vector<double>& majorweights, vector<double>& minorweights) {
+		int count, vector<vector<double> >& prefixhist,
+		vector<vector<double> >& profiles) {
 
+	// prefixhist has one more entry than the number of segments.
+	int segments = (int)prefixhist.size() - 1;
 	int i;
 	for (i=0; i<count; i++) {
-		if (i * hop + level > (int)trackhist.size()) {
+		if (i * hop + level > segments) {
 			break;
 		}
 		analysis.resize(i+1);
-		doSingleAnalysis(analysis[analysis.size()-1], i*hop+level, level,
-				trackhist, majorweights, minorweights);
+		doSingleAnalysis(analysis[analysis.size()-1], i*hop, level,
+				prefixhist, profiles);
 	}
 }
 
@@ -81621,21 +87220,27 @@ void Tool_transpose::doTrackKeyAnalysis(vector<vector<double> >& analysis, int l
 
 //////////////////////////////
 //
-// Tool_transpose::doSingleAnalysis --
+// Tool_transpose::doSingleAnalysis -- Analyze the key of the segments
+//   [startindex, startindex+length) from the cumulative histogram.
 //
 
 void Tool_transpose::doSingleAnalysis(vector<double>& analysis, int startindex, int length,
-		vector<vector<double> >& trackhist, vector<double>& majorweights,
-		vector<double>& minorweights) {
+		vector<vector<double> >& prefixhist, vector<vector<double> >& profiles) {
 	vector<double> histsum(12, 0);
 
-	for (int i=0; (i<length) && (startindex+i+length<(int)trackhist.size()); i++) {
-		for (int k=0; k<12; k++) {
-			histsum[k] += trackhist[i+startindex][k];
+	int endindex = startindex + length;
+	if (endindex >= (int)prefixhist.size()) {
+		endindex = (int)prefixhist.size() - 1;
+	}
+	for (int k=0; k<12; k++) {
+		histsum[k] = prefixhist[endindex][k] - prefixhist[startindex][k];
+		// remove rounding residue left over from the cumulative sums:
+		if (histsum[k] < 1.0e-9) {
+			histsum[k] = 0.0;
 		}
 	}
 
-	identifyKey(analysis, histsum, majorweights, minorweights);
+	identifyKey(analysis, histsum, profiles);
 }
 
 
@@ -81678,6 +87283,45 @@ void Tool_transpose::fillWeightsWithKostkaPayne(vector<double>& maj, vector<doub
 
 
 
+//////////////////////////////
+//
+// Tool_transpose::fillKeyProfileMatrix -- Store the Kostka-Payne key
+//   profiles for all 24 keys: rows 0-11 are the major keys on C to B, and
+//   rows 12-23 are the minor keys.  Each row is centered on its mean and
+//   scaled to unit length, so the Pearson correlation of a histogram with
+//   every key is a single matrix-vector product (see identifyKey()).
+//
+
+void Tool_transpose::fillKeyProfileMatrix(vector<vector<double> >& profiles) {
+	vector<double> majorweights;
+	vector<double> minorweights;
+	fillWeightsWithKostkaPayne(majorweights, minorweights);
+
+	profiles.resize(24);
+	for (int i=0; i<24; i++) {
+		vector<double>& weights = i < 12 ? majorweights : minorweights;
+		int tonic = i % 12;
+		profiles[i].resize(12);
+		double mean = 0.0;
+		for (int k=0; k<12; k++) {
+			profiles[i][k] = weights[(k - tonic + 12) % 12];
+			mean += profiles[i][k];
+		}
+		mean /= 12.0;
+		double norm = 0.0;
+		for (int k=0; k<12; k++) {
+			profiles[i][k] -= mean;
+			norm += profiles[i][k] * profiles[i][k];
+		}
+		norm = sqrt(norm);
+		for (int k=0; k<12; k++) {
+			profiles[i][k] /= norm;
+		}
+	}
+}
+
+
+
 ////////////////////////////////////////
 //
 // identifyKey -- correls contains the 12 major key correlation
@@ -81685,11 +87329,12 @@ void Tool_transpose::fillWeightsWithKostkaPayne(vector<double>& maj, vector<doub
 //      more values: index=24 is the best key, and index=25 is the
 //      second best key.  If [24] or [25] is -1, then that means that
 //      all entries in the original histogram were zero (all rests).
+//      The profiles are from fillKeyProfileMatrix().  Since they have
+//      zero mean, the histogram only has to be centered for its length.
 //
 
 void Tool_transpose::identifyKey(vector<double>& correls,
-		vector<double>& histogram, vector<double>& majorweights,
-		vector<double>& minorweights) {
+		vector<double>& histogram, vector<vector<double> >& profiles) {
 
 	correls.clear();
 	correls.reserve(26);
@@ -81706,12 +87351,25 @@ void Tool_transpose::identifyKey(vector<double>& correls,
 		return;
 	}
 
-	vector<double> majorcorrels;
-	vector<double> minorcorrels;
+	double mean = testsum / 12.0;
+	double norm = 0.0;
 	for (int i=0; i<12; i++) {
-		majorcorrels[i] = Convert::pearsonCorrelation(majorweights, histogram);
-		minorcorrels[i] = Convert::pearsonCorrelation(minorweights, histogram);
+		norm += (histogram[i] - mean) * (histogram[i] - mean);
+	}
+	norm = sqrt(norm);
+
+	vector<double> allcorrels(24, 0.0);
+	if (norm > 0.0) {
+		for (int i=0; i<24; i++) {
+			double sum = 0.0;
+			for (int k=0; k<12; k++) {
+				sum += profiles[i][k] * histogram[k];
+			}
+			allcorrels[i] = sum / norm;
+		}
 	}
+	vector<double> majorcorrels(allcorrels.begin(), allcorrels.begin() + 12);
+	vector<double> minorcorrels(allcorrels.begin() + 12, allcorrels.end());
 
 	// find max value
 	int besti;
@@ -81820,7 +87478,7 @@ double Tool_transpose::storeHistogramForTrack(vector<vector<double> >& histogram
 		HumdrumFile& infile, int track, int segments) {
 
 	histogram.clear();
-	histogram.reserve(segments);
+	histogram.resize(segments);
 
 	int i;
 	int j;
@@ -81853,12 +87511,12 @@ double Tool_transpose::storeHistogramForTrack(vector<vector<double> >& histogram
 			if (!infile.token(i, j)->isKern()) {
 				continue;
 			}
-			if (!infile.token(i, j)->isNull()) {
+			if (infile.token(i, j)->isNull()) {
 				continue;
 			}
 			tokencount = infile.token(i, j)->getSubtokenCount();
 			for (k=0; k<tokencount; k++) {
-				buffer = *infile.token(j, k);
+				buffer = infile.token(i, j)->getSubtoken(k);
 				if (buffer == ".") {
 					continue;  // ignore illegal inline null tokens
 				}
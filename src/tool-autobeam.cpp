@@ -350,7 +350,7 @@ void Tool_autobeam::breakBeamsByLyrics(HumdrumFile& infile) {
 		HTp curtok = starttok->getNextFieldToken();
 		bool hastext = false;
 		while (curtok && !curtok->isKern()) {
-			if (curtok->isDataType("**text")) {
+			if (curtok->isDataType(datatype_text)) {
 				hastext = true;
 				break;
 			}
@@ -801,7 +801,7 @@ void Tool_autobeam::getBeamedNotes(vector<HTp>& toks, HTp tok, HTp stok, HTp eto
 bool Tool_autobeam::hasSyllable(HTp token) {
 	HTp current = token->getNextFieldToken();
 	while (current && !current->isKern()) {
-		if (current->isDataType("**text")) {
+		if (current->isDataType(datatype_text)) {
 			if (current->isNull()) {
 				return false;
 			} else {
@@ -850,11 +850,7 @@ void Tool_autobeam::addBeams(HumdrumFile& infile) {
 void Tool_autobeam::initialize(HumdrumFile& infile) {
 	m_splitcount = 0;
 	m_kernspines = infile.getKernSpineStartList();
-	vector<HTp>& ks = m_kernspines;
-	m_timesigs.resize(infile.getTrackCount() + 1);
-	for (int i=0; i<(int)ks.size(); i++) {
-		infile.getTimeSigs(m_timesigs[ks[i]->getTrack()], ks[i]->getTrack());
-	}
+	m_infile = &infile;
 	m_overwriteQ = getBoolean("overwrite");
 	m_track = getInteger("track");
 	m_includerests = getBoolean("include-rests");
@@ -922,12 +918,15 @@ void Tool_autobeam::processMeasure(vector<HTp>& measure) {
 	HumNum beatdur(1);
 
 	// First, get the beat positions of all notes in the measure:
-	vector<pair<int, HumNum> >& timesig = m_timesigs[measure[0]->getTrack()];
+	int track = measure[0]->getTrack();
 	for (int i=0; i<(int)measure.size(); i++) {
 		int line = measure[i]->getLineIndex();
-		if ((current.first != timesig[line].first) ||
-		    (current.second != timesig[line].second)) {
-			current = timesig[line];
+		const TimeSigChange* timesig = m_infile->getTimeSigChange(line, track);
+		int top = timesig ? timesig->top : 0;
+		HumNum bottom = timesig ? timesig->bottom : 0;
+		if ((current.first != top) || (current.second != bottom)) {
+			current.first = top;
+			current.second = bottom;
 			beatdur = 1;
 			beatdur /= current.second;
 			beatdur *= 4; // convert to quarter-notes units from whole-notes.
@@ -1034,8 +1033,8 @@ void Tool_autobeam::addBeam(HTp startnote, HTp endnote) {
 			token = token->getNextToken();
 		}
 	}
-	startnote->push_back('L');
-	endnote->push_back('J');
+	startnote->setText(*startnote + "L");
+	endnote->setText(*endnote + "J");
 }
 
 
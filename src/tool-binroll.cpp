@@ -29,6 +29,7 @@ namespace hum {
 Tool_binroll::Tool_binroll(void) {
 	// add options here
 	define("t|timebase=s:16", "timebase to do analysis at");
+	define("m|measures=i:0",  "print roll in windows of the given number of measures");
 }
 
 
@@ -49,30 +50,26 @@ bool Tool_binroll::run(HumdrumFileSet& infiles) {
 
 bool Tool_binroll::run(const string& indata, ostream& out) {
 	HumdrumFile infile(indata);
-	bool status = run(infile);
-	if (hasAnyText()) {
-		getAllText(out);
-	} else {
-		out << infile;
-	}
-	return status;
+	return run(infile, out);
 }
 
 
+//
+// The roll is written directly to the output stream rather than being
+// stored in the tool's text buffer, so that the memory used by the -m
+// option does not depend on the length of the score.
+//
+
 bool Tool_binroll::run(HumdrumFile& infile, ostream& out) {
-	bool status = run(infile);
-	if (hasAnyText()) {
-		getAllText(out);
-	} else {
-		out << infile;
-	}
-	return status;
+	initialize();
+	processFile(infile, out);
+	return true;
 }
 
 
 bool Tool_binroll::run(HumdrumFile& infile) {
-	m_duration.setValue(1, 4); // 16th note
-	processFile(infile);
+	initialize();
+	processFile(infile, m_free_text);
 	return true;
 }
 
@@ -80,73 +77,293 @@ bool Tool_binroll::run(HumdrumFile& infile) {
 
 //////////////////////////////
 //
-// Tool_binroll::processFile --
+// Tool_binroll::initialize --
 //
 
-void Tool_binroll::processFile(HumdrumFile& infile) {
-	vector<vector<char>> output;
-	output.resize(128);
+void Tool_binroll::initialize(void) {
+	m_duration = Convert::recipToDuration(getString("timebase"));
+	if (m_duration <= 0) {
+		m_duration.setValue(1, 4); // 16th note
+	}
+	m_measures = getInteger("measures");
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::processFile -- The piano roll is stored in two bit planes:
+//    m_onsets has a bit for the time step at the start of each note, and
+//    m_sustains has bits for the rest of the time steps during the note.
+//    If the -m option is given, the roll is calculated and printed for
+//    that number of measures at a time, and notes which continue past
+//    the end of a window are carried over to the next one.  Otherwise
+//    the whole score is processed as a single window.
+//
+
+void Tool_binroll::processFile(HumdrumFile& infile, ostream& out) {
+	int tpq = infile.tpq();
+	m_stepnum = (int64_t)m_duration.getNumerator() * tpq;
+	m_stepden = m_duration.getDenominator();
 	int count = (infile.getScoreDuration() / m_duration).getInteger() + 1;
-	for (int i=0; i<(int)output.size(); i++) {
-		output[i].resize(count);
-		std::fill(output[i].begin(), output[i].end(), 0);
+
+	printHeader(infile, out);
+
+	vector<BinrollNote> pending;
+	vector<BinrollNote> carry;
+	vector<BinrollNote> notes;
+	m_windowstart = 0;
+	int startline = 0;
+	while (startline < infile.getLineCount()) {
+		int endline = getWindowEndLine(infile, startline);
+		if (endline < infile.getLineCount()) {
+			m_windowend = getStepIndex(infile[endline].getTickFromStart());
+		} else {
+			m_windowend = count;
+		}
+		clearRoll(m_windowend - m_windowstart);
+
+		carry.clear();
+		for (int i=0; i<(int)pending.size(); i++) {
+			addNote(pending[i], carry);
+		}
+		for (int i=startline; i<endline; i++) {
+			notes.clear();
+			storeLineNotes(notes, infile[i]);
+			for (int j=0; j<(int)notes.size(); j++) {
+				addNote(notes[j], carry);
+			}
+		}
+		pending.swap(carry);
+
+		printRoll(out, m_windowend - m_windowstart);
+		m_windowstart = m_windowend;
+		startline = endline;
 	}
 
-	int strandcount = infile.getStrandCount();
-	for (int i=0; i<strandcount; i++) {
-		HTp starting = infile.getStrandStart(i);
-		if (!starting->isKern()) {
+	printTrailer(infile, out);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::getWindowEndLine -- Return the index of the line which
+//    starts the next window: the barline which ends the m_measures-th
+//    measure after the start line.  If the -m option is not used, then
+//    the line count of the file is returned.
+//
+
+int Tool_binroll::getWindowEndLine(HumdrumFile& infile, int startline) {
+	if (m_measures <= 0) {
+		return infile.getLineCount();
+	}
+	int barcount = 0;
+	for (int i=startline+1; i<infile.getLineCount(); i++) {
+		if (!infile[i].isBarline()) {
 			continue;
 		}
-		HTp ending = infile.getStrandEnd(i);
-		processStrand(output, starting, ending);
+		barcount++;
+		if (barcount >= m_measures) {
+			return i;
+		}
 	}
+	return infile.getLineCount();
+}
+
 
-	printAnalysis(infile, output);
 
+//////////////////////////////
+//
+// Tool_binroll::getStepIndex -- Convert a time in ticks into the index of
+//    the time step that contains it.
+//
+
+int Tool_binroll::getStepIndex(int64_t tick) {
+	return (int)(tick * m_stepden / m_stepnum);
 }
 
 
 
 //////////////////////////////
 //
-// Tool_binroll::printAnalysis --
+// Tool_binroll::storeLineNotes -- Store the notes which start on the given
+//    line in **kern spines.  Rests and null tokens are ignored.
 //
 
-void Tool_binroll::printAnalysis(HumdrumFile& infile,
-		vector<vector<char>>& roll) {
-	HumRegex hre;
-
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isExclusive()) {
-			break;
+void Tool_binroll::storeLineNotes(vector<BinrollNote>& notes, HumdrumLine& line) {
+	if (!line.isData()) {
+		return;
+	}
+	BinrollNote note;
+	int64_t starttick = line.getTickFromStart();
+	note.startindex = getStepIndex(starttick);
+	for (int i=0; i<line.getFieldCount(); i++) {
+		HTp current = line.token(i);
+		if (!current->isKern()) {
+			continue;
 		}
-		if (infile[i].isEmpty()) {
+		if (!current->isNonNullData()) {
 			continue;
 		}
-		string line = infile[i].getText();
-		int found = 0;
-		for (int j=0; j<(int)line.size(); j++) {
-			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
-			} else {
-				found = 1;
-				m_free_text << line[j];
+		if (current->isRest()) {
+			continue;
+		}
+
+		if (current->isChord()) {
+			HumNum starttime = line.getDurationFromStart();
+			int stcount = current->getSubtokenCount();
+			for (int s=0; s<stcount; s++) {
+				string tok = current->getSubtoken(s);
+				note.pitch = Convert::kernToMidiNoteNumber(tok);
+				if ((note.pitch < 0) || (note.pitch > 127)) {
+					continue;
+				}
+				HumNum duration = Convert::recipToDuration(tok);
+				note.endindex = ((starttime+duration) / m_duration).getInteger();
+				notes.push_back(note);
 			}
+		} else {
+			note.pitch = Convert::kernToMidiNoteNumber(current);
+			if ((note.pitch < 0) || (note.pitch > 127)) {
+				continue;
+			}
+			note.endindex = getStepIndex(starttick + current->getTickDuration());
+			notes.push_back(note);
 		}
-		m_free_text << "\n";
 	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::addNote -- Add the part of a note which falls in the
+//    current window to the roll.  Notes which continue after the
+//    window are stored in carry.
+//
+
+void Tool_binroll::addNote(const BinrollNote& note, vector<BinrollNote>& carry) {
+	if ((note.endindex > m_windowend) || (note.startindex >= m_windowend)) {
+		carry.push_back(note);
+	}
+	if (note.startindex >= m_windowend) {
+		return;
+	}
+	int startindex = note.startindex;
+	if (startindex >= m_windowstart) {
+		int index = startindex - m_windowstart;
+		m_onsets[note.pitch][index >> 6] |= (uint64_t)1 << (index & 63);
+	}
+	startindex = std::max(startindex + 1, m_windowstart);
+	int endindex = std::min(note.endindex, m_windowend);
+	setBitRange(m_sustains[note.pitch], startindex - m_windowstart,
+			endindex - m_windowstart);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::clearRoll -- Allocate and clear the bit planes for a window
+//    of the given number of time steps.
+//
 
-	for (int i=0; i<(int)roll[0].size(); i++) {
-		for (int j=0; j<(int)roll.size(); j++) {
-			m_free_text << (int)roll[j][i];
-			if (j < (int)roll.size() - 1) {
-				m_free_text << ' ';
+void Tool_binroll::clearRoll(int width) {
+	int words = (width + 63) / 64;
+	m_onsets.resize(128);
+	m_sustains.resize(128);
+	for (int i=0; i<128; i++) {
+		m_onsets[i].assign(words, 0);
+		m_sustains[i].assign(words, 0);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::setBitRange -- Set the bits from startindex up to (but not
+//    including) endindex, filling whole words at a time.
+//
+
+void Tool_binroll::setBitRange(vector<uint64_t>& row, int startindex,
+		int endindex) {
+	if (endindex <= startindex) {
+		return;
+	}
+	int startword = startindex >> 6;
+	int endword   = (endindex - 1) >> 6;
+	uint64_t startmask = ~(uint64_t)0 << (startindex & 63);
+	uint64_t endmask   = ~(uint64_t)0 >> (63 - ((endindex - 1) & 63));
+	if (startword == endword) {
+		row[startword] |= startmask & endmask;
+		return;
+	}
+	row[startword] |= startmask;
+	for (int i=startword+1; i<endword; i++) {
+		row[i] = ~(uint64_t)0;
+	}
+	row[endword] |= endmask;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::printRoll -- Print the time steps of the current window,
+//    one line per time step with 128 pitch values: 2 for a note attack,
+//    1 for a sustained note and 0 otherwise.
+//
+
+void Tool_binroll::printRoll(ostream& out, int width) {
+	string line(128 * 2, ' ');
+	line.back() = '\n';
+	for (int i=0; i<width; i++) {
+		int word = i >> 6;
+		uint64_t mask = (uint64_t)1 << (i & 63);
+		for (int j=0; j<128; j++) {
+			if (m_onsets[j][word] & mask) {
+				line[j*2] = '2';
+			} else if (m_sustains[j][word] & mask) {
+				line[j*2] = '1';
+			} else {
+				line[j*2] = '0';
 			}
 		}
-		m_free_text << "\n";
+		out << line;
 	}
+}
+
 
+
+//////////////////////////////
+//
+// Tool_binroll::printHeader -- Print the comments before the start of the
+//    data as "#" comments.
+//
+
+void Tool_binroll::printHeader(HumdrumFile& infile, ostream& out) {
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isExclusive()) {
+			break;
+		}
+		if (infile[i].isEmpty()) {
+			continue;
+		}
+		printComment(infile[i].getText(), out);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::printTrailer -- Print the comments after the end of the
+//    data as "#" comments.
+//
+
+void Tool_binroll::printTrailer(HumdrumFile& infile, ostream& out) {
 	int startindex = infile.getLineCount() - 1;
 	for (int i=infile.getLineCount()-1; i>=0; i--) {
 		if (infile[i].isManipulator()) {
@@ -160,17 +377,7 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 		if (infile[i].isEmpty()) {
 			continue;
 		}
-		string line = infile[i].getText();
-		int found = 0;
-		for (int j=0; j<(int)line.size(); j++) {
-			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
-			} else {
-				found = 1;
-				m_free_text << line[j];
-			}
-		}
-		m_free_text << "\n";
+		printComment(infile[i].getText(), out);
 	}
 }
 
@@ -178,61 +385,21 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 
 //////////////////////////////
 //
-// Tool_binroll::processStrand --
+// Tool_binroll::printComment -- Print a line with its leading "!"
+//    characters changed to "#".
 //
 
-void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
-		HTp ending) {
-	HTp current = starting;
-	int base12;
-	HumNum starttime;
-	HumNum duration;
-	int startindex;
-	int endindex;
-	while (current && (current != ending)) {
-		if (!current->isNonNullData()) {
-			current = current->getNextToken();
-			continue;
-		}
-		if (current->isRest()) {
-			current = current->getNextToken();
-			continue;
-		}
-
-		if (current->isChord()) {
-			int stcount = current->getSubtokenCount();
-			starttime = current->getDurationFromStart();
-			startindex = (starttime / m_duration).getInteger();
-			for (int s=0; s<stcount; s++) {
-				string tok = current->getSubtoken(s);
-				base12 = Convert::kernToMidiNoteNumber(tok);
-				if ((base12 < 0) || (base12 > 127)) {
-					continue;
-				}
-				duration = Convert::recipToDuration(tok);
-				endindex = ((starttime+duration) / m_duration).getInteger();
-				roll[base12][startindex] = 2;
-				for (int i=startindex+1; i<endindex; i++) {
-					roll[base12][i] = 1;
-				}
-			}
+void Tool_binroll::printComment(const string& line, ostream& out) {
+	int found = 0;
+	for (int j=0; j<(int)line.size(); j++) {
+		if ((line[j] == '!') && !found) {
+			out << "#";
 		} else {
-			base12 = Convert::kernToMidiNoteNumber(current);
-			if ((base12 < 0) || (base12 > 127)) {
-				current = current->getNextToken();
-				continue;
-			}
-			starttime = current->getDurationFromStart();
-			duration = current->getDuration();
-			startindex = (starttime / m_duration).getInteger();
-			endindex   = ((starttime+duration) / m_duration).getInteger();
-			roll[base12][startindex] = 2;
-			for (int i=startindex+1; i<endindex; i++) {
-				roll[base12][i] = 1;
-			}
+			found = 1;
+			out << line[j];
 		}
-		current = current->getNextToken();
 	}
+	out << "\n";
 }
 
 
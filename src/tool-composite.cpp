@@ -80,8 +80,7 @@ bool Tool_composite::run(HumdrumFile& infile) {
 	initialize();
 	processFile(infile);
 	infile.createLinesFromTokens();
-	// need to convert to text for now:
-	m_humdrum_text << infile;
+	setModifiedStructure();
 	return true;
 }
 
@@ -49,6 +49,7 @@ Tool_dissonant::Tool_dissonant(void) {
 	define("i|x|e|exinterp=s:**cdata","specify exinterp for **cdata spine");
 	define("color|colorize|color-by-rhythm=b", "color dissonant notes by beat level");
 	define("color2|colorize2|color-by-interval=b", "color dissonant notes by dissonant interval");
+	define("threads=i:1",             "number of segments to process in parallel");
 }
 
 
@@ -199,6 +200,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 
 			adjustColorization(infile);
 			infile.createLinesFromTokens();
+			setModifiedStructure();
 
 			return true;
 		}
@@ -227,8 +229,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 
 		adjustColorization(infile);
 		infile.createLinesFromTokens();
-
-		infile.createLinesFromTokens();
+		setModifiedStructure();
 		return true;
 	} else {
 		if (getBoolean("count")) {
@@ -245,6 +246,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 			printColorLegend(infile);
 			adjustColorization(infile);
 			infile.createLinesFromTokens();
+			setModifiedStructure();
 			return true;
 		}
 	}
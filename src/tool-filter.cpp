@@ -63,9 +63,24 @@ namespace hum {
 // START_MERGE
 
 
+//
+// Tools which edit the input file in place (without generating
+// Humdrum text output) are chained without re-parsing the file.  If
+// such a tool changes the spine or rhythm structure of the file, it
+// calls setModifiedStructure() and the spines are re-analyzed from
+// the edited tokens.  Tools which generate new Humdrum text output
+// have their output parsed as input for the next tool.  In both cases
+// only the spines are analyzed after the tool, and the file is analyzed
+// at the level which the next tool declares (see
+// HumTool::getAnalysisLevel()) before the next tool is run.  The
+// analyses for the analysis level of the file are done after the last
+// tool.
+//
+
 #define RUNTOOL(NAME, INFILE, COMMAND, STATUS)     \
 	Tool_##NAME *tool = new Tool_##NAME;            \
 	tool->process(COMMAND);                         \
+	analyzeInput(INFILE, analyzed, tool->getAnalysisLevel()); \
 	tool->run(INFILE);                              \
 	if (tool->hasError()) {                         \
 		status = false;                              \
@@ -73,13 +88,18 @@ namespace hum {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE.readString(tool->getHumdrumText());   \
+		INFILE.readStringNoRhythm(tool->getHumdrumText()); \
+		analyzed = ANALYZE_SPINES;                   \
+	} else if (tool->hasModifiedStructure()) {      \
+		INFILE.analyzeBaseFromTokens();              \
+		analyzed = ANALYZE_SPINES;                   \
 	}                                               \
 	delete tool;
 
 #define RUNTOOL2(NAME, INFILE1, INFILE2, COMMAND, STATUS) \
 	Tool_##NAME *tool = new Tool_##NAME;            \
 	tool->process(COMMAND);                         \
+	analyzeInput(INFILE1, analyzed, tool->getAnalysisLevel()); \
 	tool->run(INFILE1, INFILE2);                    \
 	if (tool->hasError()) {                         \
 		status = false;                              \
@@ -87,7 +107,11 @@ namespace hum {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE1.readString(tool->getHumdrumText());  \
+		INFILE1.readStringNoRhythm(tool->getHumdrumText()); \
+		analyzed = ANALYZE_SPINES;                   \
+	} else if (tool->hasModifiedStructure()) {      \
+		INFILE1.analyzeBaseFromTokens();             \
+		analyzed = ANALYZE_SPINES;                   \
 	}                                               \
 	delete tool;
 
@@ -163,7 +187,7 @@ bool Tool_filter::runUniversal(HumdrumFileSet& infiles) {
 		} else if (commands[i].first == "chooser") {
 			RUNTOOLSET(chooser, infiles, commands[i].second, status);
 		} else if (commands[i].first == "myank") {
-			RUNTOOL(myank, infiles, commands[i].second, status);
+			RUNTOOLSET(myank, infiles, commands[i].second, status);
 		}
 	}
 
@@ -187,6 +211,9 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 	HumdrumFile& infile = infiles[0];
 
 	bool status = true;
+	// analyses which are up to date for the current contents of infile
+	// (the input file is given to the first tool as it is):
+	int analyzed = ANALYZE_ALL;
 	vector<pair<string, string> > commands;
 	getCommandList(commands, infile);
 	for (int i=0; i<(int)commands.size(); i++) {
@@ -273,6 +300,8 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 		}
 	}
 
+	analyzeInput(infile, analyzed, infile.getAnalysisLevel());
+
 	removeGlobalFilterLines(infile);
 
 	// Re-load the text for each line from their tokens in case any
@@ -283,6 +312,34 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// Tool_filter::analyzeInput -- Analyze the file at the given level (see
+//    the ANALYZE_* defines in HumdrumFileBase.h) if some of the analyses
+//    are not up to date since the file was last changed by a tool.
+//    The analyses which are done are added to analyzed.  The analysis
+//    level stored in the file is not changed.
+//
+
+void Tool_filter::analyzeInput(HumdrumFile& infile, int& analyzed, int level) {
+	if (level & ANALYZE_RHYTHM) {
+		level |= ANALYZE_PARAMETERS;
+	}
+	if (level & ANALYZE_PARAMETERS) {
+		level |= ANALYZE_STRANDS;
+	}
+	if ((level & ~analyzed) == 0) {
+		return;
+	}
+	int filelevel = infile.getAnalysisLevel();
+	infile.setAnalysisLevel(level);
+	infile.analyzeStructure();
+	infile.setAnalysisLevel(filelevel);
+	analyzed |= level;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_filter::removeGlobalFilterLines --
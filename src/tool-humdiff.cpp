@@ -13,7 +13,11 @@
 #include "tool-humdiff.h"
 #include "HumRegex.h"
 #include "Convert.h"
+
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 
 using namespace std;
 
@@ -33,6 +37,8 @@ Tool_humdiff::Tool_humdiff(void) {
 	define("time-points|times=b", "display timepoint lists for each file");
 	define("note-points|notes=b", "display notepoint lists for each file");
 	define("c|color=s:red",       "color for difference markers");
+	define("b|band=i:256",        "maximum drift between files in timepoints when aligning");
+	define("threads=i:1",         "number of input files to parse in parallel");
 }
 
 
@@ -62,15 +68,6 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 		cerr << "Usage: " << getCommand() << " files" << endl;
 		return false;
 	} else {
-		HumNum targetdur = infiles[0].getScoreDuration();
-		for (int i=1; i<infiles.getSize(); i++) {
-			HumNum dur = infiles[i].getScoreDuration();
-			if (dur != targetdur) {
-				cerr << "Error: all files must have the same duration" << endl;
-				return false;
-			}
-		}
-
 		for (int i=0; i<infiles.getCount(); i++) {
 			if (i == reference) {
 				continue;
@@ -132,67 +129,295 @@ void Tool_humdiff::printTimePoints(vector<TimePoint>& timepoints) {
 
 //////////////////////////////
 //
-// Tool_humdiff::compareTimePoints --
+// Tool_humdiff::compareTimePoints -- Align the timepoints of the two files
+//    (see alignTimePoints()), and then compare the notes at each aligned
+//    pair of timepoints.  Notes in the reference file at timepoints which
+//    do not have an equivalent timepoint in the other file are marked
+//    as differences.
 //
 
 void Tool_humdiff::compareTimePoints(vector<vector<TimePoint>>& timepoints,
 		HumdrumFile& reference, HumdrumFile& alternate) {
-	vector<int> indexes(timepoints.size(), 0);
-	HumNum minval;
-	HumNum value;
-	int found;
-
 	vector<HumdrumFile*> infiles(2, NULL);
 	infiles[0] = &reference;
 	infiles[1] = &alternate;
 
-	vector<int> increment(timepoints.size(), 0);
+	vector<pair<int, int>> alignment;
+	alignTimePoints(alignment, timepoints);
+
+	vector<int> indexes(timepoints.size(), -1);
+	for (int i=0; i<(int)alignment.size(); i++) {
+		indexes.at(0) = alignment[i].first;
+		indexes.at(1) = alignment[i].second;
+		if (indexes.at(0) >= 0) {
+			TimePoint& tp = timepoints.at(0).at(indexes.at(0));
+			tp.index.resize(timepoints.size());
+			tp.index.at(1) = -1;
+			if (indexes.at(1) >= 0) {
+				tp.index.at(1) = timepoints.at(1).at(indexes.at(1)).index.at(0);
+			}
+		}
+		compareLines(indexes, timepoints, infiles);
+	}
+
+	if (getBoolean("report")) {
+		reportMeasureGaps(alignment, timepoints);
+	}
+}
+
+
 
-	while ((1)) {
-		if (indexes.at(0) >= (int)timepoints.at(0).size()) {
-			// at the end of the list of notes for the first file.
-			// break from the comparison for now and figure out how
-			// to report differences of added notes in the other file(s)
-			// later.
-			break;
+//////////////////////////////
+//
+// Tool_humdiff::alignTimePoints -- Find the lowest-cost alignment of the
+//    timepoints in two files, so that an added or missing measure in one
+//    file does not shift the comparison of all later notes.  Each entry
+//    in the alignment is a pair of indexes into timepoints[0] and
+//    timepoints[1], where -1 means that the timepoint in the other file
+//    has no equivalent.  Matching two timepoints costs the number of
+//    notes which are only in one of them (see getMatchCost()), and
+//    skipping a timepoint costs its number of notes plus one.
+//
+//    The dynamic program is limited to a band of cells around the
+//    diagonal between the start and end of both files (--band option),
+//    so time and memory grow linearly with the length of the files.
+//    Each cell of the band stores only its traceback direction.  If the
+//    files drift apart by more than the band, such as when one file has
+//    many more measures than the other, the alignment is the best one
+//    inside of the band, and a warning is given.
+//
+
+void Tool_humdiff::alignTimePoints(vector<pair<int, int>>& alignment,
+		vector<vector<TimePoint>>& timepoints) {
+	alignment.clear();
+	int rows = (int)timepoints.at(0).size();
+	int cols = (int)timepoints.at(1).size();
+
+	vector<vector<vector<pair<int, HumNum>>>> notes(2);
+	vector<vector<HumNum>> durations(2);
+	for (int i=0; i<2; i++) {
+		notes[i].resize(timepoints.at(i).size());
+		durations[i].resize(timepoints.at(i).size());
+		for (int j=0; j<(int)timepoints.at(i).size(); j++) {
+			TimePoint& tp = timepoints.at(i).at(j);
+			getTimePointNotes(notes[i][j], tp);
+			durations[i][j] = (*tp.file.at(0))[tp.index.at(0)].getDuration();
 		}
-		timepoints.at(0).at(indexes.at(0)).index.resize(timepoints.size());
-		for (int i=1; i<(int)timepoints.size(); i++) {
-			timepoints.at(0).at(indexes.at(0)).index.at(i) = -1;
+	}
+
+	// The band must be at least as wide as the average number of
+	// timepoints in the second file for each timepoint in the first file
+	// so that neighboring rows of the band overlap.  It is not widened
+	// further for files with very different lengths, since the time would
+	// then grow with the product of the length and the difference; instead
+	// a warning is given if the best alignment touches the edge of the band.
+	int band = getInteger("band");
+	if (band < 1) {
+		band = 1;
+	}
+	if (rows > 0) {
+		band = std::max(band, cols / rows + 2);
+	}
+
+	// Row i of the band contains the columns [lo[i], hi[i]] centered on
+	// the diagonal.
+	vector<int> lo(rows + 1);
+	vector<int> hi(rows + 1);
+	vector<int64_t> offset(rows + 2, 0);
+	for (int i=0; i<=rows; i++) {
+		int center = rows ? (int)((int64_t)i * cols / rows) : cols;
+		lo[i] = std::max(0, center - band);
+		hi[i] = std::min(cols, center + band);
+		if (i == 0) {
+			lo[i] = 0;
 		}
-		minval = timepoints.at(0).at(indexes.at(0)).timestamp;
-		for (int i=1; i<(int)timepoints.size(); i++) {
-			if (indexes.at(i) >= (int)timepoints.at(i).size()) {
-				continue;
+		if (i == rows) {
+			hi[i] = cols;
+		}
+		offset[i+1] = offset[i] + (hi[i] - lo[i] + 1);
+	}
+
+	// Traceback directions: 0 = match both timepoints, 1 = skip the
+	// timepoint in the first file, 2 = skip the timepoint in the second file.
+	vector<uint8_t> trace(offset[rows+1], 0);
+
+	const int infinity = std::numeric_limits<int>::max() / 2;
+	vector<int> previous(cols + 1, infinity);
+	vector<int> current(cols + 1, infinity);
+
+	for (int i=0; i<=rows; i++) {
+		for (int j=lo[i]; j<=hi[i]; j++) {
+			int best = infinity;
+			uint8_t direction = 0;
+			if ((i == 0) && (j == 0)) {
+				best = 0;
 			}
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
-			if (value < minval) {
-				minval = value;
+			if ((i > 0) && (j > 0) && (j-1 >= lo[i-1]) && (j-1 <= hi[i-1])) {
+				int cost = previous[j-1] + getMatchCost(notes[0][i-1],
+						durations[0][i-1], notes[1][j-1], durations[1][j-1]);
+				if (cost < best) {
+					best = cost;
+					direction = 0;
+				}
 			}
+			if ((i > 0) && (j >= lo[i-1]) && (j <= hi[i-1])) {
+				int cost = previous[j] + (int)notes[0][i-1].size() + 1;
+				if (cost < best) {
+					best = cost;
+					direction = 1;
+				}
+			}
+			if ((j > lo[i])) {
+				int cost = current[j-1] + (int)notes[1][j-1].size() + 1;
+				if (cost < best) {
+					best = cost;
+					direction = 2;
+				}
+			}
+			current[j] = best;
+			trace[offset[i] + j - lo[i]] = direction;
 		}
-		found = 0;
-		fill(increment.begin(), increment.end(), 0);
-
-		for (int i=0; i<(int)timepoints.size(); i++) {
-			if (indexes.at(i) >= (int)timepoints.at(i).size()) {
-				// index is too large for file, so skip checking it.
-				continue;
+		if (i > 0) {
+			for (int j=lo[i-1]; j<=hi[i-1]; j++) {
+				previous[j] = infinity;
 			}
-			found = 1;
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
+		}
+		for (int j=lo[i]; j<=hi[i]; j++) {
+			previous[j] = current[j];
+			current[j] = infinity;
+		}
+	}
 
-			if (value == minval) {
-				timepoints.at(0).at(indexes.at(0)).index.at(i) = timepoints.at(i).at(indexes.at(i)).index.at(0);
-				increment.at(i)++;
-			}
+	int i = rows;
+	int j = cols;
+	bool truncated = false;
+	while ((i > 0) || (j > 0)) {
+		if (((j == lo[i]) && (j > 0)) || ((j == hi[i]) && (j < cols))) {
+			truncated = true;
 		}
-		if (!found) {
-			break;
+		uint8_t direction = trace[offset[i] + j - lo[i]];
+		if ((direction == 0) && (i > 0) && (j > 0)) {
+			alignment.emplace_back(i-1, j-1);
+			i--;
+			j--;
+		} else if ((direction == 1) || (j == 0)) {
+			alignment.emplace_back(i-1, -1);
+			i--;
 		} else {
-			compareLines(minval, indexes, timepoints, infiles);
+			alignment.emplace_back(-1, j-1);
+			j--;
 		}
-		for (int i=0; i<(int)increment.size(); i++) {
-			indexes.at(i) += increment.at(i);
+	}
+	std::reverse(alignment.begin(), alignment.end());
+
+	if (truncated) {
+		m_warning_text << "Warning: the alignment of the files reached the edge "
+		               << "of the band (" << band << " timepoints), so the files "
+		               << "may be better aligned with a larger --band value."
+		               << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getTimePointNotes -- Return a sorted list of the pitches
+//    (base-40) and tied durations of notes which start at the timepoint.
+//
+
+void Tool_humdiff::getTimePointNotes(vector<pair<int, HumNum>>& notes,
+		TimePoint& tp) {
+	vector<NotePoint> notelist;
+	getNoteList(notelist, *tp.file.at(0), tp.index.at(0), tp.measure, 0, -1);
+	notes.resize(notelist.size());
+	for (int i=0; i<(int)notelist.size(); i++) {
+		notes[i].first = notelist[i].b40;
+		notes[i].second = notelist[i].duration;
+	}
+	std::sort(notes.begin(), notes.end());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getMatchCost -- Return the cost of aligning two timepoints:
+//    the number of notes which are found at only one of the timepoints,
+//    plus one if the durations of the timepoints differ.  The note lists
+//    must be sorted.
+//
+
+int Tool_humdiff::getMatchCost(vector<pair<int, HumNum>>& notes1, HumNum dur1,
+		vector<pair<int, HumNum>>& notes2, HumNum dur2) {
+	int cost = (dur1 == dur2) ? 0 : 1;
+	int i = 0;
+	int j = 0;
+	while ((i < (int)notes1.size()) && (j < (int)notes2.size())) {
+		if (notes1[i] < notes2[j]) {
+			cost++;
+			i++;
+		} else if (notes2[j] < notes1[i]) {
+			cost++;
+			j++;
+		} else {
+			i++;
+			j++;
+		}
+	}
+	cost += (int)notes1.size() - i;
+	cost += (int)notes2.size() - j;
+	return cost;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::reportMeasureGaps -- Report measures for which none of the
+//    timepoints have an equivalent in the other file (measures which
+//    were added to or removed from the second file).
+//
+
+void Tool_humdiff::reportMeasureGaps(vector<pair<int, int>>& alignment,
+		vector<vector<TimePoint>>& timepoints) {
+	for (int f=0; f<2; f++) {
+		// paired[i] is true if timepoint i of file f has an equivalent:
+		vector<bool> paired(timepoints.at(f).size(), false);
+		for (int i=0; i<(int)alignment.size(); i++) {
+			int index = f ? alignment[i].second : alignment[i].first;
+			int other = f ? alignment[i].first : alignment[i].second;
+			if ((index >= 0) && (other >= 0)) {
+				paired[index] = true;
+			}
+		}
+		int start = 0;
+		while (start < (int)timepoints.at(f).size()) {
+			int measure = timepoints.at(f).at(start).measure;
+			int end = start;
+			bool found = false;
+			while ((end < (int)timepoints.at(f).size()) &&
+					(timepoints.at(f).at(end).measure == measure)) {
+				found |= paired[end];
+				end++;
+			}
+			if (!found) {
+				HumdrumFile& infile = *timepoints.at(f).at(start).file.at(0);
+				int line = timepoints.at(f).at(start).index.at(0);
+				if (f == 0) {
+					cout << "MEASURE " << measure
+					     << " OF REFERENCE IS MISSING IN SOURCE 1" << endl;
+					cout << "\tREFERENCE LINE NO.\t: " << line+1 << endl;
+					cout << "\tREFERENCE LINE TEXT\t: " << infile[line] << endl;
+				} else {
+					cout << "MEASURE " << measure
+					     << " OF SOURCE 1 IS MISSING IN REFERENCE" << endl;
+					cout << "\tTARGET  1 LINE NO. :\t" << line+1 << endl;
+					cout << "\tTARGET  1 LINE TEXT:\t" << infile[line] << endl;
+				}
+				cout << endl;
+			}
+			start = end;
 		}
 	}
 }
@@ -247,10 +472,12 @@ void Tool_humdiff::markNote(NotePoint& np) {
 
 //////////////////////////////
 //
-// Tool_humdiff::compareLines --
+// Tool_humdiff::compareLines -- Compare the notes at a pair of aligned
+//    timepoints.  An index of -1 means that the file does not have an
+//    equivalent timepoint.
 //
 
-void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
+void Tool_humdiff::compareLines(vector<int>& indexes,
 		vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles) {
 
 	bool reportQ = getBoolean("report");
@@ -261,11 +488,7 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 	// Note: timepoints size must be 2
 	// and infiles size must be 2
 	for (int i=0; i<(int)timepoints.size(); i++) {
-		if (indexes.at(i) >= (int)timepoints.at(i).size()) {
-			continue;
-		}
-		if (timepoints.at(i).at(indexes.at(i)).timestamp != minval) {
-			// not at the same time
+		if (indexes.at(i) < 0) {
 			continue;
 		}
 
@@ -282,6 +505,10 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 		for (int j=1; j<(int)notelist.size(); j++) {
 			int status = findNoteInList(notelist.at(0).at(i), notelist.at(j));
 			notelist.at(0).at(i).matched.at(j) = status;
+			if (status >= 0) {
+				// do not match the same note twice:
+				notelist.at(j).at(status).processed = 1;
+			}
 			if ((status < 0) && !reportQ) {
 				markNote(notelist.at(0).at(i));
 			}
@@ -311,17 +538,32 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 				cout << "\tREFERENCE LINE NO.\t: " << humindex+1 << endl;
 				cout << "\tREFERENCE LINE TEXT\t: " << (*infiles[0])[humindex] << endl;
 
+				int targetindex = -1;
+				if (indexes.at(j) >= 0) {
+					targetindex = timepoints.at(j).at(indexes.at(j)).index.at(0);
+				}
+
 				cout << "\tTARGET  " << j << " LINE NO. ";
 				if (j < 10) {
 					cout << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				cout << ":\t";
+				if (targetindex >= 0) {
+					cout << targetindex+1 << endl;
+				} else {
+					cout << "X" << endl;
+				}
 
 				cout << "\tTARGET  " << j << " LINE TEXT";
 				if (j < 10) {
 					cout << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				cout << ":\t";
+				if (targetindex >= 0) {
+					cout << (*infiles[j])[targetindex] << endl;
+				} else {
+					cout << "X" << endl;
+				}
 
 				cout << endl;
 			}
@@ -391,7 +633,7 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 			notelist.back().subtoken = subtok;
 			notelist.back().subindex = j;
 			notelist.back().measurequarter = token->getDurationFromBarline();
-			notelist.back().measure =
+			notelist.back().measure = measure;
 			notelist.back().track = track;
 			notelist.back().layer = layer;
 			notelist.back().sourceindex = sourceindex;
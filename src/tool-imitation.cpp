@@ -26,7 +26,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <map>
 #include <sstream>
+#include <unordered_map>
 
 using namespace std;
 
@@ -35,9 +38,6 @@ namespace hum {
 // START_MERGE
 
 
-int Tool_imitation::Enumerator = 0;
-
-
 /////////////////////////////////
 //
 // Tool_imitation::Tool_imitation -- Set the recognized options for the tool.
@@ -121,7 +121,7 @@ bool Tool_imitation::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_imitation::run(HumdrumFile& infile) {
-	Enumerator = 0;
+	m_enumerator = 0;
 
 	NoteGrid grid(infile);
 
@@ -130,7 +130,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		// return 1;
 	}
 
-	Enumerator = 0;
+	m_enumerator = 0;
 	m_threshold = getInteger("threshold") + 1;
 	if (m_threshold < 3) {
 		m_threshold = 3;
@@ -226,7 +226,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 			infile.insertDataSpineBefore(track, results.at(i-1), "", exinterp);
 		}
 	}
-	if (m_mark && Enumerator) {
+	if (m_mark && m_enumerator) {
 		string rdfline = "!!!RDF**kern: ";
 		rdfline += m_marker;
 		rdfline += " = marked note (color=\"chocolate\")";
@@ -239,8 +239,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		}
 	}
 	infile.createLinesFromTokens();
-	// new data spines not showing up after createLinesFromTokens(), so force to text for now:
-	m_humdrum_text << infile;
+	setModifiedStructure();
 	return true;
 }
 
@@ -325,20 +324,82 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 	vector<int> enum1(v1a.size(), 0);
 	vector<int> enum2(v2a.size(), 0);
 
+	// Group the start positions in the second voice by their first
+	// interval.  compareSequences() can only return a non-zero count when
+	// the first intervals match, so the other positions do not have to
+	// be compared (and do not affect the skipping over partial matches).
+	// Also group them by their first min-1 intervals: a match needs at
+	// least that many matching intervals, so only these positions can
+	// start a match (candidates).
+	int keysize = min - 1;
+	map<double, vector<int>> positions;
+	std::unordered_map<string, vector<int>> candidates;
+	for (int j=0; j<(int)v2i.size() - 1; j++) {
+		if (Convert::isNaN(v2i.at(j))) {
+			// sequences cannot start with rests
+			continue;
+		}
+		if (m_rest2) {
+			if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+				// match target must be preceded by a rest (or start of music)
+				continue;
+			}
+		}
+		positions[v2i.at(j)].push_back(j);
+		if (j + keysize <= (int)v2i.size()) {
+			candidates[getIntervalKey(v2i, j, keysize, false)].push_back(j);
+		}
+	}
+
 	for (int i=0; i<(int)v1i.size() - 1; i++) {
+		if (m_rest || m_rest2) {
+			if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
+				// match initiator must be preceded by a rest (or start of music)
+				continue;
+			}
+		}
+		if (Convert::isNaN(v1i.at(i))) {
+			continue;
+		}
+		if (i + keysize > (int)v1i.size()) {
+			continue;
+		}
+		auto cfound = candidates.find(getIntervalKey(v1i, i, keysize, m_inversion));
+		if (cfound == candidates.end()) {
+			continue;
+		}
+		vector<int>& clist = cfound->second;
+		vector<int>& jlist = positions[m_inversion ? -v1i.at(i) : v1i.at(i)];
 		count = 0;
-		for (int j=0; j<(int)v2i.size() - 1; j++) {
-			if (m_rest || m_rest2) {
-				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
-					// match initiator must be preceded by a rest (or start of music)
-					continue;
-				}
+		int nextj = 0;
+		int c = 0;
+		int jumped = -1;
+		for (int p=0; p<(int)jlist.size(); p++) {
+			while ((c < (int)clist.size()) && (clist[c] < jlist[p])) {
+				c++;
 			}
-			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
-					// match target must be preceded by a rest (or start of music)
-					continue;
+			if (c >= (int)clist.size()) {
+				// no more matches are possible
+				break;
+			}
+			if (jumped != c) {
+				// Jump to the last position before the next candidate
+				// which follows a gap of at least min positions.  Positions
+				// before the gap are not candidates, so they skip at most
+				// min-1 positions and cannot skip over the position after
+				// the gap.
+				jumped = c;
+				int target = (int)(std::lower_bound(jlist.begin() + p, jlist.end(),
+						clist[c]) - jlist.begin());
+				while ((target > p) && (jlist[target-1] > jlist[target] - min)) {
+					target--;
 				}
+				p = target;
+			}
+			int j = jlist[p];
+			if (j < nextj) {
+				// skipped over by the previous comparison
+				continue;
 			}
 			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
 				// avoid re-matching an existing match as a submatch
@@ -349,7 +410,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				count = checkForIntervalSequence(m_intervals, v1i, i, count);
 			}
 			if (count < min) {
-				j += count;
+				nextj = j + count + 1;
 				continue;
 			}
 
@@ -362,14 +423,14 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 			HumNum distance2 = time1 - time2;
 
 			if (m_maxdistanceQ && (distance1.getAbs().getFloat() > m_maxdistance)) {
-				j += count;
+				nextj = j + count + 1;
 				continue;
 			}
 
-			Enumerator++;
+			m_enumerator++;
 			for (int k=0; k<count; k++) {
-				enum1.at(i+k) = Enumerator;
-				enum2.at(j+k) = Enumerator;
+				enum1.at(i+k) = m_enumerator;
+				enum2.at(j+k) = m_enumerator;
 			}
 
 			int interval = int(*attacks.at(v2).at(j) - *attacks.at(v1).at(i));
@@ -392,7 +453,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v1).at(line1) += "n";
 						}
-						results.at(v1).at(line1) += to_string(Enumerator);
+						results.at(v1).at(line1) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -499,7 +560,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v2).at(line2) += "n";
 						}
-						results.at(v2).at(line2) += to_string(Enumerator);
+						results.at(v2).at(line2) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -626,13 +687,42 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 			}
 
 			// skip over match (need to do in i as well somehow)
-			j += count;
+			nextj = j + count + 1;
 		} // j loop
 	} // i loop
 }
 
 
 
+//////////////////////////////
+//
+// Tool_imitation::getIntervalKey -- Return a hash key for a sequence
+//    of intervals (inverted if negate is true).  Rests (NaN) are equal
+//    to each other as in compareSequences().
+//
+
+string Tool_imitation::getIntervalKey(vector<double>& intervals, int start,
+		int count, bool negate) {
+	string key;
+	key.resize(count * sizeof(double));
+	for (int i=0; i<count; i++) {
+		double value = intervals.at(start + i);
+		if (Convert::isNaN(value)) {
+			value = NAN;
+		} else if (negate) {
+			value = -value;
+		}
+		if (value == 0.0) {
+			// do not distinguish between -0.0 and 0.0
+			value = 0.0;
+		}
+		memcpy(&key[i * sizeof(double)], &value, sizeof(double));
+	}
+	return key;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_imitation::markedTiedNotes --
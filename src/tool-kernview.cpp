@@ -164,6 +164,7 @@ void Tool_kernview::processFile(HumdrumFile& infile) {
 
 	int line = kernish[0]->getLineIndex();
 	infile[line].createLineFromTokens();
+	setModifiedStructure();
 
 }
 
@@ -14,6 +14,11 @@
 #include "HumRegex.h"
 #include "Convert.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <unordered_set>
+
 using namespace std;
 
 namespace hum {
@@ -33,6 +38,10 @@ Tool_msearch::Tool_msearch(void) {
 	define("x|cross=b",         "search across parts");
 	define("c|color=s",         "highlight color");
 	define("m|mark|marker=s:@", "marking character");
+	define("index=s",           "n-gram index of the input files (skip files without matches)");
+	define("query-file=s",      "file of music queries, one per line");
+	define("l|list=b",          "list matches rather than marking them");
+	define("threads=i:1",       "number of segments to process in parallel");
 }
 
 
@@ -75,21 +84,42 @@ bool Tool_msearch::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_msearch::run(HumdrumFile& infile) {
-	NoteGrid grid(infile);
-	if (getBoolean("debug")) {
-		grid.printGridInfo(cerr);
-		// return 1;
-	}
 	initialize();
 
 	if (getBoolean("text")) {
 		m_text = getString("text");
 	}
 
+	if (m_text.empty() && !loadQueries()) {
+		return false;
+	}
+	if (m_text.empty() && getBoolean("list")) {
+		suppressHumdrumFileOutput();
+	}
+
+	if (getBoolean("index") && !loadIndex()) {
+		return false;
+	}
+
+	vector<MSearchPosting> candidates;
+	bool indexQ = false;
+	if (m_text.empty() && getBoolean("index")) {
+		indexQ = getIndexCandidates(infile, candidates);
+		if (indexQ && candidates.empty() && !getBoolean("debug")) {
+			// No matches in file, so do not create the note grid.  The
+			// file is printed unchanged as when there are no matches.
+			return true;
+		}
+	}
+
+	NoteGrid grid(infile);
+	if (getBoolean("debug")) {
+		grid.printGridInfo(cerr);
+		// return 1;
+	}
+
 	if (m_text.empty()) {
-		vector<MSearchQueryToken> query;
-		fillMusicQuery(query, getString("query"));
-		doMusicSearch(infile, grid, query);
+		doMusicSearch(infile, grid, indexQ ? &candidates : NULL);
 	} else {
 		vector<MSearchTextQuery> query;
 		fillTextQuery(query, getString("text"));
@@ -113,6 +143,158 @@ void Tool_msearch::initialize(void) {
 
 
 
+//////////////////////////////
+//
+// Tool_msearch::loadQueries -- Parse the music queries the first time
+//    that they are needed, and compile them into the matcher.  Returns
+//    false if the query file cannot be read.
+//
+
+bool Tool_msearch::loadQueries(void) {
+	if (m_queriesloaded) {
+		return true;
+	}
+	m_queries.clear();
+	m_querystrings.clear();
+	m_matcher.clear();
+	if (getBoolean("query-file")) {
+		ifstream input(getString("query-file").c_str());
+		if (!input.is_open()) {
+			m_error_text << "Error: cannot read query file "
+			             << getString("query-file") << endl;
+			return false;
+		}
+		string line;
+		while (getline(input, line)) {
+			if (!line.empty() && (line.back() == '\r')) {
+				line.pop_back();
+			}
+			if (line.empty()) {
+				continue;
+			}
+			m_querystrings.push_back(line);
+		}
+	} else {
+		m_querystrings.push_back(getString("query"));
+	}
+	m_queries.resize(m_querystrings.size());
+	for (int i=0; i<(int)m_querystrings.size(); i++) {
+		fillMusicQuery(m_queries[i], m_querystrings[i]);
+		m_matcher.addQuery(m_queries[i]);
+	}
+	m_queriesloaded = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::loadIndex -- Read the n-gram index given by the --index
+//    option the first time that it is needed, and look up the locations
+//    of the music queries in all of the indexed files.  Returns false if
+//    the index cannot be read.
+//
+
+bool Tool_msearch::loadIndex(void) {
+	if (m_indexloaded) {
+		return true;
+	}
+	if (!m_index.read(getString("index"))) {
+		m_error_text << "Error: cannot read index file "
+		             << getString("index") << endl;
+		return false;
+	}
+	m_indexloaded = true;
+	if (!m_text.empty()) {
+		return true;
+	}
+	// The candidates are the locations of any of the queries.  If one
+	// of the queries is too short to be looked up, all files are
+	// searched completely.
+	m_indexusable = true;
+	m_candidates.clear();
+	vector<MSearchPosting> matches;
+	for (int i=0; i<(int)m_queries.size(); i++) {
+		if (!m_index.search(m_queries[i], matches)) {
+			m_indexusable = false;
+			m_candidates.clear();
+			break;
+		}
+		m_candidates.insert(m_candidates.end(), matches.begin(), matches.end());
+	}
+	sort(m_candidates.begin(), m_candidates.end());
+	m_candidates.erase(unique(m_candidates.begin(), m_candidates.end()),
+			m_candidates.end());
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::filterFileList -- Remove the input files which are in
+//    the index (--index option) but have no possible matches for the
+//    music queries, so that they do not need to be read at all.  Files
+//    which are not in the index are kept and searched completely.
+//    Returns false if the list cannot be filtered, in which case it is
+//    not changed.
+//
+
+bool Tool_msearch::filterFileList(vector<string>& files) {
+	if (!getBoolean("index") || getBoolean("text") || getBoolean("debug")) {
+		return false;
+	}
+	if (!loadQueries() || !loadIndex() || !m_indexusable) {
+		return false;
+	}
+	// Filenames can be repeated in the index, so use the names of the
+	// files with candidates rather than their indexes:
+	std::unordered_set<string> matched;
+	for (int i=0; i<(int)m_candidates.size(); i++) {
+		matched.insert(m_index.getFileName(m_candidates[i].file));
+	}
+	vector<string> output;
+	for (int i=0; i<(int)files.size(); i++) {
+		if ((m_index.getFileIndex(files[i]) < 0) ||
+				(matched.find(files[i]) != matched.end())) {
+			output.push_back(files[i]);
+		}
+	}
+	files.swap(output);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::getIndexCandidates -- Return the possible match locations
+//    in a file as found in the index.  Returns false if the index cannot
+//    be used, either because the file is not in the index or because
+//    a query is too short, in which case the whole file is searched.
+//
+
+bool Tool_msearch::getIndexCandidates(HumdrumFile& infile,
+		vector<MSearchPosting>& candidates) {
+	candidates.clear();
+	if (!m_indexusable) {
+		return false;
+	}
+	int findex = m_index.getFileIndex(infile.getFilename());
+	if (findex < 0) {
+		return false;
+	}
+	auto first = lower_bound(m_candidates.begin(), m_candidates.end(),
+			MSearchPosting(findex, 0, 0));
+	auto last = lower_bound(first, m_candidates.end(),
+			MSearchPosting(findex + 1, 0, 0));
+	candidates.assign(first, last);
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::fillWords --
@@ -237,6 +419,7 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 		}
 		infile.appendLine(content);
 		infile.createLinesFromTokens();
+		setModifiedStructure();
 	}
 
 	for (int i=0; i<(int)words.size(); i++) {
@@ -250,38 +433,60 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 //////////////////////////////
 //
 // Tool_msearch::doMusicSearch -- do a basic melodic search of all parts.
+//    All queries are searched for in one pass through each voice.  If
+//    a list of candidates from the index is given, then only the voices
+//    which contain a candidate location are searched.
 //
 
 void Tool_msearch::doMusicSearch(HumdrumFile& infile, NoteGrid& grid,
-		vector<MSearchQueryToken>& query) {
-
-	vector<vector<NoteCell*>> attacks;
-	attacks.resize(grid.getVoiceCount());
-	for (int i=0; i<grid.getVoiceCount(); i++) {
-		grid.getNoteAndRestAttacks(attacks[i], i);
+		vector<MSearchPosting>* candidates) {
+
+	vector<bool> searchvoice(grid.getVoiceCount(), candidates == NULL);
+	if (candidates) {
+		for (int k=0; k<(int)candidates->size(); k++) {
+			int i = candidates->at(k).voice;
+			if ((i >= 0) && (i < (int)searchvoice.size())) {
+				searchvoice[i] = true;
+			}
+		}
 	}
 
-	vector<NoteCell*>  match;
+	bool listQ = getBoolean("list");
+	vector<NoteCell*> attacks;
+	vector<NoteCell*> match;
+	vector<MSearchMatch> matches;
 	int mcount = 0;
-	for (int i=0; i<(int)attacks.size(); i++) {
-		for (int j=0; j<(int)attacks[i].size(); j++) {
-			checkForMatchDiatonicPC(attacks[i], j, query, match);
-			if (!match.empty()) {
-				mcount++;
+	for (int i=0; i<grid.getVoiceCount(); i++) {
+		if (!searchvoice[i]) {
+			continue;
+		}
+		grid.getNoteAndRestAttacks(attacks, i);
+		m_matcher.search(attacks, matches);
+		for (int j=0; j<(int)matches.size(); j++) {
+			match.clear();
+			match.push_back(attacks[matches[j].start]);
+			if (matches[j].end < 0) {
+				match.push_back(NULL);
+			} else {
+				match.push_back(attacks[matches[j].end]);
+			}
+			mcount++;
+			if (listQ) {
+				printMatch(infile, matches[j].query, match);
+			} else {
 				markMatch(infile, match);
-				// cerr << "FOUND MATCH AT " << i << ", " << j << endl;
-				// markNotes(attacks[i], j, (int)query.size());
 			}
 		}
 	}
 
-	if (mcount) {
+	if (mcount && !listQ) {
 		string content = "!!!RDF**kern: " + m_marker + " = marked note";
 		if (getBoolean("color")) {
 			content += ", color=\"" + getString("color") + "\"";
 		}
 		infile.appendLine(content);
 		infile.createLinesFromTokens();
+		setModifiedStructure();
 	}
 }
 
@@ -331,6 +536,28 @@ void Tool_msearch::markMatch(HumdrumFile& infile, vector<NoteCell*>& match) {
 
 
 
+//////////////////////////////
+//
+// Tool_msearch::printMatch -- List the location of a match (filename,
+//    query, and line and field number of the first note).
+//
+
+void Tool_msearch::printMatch(HumdrumFile& infile, int query,
+		vector<NoteCell*>& match) {
+	if (match.empty()) {
+		return;
+	}
+	HTp mstart = match[0]->getToken();
+	m_free_text << infile.getFilename() << '\t' << m_querystrings.at(query);
+	if (mstart) {
+		m_free_text << '\t' << mstart->getLineNumber()
+		            << '\t' << mstart->getFieldNumber();
+	}
+	m_free_text << endl;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::markTextMatch -- assumes monophonic voices.
@@ -647,6 +874,758 @@ void Tool_msearch::fillMusicQuery(vector<MSearchQueryToken>& query,
 }
 
 
+
+//////////////////////////////
+//
+// MSearchIndex::MSearchIndex -- Constructor.
+//
+
+MSearchIndex::MSearchIndex(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::~MSearchIndex -- Deconstructor.
+//
+
+MSearchIndex::~MSearchIndex() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::clear -- Remove all files from the index.
+//
+
+void MSearchIndex::clear(void) {
+	m_files.clear();
+	m_fileindex.clear();
+	m_postings.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::setNgramLength -- Set the number of attacks in each
+//    index key (default 3).  Changing the length clears the index.
+//
+
+void MSearchIndex::setNgramLength(int length) {
+	if (length < 1) {
+		length = 1;
+	}
+	if (length != m_ngram) {
+		clear();
+		m_ngram = length;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNgramLength -- Return the number of attacks in
+//    each index key.
+//
+
+int MSearchIndex::getNgramLength(void) const {
+	return m_ngram;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addFile -- Add the n-grams of diatonic pitch classes in
+//    all voices of a file to the index.  The attacks are counted in the
+//    same way as in Tool_msearch::doMusicSearch (notes and first rest
+//    slices).  Returns the index of the file.
+//
+
+int MSearchIndex::addFile(HumdrumFile& infile) {
+	NoteGrid grid(infile);
+	return addFile(infile.getFilename(), grid);
+}
+
+
+int MSearchIndex::addFile(const string& filename, NoteGrid& grid) {
+	int findex = (int)m_files.size();
+	m_files.push_back(filename);
+	m_fileindex.emplace(filename, findex);
+
+	vector<NoteCell*> attacks;
+	string symbols;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		symbols.clear();
+		for (int a=0; a<(int)attacks.size(); a++) {
+			symbols += getNoteSymbol(attacks[a]);
+		}
+		for (int a=0; a+m_ngram<=(int)symbols.size(); a++) {
+			m_postings[symbols.substr(a, m_ngram)].emplace_back(findex, v, a);
+		}
+	}
+	return findex;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::write -- Save the index to a file or to an output
+//    stream.  The format is:
+//       MSearchIndex   1
+//       ngram          <n-gram length>
+//       file           <filename>   (one line for each file, in order)
+//    followed by one line for each n-gram, sorted:
+//       <n-gram>   <file>,<voice>,<attack>   ...
+//
+
+bool MSearchIndex::write(const string& indexfile) const {
+	std::ofstream output(indexfile.c_str(), std::ios::out | std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	write(output);
+	output.close();
+	return !output.fail();
+}
+
+
+ostream& MSearchIndex::write(ostream& out) const {
+	out << "MSearchIndex\t1\n";
+	out << "ngram\t" << m_ngram << "\n";
+	for (int i=0; i<(int)m_files.size(); i++) {
+		out << "file\t" << m_files[i] << "\n";
+	}
+	vector<string> keys;
+	keys.reserve(m_postings.size());
+	for (auto& it : m_postings) {
+		keys.push_back(it.first);
+	}
+	sort(keys.begin(), keys.end());
+	for (int i=0; i<(int)keys.size(); i++) {
+		const vector<MSearchPosting>& postings = m_postings.at(keys[i]);
+		out << keys[i];
+		for (int j=0; j<(int)postings.size(); j++) {
+			out << (j == 0 ? '\t' : ' ') << postings[j].file << ','
+			    << postings[j].voice << ',' << postings[j].attack;
+		}
+		out << '\n';
+	}
+	return out;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::read -- Load an index from a file or from an input
+//    stream.  Returns false if the input is not an msearch index.
+//
+
+bool MSearchIndex::read(const string& indexfile) {
+	ifstream input(indexfile.c_str(), std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	return read(input);
+}
+
+
+bool MSearchIndex::read(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line.compare(0, 13, "MSearchIndex\t") != 0)) {
+		return false;
+	}
+	while (getline(input, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		if (line.compare(0, 6, "ngram\t") == 0) {
+			m_ngram = atoi(line.c_str() + 6);
+			if (m_ngram < 1) {
+				clear();
+				return false;
+			}
+			continue;
+		}
+		if (line.compare(0, 5, "file\t") == 0) {
+			int findex = (int)m_files.size();
+			m_files.push_back(line.substr(5));
+			m_fileindex.emplace(m_files.back(), findex);
+			continue;
+		}
+		// n-gram entry: key followed by comma-separated postings
+		size_t tab = line.find('\t');
+		if (tab == string::npos) {
+			clear();
+			return false;
+		}
+		vector<MSearchPosting>& postings = m_postings[line.substr(0, tab)];
+		const char* ptr = line.c_str() + tab;
+		char* end;
+		while ((*ptr == '\t') || (*ptr == ' ')) {
+			MSearchPosting posting;
+			posting.file = (int)strtol(ptr + 1, &end, 10);
+			if (*end != ',') {
+				clear();
+				return false;
+			}
+			posting.voice = (int)strtol(end + 1, &end, 10);
+			if (*end != ',') {
+				clear();
+				return false;
+			}
+			posting.attack = (int)strtol(end + 1, &end, 10);
+			postings.push_back(posting);
+			ptr = end;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileCount -- Return the number of indexed files.
+//
+
+int MSearchIndex::getFileCount(void) const {
+	return (int)m_files.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileIndex -- Return the index of a file, or -1 if
+//    the file is not in the index.
+//
+
+int MSearchIndex::getFileIndex(const string& filename) const {
+	auto it = m_fileindex.find(filename);
+	if (it == m_fileindex.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileName -- Return the filename of an indexed file.
+//
+
+const string& MSearchIndex::getFileName(int index) const {
+	static string empty;
+	if ((index < 0) || (index >= (int)m_files.size())) {
+		return empty;
+	}
+	return m_files[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNgramCount -- Return the number of different n-grams
+//    in the index.
+//
+
+int MSearchIndex::getNgramCount(void) const {
+	return (int)m_postings.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::search -- Find the possible match locations of a
+//    music query.  The longest run of pitches/rests in the query is
+//    looked up, and the returned postings give the attack indexes where
+//    Tool_msearch::checkForMatchDiatonicPC has to be tried (the rest of
+//    the query, such as rhythms, intervals and accidentals, has to be
+//    checked in the file).  The matches are sorted by file.  Returns
+//    false if the query does not contain enough pitches to use the index.
+//
+
+bool MSearchIndex::search(const vector<MSearchQueryToken>& query,
+		vector<MSearchPosting>& matches) const {
+	matches.clear();
+	string symbols;
+	int offset = getLongestPitchRun(query, symbols);
+	if ((int)symbols.size() < m_ngram) {
+		return false;
+	}
+
+	int count = (int)symbols.size() - m_ngram + 1;
+	vector<const vector<MSearchPosting>*> lists(count, NULL);
+	int best = 0;
+	for (int k=0; k<count; k++) {
+		auto it = m_postings.find(symbols.substr(k, m_ngram));
+		if (it == m_postings.end()) {
+			// no matches in any file
+			return true;
+		}
+		lists[k] = &it->second;
+		if (lists[k]->size() < lists[best]->size()) {
+			best = k;
+		}
+	}
+
+	// Start with the n-gram that has the fewest postings, and check that
+	// the other n-grams follow it:
+	for (int i=0; i<(int)lists[best]->size(); i++) {
+		const MSearchPosting& posting = lists[best]->at(i);
+		int start = posting.attack - best;
+		if (start - offset < 0) {
+			continue;
+		}
+		bool found = true;
+		for (int k=0; k<count; k++) {
+			if (k == best) {
+				continue;
+			}
+			MSearchPosting target(posting.file, posting.voice, start + k);
+			if (!binary_search(lists[k]->begin(), lists[k]->end(), target)) {
+				found = false;
+				break;
+			}
+		}
+		if (found) {
+			matches.emplace_back(posting.file, posting.voice, start - offset);
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getLongestPitchRun -- Return the symbols of the longest
+//    run of consecutive pitch/rest tokens in a query.  Query tokens are
+//    mapped to attacks in the same way as in
+//    Tool_msearch::checkForMatchDiatonicPC.  The return value is the attack
+//    offset of the run from the start of a match.
+//
+
+int MSearchIndex::getLongestPitchRun(const vector<MSearchQueryToken>& query,
+		string& symbols) const {
+	symbols.clear();
+	int offset = 0;
+	string current;
+	int currentoffset = 0;
+	bool lastIsInterval = false;
+	int c = 0;
+	for (int i=0; i<(int)query.size(); i++) {
+		char symbol = 0;
+		if (query[i].anything) {
+			// matches any note
+		} else if (query[i].base <= 0) {
+			lastIsInterval = true;
+		} else {
+			if (lastIsInterval) {
+				c++;
+				lastIsInterval = false;
+			}
+			symbol = getQuerySymbol(query[i]);
+		}
+		if (!symbol) {
+			current.clear();
+			continue;
+		}
+		if (current.empty()) {
+			currentoffset = i - c;
+		}
+		current += symbol;
+		if (current.size() > symbols.size()) {
+			symbols = current;
+			offset = currentoffset;
+		}
+	}
+	return offset;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNoteSymbol -- Return the index symbol of a note
+//    attack: c, d, e, f, g, a or b for the diatonic pitch class, or r for
+//    rests.
+//
+
+char MSearchIndex::getNoteSymbol(NoteCell* cell) {
+	static const char* letters = "cdefgab";
+	double dpc = cell->getAbsDiatonicPitchClass();
+	if (Convert::isNaN(dpc)) {
+		return 'r';
+	}
+	return letters[(int)dpc % 7];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getQuerySymbol -- Return the index symbol for a pitch
+//    or rest query token, or 0 if the token does not have a pitch.
+//
+
+char MSearchIndex::getQuerySymbol(const MSearchQueryToken& token) {
+	static const char* letters = "cdefgab";
+	if (Convert::isNaN(token.pc)) {
+		return 'r';
+	}
+	if (token.pc < 0) {
+		return 0;
+	}
+	if (token.base == 40) {
+		return letters[Convert::base40ToDiatonic((int)token.pc) % 7];
+	} else if (token.base == 7) {
+		return letters[(int)token.pc % 7];
+	}
+	return 0;
+}
+
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::MSearchMatcher -- Constructor.
+//
+
+MSearchMatcher::MSearchMatcher(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::~MSearchMatcher -- Deconstructor.
+//
+
+MSearchMatcher::~MSearchMatcher() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::clear -- Remove all queries.
+//
+
+void MSearchMatcher::clear(void) {
+	m_queries.clear();
+	m_bitcount = 0;
+	m_bitquery.clear();
+	m_start.clear();
+	m_final.clear();
+	m_dpcrows.assign(8, vector<uint64_t>());
+	m_b40rows.assign(41, vector<uint64_t>());
+	m_b40dirrows.assign(4, vector<uint64_t>());
+	m_midirows.assign(4, vector<uint64_t>());
+	m_durrows.clear();
+	m_durother.clear();
+	m_durations.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::addQuery -- Compile a query into the matcher (a
+//    bit-parallel Shift-And automaton with one state bit for each attack
+//    of each query).  Query tokens are mapped to attacks, and checked
+//    against the notes, in the same way as in
+//    Tool_msearch::checkForMatchDiatonicPC.  Returns the index of the
+//    query.
+//
+
+int MSearchMatcher::addQuery(const vector<MSearchQueryToken>& query) {
+	int qindex = (int)m_queries.size();
+
+	vector<int> positions(query.size());
+	bool lastIsInterval = false;
+	int c = 0;
+	for (int i=0; i<(int)query.size(); i++) {
+		if (query[i].anything) {
+			// matches any note
+		} else if (query[i].base <= 0) {
+			lastIsInterval = true;
+		} else if (lastIsInterval) {
+			// pitch is checked at the same note as the interval
+			c++;
+			lastIsInterval = false;
+		}
+		positions[i] = i - c;
+	}
+
+	QueryInfo info;
+	info.tokens = (int)query.size();
+	info.length = (int)query.size() - c;
+	info.firstbit = m_bitcount;
+	m_queries.push_back(info);
+	if (info.length == 0) {
+		return qindex;
+	}
+
+	m_bitcount += info.length;
+	m_bitquery.resize(m_bitcount, qindex);
+	int words = (m_bitcount + 63) / 64;
+	m_start.resize(words, 0);
+	m_final.resize(words, 0);
+	resizeRows(m_dpcrows, words);
+	resizeRows(m_b40rows, words);
+	resizeRows(m_b40dirrows, words);
+	resizeRows(m_midirows, words);
+	resizeRows(m_durrows, words);
+	m_durother.resize(words, ~0ULL);
+
+	int bit = info.firstbit;
+	m_start[bit / 64] |= 1ULL << (bit % 64);
+	bit = info.firstbit + info.length - 1;
+	m_final[bit / 64] |= 1ULL << (bit % 64);
+
+	for (int i=0; i<(int)query.size(); i++) {
+		const MSearchQueryToken& token = query[i];
+		bit = info.firstbit + positions[i];
+		if (token.anything) {
+			continue;
+		}
+		if (token.base <= 0) {
+			// gross contour (rhythm is not checked)
+			if (token.direction > 0) {
+				restrictBit(m_midirows, bit, 0);
+			} else if (token.direction < 0) {
+				restrictBit(m_midirows, bit, 1);
+			} else {
+				restrictBit(m_midirows, bit, 2);
+			}
+			continue;
+		}
+
+		int pc = Convert::isNaN(token.pc) ? -1 : (int)token.pc;
+		if (token.base == 40) {
+			if (Convert::isNaN(token.pc)) {
+				pc = 40;
+			} else if ((pc < 0) || (pc >= 40)) {
+				pc = -1;
+			}
+			restrictBit(m_b40rows, bit, pc);
+		} else {
+			if (Convert::isNaN(token.pc)) {
+				pc = 7;
+			} else if ((pc < 0) || (pc >= 7)) {
+				pc = -1;
+			}
+			restrictBit(m_dpcrows, bit, pc);
+		}
+
+		// direction is not checked for the first note of a voice (3):
+		if (token.direction > 0) {
+			restrictBit(m_b40dirrows, bit, 0, 3);
+		} else if (token.direction < 0) {
+			restrictBit(m_b40dirrows, bit, 1, 3);
+		}
+
+		if (!token.rhythm.empty()) {
+			int row = getDurationRow(token.duration);
+			restrictBit(m_durrows, bit, row);
+			m_durother[bit / 64] &= ~(1ULL << (bit % 64));
+		}
+	}
+
+	return qindex;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::getQueryCount -- Return the number of queries.
+//
+
+int MSearchMatcher::getQueryCount(void) const {
+	return (int)m_queries.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::resizeRows -- Add state words to each row of a
+//     feature table.  New query attacks accept all features until
+//     they are restricted.
+//
+
+void MSearchMatcher::resizeRows(vector<vector<uint64_t>>& rows, int words) {
+	for (int i=0; i<(int)rows.size(); i++) {
+		rows[i].resize(words, ~0ULL);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::restrictBit -- Clear a state bit in all rows of a
+//     feature table except for the allowed rows.
+//
+
+void MSearchMatcher::restrictBit(vector<vector<uint64_t>>& rows, int bit,
+		int allowed, int allowed2) {
+	uint64_t mask = ~(1ULL << (bit % 64));
+	for (int i=0; i<(int)rows.size(); i++) {
+		if ((i == allowed) || (i == allowed2)) {
+			continue;
+		}
+		rows[i][bit / 64] &= mask;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::getDurationRow -- Return the row in m_durrows for a
+//     duration, adding a new row if the duration is not in any previous
+//     query.
+//
+
+int MSearchMatcher::getDurationRow(HumNum duration) {
+	for (int i=0; i<(int)m_durations.size(); i++) {
+		if (m_durations[i] == duration) {
+			return i;
+		}
+	}
+	m_durations.push_back(duration);
+	// a new duration is accepted by the same attacks as other durations:
+	m_durrows.push_back(m_durother);
+	return (int)m_durrows.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::search -- Find all matches of all queries in a list of
+//     note and rest attacks with one pass through the list.  Matches are
+//     sorted by their last note, and then by query index.
+//
+
+void MSearchMatcher::search(vector<NoteCell*>& notes,
+		vector<MSearchMatch>& matches) {
+	matches.clear();
+	int count = (int)notes.size();
+	int words = (int)m_start.size();
+	vector<uint64_t> state(words, 0);
+
+	for (int k=0; k<count; k++) {
+		NoteCell* note = notes[k];
+
+		double value = note->getAbsDiatonicPitchClass();
+		int dpc = Convert::isNaN(value) ? 7 : (int)value;
+		value = note->getAbsBase40PitchClass();
+		int b40 = Convert::isNaN(value) ? 40 : (int)value;
+		int b40dir = 3;
+		int mididir = 3;
+		if (k > 0) {
+			int interval = (int)(note->getAbsBase40Pitch() -
+					notes[k-1]->getAbsBase40Pitch());
+			b40dir = interval > 0 ? 0 : (interval < 0 ? 1 : 2);
+			double midi = note->getAbsMidiPitch();
+			double lastmidi = notes[k-1]->getAbsMidiPitch();
+			if (midi > lastmidi) {
+				mididir = 0;
+			} else if (midi < lastmidi) {
+				mididir = 1;
+			} else if (midi == lastmidi) {
+				mididir = 2;
+			}
+		}
+		const uint64_t* durrow = m_durother.data();
+		if (!m_durations.empty()) {
+			HumNum duration = note->getDuration();
+			for (int i=0; i<(int)m_durations.size(); i++) {
+				if (m_durations[i] == duration) {
+					durrow = m_durrows[i].data();
+					break;
+				}
+			}
+		}
+		const uint64_t* dpcrow = m_dpcrows[dpc].data();
+		const uint64_t* b40row = m_b40rows[b40].data();
+		const uint64_t* b40dirrow = m_b40dirrows[b40dir].data();
+		const uint64_t* midirow = m_midirows[mididir].data();
+
+		uint64_t carry = 0;
+		for (int w=0; w<words; w++) {
+			uint64_t next = (state[w] << 1) | carry | m_start[w];
+			carry = state[w] >> 63;
+			state[w] = next & dpcrow[w] & b40row[w] & b40dirrow[w] &
+					midirow[w] & durrow[w];
+			uint64_t found = state[w] & m_final[w];
+			while (found) {
+				int b = 0;
+				while (!(found & (1ULL << b))) {
+					b++;
+				}
+				found &= ~(1ULL << b);
+				int qindex = m_bitquery[w * 64 + b];
+				addMatch(matches, qindex, k - m_queries[qindex].length + 1, count);
+			}
+		}
+
+		// Empty queries match at every note:
+		for (int q=0; q<(int)m_queries.size(); q++) {
+			if (m_queries[q].length == 0) {
+				addMatch(matches, q, k, count);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchMatcher::addMatch -- Store a match if the query fits before the
+//     end of the voice.  The length check and the note after the match
+//     follow Tool_msearch::checkForMatchDiatonicPC, which counts query
+//     tokens rather than attacks.
+//
+
+void MSearchMatcher::addMatch(vector<MSearchMatch>& matches, int query,
+		int start, int count) {
+	const QueryInfo& info = m_queries[query];
+	if (start + info.tokens > count) {
+		return;
+	}
+	int end = -1;
+	if (start + info.tokens < count) {
+		end = start + info.length;
+	}
+	matches.emplace_back(query, start, end);
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
@@ -146,13 +146,32 @@ void Tool_periodicity::printPeriodicityAnalysis(ostream& out, vector<vector<doub
 
 //////////////////////////////
 //
-// Tool_periodicity::doPeriodicAnalysis --
+// Tool_periodicity::doPeriodicAnalysis -- Fold the attack grid at each
+//    period from 1 to minrhy.  At fine rhythmic resolutions most of the
+//    grid is empty, so in that case only the attack positions are folded,
+//    which gives the same sums without visiting every grid element for
+//    every period.
 //
 
 void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, vector<double>& grid, HumNum minrhy) {
 	analysis.resize(minrhy.getNumerator());
+
+	vector<int> positions;
+	vector<double> weights;
+	for (int i=0; i<(int)grid.size(); i++) {
+		if (grid[i] != 0.0) {
+			positions.push_back(i);
+			weights.push_back(grid[i]);
+		}
+	}
+
+	bool sparseQ = (int)positions.size() * 8 < (int)grid.size();
 	for (int i=0; i<(int)analysis.size(); i++) {
-		doAnalysis(analysis, i, grid);
+		if (sparseQ) {
+			doSparseAnalysis(analysis, i, positions, weights);
+		} else {
+			doAnalysis(analysis, i, grid);
+		}
 	}
 }
 
@@ -160,20 +179,47 @@ void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, v
 
 //////////////////////////////
 //
-// Tool_periodicity::doAnalysis --
+// Tool_periodicity::doAnalysis -- Sum the grid into the bins of one
+//    period.  The grid is added one period-length block at a time so
+//    that the inner loop is over contiguous memory.
 //
 
 void Tool_periodicity::doAnalysis(vector<vector<double>>& analysis, int level, vector<double>& grid) {
 	int period = level + 1;
-	analysis[level].resize(period);
-	std::fill(analysis[level].begin(), analysis[level].end(), 0.0);
-	for (int i=0; i<period; i++) {
-		int j = i;
-		while (j < (int)grid.size()) {
-			analysis[level][i] += grid[j];
-			j += period;
+	vector<double>& bins = analysis[level];
+	bins.resize(period);
+	std::fill(bins.begin(), bins.end(), 0.0);
+	int size = (int)grid.size();
+	int j = 0;
+	for (j=0; j + period <= size; j += period) {
+		const double* block = grid.data() + j;
+		for (int i=0; i<period; i++) {
+			bins[i] += block[i];
 		}
 	}
+	for (int i=0; j + i < size; i++) {
+		bins[i] += grid[j + i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_periodicity::doSparseAnalysis -- Sum the attacks into the bins
+//    of one period, given the positions and weights of the non-zero
+//    elements of the grid.
+//
+
+void Tool_periodicity::doSparseAnalysis(vector<vector<double>>& analysis, int level,
+		vector<int>& positions, vector<double>& weights) {
+	int period = level + 1;
+	vector<double>& bins = analysis[level];
+	bins.resize(period);
+	std::fill(bins.begin(), bins.end(), 0.0);
+	for (int k=0; k<(int)positions.size(); k++) {
+		bins[positions[k] % period] += weights[k];
+	}
 }
 
 
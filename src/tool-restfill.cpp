@@ -30,6 +30,8 @@ namespace hum {
 Tool_restfill::Tool_restfill(void) {
 	define("y|hidden-rests=b",        "hide inserted rests");
 	define("i|exinterp=s:kern",       "type of spine to fill with rests");
+	// blank measures are hidden from the rhythm analysis in processFile():
+	m_analysis_level = ANALYZE_SPINES;
 }
 
 
@@ -13,7 +13,10 @@
 #include "tool-simat.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <sstream>
+#include <thread>
 
 #include "Convert.h"
 #include "HumRegex.h"
@@ -578,6 +581,28 @@ MeasureComparisonGrid::~MeasureComparisonGrid() {
 
 void MeasureComparisonGrid::clear(void) {
 	m_grid.clear();
+	m_sparse.clear();
+	m_sparseQ = false;
+	m_hist1.clear();
+	m_hist2.clear();
+	m_sd1.clear();
+	m_sd2.clear();
+	m_empty1.clear();
+	m_empty2.clear();
+	m_rows = 0;
+	m_cols = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::setThreadCount -- Set the number of threads
+//    used to calculate the grid (default 1).
+//
+
+void MeasureComparisonGrid::setThreadCount(int count) {
+	m_threads = count < 1 ? 1 : count;
 }
 
 
@@ -592,17 +617,238 @@ void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2)
 }
 
 void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2) {
-	m_grid.resize(set1.size());
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		m_grid[i].resize(set2.size());
+	clear();
+	m_set1 = &set1;
+	m_set2 = &set2;
+	packHistograms(set1, m_hist1, m_sd1, m_empty1);
+	packHistograms(set2, m_hist2, m_sd2, m_empty2);
+	m_rows = set1.size();
+	m_cols = set2.size();
+	m_grid.resize((size_t)m_rows * m_cols);
+	runThreads();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::analyzeSparse -- Calculate the correlations
+//    without storing the full grid.  For each measure in the first set,
+//    only the topk highest correlations are kept (all if topk is 0),
+//    and only if they are at least the threshold.
+//
+
+void MeasureComparisonGrid::analyzeSparse(MeasureDataSet& set1,
+		MeasureDataSet& set2, int topk, double threshold) {
+	clear();
+	m_set1 = &set1;
+	m_set2 = &set2;
+	packHistograms(set1, m_hist1, m_sd1, m_empty1);
+	packHistograms(set2, m_hist2, m_sd2, m_empty2);
+	m_rows = set1.size();
+	m_cols = set2.size();
+	m_sparseQ = true;
+	m_topk = topk < 0 ? 0 : topk;
+	m_threshold = threshold;
+	m_sparse.resize(m_rows);
+	runThreads();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::packHistograms -- Store the 7-pc histograms of
+//    a set of measures in a contiguous array.  Each histogram is stored
+//    as the deviations from its running mean which are used in
+//    Convert::pearsonCorrelation(), together with its standard deviation,
+//    so that only the covariance has to be calculated for each pair of
+//    measures.
+//
+
+void MeasureComparisonGrid::packHistograms(MeasureDataSet& set,
+		vector<double>& hist, vector<double>& sd, vector<char>& empty) {
+	hist.assign((size_t)set.size() * HIST_STRIDE, 0.0);
+	sd.assign(set.size(), 0.0);
+	empty.assign(set.size(), 0);
+	for (int i=0; i<set.size(); i++) {
+		if (set[i].getSum7pc() == 0.0) {
+			empty[i] = 1;
+			continue;
+		}
+		vector<double>& x = set[i].getHistogram7pc();
+		double* delta = hist.data() + (size_t)i * HIST_STRIDE;
+		int size = (int)x.size();
+		double sumx = 0.0;
+		double meanx = x[0];
+		for (int k=2; k<=size; k++) {
+			double sweep = (k-1.0) / k;
+			double deltax = x[k-1] - meanx;
+			delta[k-2] = deltax;
+			sumx  += deltax * deltax * sweep;
+			meanx += deltax / k;
+		}
+		sd[i] = sqrt(sumx / size);
 	}
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			m_grid[i][j].compare(set1[i], set2[j]);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::correlate -- Return the correlation between a
+//    measure in the first set and one in the second set, calculated in
+//    the same way as MeasureComparison::compare().
+//
+
+double MeasureComparisonGrid::correlate(int index1, int index2) {
+	static const double sweep[HIST_STRIDE] = {
+		1.0/2.0, 2.0/3.0, 3.0/4.0, 4.0/5.0, 5.0/6.0, 6.0/7.0, 0.0, 0.0
+	};
+	if (m_empty1[index1] || m_empty2[index2]) {
+		if (m_empty1[index1] && m_empty2[index2]) {
+			return 1.0;
 		}
+		return 0.0;
 	}
-	m_set1 = &set1;
-	m_set2 = &set2;
+	const double* delta1 = m_hist1.data() + (size_t)index1 * HIST_STRIDE;
+	const double* delta2 = m_hist2.data() + (size_t)index2 * HIST_STRIDE;
+	double sumco = 0.0;
+	for (int k=0; k<HIST_STRIDE; k++) {
+		sumco += delta1[k] * delta2[k] * sweep[k];
+	}
+	double covxy = sumco / 7;
+	double correlation = covxy / (m_sd1[index1] * m_sd2[index2]);
+	if (fabs(correlation - 1.0) < 0.00000001) {
+		correlation = 1.0;
+	}
+	return correlation;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::runThreads -- Divide the rows of the grid into
+//    blocks and calculate them in separate threads.
+//
+
+void MeasureComparisonGrid::runThreads(void) {
+	const int blocksize = 32;
+	int blockcount = (m_rows + blocksize - 1) / blocksize;
+	int threadcount = std::min(m_threads, blockcount);
+	if (threadcount <= 1) {
+		analyzeRows(0, m_rows);
+		return;
+	}
+	std::atomic<int> nextblock(0);
+	vector<std::thread> threads;
+	for (int t=0; t<threadcount; t++) {
+		threads.emplace_back([this, &nextblock, blockcount, blocksize]() {
+			int block;
+			while ((block = nextblock++) < blockcount) {
+				int startrow = block * blocksize;
+				analyzeRows(startrow, std::min(startrow + blocksize, m_rows));
+			}
+		});
+	}
+	for (int t=0; t<(int)threads.size(); t++) {
+		threads[t].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::analyzeRows -- Calculate a block of rows of the
+//    grid, in tiles of columns so that the histograms of the rows and
+//    columns stay in the cache.  In sparse mode the best correlations of
+//    each row are kept in a min-heap.
+//
+
+void MeasureComparisonGrid::analyzeRows(int startrow, int stoprow) {
+	const int tilesize = 256;
+	auto greater = [](const pair<int, double>& a, const pair<int, double>& b) {
+		return a.second > b.second;
+	};
+	for (int tile=0; tile<m_cols; tile+=tilesize) {
+		int stopcol = std::min(tile + tilesize, m_cols);
+		for (int i=startrow; i<stoprow; i++) {
+			if (!m_sparseQ) {
+				double* row = m_grid.data() + (size_t)i * m_cols;
+				for (int j=tile; j<stopcol; j++) {
+					row[j] = correlate(i, j);
+				}
+				continue;
+			}
+			vector<pair<int, double>>& entries = m_sparse[i];
+			for (int j=tile; j<stopcol; j++) {
+				double correlation = correlate(i, j);
+				if (std::isnan(correlation) || (correlation < m_threshold)) {
+					continue;
+				}
+				if (m_topk <= 0) {
+					entries.emplace_back(j, correlation);
+				} else if ((int)entries.size() < m_topk) {
+					entries.emplace_back(j, correlation);
+					std::push_heap(entries.begin(), entries.end(), greater);
+				} else if (correlation > entries.front().second) {
+					std::pop_heap(entries.begin(), entries.end(), greater);
+					entries.back() = std::make_pair(j, correlation);
+					std::push_heap(entries.begin(), entries.end(), greater);
+				}
+			}
+		}
+	}
+	if (m_sparseQ && (m_topk > 0)) {
+		// sort the best matches in each row by column
+		for (int i=startrow; i<stoprow; i++) {
+			std::sort(m_sparse[i].begin(), m_sparse[i].end());
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getRowCount -- Return the number of measures
+//    in the first set.
+//
+
+int MeasureComparisonGrid::getRowCount(void) {
+	return m_rows;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getColumnCount -- Return the number of measures
+//    in the second set.
+//
+
+int MeasureComparisonGrid::getColumnCount(void) {
+	return m_cols;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getCorrelation7pc -- Return the correlation
+//    between a measure in the first set and one in the second set.
+//
+
+double MeasureComparisonGrid::getCorrelation7pc(int index1, int index2) {
+	if ((index1 < 0) || (index1 >= m_rows) || (index2 < 0) || (index2 >= m_cols)) {
+		return NAN;
+	}
+	if (m_sparseQ) {
+		return correlate(index1, index2);
+	}
+	return m_grid[(size_t)index1 * m_cols + index2];
 }
 
 
@@ -614,15 +860,15 @@ void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2)
 //
 
 ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			double correl = m_grid[i][j].getCorrelation7pc();
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			double correl = getCorrelation7pc(i, j);
 			if (correl > 0.0) {
 				out << int(correl * 100.0 + 0.5)/100.0;
 			} else {
 				out << -int(-correl * 100.0 + 0.5)/100.0;
 			}
-			if (j < (int)m_grid[i].size() - 1) {
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -640,18 +886,18 @@ ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
 //
 
 ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
 			if (i != j) {
 				continue;
 			}
-			double correl = m_grid[i][j].getCorrelation7pc();
+			double correl = getCorrelation7pc(i, j);
 			if (correl > 0.0) {
 				out << int(correl * 100.0 + 0.5)/100.0;
 			} else {
 				out << -int(-correl * 100.0 + 0.5)/100.0;
 			}
-			if (j < (int)m_grid[i].size() - 1) {
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -662,6 +908,33 @@ ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
 
 
 
+//////////////////////////////
+//
+// MeasureComparisonGrid::printSparseGrid -- Print the stored correlations
+//    after analyzeSparse(), one per line: row number, column number (both
+//    starting at 1 as in the lines/columns of printCorrelationGrid()) and
+//    correlation.
+//    default value: out = std::cout
+//
+
+ostream& MeasureComparisonGrid::printSparseGrid(ostream& out) {
+	for (int i=0; i<(int)m_sparse.size(); i++) {
+		for (int j=0; j<(int)m_sparse[i].size(); j++) {
+			double correl = m_sparse[i][j].second;
+			out << i + 1 << '\t' << m_sparse[i][j].first + 1 << '\t';
+			if (correl > 0.0) {
+				out << int(correl * 100.0 + 0.5)/100.0;
+			} else {
+				out << -int(-correl * 100.0 + 0.5)/100.0;
+			}
+			out << '\n';
+		}
+	}
+	return out;
+}
+
+
+
 //////////////////////////////
 //
 // MeasureComparisonGrid::getColorMapping --
@@ -949,15 +1222,15 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 	double sdur1 = getScoreDuration1();
 	double sdur2 = getScoreDuration2();
 
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
 			width = getDuration2(j) / sdur2 * imagewidth;
 			height = getDuration1(i) / sdur1 * imageheight;
 
 			x = getStartTime2(j)/sdur2 * imageheight;
 			y = getStartTime1(i)/sdur1 * imagewidth;
 
-			getColorMapping(m_grid[i][j].getCorrelation7pc(), hue, saturation, lightness);
+			getColorMapping(getCorrelation7pc(i, j), hue, saturation, lightness);
 			ss << "hsl(" << hue << "," << saturation << "%," << lightness << "%)";
 			crect = grid.append_child("rect");
 			crect.append_attribute("x") = to_string(x).c_str();
@@ -990,6 +1263,9 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 Tool_simat::Tool_simat(void) {
 	define("r|raw=b", "output raw correlation matrix");
 	define("d|diagonal=b", "output diagonal of correlation matrix");
+	define("k|top=i:0", "output only the k highest correlations for each measure");
+	define("t|threshold=d:-1.0", "output only correlations at or above threshold");
+	define("j|jobs=i:1", "number of threads for calculating the matrix");
 }
 
 
@@ -1072,6 +1348,15 @@ bool Tool_simat::run(HumdrumFile& infile1, HumdrumFile& infile2) {
 void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 	m_data1.parse(infile1);
 	m_data2.parse(infile2);
+	m_grid.setThreadCount(getInteger("jobs"));
+	if (getBoolean("top") || getBoolean("threshold")) {
+		// sparse output: do not store the full matrix.
+		m_grid.analyzeSparse(m_data1, m_data2, getInteger("top"),
+				getDouble("threshold"));
+		m_grid.printSparseGrid(m_free_text);
+		suppressHumdrumFileOutput();
+		return;
+	}
 	m_grid.analyze(m_data1, m_data2);
 	if (getBoolean("raw")) {
 		m_grid.printCorrelationGrid(m_free_text);
@@ -28,6 +28,8 @@ namespace hum {
 Tool_tabber::Tool_tabber(void) {
 	// do nothing for now.
 	define("r|remove=b",    "remove any extra tabs");
+	// only the spine widths are needed:
+	m_analysis_level = ANALYZE_SPINES;
 }
 
 
@@ -22,6 +22,7 @@
 #include "tool-transpose.h"
 #include "Convert.h"
 #include "HumRegex.h"
+#include <cmath>
 #include <cstring>
 #include <ctype.h>
 
@@ -757,7 +758,7 @@ void Tool_transpose::printNewKeyInterpretation(HumdrumLine& aRecord,
 	if (islower(aRecord.token(index)->at(1))) {
 		mode = 1;
 	}
-	int base40 = Convert::kernToBase40(*aRecord.token(index));
+	int base40 = Convert::kernToBase40(aRecord.token(index));
 	currentkey = base40;
 	base40 = base40 + transval;
 	base40 = base40 + 4000;
@@ -1053,10 +1054,11 @@ void Tool_transpose::doAutoTransposeAnalysis(HumdrumFile& infile) {
 	infile.getTrackStartList(tracks);
 	int i;
 	for (i=0; i<(int)tracks.size(); i++) {
+		int track = tracks[i]->getTrack();
 		if (tracks[i]->isKern()) {
-			ktracks[i] = tracks[i]->getTrack();
+			ktracks[track] = track;
 		} else {
-			ktracks[i] = 0;
+			ktracks[track] = 0;
 		}
 	}
 
@@ -1125,7 +1127,7 @@ void Tool_transpose::doTranspositionAnalysis(vector<vector<vector<double> > >& a
 	int value;
 
 	for (i=0; i<1; i++) {
-		for (j=2; j<3; j++) {
+		for (j=2; (j<3) && (j<(int)analysis.size()); j++) {
 			for (k=0; k<(int)analysis[i].size(); k++) {
 				if (analysis[i][k][24] >= 0 && analysis[j][k][24] >= 0) {
 					value1 = (int)analysis[i][k][25];
@@ -1164,6 +1166,9 @@ void Tool_transpose::printRawTrackAnalysis(vector<vector<vector<double> > >& ana
 	int value;
 	int value2;
 
+	if (analysis.empty()) {
+		return;
+	}
 	for (i=0; i<(int)analysis[0].size(); i++) {
 		m_free_text << "Frame\t" << i << ":";
 		for (j=0; j<(int)analysis.size(); j++) {
@@ -1189,16 +1194,18 @@ void Tool_transpose::printRawTrackAnalysis(vector<vector<vector<double> > >& ana
 
 //////////////////////////////
 //
-// doAutoKeyAnalysis --
+// doAutoKeyAnalysis -- The segment histograms of each track are first
+//     converted into cumulative sums, so that the histogram of any window
+//     of segments can be calculated with a single subtraction.  The
+//     cumulative sums can be reused for analyses at other window sizes.
 //
 
 void Tool_transpose::doAutoKeyAnalysis(vector<vector<vector<double> > >& analysis, int level,
 		int hop, int count, int segments, vector<int>& ktracks,
 		vector<vector<vector<double> > >& trackhist) {
 
-	vector<double> majorweights;
-	vector<double> minorweights;
-	fillWeightsWithKostkaPayne(majorweights, minorweights);
+	vector<vector<double> > profiles;
+	fillKeyProfileMatrix(profiles);
 
 	int size = 0;
 	int i;
@@ -1213,13 +1220,37 @@ void Tool_transpose::doAutoKeyAnalysis(vector<vector<vector<double> > >& analysi
 		analysis[i].reserve(count);
 	}
 
+	vector<vector<double> > prefixhist;
 	int aindex = 0;
 	for (i=1; i<(int)ktracks.size(); i++) {
 		if (!ktracks[i]) {
 			continue;
 		}
+		buildHistogramPrefixSums(prefixhist, trackhist[i]);
 		doTrackKeyAnalysis(analysis[aindex++], level, hop, count,
-				trackhist[i], majorweights, minorweights);
+				prefixhist, profiles);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::buildHistogramPrefixSums -- Store the cumulative pitch-class
+//   histogram of a track: prefixhist[i] is the sum of the segment histograms
+//   before segment i, so the histogram of segments [a, b) is
+//   prefixhist[b] - prefixhist[a].
+//
+
+void Tool_transpose::buildHistogramPrefixSums(vector<vector<double> >& prefixhist,
+		vector<vector<double> >& trackhist) {
+	prefixhist.resize(trackhist.size() + 1);
+	prefixhist[0].assign(12, 0.0);
+	for (int i=0; i<(int)trackhist.size(); i++) {
+		prefixhist[i+1].resize(12);
+		for (int k=0; k<12; k++) {
+			prefixhist[i+1][k] = prefixhist[i][k] + trackhist[i][k];
+		}
 	}
 }
 
@@ -1228,21 +1259,24 @@ void Tool_transpose::doAutoKeyAnalysis(vector<vector<vector<double> > >& analysi
 //////////////////////////////
 //
 // Tool_transpose::doTrackKeyAnalysis -- Do individual key analyses of sections of the
-//   given track.
+//   given track.  The window of each analysis is level segments long, and
+//   successive windows start hop segments apart.
 //
 
 void Tool_transpose::doTrackKeyAnalysis(vector<vector<double> >& analysis, int level, int hop,
-		int count, vector<vector<double> >& trackhist,
-		vector<double>& majorweights, vector<double>& minorweights) {
+		int count, vector<vector<double> >& prefixhist,
+		vector<vector<double> >& profiles) {
 
+	// prefixhist has one more entry than the number of segments.
+	int segments = (int)prefixhist.size() - 1;
 	int i;
 	for (i=0; i<count; i++) {
-		if (i * hop + level > (int)trackhist.size()) {
+		if (i * hop + level > segments) {
 			break;
 		}
 		analysis.resize(i+1);
-		doSingleAnalysis(analysis[analysis.size()-1], i*hop+level, level,
-				trackhist, majorweights, minorweights);
+		doSingleAnalysis(analysis[analysis.size()-1], i*hop, level,
+				prefixhist, profiles);
 	}
 }
 
@@ -1250,21 +1284,27 @@ void Tool_transpose::doTrackKeyAnalysis(vector<vector<double> >& analysis, int l
 
 //////////////////////////////
 //
-// Tool_transpose::doSingleAnalysis --
+// Tool_transpose::doSingleAnalysis -- Analyze the key of the segments
+//   [startindex, startindex+length) from the cumulative histogram.
 //
 
 void Tool_transpose::doSingleAnalysis(vector<double>& analysis, int startindex, int length,
-		vector<vector<double> >& trackhist, vector<double>& majorweights,
-		vector<double>& minorweights) {
+		vector<vector<double> >& prefixhist, vector<vector<double> >& profiles) {
 	vector<double> histsum(12, 0);
 
-	for (int i=0; (i<length) && (startindex+i+length<(int)trackhist.size()); i++) {
-		for (int k=0; k<12; k++) {
-			histsum[k] += trackhist[i+startindex][k];
+	int endindex = startindex + length;
+	if (endindex >= (int)prefixhist.size()) {
+		endindex = (int)prefixhist.size() - 1;
+	}
+	for (int k=0; k<12; k++) {
+		histsum[k] = prefixhist[endindex][k] - prefixhist[startindex][k];
+		// remove rounding residue left over from the cumulative sums:
+		if (histsum[k] < 1.0e-9) {
+			histsum[k] = 0.0;
 		}
 	}
 
-	identifyKey(analysis, histsum, majorweights, minorweights);
+	identifyKey(analysis, histsum, profiles);
 }
 
 
@@ -1307,6 +1347,45 @@ void Tool_transpose::fillWeightsWithKostkaPayne(vector<double>& maj, vector<doub
 
 
 
+//////////////////////////////
+//
+// Tool_transpose::fillKeyProfileMatrix -- Store the Kostka-Payne key
+//   profiles for all 24 keys: rows 0-11 are the major keys on C to B, and
+//   rows 12-23 are the minor keys.  Each row is centered on its mean and
+//   scaled to unit length, so the Pearson correlation of a histogram with
+//   every key is a single matrix-vector product (see identifyKey()).
+//
+
+void Tool_transpose::fillKeyProfileMatrix(vector<vector<double> >& profiles) {
+	vector<double> majorweights;
+	vector<double> minorweights;
+	fillWeightsWithKostkaPayne(majorweights, minorweights);
+
+	profiles.resize(24);
+	for (int i=0; i<24; i++) {
+		vector<double>& weights = i < 12 ? majorweights : minorweights;
+		int tonic = i % 12;
+		profiles[i].resize(12);
+		double mean = 0.0;
+		for (int k=0; k<12; k++) {
+			profiles[i][k] = weights[(k - tonic + 12) % 12];
+			mean += profiles[i][k];
+		}
+		mean /= 12.0;
+		double norm = 0.0;
+		for (int k=0; k<12; k++) {
+			profiles[i][k] -= mean;
+			norm += profiles[i][k] * profiles[i][k];
+		}
+		norm = sqrt(norm);
+		for (int k=0; k<12; k++) {
+			profiles[i][k] /= norm;
+		}
+	}
+}
+
+
+
 ////////////////////////////////////////
 //
 // identifyKey -- correls contains the 12 major key correlation
@@ -1314,11 +1393,12 @@ void Tool_transpose::fillWeightsWithKostkaPayne(vector<double>& maj, vector<doub
 //      more values: index=24 is the best key, and index=25 is the
 //      second best key.  If [24] or [25] is -1, then that means that
 //      all entries in the original histogram were zero (all rests).
+//      The profiles are from fillKeyProfileMatrix().  Since they have
+//      zero mean, the histogram only has to be centered for its length.
 //
 
 void Tool_transpose::identifyKey(vector<double>& correls,
-		vector<double>& histogram, vector<double>& majorweights,
-		vector<double>& minorweights) {
+		vector<double>& histogram, vector<vector<double> >& profiles) {
 
 	correls.clear();
 	correls.reserve(26);
@@ -1335,12 +1415,25 @@ void Tool_transpose::identifyKey(vector<double>& correls,
 		return;
 	}
 
-	vector<double> majorcorrels;
-	vector<double> minorcorrels;
+	double mean = testsum / 12.0;
+	double norm = 0.0;
 	for (int i=0; i<12; i++) {
-		majorcorrels[i] = Convert::pearsonCorrelation(majorweights, histogram);
-		minorcorrels[i] = Convert::pearsonCorrelation(minorweights, histogram);
+		norm += (histogram[i] - mean) * (histogram[i] - mean);
+	}
+	norm = sqrt(norm);
+
+	vector<double> allcorrels(24, 0.0);
+	if (norm > 0.0) {
+		for (int i=0; i<24; i++) {
+			double sum = 0.0;
+			for (int k=0; k<12; k++) {
+				sum += profiles[i][k] * histogram[k];
+			}
+			allcorrels[i] = sum / norm;
+		}
 	}
+	vector<double> majorcorrels(allcorrels.begin(), allcorrels.begin() + 12);
+	vector<double> minorcorrels(allcorrels.begin() + 12, allcorrels.end());
 
 	// find max value
 	int besti;
@@ -1449,7 +1542,7 @@ double Tool_transpose::storeHistogramForTrack(vector<vector<double> >& histogram
 		HumdrumFile& infile, int track, int segments) {
 
 	histogram.clear();
-	histogram.reserve(segments);
+	histogram.resize(segments);
 
 	int i;
 	int j;
@@ -1482,12 +1575,12 @@ double Tool_transpose::storeHistogramForTrack(vector<vector<double> >& histogram
 			if (!infile.token(i, j)->isKern()) {
 				continue;
 			}
-			if (!infile.token(i, j)->isNull()) {
+			if (infile.token(i, j)->isNull()) {
 				continue;
 			}
 			tokencount = infile.token(i, j)->getSubtokenCount();
 			for (k=0; k<tokencount; k++) {
-				buffer = *infile.token(j, k);
+				buffer = infile.token(i, j)->getSubtoken(k);
 				if (buffer == ".") {
 					continue;  // ignore illegal inline null tokens
 				}
@@ -0,0 +1,172 @@
+// Description: Compare the analysis done by HumdrumFileStructure::analyzeEdits()
+//              after editing tokens with setText() against a full analysis
+//              of the edited file contents.
+
+#include "humlib.h"
+
+#include <functional>
+
+using namespace hum;
+
+//////////////////////////////
+//
+// compareAnalysis -- Return true if the line and token timings of the two
+//    files are the same.
+//
+
+bool compareAnalysis(HumdrumFile& edited, HumdrumFile& full) {
+	if (edited.getLineCount() != full.getLineCount()) {
+		cerr << "Line count mismatch" << endl;
+		return false;
+	}
+	for (int i=0; i<full.getLineCount(); i++) {
+		if ((string)edited[i] != (string)full[i]) {
+			cerr << "Line " << i+1 << " text: " << edited[i]
+			     << " expected: " << full[i] << endl;
+			return false;
+		}
+		if ((edited[i].getDurationFromStart() != full[i].getDurationFromStart()) ||
+				(edited[i].getDuration() != full[i].getDuration()) ||
+				(edited[i].getDurationFromBarline() != full[i].getDurationFromBarline()) ||
+				(edited[i].getDurationToBarline() != full[i].getDurationToBarline())) {
+			cerr << "Line " << i+1 << " timing: "
+			     << edited[i].getDurationFromStart() << " "
+			     << edited[i].getDuration() << " expected: "
+			     << full[i].getDurationFromStart() << " "
+			     << full[i].getDuration() << "\t" << full[i] << endl;
+			return false;
+		}
+		for (int j=0; j<full[i].getTokenCount(); j++) {
+			HTp etok = edited.token(i, j);
+			HTp ftok = full.token(i, j);
+			if (etok->getDuration() != ftok->getDuration()) {
+				cerr << "Token " << *ftok << " on line " << i+1
+				     << " duration: " << etok->getDuration()
+				     << " expected: " << ftok->getDuration() << endl;
+				return false;
+			}
+			if (etok->getStrandIndex() != ftok->getStrandIndex()) {
+				cerr << "Token " << *ftok << " on line " << i+1
+				     << " strand: " << etok->getStrandIndex()
+				     << " expected: " << ftok->getStrandIndex() << endl;
+				return false;
+			}
+		}
+	}
+	for (int i=0; i<full.getBarlineCount(); i++) {
+		if (edited.getBarlineDuration(i) != full.getBarlineDuration(i)) {
+			cerr << "Barline " << i << " duration mismatch" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// testEdits -- Apply the edits to the input, update the analysis with
+//    analyzeEdits() and compare it to a full analysis of the result.
+//
+
+bool testEdits(const string& name, const string& input,
+		std::function<void(HumdrumFile&)> edit) {
+	HumdrumFile edited;
+	edited.readString(input);
+	edit(edited);
+	if (!edited.analyzeEdits()) {
+		cerr << name << ": " << edited.getParseError() << endl;
+		return false;
+	}
+
+	stringstream contents;
+	contents << edited;
+	HumdrumFile full;
+	full.readString(contents.str());
+	full.analyzeRhythmStructure();
+
+	if (!compareAnalysis(edited, full)) {
+		cerr << name << ": incremental analysis differs" << endl;
+		return false;
+	}
+	return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	string input =
+		"**kern\t**kern\n"
+		"*M4/4\t*M4/4\n"
+		"=1\t=1\n"
+		"2c\t4e\n"
+		".\t4f\n"
+		"4d\t4g\n"
+		"4e\t4a\n"
+		"=2\t=2\n"
+		"4f\t4b\n"
+		"4g\t4cc\n"
+		"2a\t2dd\n"
+		"=3\t=3\n"
+		"*-\t*-\n";
+
+	int errors = 0;
+
+	// text edit which does not change durations:
+	errors += !testEdits("pitch", input, [](HumdrumFile& infile) {
+		infile.token(3, 0)->setText("2d");
+	});
+
+	// duration edits which keep the measure length:
+	errors += !testEdits("rhythm", input, [](HumdrumFile& infile) {
+		infile.token(8, 0)->setText("8f");
+		infile.token(8, 1)->setText("8b");
+		infile.token(9, 0)->setText("4.g");
+		infile.token(9, 1)->setText("4.cc");
+	});
+
+	// duration edits which move a line with a null token:
+	errors += !testEdits("rhythm-null", input, [](HumdrumFile& infile) {
+		infile.token(3, 1)->setText("8e");
+		infile.token(4, 1)->setText("4.f");
+	});
+
+	// duration edits which change the length of a measure:
+	errors += !testEdits("rhythm-measure", input, [](HumdrumFile& infile) {
+		infile.token(6, 0)->setText("2e");
+		infile.token(6, 1)->setText("2a");
+		infile.token(10, 0)->setText("4a");
+		infile.token(10, 1)->setText("4dd");
+	});
+
+	// null token replaced by a note:
+	errors += !testEdits("null", input, [](HumdrumFile& infile) {
+		infile.token(3, 0)->setText("4c");
+		infile.token(4, 0)->setText("4dd");
+	});
+
+	// spine split and merge:
+	string splitinput =
+		"**kern\t**kern\n"
+		"*\t*\n"
+		"4c\t4e\n"
+		"*\t*\n"
+		"4d\t4f\n"
+		"*-\t*-\n";
+	errors += !testEdits("split", splitinput, [](HumdrumFile& infile) {
+		infile.token(1, 0)->setText("*^");
+		infile[2].insertToken(1, "4g");
+		infile.token(3, 0)->setText("*v");
+		infile[3].insertToken(1, "*v");
+	});
+
+	if (errors) {
+		cerr << errors << " edit test(s) failed" << endl;
+		return 1;
+	}
+	cout << "edit tests passed" << endl;
+	return 0;
+}
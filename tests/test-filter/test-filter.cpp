@@ -0,0 +1,116 @@
+// Description: Compare the output of tools chained in the filter tool
+//              with the output of the same tools run one after another
+//              on freshly parsed input.
+
+#include "humlib.h"
+
+using namespace hum;
+
+//////////////////////////////
+//
+// runTool -- Run a tool on freshly parsed input and return its output.
+//
+
+template <class TOOL>
+string runTool(const string& contents, const string& command) {
+	HumdrumFile infile;
+	infile.readStringNoRhythm(contents);
+	TOOL tool;
+	tool.process(command);
+	tool.run(infile);
+	if (tool.hasHumdrumText()) {
+		return tool.getHumdrumText();
+	}
+	infile.createLinesFromTokens();
+	stringstream output;
+	output << infile;
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// runSequence -- Run each tool on the output of the previous tool.
+//
+
+string runSequence(const string& input, const vector<string>& commands) {
+	string contents = input;
+	for (int i=0; i<(int)commands.size(); i++) {
+		string name = commands[i].substr(0, commands[i].find(' '));
+		if (name == "autobeam") {
+			contents = runTool<Tool_autobeam>(contents, commands[i]);
+		} else if (name == "extract") {
+			contents = runTool<Tool_extract>(contents, commands[i]);
+		} else if (name == "restfill") {
+			contents = runTool<Tool_restfill>(contents, commands[i]);
+		} else if (name == "transpose") {
+			contents = runTool<Tool_transpose>(contents, commands[i]);
+		} else {
+			return "";
+		}
+	}
+	return contents;
+}
+
+
+
+//////////////////////////////
+//
+// testChain --
+//
+
+bool testChain(const string& input, const vector<string>& commands) {
+	string chain;
+	for (int i=0; i<(int)commands.size(); i++) {
+		if (i > 0) {
+			chain += " | ";
+		}
+		chain += commands[i];
+	}
+	HumdrumFile infile;
+	infile.readStringNoRhythm(input + "!!!filter: " + chain + "\n");
+	Tool_filter filter;
+	filter.run(infile);
+	stringstream output;
+	output << infile;
+	string expected = runSequence(input, commands) + "!!!Xfilter: " + chain + "\n";
+	if (output.str() != expected) {
+		cerr << "Chain " << chain << " gives:\n" << output.str()
+		     << "but expected:\n" << expected;
+		return false;
+	}
+	return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	string input =
+		"**kern\t**kern\n"
+		"*M4/4\t*M4/4\n"
+		"=1\t=1\n"
+		"8c\t4e\n"
+		"8d\t.\n"
+		"8e\t4f\n"
+		"8f\t.\n"
+		"2g\t2g\n"
+		"=2\t=2\n"
+		"1c\t.\n"
+		"=3\t=3\n"
+		"*-\t*-\n";
+
+	int errors = 0;
+	errors += !testChain(input, {"transpose -t M2", "restfill"});
+	errors += !testChain(input, {"restfill", "autobeam"});
+	errors += !testChain(input, {"extract -f 1", "autobeam", "transpose -t m3"});
+
+	if (errors) {
+		cerr << errors << " filter test(s) failed" << endl;
+		return 1;
+	}
+	cout << "filter tests passed" << endl;
+	return 0;
+}
@@ -0,0 +1,214 @@
+// Description: Check that HumHash behaves like a map of namespace 1,
+//              namespace 2 and key to a value when parameters are set
+//              again, deleted, and accessed through the different
+//              namespace forms, including names first seen on other
+//              threads.
+
+#include "humlib.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+using namespace hum;
+
+typedef map<string, map<string, map<string, string> > > ParamMap;
+
+std::atomic<int> errors(0);
+
+void check(bool test, const string& message) {
+	if (!test) {
+		cerr << "Error: " << message << endl;
+		errors++;
+	}
+}
+
+//////////////////////////////
+//
+// splitKey -- Split "ns1:ns2:key", "ns2:key" or "key" in the same
+//     manner as HumHash.
+//
+
+void splitKey(const string& name, string& ns1, string& ns2, string& key) {
+	ns1 = "";
+	ns2 = "";
+	key = name;
+	auto loc1 = name.find(':');
+	if (loc1 == string::npos) {
+		return;
+	}
+	auto loc2 = name.find(':', loc1 + 1);
+	if (loc2 == string::npos) {
+		ns2 = name.substr(0, loc1);
+		key = name.substr(loc1 + 1);
+		return;
+	}
+	ns1 = name.substr(0, loc1);
+	ns2 = name.substr(loc1 + 1, loc2 - loc1 - 1);
+	key = name.substr(loc2 + 1);
+}
+
+//////////////////////////////
+//
+// compareAll -- Compare every key in the reference map with the hash.
+//
+
+void compareAll(const HumHash& hash, const ParamMap& reference,
+		const vector<string>& names, const string& label) {
+	vector<string> expected;
+	for (auto& it1 : reference) {
+		for (auto& it2 : it1.second) {
+			for (auto& it3 : it2.second) {
+				expected.push_back(it1.first + ":" + it2.first + ":" + it3.first);
+			}
+		}
+	}
+	check(hash.getKeys() == expected, label + ": getKeys() differs");
+	for (auto& name : names) {
+		string ns1, ns2, key;
+		splitKey(name, ns1, ns2, key);
+		string value;
+		bool defined = false;
+		auto it1 = reference.find(ns1);
+		if (it1 != reference.end()) {
+			auto it2 = it1->second.find(ns2);
+			if (it2 != it1->second.end()) {
+				auto it3 = it2->second.find(key);
+				if (it3 != it2->second.end()) {
+					defined = true;
+					value = it3->second;
+				}
+			}
+		}
+		check(hash.isDefined(ns1, ns2, key) == defined, label + ": isDefined " + name);
+		check(hash.isDefined(name) == defined, label + ": isDefined(string) " + name);
+		check(hash.getValue(ns1, ns2, key) == value, label + ": getValue " + name);
+		check(hash.getValue(name) == value, label + ": getValue(string) " + name);
+		if (ns1.empty()) {
+			check(hash.getValue(ns2, key) == value, label + ": getValue(ns2) " + name);
+		}
+		vector<string> keys;
+		if (it1 != reference.end()) {
+			auto it2 = it1->second.find(ns2);
+			if (it2 != it1->second.end()) {
+				for (auto& it3 : it2->second) {
+					keys.push_back(it3.first);
+				}
+			}
+		}
+		check(hash.getKeys(ns1, ns2) == keys, label + ": getKeys " + ns1 + ":" + ns2);
+	}
+}
+
+//////////////////////////////
+//
+// testRandom -- Apply random sets and deletes to a hash and a reference
+//     map and compare them after each step.
+//
+
+void testRandom(void) {
+	vector<string> ns1list = { "", "LO", "auto" };
+	vector<string> ns2list = { "", "N", "R", "auto" };
+	vector<string> keylist = { "vis", "t", "x", "auto", "N" };
+	vector<string> names;
+	for (auto& ns1 : ns1list) {
+		for (auto& ns2 : ns2list) {
+			for (auto& key : keylist) {
+				names.push_back(ns1 + ":" + ns2 + ":" + key);
+				if (ns1.empty()) {
+					names.push_back(ns2 + ":" + key);
+				}
+			}
+		}
+	}
+	std::mt19937 random(1);
+	HumHash hash;
+	ParamMap reference;
+	for (int i=0; i<2000; i++) {
+		string name = names[random() % names.size()];
+		string ns1, ns2, key;
+		splitKey(name, ns1, ns2, key);
+		int action = random() % 4;
+		if (action == 3) {
+			reference[ns1][ns2].erase(key);
+			if (reference[ns1][ns2].empty()) {
+				reference[ns1].erase(ns2);
+				if (reference[ns1].empty()) {
+					reference.erase(ns1);
+				}
+			}
+			if (random() % 2) {
+				hash.deleteValue(ns1, ns2, key);
+			} else {
+				hash.deleteValue(name);
+			}
+		} else {
+			string value = to_string(i);
+			reference[ns1][ns2][key] = value;
+			if (action == 0) {
+				hash.setValue(ns1, ns2, key, value);
+			} else if (action == 1) {
+				hash.setValue(name, value);
+			} else {
+				hash.setValue(ns1, ns2, key, i);
+			}
+		}
+		compareAll(hash, reference, names, "step " + to_string(i));
+		if (errors) {
+			return;
+		}
+	}
+	HumHash copy(hash);
+	compareAll(copy, reference, names, "copy");
+	HumHash assigned;
+	assigned.setValue("LO", "N", "vis", "1");
+	assigned = hash;
+	compareAll(assigned, reference, names, "assignment");
+}
+
+//////////////////////////////
+//
+// testThreads -- A name which was undefined when a thread first looked
+//     it up must be found once another thread has set it.
+//
+
+void testThreads(void) {
+	HumHash hash;
+	check(!hash.isDefined("test-hashmap", "thread", "key"), "new name defined");
+	std::thread setter([&hash]() {
+		hash.setValue("test-hashmap", "thread", "key", "value");
+	});
+	setter.join();
+	check(hash.isDefined("test-hashmap", "thread", "key"), "name set on other thread not found");
+	check(hash.getValue("test-hashmap:thread:key") == "value", "value set on other thread not found");
+
+	vector<std::thread> readers;
+	for (int i=0; i<4; i++) {
+		readers.emplace_back([&hash, i]() {
+			HumHash local;
+			for (int j=0; j<1000; j++) {
+				string key = "k" + to_string(j % 50);
+				local.setValue("thread" + to_string(i), key, j);
+				if (local.getValueInt("thread" + to_string(i), key) != j) {
+					check(false, "thread value");
+				}
+				if (hash.getValue("test-hashmap", "thread", "key") != "value") {
+					check(false, "shared value");
+				}
+			}
+		});
+	}
+	for (auto& reader : readers) {
+		reader.join();
+	}
+}
+
+int main(int argc, char** argv) {
+	testRandom();
+	testThreads();
+	if (errors) {
+		return 1;
+	}
+	cout << "All HumHash tests passed." << endl;
+	return 0;
+}
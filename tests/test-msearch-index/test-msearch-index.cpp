@@ -0,0 +1,225 @@
+// Description: Check that msearch gives the same matches with and without
+//              an n-gram index (--index option) of the searched files, and
+//              that searching for several queries at once (--query-file
+//              option) finds the same matches as searching for each query
+//              separately.  Also check that only files without matches
+//              are removed from the input file list when using the index.
+//              Usage: test-msearch-index tests/files/*.krn
+
+#include "humlib.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+using namespace hum;
+
+static const char* indexname = "test-msearch-index.tmp";
+static const char* queryname = "test-msearch-queries.tmp";
+
+//////////////////////////////
+//
+// runSearch -- Run msearch on each file in the same way as the msearch
+//     command, and return the combined output.
+//
+
+string runSearch(const vector<string>& files, const string& options) {
+	Tool_msearch msearch;
+	msearch.process("msearch " + options);
+	stringstream output;
+	for (int i=0; i<(int)files.size(); i++) {
+		HumdrumFile infile;
+		infile.readNoRhythm(files[i]);
+		infile.setFilename(files[i]);
+		msearch.run(infile);
+		if (msearch.hasAnyText()) {
+			msearch.getAllText(output);
+		} else {
+			output << infile;
+		}
+		if (msearch.hasError()) {
+			msearch.getError(output);
+		}
+		msearch.clearOutput();
+	}
+	return output.str();
+}
+
+//////////////////////////////
+//
+// testQuery -- Compare a search with and without the index, both when
+//     listing and when marking matches.
+//
+
+bool testQuery(const vector<string>& files, const string& query) {
+	bool status = true;
+	vector<string> modes = { "-l ", "" };
+	for (auto& mode : modes) {
+		string options = mode + "-q \"" + query + "\"";
+		string plain = runSearch(files, options);
+		string indexed = runSearch(files, "--index " + string(indexname) + " " + options);
+		if (plain != indexed) {
+			cerr << "Different results for msearch " << options << endl;
+			cerr << "Without index:\n" << plain;
+			cerr << "With index:\n" << indexed;
+			status = false;
+		}
+	}
+	return status;
+}
+
+//////////////////////////////
+//
+// getSortedLines -- Split output into lines and sort them.
+//
+
+vector<string> getSortedLines(const string& text) {
+	vector<string> output;
+	stringstream input(text);
+	string line;
+	while (getline(input, line)) {
+		output.push_back(line);
+	}
+	sort(output.begin(), output.end());
+	return output;
+}
+
+//////////////////////////////
+//
+// testQueryFile -- Search for several queries at once, with and without
+//     the index, and compare with the matches of the separate queries.
+//
+
+bool testQueryFile(const vector<string>& files, const vector<string>& queries) {
+	ofstream output(queryname);
+	string single;
+	string label;
+	for (auto& query : queries) {
+		output << query << "\n";
+		single += runSearch(files, "-l -q \"" + query + "\"");
+		label += " " + query;
+	}
+	output.close();
+
+	bool status = true;
+	string options = "-l --query-file " + string(queryname);
+	string plain = runSearch(files, options);
+	string indexed = runSearch(files, "--index " + string(indexname) + " " + options);
+	if (getSortedLines(plain) != getSortedLines(single)) {
+		cerr << "Different results for queries" << label << endl;
+		cerr << "Separate queries:\n" << single;
+		cerr << "Query file:\n" << plain;
+		status = false;
+	}
+	if (plain != indexed) {
+		cerr << "Different results with index for queries" << label << endl;
+		cerr << "Without index:\n" << plain;
+		cerr << "With index:\n" << indexed;
+		status = false;
+	}
+	options = "--query-file " + string(queryname);
+	plain = runSearch(files, options);
+	indexed = runSearch(files, "--index " + string(indexname) + " " + options);
+	if (plain != indexed) {
+		cerr << "Different marked results with index for queries" << label << endl;
+		status = false;
+	}
+	remove(queryname);
+	return status;
+}
+
+//////////////////////////////
+//
+// testFileList -- Check that the files which are removed from the input
+//     list by the index have no matches, and that files which are not in
+//     the index are kept.
+//
+
+bool testFileList(const vector<string>& files, const string& query) {
+	vector<string> list = files;
+	list.push_back("not-in-index.krn");
+	Tool_msearch msearch;
+	msearch.process("msearch --index " + string(indexname) + " -q \"" + query + "\"");
+	bool status = true;
+	if (!msearch.filterFileList(list)) {
+		// query is too short to be looked up in the index.
+		if (list.size() != files.size() + 1) {
+			cerr << "File list changed for query " << query << endl;
+			status = false;
+		}
+		return status;
+	}
+	if (find(list.begin(), list.end(), "not-in-index.krn") == list.end()) {
+		cerr << "File not in index was removed for query " << query << endl;
+		status = false;
+	}
+	for (int i=0; i<(int)files.size(); i++) {
+		if (find(list.begin(), list.end(), files[i]) != list.end()) {
+			continue;
+		}
+		string matches = runSearch(vector<string>(1, files[i]), "-l -q \"" + query + "\"");
+		if (!matches.empty()) {
+			cerr << "File " << files[i] << " with matches was removed for query "
+			     << query << endl;
+			status = false;
+		}
+	}
+	return status;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " file.krn [file.krn ...]" << endl;
+		return 1;
+	}
+	vector<string> files;
+	for (int i=1; i<argc; i++) {
+		files.push_back(argv[i]);
+	}
+
+	MSearchIndex index;
+	for (int i=0; i<(int)files.size(); i++) {
+		HumdrumFile infile;
+		infile.read(files[i]);
+		infile.setFilename(files[i]);
+		index.addFile(infile);
+	}
+	vector<MSearchQueryToken> query;
+	Tool_msearch msearch;
+	msearch.fillMusicQuery(query, "cde");
+	vector<MSearchPosting> postings;
+	if (!index.search(query, postings) || postings.empty()) {
+		cerr << "Query cde not found in index" << endl;
+		return 1;
+	}
+	if (!index.write(indexname)) {
+		cerr << "Cannot write index " << indexname << endl;
+		return 1;
+	}
+
+	vector<string> queries = {
+		"c", "cd", "cde", "cdefg", "edc", "gab", "aa", "ccc", "gfe",
+		"4c", "4c4d", "8g8a", "cr", "rc", "c#d", "b-c", "c/d", "^c^d",
+		"vcvd", "c=c", "abcdefg", "4e4f4g", "ded", "fed", "cdc"
+	};
+
+	int errors = 0;
+	for (auto& query : queries) {
+		errors += !testQuery(files, query);
+	}
+	errors += !testQueryFile(files, { "cde", "gab", "edc" });
+	errors += !testQueryFile(files, { "cdefg", "4c4d", "fed", "cde" });
+	// "c" is too short to be looked up in the index:
+	errors += !testQueryFile(files, { "cde", "c" });
+	for (auto& query : queries) {
+		errors += !testFileList(files, query);
+	}
+	remove(indexname);
+
+	if (errors) {
+		cerr << errors << " msearch index tests failed" << endl;
+		return 1;
+	}
+	cout << "All msearch index tests passed." << endl;
+	return 0;
+}
@@ -0,0 +1,154 @@
+// Description: Check that reading a Humdrum file by name (memory-mapped),
+//              from an input stream and from a string gives the same lines
+//              and tokens as splitting the contents with getline().  Each
+//              file is also checked with CRLF line endings, without a final
+//              newline, and an empty file is checked.
+//              Usage: test-read tests/files/*.krn
+
+#include "humlib.h"
+
+#include <cstdio>
+
+using namespace std;
+using namespace hum;
+
+static const char* tempname = "test-read.tmp";
+
+//////////////////////////////
+//
+// getlineSplit -- Split the contents into lines in the same way as the
+//     original reading loop: getline() on newlines, then removing a
+//     carriage return at the end of each line.
+//
+
+vector<string> getlineSplit(const string& contents) {
+	vector<string> output;
+	stringstream input(contents);
+	string line;
+	while (getline(input, line, '\n')) {
+		if ((!line.empty()) && (line.back() == 0x0d)) {
+			line.pop_back();
+		}
+		output.push_back(line);
+	}
+	return output;
+}
+
+//////////////////////////////
+//
+// compareFile -- Compare the lines and tokens of a parsed file with
+//     the expected lines.
+//
+
+bool compareFile(HumdrumFile& infile, const vector<string>& expected,
+		const string& label) {
+	if (infile.getLineCount() != (int)expected.size()) {
+		cerr << label << ": " << infile.getLineCount() << " lines instead of "
+		     << expected.size() << endl;
+		return false;
+	}
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if ((string)infile[i] != expected[i]) {
+			cerr << label << ": line " << i + 1 << " is \"" << infile[i]
+			     << "\" instead of \"" << expected[i] << "\"" << endl;
+			return false;
+		}
+		string tokens;
+		for (int j=0; j<infile[i].getTokenCount(); j++) {
+			if (j > 0) {
+				tokens += '\t';
+			}
+			tokens += *infile.token(i, j);
+		}
+		if (tokens != expected[i]) {
+			cerr << label << ": tokens of line " << i + 1 << " are \"" << tokens
+			     << "\" instead of \"" << expected[i] << "\"" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+//////////////////////////////
+//
+// testContents -- Read the contents in each of the three ways and check
+//     the results against the getline() split.
+//
+
+bool testContents(const string& contents, const string& label) {
+	vector<string> expected = getlineSplit(contents);
+	bool status = true;
+
+	ofstream output(tempname, ios::binary);
+	output << contents;
+	output.close();
+
+	HumdrumFile mapped;
+	mapped.read(tempname);
+	status &= compareFile(mapped, expected, label + " (file)");
+
+	HumdrumFile streamed;
+	ifstream input(tempname, ios::binary);
+	streamed.read(input);
+	status &= compareFile(streamed, expected, label + " (stream)");
+
+	HumdrumFile fromstring;
+	fromstring.readString(contents);
+	status &= compareFile(fromstring, expected, label + " (string)");
+
+	if ((mapped.isValid() != streamed.isValid()) ||
+			(mapped.isValid() != fromstring.isValid())) {
+		cerr << label << ": parse status differs" << endl;
+		status = false;
+	}
+	remove(tempname);
+	return status;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " file.krn [file.krn ...]" << endl;
+		return 1;
+	}
+	int errors = 0;
+	for (int i=1; i<argc; i++) {
+		ifstream input(argv[i], ios::binary);
+		if (!input.is_open()) {
+			cerr << "Cannot open " << argv[i] << endl;
+			errors++;
+			continue;
+		}
+		stringstream buffer;
+		buffer << input.rdbuf();
+		string contents = buffer.str();
+		string name = argv[i];
+
+		errors += !testContents(contents, name);
+
+		string crlf;
+		for (char ch : contents) {
+			if (ch == '\n') {
+				crlf += '\r';
+			}
+			crlf += ch;
+		}
+		errors += !testContents(crlf, name + " CRLF");
+
+		string nofinal = contents;
+		while ((!nofinal.empty()) && ((nofinal.back() == '\n') ||
+				(nofinal.back() == '\r'))) {
+			nofinal.pop_back();
+		}
+		errors += !testContents(nofinal, name + " without final newline");
+		errors += !testContents(nofinal + "\r\n\r\n", name + " with blank CRLF line");
+	}
+	errors += !testContents("", "empty file");
+	errors += !testContents("\n", "single newline");
+
+	if (errors) {
+		cerr << errors << " reading tests failed" << endl;
+		return 1;
+	}
+	cout << "All reading tests passed." << endl;
+	return 0;
+}
@@ -0,0 +1,71 @@
+// Description: Check that restfill fills blank measures without rhythm
+//              analysis errors.  The blank spine is renamed before the
+//              structure is analyzed, so the data type of the spine has
+//              to follow the new exclusive interpretation.
+
+#include "humlib.h"
+
+using namespace hum;
+
+bool testRestfill(const string& input, const string& expected) {
+	HumdrumFile infile;
+	infile.readStringNoRhythm(input);
+	Tool_restfill restfill;
+	restfill.run(infile);
+	if (!infile.isValid()) {
+		cerr << "Parse error: " << infile.getParseError() << endl;
+		return false;
+	}
+	stringstream output;
+	output << infile;
+	if (output.str() != expected) {
+		cerr << "Expected:\n" << expected << "but got:\n" << output.str();
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	int errors = 0;
+
+	string input4 =
+		"**kern\t**kern\n"
+		"*M4/4\t*M4/4\n"
+		"=1\t=1\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"=2\t=2\n"
+		"1c\t.\n"
+		"=3\t=3\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"*-\t*-\n";
+	string expected4 = input4;
+	expected4.replace(expected4.find("1c\t."), 4, "1c\t1r");
+	errors += !testRestfill(input4, expected4);
+
+	string input3 =
+		"**kern\t**kern\n"
+		"*M3/4\t*M3/4\n"
+		"=1\t=1\n"
+		"2.c\t.\n"
+		"=2\t=2\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"4c\t4e\n"
+		"*-\t*-\n";
+	string expected3 = input3;
+	expected3.replace(expected3.find("2.c\t."), 5, "2.c\t2.r");
+	errors += !testRestfill(input3, expected3);
+
+	if (errors) {
+		cerr << errors << " restfill test(s) failed" << endl;
+		return 1;
+	}
+	cout << "restfill tests passed" << endl;
+	return 0;
+}
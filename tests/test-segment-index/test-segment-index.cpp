@@ -0,0 +1,201 @@
+// Description: Check that reading the segments of an archive through a
+//              HumSegmentIndex (and through a saved and reloaded index)
+//              gives the same files as reading the archive sequentially
+//              with HumdrumFileStream, including archives with universal
+//              comments between the segments.  Also check that an index
+//              is not current after its archive is changed in place.
+
+#include "humlib.h"
+
+#include <cstdio>
+#include <ctime>
+#include <map>
+
+#include <utime.h>
+
+using namespace std;
+using namespace hum;
+
+static const char* archivename = "test-segment-index.tmp";
+static const char* indexname   = "test-segment-index.tmp.segidx";
+
+//////////////////////////////
+//
+// findSegment -- Return the index of the nth segment with the given
+//     name (segment names may repeat in an archive), or -1.
+//
+
+int findSegment(HumSegmentIndex& index, const string& name, int nth) {
+	for (int i=0; i<index.getSegmentCount(); i++) {
+		if (index.getSegmentName(i) != name) {
+			continue;
+		}
+		if (nth-- == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//////////////////////////////
+//
+// compareSegments -- Read the archive sequentially and compare each
+//     named file with the segment read through the index.
+//
+
+bool compareSegments(HumSegmentIndex& index, const string& label) {
+	HumdrumFileStream sequential;
+	sequential.setFileList(vector<string>(1, archivename));
+	HumdrumFile infile;
+	HumdrumFile segment;
+	bool status = true;
+	map<string, int> seen;
+	int count = 0;
+	while (sequential.read(infile)) {
+		int number = findSegment(index, infile.getFilename(),
+				seen[infile.getFilename()]++);
+		if (number < 0) {
+			// file split at a ** line without a !!!!SEGMENT: line.
+			continue;
+		}
+		count++;
+		HumdrumFileStream seekstream;
+		if (!seekstream.readSegment(segment, index, number)) {
+			cerr << label << ": cannot read segment " << infile.getFilename() << endl;
+			status = false;
+			continue;
+		}
+		stringstream expected;
+		stringstream output;
+		expected << infile;
+		output << segment;
+		if (expected.str() != output.str()) {
+			cerr << label << ": segment " << infile.getFilename() << " is\n"
+			     << output.str() << "instead of\n" << expected.str();
+			status = false;
+		}
+	}
+	if (count != index.getSegmentCount()) {
+		cerr << label << ": " << count << " named files instead of "
+		     << index.getSegmentCount() << endl;
+		status = false;
+	}
+	return status;
+}
+
+//////////////////////////////
+//
+// testArchive -- Compare sequential and indexed reading of an archive,
+//     with a new index and with an index loaded from a sidecar file.
+//
+
+bool testArchive(const string& contents, const string& label) {
+	ofstream output(archivename, ios::binary);
+	output << contents;
+	output.close();
+
+	bool status = true;
+	HumSegmentIndex index(archivename);
+	status &= compareSegments(index, label);
+
+	index.write(indexname);
+	HumSegmentIndex loaded;
+	if (!loaded.read(indexname) || !loaded.isCurrent()) {
+		cerr << label << ": cannot reload index" << endl;
+		status = false;
+	} else {
+		for (int i=0; i<index.getSegmentCount(); i++) {
+			if (loaded.getSegmentUniversals(i) != index.getSegmentUniversals(i)) {
+				cerr << label << ": universal comments of segment " << i
+				     << " not saved" << endl;
+				status = false;
+			}
+		}
+		status &= compareSegments(loaded, label + " (reloaded)");
+	}
+	remove(indexname);
+	remove(archivename);
+	return status;
+}
+
+//////////////////////////////
+//
+// testChangedArchive -- Check that an index is not current after the
+//     archive is rewritten with the same size.
+//
+
+bool testChangedArchive(void) {
+	ofstream output(archivename, ios::binary);
+	output << "!!!!SEGMENT: a\n**kern\n4c\n*-\n";
+	output.close();
+	HumSegmentIndex index(archivename);
+	bool status = index.isCurrent();
+	if (!status) {
+		cerr << "new index is not current" << endl;
+	}
+
+	output.open(archivename, ios::binary);
+	output << "!!!!SEGMENT: b\n**kern\n4d\n*-\n";
+	output.close();
+	struct utimbuf times;
+	times.actime = times.modtime = time(NULL) + 10;
+	utime(archivename, &times);
+	if (index.isCurrent()) {
+		cerr << "index is current after archive was changed" << endl;
+		status = false;
+	}
+	remove(archivename);
+	return status;
+}
+
+
+
+int main(int argc, char** argv) {
+	int errors = 0;
+
+	errors += !testArchive(
+		"!!!!COM: A\n"
+		"!!!!SEGMENT: a\n**kern\n4c\n*-\n"
+		"!!!!SEGMENT: b\n**kern\n4d\n*-\n"
+		"!!!!SEGMENT: c\n**kern\n4e\n*-\n",
+		"header only");
+
+	errors += !testArchive(
+		"!!!!SEGMENT: a\n**kern\n4c\n*-\n"
+		"!!!!SEGMENT: b\n**kern\n4d\n*-\n",
+		"no universal comments");
+
+	errors += !testArchive(
+		"!!!!COM: A\n"
+		"!!!!SEGMENT: a\n**kern\n4c\n*-\n"
+		"!!!!COM: B\n"
+		"!!!!SEGMENT: b\n**kern\n4d\n*-\n",
+		"universal comment between segments");
+
+	errors += !testArchive(
+		"!!!!COM: A\n"
+		"!!!!SEGMENT: a\n**kern\n4c\n*-\n"
+		"!!!!SEGMENT: b\n!!!!COM: B\n**kern\n4d\n*-\n"
+		"!!!!SEGMENT: c\n**kern\n4e\n*-\n",
+		"universal comment in segment");
+
+	// The file after the second **kern is not named, and its universal
+	// comment replaces the one from the start of the archive for all
+	// later files when the archive is read sequentially:
+	errors += !testArchive(
+		"!!!!COM: A\n"
+		"!!!!SEGMENT: a\n**kern\n4c\n*-\n"
+		"**kern\n!!!!COM: B\n4d\n*-\n"
+		"!!!!SEGMENT: b\n**kern\n4e\n*-\n"
+		"!!!!SEGMENT: a\n**kern\n4f\n*-\n",
+		"universal comment after unnamed file");
+
+	errors += !testChangedArchive();
+
+	if (errors) {
+		cerr << errors << " segment index tests failed" << endl;
+		return 1;
+	}
+	cout << "All segment index tests passed." << endl;
+	return 0;
+}